@@ -0,0 +1,131 @@
+#!/usr/bin/env python3
+
+# This file is part of the Soletta Project
+#
+# Copyright (C) 2015 Intel Corporation. All rights reserved.
+#
+# Redistribution and use in source and binary forms, with or without
+# modification, are permitted provided that the following conditions
+# are met:
+#
+#   * Redistributions of source code must retain the above copyright
+#     notice, this list of conditions and the following disclaimer.
+#   * Redistributions in binary form must reproduce the above copyright
+#     notice, this list of conditions and the following disclaimer in
+#     the documentation and/or other materials provided with the
+#     distribution.
+#   * Neither the name of Intel Corporation nor the names of its
+#     contributors may be used to endorse or promote products derived
+#     from this software without specific prior written permission.
+#
+# THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+# "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+# LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+# A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+# OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+# SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+# LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+# DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+# THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+# (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+# OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+# Generates the node type index read by the conffile resolver (see
+# sol-flow-resolver-conffile.c for the format), mapping each node type
+# name of the external modules to its module and type symbol.
+
+import json
+import os
+import struct
+
+MAGIC = b"SOLFTIDX"
+VERSION = 1
+HEADER_SIZE = 20
+ENTRY_SIZE = 16
+
+
+def name_hash(name):
+    # FNV-1a, must match sol_flow_name_hash()
+    h = 2166136261
+    for c in name.encode("utf-8"):
+        h ^= c
+        h = (h * 16777619) & 0xffffffff
+    return h
+
+
+def read_types(descdir, module):
+    path = os.path.join(descdir, module) + ".json"
+    if not os.path.isfile(path):
+        path = os.path.join(descdir, module.replace("_", "-")) + ".json"
+    with open(path, "r") as f:
+        definition = json.load(f)
+    for types in definition.values():
+        for t in types:
+            yield t["name"], t["symbol"]
+
+
+def build_index(entries):
+    bucket_count = 4
+    while bucket_count < len(entries) * 2:
+        bucket_count *= 2
+
+    strings = bytearray()
+    string_offsets = {}
+    strings_base = HEADER_SIZE + bucket_count * 4 + len(entries) * ENTRY_SIZE
+
+    def add_string(s):
+        if s not in string_offsets:
+            string_offsets[s] = strings_base + len(strings)
+            strings.extend(s.encode("utf-8") + b"\0")
+        return string_offsets[s]
+
+    buckets = [0] * bucket_count
+    packed_entries = bytearray()
+    for i, (name, module, symbol) in enumerate(entries):
+        h = name_hash(name)
+        b = h & (bucket_count - 1)
+        while buckets[b]:
+            b = (b + 1) & (bucket_count - 1)
+        buckets[b] = i + 1
+        packed_entries.extend(struct.pack("<4I", h, add_string(name),
+                                          add_string(module),
+                                          add_string(symbol)))
+
+    # The file always ends with a string terminator, even when empty.
+    if not strings:
+        strings.append(0)
+
+    return (MAGIC + struct.pack("<3I", VERSION, bucket_count, len(entries)) +
+            struct.pack("<%dI" % bucket_count, *buckets) +
+            bytes(packed_entries) + bytes(strings))
+
+
+if __name__ == "__main__":
+    import argparse
+    parser = argparse.ArgumentParser()
+    parser.add_argument("--modules-dir",
+                        help="Directory with the JSON descriptions of the modules",
+                        default="src/modules/flow")
+    parser.add_argument("output",
+                        help="Where to store the index")
+    parser.add_argument("modules",
+                        help="Names of the external modules to be indexed",
+                        type=str, nargs='*')
+
+    args = parser.parse_args()
+    try:
+        entries = []
+        seen = set()
+        for module in sorted(set(args.modules)):
+            for name, symbol in read_types(args.modules_dir, module):
+                if name in seen:
+                    continue
+                seen.add(name)
+                entries.append((name, module, symbol))
+
+        with open(args.output, "wb") as f:
+            f.write(build_index(entries))
+    except Exception as e:
+        if os.path.exists(args.output):
+            os.unlink(args.output)
+        raise e
@@ -34,14 +34,21 @@
 #include <dirent.h>
 #include <errno.h>
 #include <fcntl.h>
+#include <inttypes.h>
 #include <libgen.h>
 #include <limits.h>
+#include <stdarg.h>
 #include <stdio.h>
 #include <string.h>
 #include <sys/stat.h>
 #include <unistd.h>
 
+#ifdef PTHREAD
+#include <pthread.h>
+#endif
+
 #include "sol-arena.h"
+#include "sol-buffer.h"
 #include "sol-fbp.h"
 #include "sol-fbp-internal-log.h"
 #include "sol-file-reader.h"
@@ -55,21 +62,41 @@
 
 static struct {
     const char *conf_file;
-    const char *output_file;
     struct sol_ptr_vector json_files;
-    char *fbp_basename;
-    char *fbp_dirname;
+    char **files;
+    int files_count;
     bool is_subflow;
+    bool no_fusion;
+    bool no_cache;
 } args;
 
 static struct sol_arena *str_arena;
 
-static int fd;
+/* Generated code is accumulated here and written to the output file
+ * at once. */
+static struct sol_buffer output;
 
-/* In order to ensure that each generated fbp type has an unique id. */
-static unsigned int fbp_id_count;
+/* The conffile resolution keeps global state. */
+#ifdef PTHREAD
+static pthread_mutex_t conffile_lock = PTHREAD_MUTEX_INITIALIZER;
+#endif
+
+/* Each pair of FBP file and output file given in the command line is
+ * a job. Jobs share the common type store. */
+struct generator_job {
+    const char *output_file;
+    char *fbp_basename;
+    char *fbp_dirname;
+    struct sol_arena *str_arena;
+    struct sol_vector fbp_data_vector;
+    struct sol_ptr_vector file_readers;
+    /* In order to ensure that each generated fbp type has an unique id. */
+    unsigned int fbp_id_count;
+    bool failed;
+};
 
 struct fbp_data {
+    struct generator_job *job;
     struct type_description **descriptions;
     struct type_store *store;
     char *filename;
@@ -77,13 +104,109 @@ struct fbp_data {
     struct sol_fbp_graph graph;
     struct sol_vector declared_fbp_types;
     int id;
+    /* How deep in the declarations tree this fbp is, declared fbp
+     * types are resolved before the ones that declare them. */
+    uint16_t depth;
 };
 
 struct declared_fbp_type {
     char *name;
     int id;
+    uint16_t data_idx;
+};
+
+/* Packet data types that pure node types may have on their ports, and
+ * how the fused code moves them in and out of packets. */
+struct pure_data_type {
+    const char *name;
+    const char *c_type;
+    const char *packet_type;
+    const char *get_func;
+    const char *send_func;
+    bool send_by_reference;
+};
+
+static const struct pure_data_type pure_data_types[] = {
+    { "boolean", "bool", "SOL_FLOW_PACKET_TYPE_BOOLEAN",
+      "sol_flow_packet_get_boolean", "sol_flow_send_boolean_packet", false },
+    { "byte", "unsigned char", "SOL_FLOW_PACKET_TYPE_BYTE",
+      "sol_flow_packet_get_byte", "sol_flow_send_byte_packet", false },
+    { "int", "struct sol_irange", "SOL_FLOW_PACKET_TYPE_IRANGE",
+      "sol_flow_packet_get_irange", "sol_flow_send_irange_packet", true },
+    { "float", "struct sol_drange", "SOL_FLOW_PACKET_TYPE_DRANGE",
+      "sol_flow_packet_get_drange", "sol_flow_send_drange_packet", true },
+};
+
+/* Chains of pure nodes connected one-to-one are fused into a single
+ * node. For each node, 'next' is the following node in its chain and
+ * 'head' the first node of the chain (or -1 if not part of one).
+ * 'new_idx' is the index of the node in the fused graph. */
+struct fusion {
+    int *next;
+    int *head;
+    uint16_t *new_idx;
+    uint16_t node_count;
+    uint16_t chain_count;
+};
+
+static bool fused_prelude_generated;
+
+/* Specs as emitted in the generated code, kept to precompute the
+ * tables of the static flow type. The prefix is used in the names of
+ * the emitted tables. */
+struct static_tables {
+    const char *prefix;
+    uint16_t node_count;
+    uint16_t *ports_count_in;
+    uint16_t *ports_count_out;
+    struct sol_flow_static_conn_spec *conns;
+    uint16_t conn_count;
+    struct sol_vector exported_in;
+    struct sol_vector exported_out;
 };
 
+/* Set if some generated code couldn't be appended to 'output'. */
+static bool out_failed;
+
+static void out_printf(const char *fmt, ...) SOL_ATTR_PRINTF(1, 2);
+
+static void
+out_printf(const char *fmt, ...)
+{
+    va_list ap;
+    size_t avail;
+    int r;
+
+    if (out_failed)
+        return;
+
+    avail = output.reserved - output.used;
+
+    va_start(ap, fmt);
+    r = vsnprintf((char *)output.data + output.used, avail, fmt, ap);
+    va_end(ap);
+    if (r < 0)
+        goto fail;
+
+    if ((size_t)r >= avail) {
+        if (sol_buffer_ensure(&output, output.used + r + 1) < 0)
+            goto fail;
+
+        va_start(ap, fmt);
+        r = vsnprintf((char *)output.data + output.used, r + 1, fmt, ap);
+        va_end(ap);
+        if (r < 0)
+            goto fail;
+    }
+
+    output.used += r;
+    return;
+
+fail:
+    SOL_ERR("Couldn't generate code: %s", sol_util_strerrora(ENOMEM));
+    out_failed = true;
+}
+
 static void
 handle_suboptions(const struct sol_fbp_meta *meta,
     void (*handle_func)(const struct sol_fbp_meta *meta, char *option, uint16_t index, const char *fbp_file), const char *fbp_file)
@@ -94,7 +217,7 @@ handle_suboptions(const struct sol_fbp_meta *meta,
     remaining = strndupa(meta->value.data, meta->value.len);
     SOL_NULL_CHECK(remaining);
 
-    dprintf(fd, "            .%.*s = {\n", SOL_STR_SLICE_PRINT(meta->key));
+    out_printf("            .%.*s = {\n", SOL_STR_SLICE_PRINT(meta->key));
     while (remaining) {
         p = memchr(remaining, '|', strlen(remaining));
         if (p)
@@ -107,7 +230,7 @@ handle_suboptions(const struct sol_fbp_meta *meta,
         remaining = p + 1;
         i++;
     }
-    dprintf(fd, "            },\n");
+    out_printf("            },\n");
 }
 
 static void
@@ -122,7 +245,7 @@ handle_suboption_with_explicit_fields(const struct sol_fbp_meta *meta, char *opt
     }
 
     *p = '=';
-    dprintf(fd, "                .%s,\n", option);
+    out_printf("                .%s,\n", option);
 }
 
 static bool
@@ -143,7 +266,7 @@ handle_irange_drange_suboption(const struct sol_fbp_meta *meta, char *option, ui
     const char *irange_drange_fields[5] = { "val", "min", "max", "step", NULL };
 
     if (check_suboption(option, meta, fbp_file))
-        dprintf(fd, "                .%s = %s,\n", irange_drange_fields[index], option);
+        out_printf("                .%s = %s,\n", irange_drange_fields[index], option);
 }
 
 static void
@@ -153,7 +276,7 @@ handle_rgb_suboption(const struct sol_fbp_meta *meta, char *option, uint16_t ind
                                   "red_max", "green_max", "blue_max", NULL };
 
     if (check_suboption(option, meta, fbp_file))
-        dprintf(fd, "                .%s = %s,\n", rgb_fields[index], option);
+        out_printf("                .%s = %s,\n", rgb_fields[index], option);
 }
 
 static void
@@ -162,7 +285,7 @@ handle_direction_vector_suboption(const struct sol_fbp_meta *meta, char *option,
     const char *direction_vector_fields[7] = { "x", "y", "z", "min", "max", NULL };
 
     if (check_suboption(option, meta, fbp_file))
-        dprintf(fd, "                .%s = %s,\n", direction_vector_fields[index], option);
+        out_printf("                .%s = %s,\n", direction_vector_fields[index], option);
 }
 
 static bool
@@ -175,7 +298,8 @@ handle_option(const struct sol_fbp_meta *meta, struct sol_vector *options, const
         if (!sol_str_slice_str_eq(meta->key, o->name))
             continue;
 
-        if (streq(o->data_type, "int") || streq(o->data_type, "double")) {
+        if (streq(o->data_type, "int") || streq(o->data_type, "float")
+            || streq(o->data_type, "double")) {
             if (memchr(meta->value.data, ':', meta->value.len))
                 handle_suboptions(meta, handle_suboption_with_explicit_fields, fbp_file);
             else
@@ -192,12 +316,12 @@ handle_option(const struct sol_fbp_meta *meta, struct sol_vector *options, const
                 handle_suboptions(meta, handle_direction_vector_suboption, fbp_file);
         } else if (streq(o->data_type, "string")) {
             if (meta->value.data[0] == '"')
-                dprintf(fd, "            .%.*s = %.*s,\n", SOL_STR_SLICE_PRINT(meta->key), SOL_STR_SLICE_PRINT(meta->value));
+                out_printf("            .%.*s = %.*s,\n", SOL_STR_SLICE_PRINT(meta->key), SOL_STR_SLICE_PRINT(meta->value));
             else
-                dprintf(fd, "            .%.*s = \"%.*s\",\n", SOL_STR_SLICE_PRINT(meta->key), SOL_STR_SLICE_PRINT(meta->value));
+                out_printf("            .%.*s = \"%.*s\",\n", SOL_STR_SLICE_PRINT(meta->key), SOL_STR_SLICE_PRINT(meta->value));
 
         } else {
-            dprintf(fd, "            .%.*s = %.*s,\n", SOL_STR_SLICE_PRINT(meta->key), SOL_STR_SLICE_PRINT(meta->value));
+            out_printf("            .%.*s = %.*s,\n", SOL_STR_SLICE_PRINT(meta->key), SOL_STR_SLICE_PRINT(meta->value));
         }
 
         return true;
@@ -209,7 +333,7 @@ handle_option(const struct sol_fbp_meta *meta, struct sol_vector *options, const
 }
 
 static void
-handle_conffile_option(struct sol_fbp_node *n, const char *option, const char *fbp_file)
+handle_conffile_option(struct sol_arena *arena, struct sol_fbp_node *n, const char *option, const char *fbp_file)
 {
     struct sol_fbp_meta *m;
     struct sol_str_slice key_slice, value_slice;
@@ -230,8 +354,8 @@ handle_conffile_option(struct sol_fbp_node *n, const char *option, const char *f
     }
     p++;
 
-    SOL_INT_CHECK(sol_arena_slice_dup_str_n(str_arena, &key_slice, option, p - option - 1), < 0);
-    SOL_INT_CHECK(sol_arena_slice_dup_str_n(str_arena, &value_slice, p, strlen(p)), < 0);
+    SOL_INT_CHECK(sol_arena_slice_dup_str_n(arena, &key_slice, option, p - option - 1), < 0);
+    SOL_INT_CHECK(sol_arena_slice_dup_str_n(arena, &value_slice, p, strlen(p)), < 0);
 
     m = sol_vector_append(&n->meta);
     SOL_NULL_CHECK(m);
@@ -241,26 +365,35 @@ handle_conffile_option(struct sol_fbp_node *n, const char *option, const char *f
 }
 
 static const char *
-sol_fbp_generator_resolve_id(struct sol_fbp_node *n, const char *id, const char *fbp_file)
+sol_fbp_generator_resolve_id(struct sol_arena *arena, struct sol_fbp_node *n, const char *id, const char *fbp_file)
 {
-    const char *type_name;
+    const char *type_name = NULL;
     const char **opts_as_string;
     const char *const *opt;
 
+#ifdef PTHREAD
+    pthread_mutex_lock(&conffile_lock);
+#endif
+
     if (sol_conffile_resolve_path(id, &type_name, &opts_as_string, args.conf_file) < 0) {
         sol_fbp_log_print(fbp_file, n->position.line, n->position.column, "Couldn't resolve type id '%s'", id);
-        return NULL;
+        type_name = NULL;
+        goto end;
     }
 
     /* Conffile may contain options for this node type */
     for (opt = opts_as_string; *opt != NULL; opt++)
-        handle_conffile_option(n, *opt, fbp_file);
+        handle_conffile_option(arena, n, *opt, fbp_file);
 
+end:
+#ifdef PTHREAD
+    pthread_mutex_unlock(&conffile_lock);
+#endif
     return type_name;
 }
 
 static struct type_description *
-sol_fbp_generator_resolve_type(struct type_store *common_store, struct type_store *parent_store, struct sol_fbp_node *n, const char *fbp_file)
+sol_fbp_generator_resolve_type(struct sol_arena *arena, struct type_store *common_store, struct type_store *parent_store, struct sol_fbp_node *n, const char *fbp_file)
 {
     const char *type_name_as_string;
     const char *type_name;
@@ -276,7 +409,7 @@ sol_fbp_generator_resolve_type(struct type_store *common_store, struct type_stor
     if (desc)
         return desc;
 
-    type_name = sol_fbp_generator_resolve_id(n, type_name_as_string, fbp_file);
+    type_name = sol_fbp_generator_resolve_id(arena, n, type_name_as_string, fbp_file);
     if (!type_name)
         return NULL;
 
@@ -371,20 +504,20 @@ generate_options(const struct fbp_data *data)
         if (n->meta.len <= 0)
             continue;
 
-        dprintf(fd, "    static const struct %s opts%d =\n", data->descriptions[i]->options_symbol, i);
-        dprintf(fd, "        %s_OPTIONS_DEFAULTS(\n", data->descriptions[i]->symbol);
+        out_printf("    static const struct %s opts%d =\n", data->descriptions[i]->options_symbol, i);
+        out_printf("        %s_OPTIONS_DEFAULTS(\n", data->descriptions[i]->symbol);
         SOL_VECTOR_FOREACH_IDX (&n->meta, m, j) {
             if (!handle_option(m, &data->descriptions[i]->options, data->filename))
                 return EXIT_FAILURE;
         }
-        dprintf(fd, "        );\n\n");
+        out_printf("        );\n\n");
     }
 
     return true;
 }
 
 static bool
-generate_connections(const struct fbp_data *data)
+generate_connections(const struct fbp_data *data, struct static_tables *tables)
 {
     struct sol_fbp_conn *conn;
     struct sol_flow_static_conn_spec *conn_specs;
@@ -454,21 +587,36 @@ generate_connections(const struct fbp_data *data)
     qsort(conn_specs, data->graph.conns.len, sizeof(struct sol_flow_static_conn_spec),
         compare_conn_specs);
 
-    dprintf(fd, "    static const struct sol_flow_static_conn_spec conns[] = {\n");
+    out_printf("    static const struct sol_flow_static_conn_spec conns[] = {\n");
     for (i = 0; i < data->graph.conns.len; i++) {
         struct sol_flow_static_conn_spec *spec = &conn_specs[i];
-        dprintf(fd, "        { %d, %d, %d, %d },\n",
+        out_printf("        { %d, %d, %d, %d },\n",
             spec->src, spec->src_port, spec->dst, spec->dst_port);
     }
-    dprintf(fd, "        SOL_FLOW_STATIC_CONN_SPEC_GUARD\n"
+    out_printf("        SOL_FLOW_STATIC_CONN_SPEC_GUARD\n"
         "    };\n\n");
 
-    free(conn_specs);
+    tables->conns = conn_specs;
+    tables->conn_count = data->graph.conns.len;
     return true;
 }
 
 static bool
-generate_exported_port(const char *node, struct sol_vector *ports, struct sol_fbp_exported_port *e, const char *fbp_file)
+append_exported_port_spec(struct sol_vector *specs, uint16_t node, uint16_t port)
+{
+    struct sol_flow_static_port_spec *spec;
+
+    spec = sol_vector_append(specs);
+    SOL_NULL_CHECK(spec, false);
+
+    spec->node = node;
+    spec->port = port;
+    out_printf("        { %d, %d },\n", node, port);
+    return true;
+}
+
+static bool
+generate_exported_port(const char *node, struct sol_vector *ports, struct sol_fbp_exported_port *e, const char *fbp_file, struct sol_vector *specs)
 {
     struct port_description *p;
     uint16_t base;
@@ -483,7 +631,8 @@ generate_exported_port(const char *node, struct sol_vector *ports, struct sol_fb
     if (e->port_idx == -1) {
         uint16_t last = base + (p->array_size ? : 1);
         for (; base < last; base++) {
-            dprintf(fd, "        { %d, %d },\n", e->node, base);
+            if (!append_exported_port_spec(specs, e->node, base))
+                return false;
         }
     } else {
         if (e->port_idx >= p->array_size) {
@@ -492,38 +641,39 @@ generate_exported_port(const char *node, struct sol_vector *ports, struct sol_fb
                 SOL_STR_SLICE_PRINT(e->exported_name), e->port_idx, p->array_size);
             return false;
         }
-        dprintf(fd, "        { %d, %d },\n", e->node, base + e->port_idx);
+        if (!append_exported_port_spec(specs, e->node, base + e->port_idx))
+            return false;
     }
 
     return true;
 }
 
 static bool
-generate_exports(const struct fbp_data *data)
+generate_exports(const struct fbp_data *data, struct static_tables *tables)
 {
     struct sol_fbp_exported_port *e;
     struct type_description *n;
     uint16_t i;
 
     if (data->graph.exported_in_ports.len > 0) {
-        dprintf(fd, "    static const struct sol_flow_static_port_spec exported_in[] = {\n");
+        out_printf("    static const struct sol_flow_static_port_spec exported_in[] = {\n");
         SOL_VECTOR_FOREACH_IDX (&data->graph.exported_in_ports, e, i) {
             n = data->descriptions[e->node];
-            if (!generate_exported_port(n->name, &n->in_ports, e, data->filename))
+            if (!generate_exported_port(n->name, &n->in_ports, e, data->filename, &tables->exported_in))
                 return false;
         }
-        dprintf(fd, "        SOL_FLOW_STATIC_PORT_SPEC_GUARD\n"
+        out_printf("        SOL_FLOW_STATIC_PORT_SPEC_GUARD\n"
             "    };\n\n");
     }
 
     if (data->graph.exported_out_ports.len > 0) {
-        dprintf(fd, "    static const struct sol_flow_static_port_spec exported_out[] = {\n");
+        out_printf("    static const struct sol_flow_static_port_spec exported_out[] = {\n");
         SOL_VECTOR_FOREACH_IDX (&data->graph.exported_out_ports, e, i) {
             n = data->descriptions[e->node];
-            if (!generate_exported_port(n->name, &n->out_ports, e, data->filename))
+            if (!generate_exported_port(n->name, &n->out_ports, e, data->filename, &tables->exported_out))
                 return false;
         }
-        dprintf(fd, "        SOL_FLOW_STATIC_PORT_SPEC_GUARD\n"
+        out_printf("        SOL_FLOW_STATIC_PORT_SPEC_GUARD\n"
             "    };\n\n");
     }
 
@@ -538,7 +688,7 @@ generate_node_specs(const struct fbp_data *data)
     uint16_t i;
 
     SOL_VECTOR_FOREACH_IDX (&data->declared_fbp_types, dec_type, i) {
-        dprintf(fd, "    const struct sol_flow_node_type *type_%s = create_%d_%s_type();\n",
+        out_printf("    const struct sol_flow_node_type *type_%s = create_%d_%s_type();\n",
             dec_type->name, dec_type->id, dec_type->name);
     }
 
@@ -546,16 +696,16 @@ generate_node_specs(const struct fbp_data *data)
      * since sol_flow_static_new_type() doesn't copy the informations.
      * Also, we had to set NULL here and set the real value after because
      * the types are not constant values. */
-    dprintf(fd, "\n    static struct sol_flow_static_node_spec nodes[] = {\n");
+    out_printf("\n    static struct sol_flow_static_node_spec nodes[] = {\n");
     SOL_VECTOR_FOREACH_IDX (&data->graph.nodes, n, i) {
         if (n->meta.len <= 0) {
-            dprintf(fd, "        [%d] = {NULL, \"%.*s\", NULL},\n", i, SOL_STR_SLICE_PRINT(n->name));
+            out_printf("        [%d] = {NULL, \"%.*s\", NULL},\n", i, SOL_STR_SLICE_PRINT(n->name));
         } else {
-            dprintf(fd, "        [%d] = {NULL, \"%.*s\", (struct sol_flow_node_options *) &opts%d},\n",
+            out_printf("        [%d] = {NULL, \"%.*s\", (struct sol_flow_node_options *) &opts%d},\n",
                 i, SOL_STR_SLICE_PRINT(n->name), i);
         }
     }
-    dprintf(fd, "        SOL_FLOW_STATIC_NODE_SPEC_GUARD\n"
+    out_printf("        SOL_FLOW_STATIC_NODE_SPEC_GUARD\n"
         "    };\n");
 }
 
@@ -565,246 +715,1139 @@ generate_node_type_assignments(const struct fbp_data *data)
     struct declared_fbp_type *dec_type;
     uint16_t i;
 
-    dprintf(fd, "\n");
+    out_printf("\n");
 
     for (i = 0; i < data->graph.nodes.len; i++)
-        dprintf(fd, "    nodes[%d].type = %s;\n", i, data->descriptions[i]->symbol);
+        out_printf("    nodes[%d].type = %s;\n", i, data->descriptions[i]->symbol);
 
     SOL_VECTOR_FOREACH_IDX (&data->declared_fbp_types, dec_type, i) {
-        dprintf(fd, "\n    if (!type_%s)\n"
+        out_printf("\n    if (!type_%s)\n"
             "        return NULL;\n",
             dec_type->name);
     }
 }
 
 static bool
-generate_create_type_function(struct fbp_data *data)
+is_declared_fbp_type(const struct fbp_data *data, const char *name)
 {
+    struct declared_fbp_type *dec_type;
     uint16_t i;
 
-    /** Make sure to #include all the node type's headers in use. The header
-     * name is inferred on the node's module name. */
-    for (i = 0; i < (&data->graph.nodes)->len; i++) {
-        char *needle, *module;
-
-        module = data->descriptions[i]->name;
-        needle = strstr(module, "/");
-        if (needle) {
-            module = strndupa(module, strlen(module) - strlen(needle));
-        }
-
-        dprintf(fd, "#include \"%s-gen.h\"\n", module);
+    SOL_VECTOR_FOREACH_IDX (&data->declared_fbp_types, dec_type, i) {
+        if (streq(dec_type->name, name))
+            return true;
     }
 
-    dprintf(fd, "\nstatic const struct sol_flow_node_type *\n"
-        "create_%d_%s_type(void)\n"
-        "{\n",
-        data->id,
-        data->name);
+    return false;
+}
 
-    if (!generate_options(data) || !generate_connections(data) || !generate_exports(data))
-        return false;
+static uint16_t
+get_ports_count(const struct sol_vector *ports)
+{
+    const struct port_description *p;
+    uint16_t i, count = 0;
 
-    generate_node_specs(data);
+    SOL_VECTOR_FOREACH_IDX (ports, p, i) {
+        uint16_t last = p->base_port_idx + (p->array_size ? : 1);
+        if (last > count)
+            count = last;
+    }
 
-    dprintf(fd, "\n"
-        "    struct sol_flow_static_spec spec = {\n"
-        "        .api_version = %u,\n"
-        "        .nodes = nodes,\n"
-        "        .conns = conns,\n"
-        "        .exported_in = %s,\n"
-        "        .exported_out = %s,\n"
-        "    };\n",
-        SOL_FLOW_STATIC_API_VERSION,
-        data->graph.exported_in_ports.len > 0 ? "exported_in" : "NULL",
-        data->graph.exported_out_ports.len > 0 ? "exported_out" : "NULL");
+    return count;
+}
 
-    generate_node_type_assignments(data);
+static void
+generate_exported_base_conn_ids(const char *name, const struct sol_vector *specs,
+    const uint16_t *counts, const uint32_t *offsets)
+{
+    const struct sol_flow_static_port_spec *spec;
+    uint16_t i;
 
-    dprintf(fd, "\n"
-        "    return sol_flow_static_new_type(&spec);\n"
-        "}\n\n");
+    if (specs->len == 0)
+        return;
 
-    return true;
+    out_printf("    static const uint16_t %s[] = {", name);
+    SOL_VECTOR_FOREACH_IDX (specs, spec, i)
+        out_printf("%s%d", i ? ", " : " ", counts[offsets[spec->node] + spec->port]);
+    out_printf(" };\n");
 }
 
-static int
-generate(struct sol_vector *fbp_data_vector)
+/* Computes the same tables sol_flow_static_new_type() would compute
+ * at runtime from the emitted specs (see setup_conn_ids() in
+ * sol-flow-static.c), so the generated code can skip that work by
+ * using sol_flow_static_new_type_precomputed(). */
+static bool
+generate_precomputed(const struct static_tables *tables)
 {
-    struct fbp_data *data;
-    uint16_t i;
+    struct sol_flow_static_node_info *node_infos;
+    struct sol_flow_static_conn_info *conn_infos = NULL;
+    uint32_t *in_offsets = NULL, *out_offsets = NULL, in_total = 0, out_total = 0;
+    uint16_t *in_counts = NULL, *out_counts = NULL;
+    uint16_t node_count = tables->node_count, i;
+    const char *prefix = tables->prefix;
+    char name[64];
+    bool ret = false;
 
-    if (!args.is_subflow) {
-        dprintf(fd, "#include \"sol-flow.h\"\n"
-            "#include \"sol-flow-static.h\"\n"
-            "#include \"sol-mainloop.h\"\n"
-            "\n"
-            "static struct sol_flow_node *flow;\n\n");
+    node_infos = calloc(node_count, sizeof(struct sol_flow_static_node_info));
+    SOL_NULL_CHECK(node_infos, false);
+
+    if (tables->conn_count > 0) {
+        conn_infos = calloc(tables->conn_count, sizeof(struct sol_flow_static_conn_info));
+        SOL_NULL_CHECK_GOTO(conn_infos, end);
     }
 
-    SOL_VECTOR_FOREACH_REVERSE_IDX (fbp_data_vector, data, i) {
-        if (!generate_create_type_function(data)) {
-            SOL_ERR("Couldn't generate %s type function", data->name);
-            return EXIT_FAILURE;
-        }
+    in_offsets = malloc(node_count * sizeof(uint32_t));
+    SOL_NULL_CHECK_GOTO(in_offsets, end);
+    out_offsets = malloc(node_count * sizeof(uint32_t));
+    SOL_NULL_CHECK_GOTO(out_offsets, end);
+
+    for (i = 0; i < node_count; i++) {
+        node_infos[i].ports_count_in = tables->ports_count_in[i];
+        node_infos[i].ports_count_out = tables->ports_count_out[i];
+        in_offsets[i] = in_total;
+        out_offsets[i] = out_total;
+        in_total += node_infos[i].ports_count_in;
+        out_total += node_infos[i].ports_count_out;
     }
 
-    if (!args.is_subflow) {
-        dprintf(fd, "static void\n"
-            "startup(void)\n"
-            "{\n"
-            "    const struct sol_flow_node_type *type;\n\n"
-            "    type = create_0_root_type();\n"
-            "    if (!type)\n"
-            "        return;\n\n"
-            "    flow = sol_flow_node_new(NULL, NULL, type, NULL);\n"
-            "}\n\n"
-            "static void\n"
-            "shutdown(void)\n"
-            "{\n"
-            "    sol_flow_node_del(flow);\n"
-            "}\n\n"
-            "SOL_MAIN_DEFAULT(startup, shutdown);\n");
+    in_counts = calloc(in_total ? in_total : 1, sizeof(uint16_t));
+    SOL_NULL_CHECK_GOTO(in_counts, end);
+    out_counts = calloc(out_total ? out_total : 1, sizeof(uint16_t));
+    SOL_NULL_CHECK_GOTO(out_counts, end);
+
+    for (i = 0; i < tables->conn_count; i++) {
+        const struct sol_flow_static_conn_spec *spec = &tables->conns[i];
+
+        if (i == 0 || spec->src != tables->conns[i - 1].src)
+            node_infos[spec->src].first_conn_idx = i;
+
+        conn_infos[i].in_conn_id = in_counts[in_offsets[spec->dst] + spec->dst_port]++;
+        if (spec->src_port < node_infos[spec->src].ports_count_out)
+            conn_infos[i].out_conn_id = out_counts[out_offsets[spec->src] + spec->src_port]++;
     }
 
-    return EXIT_SUCCESS;
+    out_printf("\n    static const struct sol_flow_static_node_info %snode_infos[] = {\n", prefix);
+    for (i = 0; i < node_count; i++) {
+        out_printf("        { %d, %d, %d },\n", node_infos[i].first_conn_idx,
+            node_infos[i].ports_count_in, node_infos[i].ports_count_out);
+    }
+    out_printf("    };\n");
+
+    if (tables->conn_count > 0) {
+        out_printf("    static const struct sol_flow_static_conn_info %sconn_infos[] = {\n", prefix);
+        for (i = 0; i < tables->conn_count; i++) {
+            out_printf("        { %d, %d },\n",
+                conn_infos[i].out_conn_id, conn_infos[i].in_conn_id);
+        }
+        out_printf("    };\n");
+    }
+
+    snprintf(name, sizeof(name), "%sexported_in_base_conn_ids", prefix);
+    generate_exported_base_conn_ids(name, &tables->exported_in, in_counts, in_offsets);
+    snprintf(name, sizeof(name), "%sexported_out_base_conn_ids", prefix);
+    generate_exported_base_conn_ids(name, &tables->exported_out, out_counts, out_offsets);
+
+    out_printf("    static const struct sol_flow_static_precomputed %sprecomputed = {\n"
+        "        .api_version = %u,\n"
+        "        .node_count = %u,\n"
+        "        .conn_count = %u,\n"
+        "        .node_infos = %snode_infos,\n",
+        prefix, SOL_FLOW_STATIC_PRECOMPUTED_API_VERSION,
+        node_count, tables->conn_count, prefix);
+    if (tables->conn_count > 0)
+        out_printf("        .conn_infos = %sconn_infos,\n", prefix);
+    if (tables->exported_in.len > 0)
+        out_printf("        .exported_in_base_conn_ids = %sexported_in_base_conn_ids,\n", prefix);
+    if (tables->exported_out.len > 0)
+        out_printf("        .exported_out_base_conn_ids = %sexported_out_base_conn_ids,\n", prefix);
+    out_printf("    };\n");
+
+    ret = true;
+
+end:
+    free(node_infos);
+    free(conn_infos);
+    free(in_offsets);
+    free(out_offsets);
+    free(in_counts);
+    free(out_counts);
+    return ret;
 }
 
-static bool
-sol_fbp_generator_type_store_load_file(struct type_store *common_store, const char *json_file)
+static const struct pure_data_type *
+find_pure_data_type(const struct sol_vector *ports)
 {
-    struct sol_file_reader *fr = NULL;
+    const struct port_description *p;
+    uint16_t i;
 
-    fr = sol_file_reader_open(json_file);
-    if (!fr) {
-        SOL_ERR("Couldn't open json file '%s': %s\n", json_file, sol_util_strerrora(errno));
-        return false;
-    }
+    if (ports->len != 1)
+        return NULL;
 
-    if (!type_store_read_from_json(common_store, sol_file_reader_get_all(fr))) {
-        SOL_ERR("Couldn't read from json file '%s', please check its format.", json_file);
-        sol_file_reader_close(fr);
-        return false;
-    }
+    p = sol_vector_get(ports, 0);
+    if (p->array_size > 0)
+        return NULL;
 
-    sol_file_reader_close(fr);
+    for (i = 0; i < ARRAY_SIZE(pure_data_types); i++) {
+        if (streq(p->data_type, pure_data_types[i].name))
+            return &pure_data_types[i];
+    }
 
-    return true;
+    return NULL;
 }
 
 static bool
-sol_fbp_generator_type_store_load(struct type_store *common_store)
+is_exported_node(const struct fbp_data *data, uint16_t node)
 {
-    const char *file;
+    struct sol_fbp_exported_port *e;
     uint16_t i;
 
-    SOL_PTR_VECTOR_FOREACH_IDX (&args.json_files, file, i) {
-        if (!sol_fbp_generator_type_store_load_file(common_store, file))
-            return false;
+    SOL_VECTOR_FOREACH_IDX (&data->graph.exported_in_ports, e, i) {
+        if (e->node == node)
+            return true;
+    }
+    SOL_VECTOR_FOREACH_IDX (&data->graph.exported_out_ports, e, i) {
+        if (e->node == node)
+            return true;
     }
 
-    return true;
+    return false;
 }
 
-static bool handle_json_path(const char *path);
-
 static bool
-handle_json_dir(const char *path)
+is_pure_node(const struct fbp_data *data, uint16_t node)
 {
-    DIR *dp;
-    struct dirent *entry;
-    char full_path[PATH_MAX];
-    int r;
+    const struct type_description *desc = data->descriptions[node];
 
-    dp = opendir(path);
-    if (!dp)
-        return false;
+    return desc->pure && find_pure_data_type(&desc->in_ports)
+           && find_pure_data_type(&desc->out_ports)
+           && !is_exported_node(data, node);
+}
 
-    while ((entry = readdir(dp))) {
-        if (entry->d_name[0] == '.')
-            continue;
+static bool
+is_fusable_conn(const struct fbp_data *data, const struct sol_fbp_conn *conn,
+    const bool *pure, const uint16_t *in_count, const uint16_t *out_count)
+{
+    const struct port_description *src_port, *dst_port;
 
-        r = snprintf(full_path, sizeof(full_path), "%s/%s", path, entry->d_name);
-        if (r < 0 || r >= (int)sizeof(full_path)) {
-            closedir(dp);
-            return false;
-        }
+    if (conn->src == conn->dst || !pure[conn->src] || !pure[conn->dst])
+        return false;
+    if (out_count[conn->src] != 1 || in_count[conn->dst] != 1)
+        return false;
 
-        if (!handle_json_path(full_path)) {
-            closedir(dp);
-            return false;
-        }
-    }
+    src_port = sol_vector_get(&data->descriptions[conn->src]->out_ports, 0);
+    dst_port = sol_vector_get(&data->descriptions[conn->dst]->in_ports, 0);
 
-    closedir(dp);
+    /* Connections from the error port are never fused. */
+    if (!sol_str_slice_str_eq(conn->src_port, src_port->name))
+        return false;
 
-    return true;
+    return streq(src_port->data_type, dst_port->data_type);
 }
 
-static const char *
-get_file_ext(const char *file)
+static void
+fusion_clear(struct fusion *fusion)
 {
-    char *ext = strrchr(file, '.');
-
-    if (!ext)
-        ext = (char *)"";
-
-    return ext;
+    free(fusion->next);
+    free(fusion->head);
+    free(fusion->new_idx);
 }
 
 static bool
-handle_json_path(const char *path)
+fusion_init(struct fusion *fusion, const struct fbp_data *data)
 {
-    struct stat s;
-    char *dup_path;
+    struct sol_fbp_conn *conn;
+    uint16_t *in_count = NULL, *out_count = NULL, node_count = data->graph.nodes.len, i;
+    bool *pure = NULL, *has_prev = NULL, ret = false;
+
+    *fusion = (struct fusion){ .node_count = node_count };
+
+    fusion->next = malloc(node_count * sizeof(int));
+    fusion->head = malloc(node_count * sizeof(int));
+    fusion->new_idx = malloc(node_count * sizeof(uint16_t));
+    in_count = calloc(node_count, sizeof(uint16_t));
+    out_count = calloc(node_count, sizeof(uint16_t));
+    pure = calloc(node_count, sizeof(bool));
+    has_prev = calloc(node_count, sizeof(bool));
+    if (!fusion->next || !fusion->head || !fusion->new_idx || !in_count
+        || !out_count || !pure || !has_prev) {
+        SOL_WRN("Couldn't allocate memory to fuse nodes");
+        goto end;
+    }
 
-    if (stat(path, &s) != 0)
-        return false;
+    for (i = 0; i < node_count; i++) {
+        fusion->next[i] = -1;
+        fusion->head[i] = -1;
+        pure[i] = !args.no_fusion && is_pure_node(data, i);
+    }
 
-    if (S_ISDIR(s.st_mode))
-        return handle_json_dir(path);
+    SOL_VECTOR_FOREACH_IDX (&data->graph.conns, conn, i) {
+        in_count[conn->dst]++;
+        out_count[conn->src]++;
+    }
 
-    if (S_ISREG(s.st_mode) && streq(get_file_ext(path), ".json")) {
-        dup_path = sol_arena_strdup(str_arena, path);
-        SOL_NULL_CHECK(dup_path, false);
+    SOL_VECTOR_FOREACH_IDX (&data->graph.conns, conn, i) {
+        if (!is_fusable_conn(data, conn, pure, in_count, out_count))
+            continue;
+        fusion->next[conn->src] = conn->dst;
+        has_prev[conn->dst] = true;
+    }
 
-        sol_ptr_vector_append(&args.json_files, dup_path);
+    /* Walk from the chain heads, members of pure cycles have no head
+     * and are left alone. */
+    for (i = 0; i < node_count; i++) {
+        int n;
+
+        if (fusion->next[i] < 0 || has_prev[i])
+            continue;
+
+        for (n = i; n >= 0; n = fusion->next[n])
+            fusion->head[n] = i;
+        fusion->chain_count++;
     }
 
-    return true;
+    for (i = 0, node_count = 0; i < fusion->node_count; i++) {
+        if (fusion->head[i] >= 0 && fusion->head[i] != i)
+            fusion->new_idx[i] = fusion->new_idx[fusion->head[i]];
+        else
+            fusion->new_idx[i] = node_count++;
+    }
+    fusion->node_count = node_count;
+
+    ret = true;
+
+end:
+    free(in_count);
+    free(out_count);
+    free(pure);
+    free(has_prev);
+    if (!ret)
+        fusion_clear(fusion);
+    return ret;
 }
 
 static void
-print_usage(const char *program)
+generate_fused_prelude(void)
 {
-    fprintf(stderr, "usage: %s [options] [-c conf_file]"
-        "[-j json_file -j json_file ...] fbp_file output_file\n"
+    if (fused_prelude_generated)
+        return;
+    fused_prelude_generated = true;
+
+    out_printf("\n#include <errno.h>\n"
+        "#include <float.h>\n"
+        "#include <math.h>\n"
+        "#include <stdlib.h>\n"
+        "#include \"sol-flow-inspector.h\"\n"
         "\n"
-        "Generates C code from fbp_file to output_file.\n\n"
-        "Options:\n"
-        "    -s  Generate a subflow code (without includes and main).\n",
-        program);
+        "/* Node type of a chain of pure nodes fused into one. The packet\n"
+        " * types are only known at runtime, so they are set when the ports\n"
+        " * are first counted, like in the node types being fused. */\n"
+        "struct fused_node_type {\n"
+        "    struct sol_flow_node_type base;\n"
+        "    struct sol_flow_port_type_in in;\n"
+        "    struct sol_flow_port_type_out out;\n"
+        "    const struct sol_flow_packet_type **in_packet_type;\n"
+        "    const struct sol_flow_packet_type **out_packet_type;\n"
+        "};\n"
+        "\n"
+        "static void\n"
+        "fused_get_ports_counts(const struct sol_flow_node_type *type, uint16_t *ports_in_count, uint16_t *ports_out_count)\n"
+        "{\n"
+        "    struct fused_node_type *fused = (struct fused_node_type *)type;\n"
+        "\n"
+        "    if (!fused->in.packet_type) {\n"
+        "        fused->in.packet_type = *fused->in_packet_type;\n"
+        "        fused->out.packet_type = *fused->out_packet_type;\n"
+        "    }\n"
+        "\n"
+        "    if (ports_in_count)\n"
+        "        *ports_in_count = 1;\n"
+        "    if (ports_out_count)\n"
+        "        *ports_out_count = 1;\n"
+        "}\n"
+        "\n"
+        "static const struct sol_flow_port_type_in *\n"
+        "fused_get_port_in(const struct sol_flow_node_type *type, uint16_t port)\n"
+        "{\n"
+        "    return port == 0 ? &((const struct fused_node_type *)type)->in : NULL;\n"
+        "}\n"
+        "\n"
+        "static const struct sol_flow_port_type_out *\n"
+        "fused_get_port_out(const struct sol_flow_node_type *type, uint16_t port)\n"
+        "{\n"
+        "    return port == 0 ? &((const struct fused_node_type *)type)->out : NULL;\n"
+        "}\n");
 }
 
 static bool
-sol_fbp_generator_handle_args(int argc, char *argv[])
+generate_fused_step(const struct fbp_data *data, int node, uint16_t step)
 {
-    char *filename;
-    bool has_json_file = false;
-    int opt;
+    const struct type_description *desc = data->descriptions[node];
+    const struct sol_fbp_node *n = sol_vector_get(&data->graph.nodes, node);
+    const struct pure_data_type *in = find_pure_data_type(&desc->in_ports);
+    const struct pure_data_type *out = find_pure_data_type(&desc->out_ports);
+    struct sol_fbp_meta *m;
+    uint16_t i;
 
-    if (argc < 3) {
-        print_usage(argv[0]);
-        return false;
-    }
+    out_printf("\n    /* %.*s (%s) */\n"
+        "    {\n",
+        SOL_STR_SLICE_PRINT(n->name), desc->name);
+
+    if (strstr(desc->pure, "opts")) {
+        out_printf("        static const struct %s opts_value =\n"
+            "            %s_OPTIONS_DEFAULTS(\n",
+            desc->options_symbol, desc->symbol);
+        SOL_VECTOR_FOREACH_IDX (&n->meta, m, i) {
+            if (!handle_option(m, (struct sol_vector *)&desc->options, data->filename))
+                return false;
+        }
+        out_printf("            );\n"
+            "        const struct %s *opts = &opts_value;\n",
+            desc->options_symbol);
+    }
+
+    out_printf("        const %s in = v%d;\n"
+        "        %s out;\n"
+        "\n"
+        "        %s\n"
+        "        v%d = out;\n"
+        "    }\n",
+        in->c_type, step, out->c_type, desc->pure, step + 1);
+
+    return true;
+}
+
+static bool
+generate_fused_type(const struct fbp_data *data, const struct fusion *fusion, int head)
+{
+    const struct pure_data_type *in, *out;
+    uint16_t step;
+    int n, tail = head;
+
+    in = find_pure_data_type(&data->descriptions[head]->in_ports);
+
+    out_printf("\nstatic int\n"
+        "fused_%d_%d_process(struct sol_flow_node *node, void *data, uint16_t port, uint16_t conn_id, const struct sol_flow_packet *packet)\n"
+        "{\n"
+        "    %s v0;\n",
+        data->id, head, in->c_type);
+
+    for (n = head, step = 1; n >= 0; n = fusion->next[n], step++) {
+        out = find_pure_data_type(&data->descriptions[n]->out_ports);
+        out_printf("    %s v%d;\n", out->c_type, step);
+        tail = n;
+    }
+
+    out_printf("    int r;\n"
+        "\n"
+        "    r = %s(packet, &v0);\n"
+        "    if (r < 0)\n"
+        "        return r;\n",
+        in->get_func);
+
+    for (n = head, step = 0; n >= 0; n = fusion->next[n], step++) {
+        if (!generate_fused_step(data, n, step))
+            return false;
+    }
+
+    out = find_pure_data_type(&data->descriptions[tail]->out_ports);
+    out_printf("\n    return %s(node, 0, %sv%d);\n"
+        "}\n"
+        "\n"
+        "static struct fused_node_type fused_%d_%d_type = {\n"
+        "    .base = {\n"
+        "        .api_version = SOL_FLOW_NODE_TYPE_API_VERSION,\n"
+        "        .get_ports_counts = fused_get_ports_counts,\n"
+        "        .get_port_in = fused_get_port_in,\n"
+        "        .get_port_out = fused_get_port_out,\n"
+        "    },\n"
+        "    .in = {\n"
+        "        .api_version = SOL_FLOW_PORT_TYPE_IN_API_VERSION,\n"
+        "        .process = fused_%d_%d_process,\n"
+        "    },\n"
+        "    .out = {\n"
+        "        .api_version = SOL_FLOW_PORT_TYPE_OUT_API_VERSION,\n"
+        "    },\n"
+        "    .in_packet_type = &%s,\n"
+        "    .out_packet_type = &%s,\n"
+        "};\n",
+        out->send_func, out->send_by_reference ? "&" : "", step,
+        data->id, head, data->id, head, in->packet_type, out->packet_type);
+
+    return true;
+}
+
+static bool
+generate_fused_types(const struct fbp_data *data, const struct fusion *fusion)
+{
+    uint16_t i;
+
+    if (fusion->chain_count == 0)
+        return true;
+
+    generate_fused_prelude();
+
+    for (i = 0; i < data->graph.nodes.len; i++) {
+        if (fusion->head[i] != i)
+            continue;
+        if (!generate_fused_type(data, fusion, i))
+            return false;
+    }
+
+    return true;
+}
+
+/* Exported ports never belong to a chain, only their node index
+ * changes. */
+static bool
+generate_fused_exports(const char *name, struct sol_vector *fused_specs,
+    const struct sol_vector *specs, const struct fusion *fusion)
+{
+    const struct sol_flow_static_port_spec *spec;
+    uint16_t i;
+
+    if (specs->len == 0)
+        return true;
+
+    out_printf("    static const struct sol_flow_static_port_spec fused_%s[] = {\n", name);
+    SOL_VECTOR_FOREACH_IDX (specs, spec, i) {
+        if (!append_exported_port_spec(fused_specs, fusion->new_idx[spec->node], spec->port))
+            return false;
+    }
+    out_printf("        SOL_FLOW_STATIC_PORT_SPEC_GUARD\n"
+        "    };\n");
+
+    return true;
+}
+
+/* Emits the static flow spec of the graph with its pure chains fused,
+ * used unless an inspector is set, since it wouldn't see the fused
+ * nodes and their connections. */
+static bool
+generate_fused_spec(const struct fbp_data *data, const struct fusion *fusion,
+    const struct static_tables *tables)
+{
+    struct static_tables fused = {
+        .prefix = "fused_",
+        .node_count = fusion->node_count,
+    };
+    struct sol_fbp_node *n;
+    bool ret = false;
+    uint16_t i;
+
+    sol_vector_init(&fused.exported_in, sizeof(struct sol_flow_static_port_spec));
+    sol_vector_init(&fused.exported_out, sizeof(struct sol_flow_static_port_spec));
+
+    fused.ports_count_in = malloc(fusion->node_count * sizeof(uint16_t));
+    fused.ports_count_out = malloc(fusion->node_count * sizeof(uint16_t));
+    fused.conns = malloc((tables->conn_count ? : 1) * sizeof(struct sol_flow_static_conn_spec));
+    if (!fused.ports_count_in || !fused.ports_count_out || !fused.conns) {
+        SOL_WRN("Couldn't allocate memory to fuse nodes");
+        goto end;
+    }
+
+    out_printf("\n    static struct sol_flow_static_node_spec fused_nodes[] = {\n");
+    SOL_VECTOR_FOREACH_IDX (&data->graph.nodes, n, i) {
+        uint16_t idx = fusion->new_idx[i];
+        int m;
+
+        if (fusion->head[i] >= 0 && fusion->head[i] != i)
+            continue;
+
+        fused.ports_count_in[idx] = tables->ports_count_in[i];
+        fused.ports_count_out[idx] = tables->ports_count_out[i];
+
+        if (fusion->head[i] < 0) {
+            if (n->meta.len <= 0) {
+                out_printf("        [%d] = {NULL, \"%.*s\", NULL},\n", idx, SOL_STR_SLICE_PRINT(n->name));
+            } else {
+                out_printf("        [%d] = {NULL, \"%.*s\", (struct sol_flow_node_options *) &opts%d},\n",
+                    idx, SOL_STR_SLICE_PRINT(n->name), i);
+            }
+            continue;
+        }
+
+        out_printf("        [%d] = {NULL, \"", idx);
+        for (m = i; m >= 0; m = fusion->next[m]) {
+            const struct sol_fbp_node *member = sol_vector_get(&data->graph.nodes, m);
+            out_printf("%s%.*s", m == i ? "" : "+", SOL_STR_SLICE_PRINT(member->name));
+        }
+        out_printf("\", NULL},\n");
+    }
+    out_printf("        SOL_FLOW_STATIC_NODE_SPEC_GUARD\n"
+        "    };\n");
+
+    for (i = 0; i < tables->conn_count; i++) {
+        const struct sol_flow_static_conn_spec *spec = &tables->conns[i];
+
+        if (fusion->head[spec->src] >= 0 && fusion->next[spec->src] == spec->dst)
+            continue;
+
+        fused.conns[fused.conn_count] = *spec;
+        fused.conns[fused.conn_count].src = fusion->new_idx[spec->src];
+        fused.conns[fused.conn_count].dst = fusion->new_idx[spec->dst];
+        fused.conn_count++;
+    }
+
+    qsort(fused.conns, fused.conn_count, sizeof(struct sol_flow_static_conn_spec),
+        compare_conn_specs);
+
+    out_printf("    static const struct sol_flow_static_conn_spec fused_conns[] = {\n");
+    for (i = 0; i < fused.conn_count; i++) {
+        struct sol_flow_static_conn_spec *spec = &fused.conns[i];
+        out_printf("        { %d, %d, %d, %d },\n",
+            spec->src, spec->src_port, spec->dst, spec->dst_port);
+    }
+    out_printf("        SOL_FLOW_STATIC_CONN_SPEC_GUARD\n"
+        "    };\n");
+
+    if (!generate_fused_exports("exported_in", &fused.exported_in, &tables->exported_in, fusion)
+        || !generate_fused_exports("exported_out", &fused.exported_out, &tables->exported_out, fusion))
+        goto end;
+
+    if (!generate_precomputed(&fused))
+        goto end;
+
+    out_printf("\n"
+        "    struct sol_flow_static_spec fused_spec = {\n"
+        "        .api_version = %u,\n"
+        "        .nodes = fused_nodes,\n"
+        "        .conns = fused_conns,\n"
+        "        .exported_in = %s,\n"
+        "        .exported_out = %s,\n"
+        "    };\n\n",
+        SOL_FLOW_STATIC_API_VERSION,
+        tables->exported_in.len > 0 ? "fused_exported_in" : "NULL",
+        tables->exported_out.len > 0 ? "fused_exported_out" : "NULL");
+
+    for (i = 0; i < data->graph.nodes.len; i++) {
+        if (fusion->head[i] < 0) {
+            out_printf("    fused_nodes[%d].type = %s;\n",
+                fusion->new_idx[i], data->descriptions[i]->symbol);
+        } else if (fusion->head[i] == i) {
+            out_printf("    fused_nodes[%d].type = &fused_%d_%d_type.base;\n",
+                fusion->new_idx[i], data->id, i);
+        }
+    }
+
+    ret = true;
+
+end:
+    free(fused.ports_count_in);
+    free(fused.ports_count_out);
+    free(fused.conns);
+    sol_vector_clear(&fused.exported_in);
+    sol_vector_clear(&fused.exported_out);
+    return ret;
+}
+
+static bool
+generate_create_type_function(struct fbp_data *data)
+{
+    struct static_tables tables = { .prefix = "", .node_count = data->graph.nodes.len };
+    struct fusion fusion;
+    bool ret = false;
+    uint16_t i;
+
+    if (!fusion_init(&fusion, data))
+        return false;
+
+    /** Make sure to #include all the node type's headers in use. The header
+     * name is inferred on the node's module name. */
+    for (i = 0; i < (&data->graph.nodes)->len; i++) {
+        char *needle, *module;
+
+        /* declared fbp types are generated in this same file */
+        if (is_declared_fbp_type(data, data->descriptions[i]->name))
+            continue;
+
+        module = data->descriptions[i]->name;
+        needle = strstr(module, "/");
+        if (needle) {
+            module = strndupa(module, strlen(module) - strlen(needle));
+        }
+
+        out_printf("#include \"%s-gen.h\"\n", module);
+    }
+
+    if (!generate_fused_types(data, &fusion))
+        goto end;
+
+    out_printf("\nstatic const struct sol_flow_node_type *\n"
+        "create_%d_%s_type(void)\n"
+        "{\n",
+        data->id,
+        data->name);
+
+    sol_vector_init(&tables.exported_in, sizeof(struct sol_flow_static_port_spec));
+    sol_vector_init(&tables.exported_out, sizeof(struct sol_flow_static_port_spec));
+
+    tables.ports_count_in = malloc(tables.node_count * sizeof(uint16_t));
+    tables.ports_count_out = malloc(tables.node_count * sizeof(uint16_t));
+    if (!tables.ports_count_in || !tables.ports_count_out)
+        goto end;
+
+    for (i = 0; i < tables.node_count; i++) {
+        tables.ports_count_in[i] = get_ports_count(&data->descriptions[i]->in_ports);
+        tables.ports_count_out[i] = get_ports_count(&data->descriptions[i]->out_ports);
+    }
+
+    if (!generate_options(data) || !generate_connections(data, &tables) || !generate_exports(data, &tables))
+        goto end;
+
+    generate_node_specs(data);
+
+    if (!generate_precomputed(&tables))
+        goto end;
+
+    out_printf("\n"
+        "    struct sol_flow_static_spec spec = {\n"
+        "        .api_version = %u,\n"
+        "        .nodes = nodes,\n"
+        "        .conns = conns,\n"
+        "        .exported_in = %s,\n"
+        "        .exported_out = %s,\n"
+        "    };\n",
+        SOL_FLOW_STATIC_API_VERSION,
+        data->graph.exported_in_ports.len > 0 ? "exported_in" : "NULL",
+        data->graph.exported_out_ports.len > 0 ? "exported_out" : "NULL");
+
+    generate_node_type_assignments(data);
+
+    if (fusion.chain_count > 0) {
+        if (!generate_fused_spec(data, &fusion, &tables))
+            goto end;
+
+        out_printf("\n"
+            "    if (!sol_flow_get_inspector())\n"
+            "        return sol_flow_static_new_type_precomputed(&fused_spec, &fused_precomputed);\n");
+    }
+
+    out_printf("\n"
+        "    return sol_flow_static_new_type_precomputed(&spec, &precomputed);\n"
+        "}\n\n");
+
+    ret = true;
+
+end:
+    fusion_clear(&fusion);
+    free(tables.ports_count_in);
+    free(tables.ports_count_out);
+    free(tables.conns);
+    sol_vector_clear(&tables.exported_in);
+    sol_vector_clear(&tables.exported_out);
+    return ret;
+}
+
+static int
+generate(struct sol_vector *fbp_data_vector)
+{
+    struct fbp_data *data;
+    uint16_t i;
+
+    fused_prelude_generated = false;
+
+    if (!args.is_subflow) {
+        out_printf("#include \"sol-flow.h\"\n"
+            "#include \"sol-flow-static.h\"\n"
+            "#include \"sol-mainloop.h\"\n"
+            "\n"
+            "static struct sol_flow_node *flow;\n\n");
+    }
+
+    SOL_VECTOR_FOREACH_REVERSE_IDX (fbp_data_vector, data, i) {
+        if (!generate_create_type_function(data)) {
+            SOL_ERR("Couldn't generate %s type function", data->name);
+            return EXIT_FAILURE;
+        }
+    }
+
+    if (!args.is_subflow) {
+        out_printf("static void\n"
+            "startup(void)\n"
+            "{\n"
+            "    const struct sol_flow_node_type *type;\n\n"
+            "    type = create_0_root_type();\n"
+            "    if (!type)\n"
+            "        return;\n\n"
+            "    flow = sol_flow_node_new(NULL, NULL, type, NULL);\n"
+            "}\n\n"
+            "static void\n"
+            "shutdown(void)\n"
+            "{\n"
+            "    sol_flow_node_del(flow);\n"
+            "}\n\n"
+            "SOL_MAIN_DEFAULT(startup, shutdown);\n");
+    }
+
+    return EXIT_SUCCESS;
+}
+
+#define MAX_WORKER_THREADS 32
+
+struct parallel_ctx {
+    bool (*func)(void *data, uint16_t idx);
+    void *data;
+    unsigned int next;
+    uint16_t count;
+    bool failed;
+};
+
+static void *
+parallel_worker(void *data)
+{
+    struct parallel_ctx *ctx = data;
+    unsigned int idx;
+
+    while ((idx = __atomic_fetch_add(&ctx->next, 1, __ATOMIC_RELAXED)) < ctx->count) {
+        if (!ctx->func(ctx->data, idx))
+            __atomic_store_n(&ctx->failed, true, __ATOMIC_RELAXED);
+    }
+
+    return NULL;
+}
+
+/* Calls 'func' for each index in [0, count), spreading the calls over
+ * as many threads as there are CPUs online. The calling thread takes
+ * part as well, so without pthreads this is a plain loop. Returns
+ * false if any of the calls failed. */
+static bool
+run_parallel(uint16_t count, bool (*func)(void *data, uint16_t idx), void *data)
+{
+    struct parallel_ctx ctx = {
+        .func = func,
+        .data = data,
+        .count = count,
+    };
+
+#ifdef PTHREAD
+    pthread_t threads[MAX_WORKER_THREADS];
+    long n_threads, i, started = 0;
+
+    n_threads = sysconf(_SC_NPROCESSORS_ONLN);
+    if (n_threads > MAX_WORKER_THREADS)
+        n_threads = MAX_WORKER_THREADS;
+    if (n_threads > count)
+        n_threads = count;
+
+    /* If some thread can't be created, the remaining ones (at least
+     * the calling thread) take its share. */
+    for (i = 1; i < n_threads; i++) {
+        if (pthread_create(&threads[started], NULL, parallel_worker, &ctx) != 0)
+            break;
+        started++;
+    }
+
+    parallel_worker(&ctx);
+
+    for (i = 0; i < started; i++)
+        pthread_join(threads[i], NULL);
+#else
+    parallel_worker(&ctx);
+#endif
+
+    return !ctx.failed;
+}
+
+static bool
+sol_fbp_generator_type_store_load_file(struct type_store *common_store, const char *json_file,
+    struct type_store_source *source)
+{
+    struct sol_file_reader *fr = NULL;
+
+    fr = sol_file_reader_open(json_file);
+    if (!fr) {
+        SOL_ERR("Couldn't open json file '%s': %s\n", json_file, sol_util_strerrora(errno));
+        return false;
+    }
+
+    type_store_source_stamp(source, json_file, sol_file_reader_get_stat(fr),
+        sol_file_reader_get_all(fr));
+
+    if (!type_store_read_from_json(common_store, sol_file_reader_get_all(fr))) {
+        SOL_ERR("Couldn't read from json file '%s', please check its format.", json_file);
+        sol_file_reader_close(fr);
+        return false;
+    }
+
+    sol_file_reader_close(fr);
+
+    return true;
+}
+
+struct type_store_load_ctx {
+    struct type_store **stores;
+    struct type_store_source *sources;
+};
+
+static bool
+type_store_load_task(void *data, uint16_t idx)
+{
+    struct type_store_load_ctx *ctx = data;
+
+    ctx->stores[idx] = type_store_new();
+    if (!ctx->stores[idx]) {
+        SOL_ERR("Couldn't create type store.");
+        return false;
+    }
+
+    return sol_fbp_generator_type_store_load_file(ctx->stores[idx],
+        sol_ptr_vector_get(&args.json_files, idx), &ctx->sources[idx]);
+}
+
+static int
+create_dirs(const char *path)
+{
+    char *tmp, *p;
+
+    tmp = strdupa(path);
+    for (p = tmp + 1; *p; p++) {
+        if (*p != '/')
+            continue;
+        *p = '\0';
+        if (mkdir(tmp, 0700) < 0 && errno != EEXIST)
+            return -errno;
+        *p = '/';
+    }
+
+    if (mkdir(tmp, 0700) < 0 && errno != EEXIST)
+        return -errno;
+
+    return 0;
+}
+
+/* The parsed JSON files are cached in $SOL_FLOW_CACHE_DIR,
+ * $XDG_CACHE_HOME/soletta/types or $HOME/.cache/soletta/types, one
+ * file per set of JSON files. */
+static char *
+get_cache_dir(void)
+{
+    const char *dir;
+    char *path;
+    int r;
+
+    dir = getenv("SOL_FLOW_CACHE_DIR");
+    if (dir)
+        return *dir ? strdup(dir) : NULL;
+
+    dir = getenv("XDG_CACHE_HOME");
+    if (dir && *dir) {
+        r = asprintf(&path, "%s/soletta/types", dir);
+    } else {
+        dir = getenv("HOME");
+        if (!dir || !*dir)
+            return NULL;
+        r = asprintf(&path, "%s/.cache/soletta/types", dir);
+    }
+
+    return r < 0 ? NULL : path;
+}
+
+static char *
+get_cache_file(const char *cache_dir)
+{
+    char real[PATH_MAX], *path;
+    const char *file;
+    uint64_t slot = SOL_UTIL_HASH_INIT;
+    uint16_t i;
+
+    SOL_PTR_VECTOR_FOREACH_IDX (&args.json_files, file, i) {
+        if (realpath(file, real))
+            file = real;
+        slot = sol_util_hash_mem(slot, file, strlen(file) + 1);
+    }
+
+    if (asprintf(&path, "%s/%016" PRIx64 ".types", cache_dir, slot) < 0)
+        return NULL;
+
+    return path;
+}
+
+static void
+save_type_store_cache(struct type_store *common_store, const char *cache_dir,
+    const char *cache_file, const struct type_store_source *sources)
+{
+    int err;
+
+    err = create_dirs(cache_dir);
+    if (err >= 0)
+        err = type_store_write_cache(common_store, cache_file, sources,
+            sol_ptr_vector_get_len(&args.json_files));
+    if (err < 0)
+        SOL_INF("Couldn't save types cache '%s': %s", cache_file, sol_util_strerrora(-err));
+}
+
+static struct type_store *
+sol_fbp_generator_type_store_load(void)
+{
+    struct type_store_load_ctx ctx = { NULL, NULL };
+    struct type_store *common_store = NULL;
+    char *cache_dir = NULL, *cache_file = NULL;
+    uint16_t i, count = sol_ptr_vector_get_len(&args.json_files);
+    bool ret;
+
+    if (!args.no_cache) {
+        cache_dir = get_cache_dir();
+        if (cache_dir)
+            cache_file = get_cache_file(cache_dir);
+    }
+
+    if (cache_file) {
+        common_store = type_store_new_from_cache(cache_file, &args.json_files);
+        if (common_store)
+            goto end;
+    }
+
+    common_store = type_store_new();
+    if (!common_store)
+        goto end;
+
+    /* Each JSON file is read into its own store by the workers, then
+     * the stores are merged in command line order, so the first
+     * description of a type is still the one found. */
+    ctx.stores = calloc(count, sizeof(struct type_store *));
+    ctx.sources = calloc(count, sizeof(struct type_store_source));
+    if (!ctx.stores || !ctx.sources) {
+        ret = false;
+        goto fail;
+    }
+
+    ret = run_parallel(count, type_store_load_task, &ctx);
+
+    for (i = 0; i < count; i++) {
+        if (ret && !type_store_merge(common_store, ctx.stores[i])) {
+            SOL_ERR("Couldn't merge types from '%s'",
+                (const char *)sol_ptr_vector_get(&args.json_files, i));
+            ret = false;
+        }
+        if (ctx.stores[i])
+            type_store_del(ctx.stores[i]);
+    }
+
+    if (ret && cache_file)
+        save_type_store_cache(common_store, cache_dir, cache_file, ctx.sources);
+
+fail:
+    if (!ret) {
+        type_store_del(common_store);
+        common_store = NULL;
+    }
+    free(ctx.stores);
+    free(ctx.sources);
+end:
+    free(cache_file);
+    free(cache_dir);
+    return common_store;
+}
+
+static bool handle_json_path(const char *path);
+
+static bool
+handle_json_dir(const char *path)
+{
+    DIR *dp;
+    struct dirent *entry;
+    char full_path[PATH_MAX];
+    int r;
+
+    dp = opendir(path);
+    if (!dp)
+        return false;
+
+    while ((entry = readdir(dp))) {
+        if (entry->d_name[0] == '.')
+            continue;
+
+        r = snprintf(full_path, sizeof(full_path), "%s/%s", path, entry->d_name);
+        if (r < 0 || r >= (int)sizeof(full_path)) {
+            closedir(dp);
+            return false;
+        }
+
+        if (!handle_json_path(full_path)) {
+            closedir(dp);
+            return false;
+        }
+    }
+
+    closedir(dp);
+
+    return true;
+}
+
+static const char *
+get_file_ext(const char *file)
+{
+    char *ext = strrchr(file, '.');
+
+    if (!ext)
+        ext = (char *)"";
+
+    return ext;
+}
+
+static bool
+handle_json_path(const char *path)
+{
+    struct stat s;
+    char *dup_path;
+
+    if (stat(path, &s) != 0)
+        return false;
+
+    if (S_ISDIR(s.st_mode))
+        return handle_json_dir(path);
+
+    if (S_ISREG(s.st_mode) && streq(get_file_ext(path), ".json")) {
+        dup_path = sol_arena_strdup(str_arena, path);
+        SOL_NULL_CHECK(dup_path, false);
+
+        sol_ptr_vector_append(&args.json_files, dup_path);
+    }
+
+    return true;
+}
+
+static void
+print_usage(const char *program)
+{
+    fprintf(stderr, "usage: %s [options] [-c conf_file]"
+        "[-j json_file -j json_file ...] fbp_file output_file [fbp_file output_file ...]\n"
+        "\n"
+        "Generates C code from each fbp_file to the output_file following it.\n"
+        "Several independent flows may be given, sharing the loaded JSON files.\n\n"
+        "Options:\n"
+        "    -s  Generate a subflow code (without includes and main).\n"
+        "    -F  Don't fuse chains of pure nodes into a single node.\n"
+        "    -n  Don't use the cache of parsed JSON files. The cache directory is\n"
+        "        $SOL_FLOW_CACHE_DIR, $XDG_CACHE_HOME/soletta/types or\n"
+        "        $HOME/.cache/soletta/types.\n",
+        program);
+}
+
+static bool
+sol_fbp_generator_handle_args(int argc, char *argv[])
+{
+    bool has_json_file = false;
+    int opt;
+
+    if (argc < 3) {
+        print_usage(argv[0]);
+        return false;
+    }
 
     sol_ptr_vector_init(&args.json_files);
 
-    while ((opt = getopt(argc, argv, "sc:j:")) != -1) {
+    while ((opt = getopt(argc, argv, "sFnc:j:")) != -1) {
         switch (opt) {
         case 's':
             args.is_subflow = true;
             break;
+        case 'F':
+            args.no_fusion = true;
+            break;
+        case 'n':
+            args.no_cache = true;
+            break;
         case 'c':
             args.conf_file = optarg;
             break;
@@ -821,8 +1864,9 @@ sol_fbp_generator_handle_args(int argc, char *argv[])
         }
     }
 
-    if (optind != argc - 2) {
-        fprintf(stderr, "A single FBP input file and output file is required."
+    args.files_count = argc - optind;
+    if (args.files_count < 2 || args.files_count % 2 != 0 || args.files_count / 2 >= UINT16_MAX) {
+        fprintf(stderr, "Each FBP input file must be followed by its output file."
             " e.g. './sol-fbp-generator -j builtins.json simple.fbp simple-fbp.c'\n");
         return false;
     }
@@ -833,18 +1877,34 @@ sol_fbp_generator_handle_args(int argc, char *argv[])
         return false;
     }
 
-    filename = argv[optind];
-    args.output_file = argv[optind + 1];
+    args.files = argv + optind;
+
+    return true;
+}
+
+static bool
+generator_job_init(struct generator_job *job, const char *filename, const char *output_file)
+{
+    job->output_file = output_file;
+    job->fbp_id_count = 0;
+    job->failed = false;
+    sol_vector_init(&job->fbp_data_vector, sizeof(struct fbp_data));
+    sol_ptr_vector_init(&job->file_readers);
+
+    job->str_arena = sol_arena_new();
+    if (!job->str_arena) {
+        SOL_ERR("Couldn't create str arena");
+        return false;
+    }
 
-    args.fbp_basename = sol_arena_strdup(str_arena, basename(strdupa(filename)));
-    if (!args.fbp_basename) {
+    job->fbp_basename = sol_arena_strdup(job->str_arena, basename(strdupa(filename)));
+    if (!job->fbp_basename) {
         SOL_ERR("Couldn't get %s basename.", filename);
         return false;
     }
 
-    args.fbp_dirname = sol_arena_strdup(str_arena, dirname(strdupa(filename)));
-    if (!args.fbp_dirname) {
-        free(args.fbp_basename);
+    job->fbp_dirname = sol_arena_strdup(job->str_arena, dirname(strdupa(filename)));
+    if (!job->fbp_dirname) {
         SOL_ERR("Couldn't get %s dirname args.", filename);
         return false;
     }
@@ -852,6 +1912,28 @@ sol_fbp_generator_handle_args(int argc, char *argv[])
     return true;
 }
 
+static void
+generator_job_fini(struct generator_job *job)
+{
+    struct sol_file_reader *fr;
+    struct fbp_data *data;
+    uint16_t i;
+
+    SOL_VECTOR_FOREACH_IDX (&job->fbp_data_vector, data, i) {
+        free(data->descriptions);
+        if (data->store)
+            type_store_del(data->store);
+        sol_fbp_graph_fini(&data->graph);
+        sol_vector_clear(&data->declared_fbp_types);
+    }
+    sol_vector_clear(&job->fbp_data_vector);
+    SOL_PTR_VECTOR_FOREACH_IDX (&job->file_readers, fr, i)
+        sol_file_reader_close(fr);
+    sol_ptr_vector_clear(&job->file_readers);
+    if (job->str_arena)
+        sol_arena_del(job->str_arena);
+}
+
 static bool
 add_fbp_type_to_type_store(struct type_store *parent_store, struct fbp_data *data)
 {
@@ -860,10 +1942,11 @@ add_fbp_type_to_type_store(struct type_store *parent_store, struct fbp_data *dat
     struct type_description type;
     bool ret = false;
     char node_type[2048];
-    int r;
+    int r, base_port_idx;
     uint16_t i, j;
 
     type.name = data->name;
+    type.pure = NULL;
 
     r = snprintf(node_type, sizeof(node_type), "type_%s", data->name);
     if (r < 0 || r >= (int)sizeof(node_type))
@@ -874,7 +1957,11 @@ add_fbp_type_to_type_store(struct type_store *parent_store, struct fbp_data *dat
     /* useless for fbp type */
     type.options_symbol = (char *)"";
 
+    /* Each exported port takes as many ports of the fbp type as it
+     * exports from the inner node: the whole array, unless an index
+     * was given. */
     sol_vector_init(&type.in_ports, sizeof(struct port_description));
+    base_port_idx = 0;
     SOL_VECTOR_FOREACH_IDX (&data->graph.exported_in_ports, e, i) {
         p = sol_vector_append(&type.in_ports);
         SOL_NULL_CHECK_GOTO(p, fail_in_ports);
@@ -884,14 +1971,16 @@ add_fbp_type_to_type_store(struct type_store *parent_store, struct fbp_data *dat
         SOL_VECTOR_FOREACH_IDX (&data->descriptions[e->node]->in_ports, port, j) {
             if (streqn(e->port.data, port->name, e->port.len)) {
                 p->data_type = strdupa(port->data_type);
-                p->array_size = port->array_size;
-                p->base_port_idx = port->base_port_idx;
+                p->array_size = e->port_idx == -1 ? port->array_size : 0;
+                p->base_port_idx = base_port_idx;
             }
         }
         SOL_NULL_CHECK_GOTO(p->data_type, fail_in_ports);
+        base_port_idx += p->array_size ? : 1;
     }
 
     sol_vector_init(&type.out_ports, sizeof(struct port_description));
+    base_port_idx = 0;
     SOL_VECTOR_FOREACH_IDX (&data->graph.exported_out_ports, e, i) {
         p = sol_vector_append(&type.out_ports);
         SOL_NULL_CHECK_GOTO(p, fail_out_ports);
@@ -901,11 +1990,12 @@ add_fbp_type_to_type_store(struct type_store *parent_store, struct fbp_data *dat
         SOL_VECTOR_FOREACH_IDX (&data->descriptions[e->node]->out_ports, port, j) {
             if (streqn(e->port.data, port->name, e->port.len)) {
                 p->data_type = strdupa(port->data_type);
-                p->array_size = port->array_size;
-                p->base_port_idx = port->base_port_idx;
+                p->array_size = e->port_idx == -1 ? port->array_size : 0;
+                p->base_port_idx = base_port_idx;
             }
         }
         SOL_NULL_CHECK_GOTO(p->data_type, fail_out_ports);
+        base_port_idx += p->array_size ? : 1;
     }
 
     /* useless for fbp type */
@@ -933,7 +2023,8 @@ resolve_node(struct fbp_data *data, struct type_store *common_store)
         return false;
 
     SOL_VECTOR_FOREACH_IDX (&data->graph.nodes, n, i) {
-        data->descriptions[i] = sol_fbp_generator_resolve_type(common_store, data->store, n, data->filename);
+        data->descriptions[i] = sol_fbp_generator_resolve_type(data->job->str_arena,
+            common_store, data->store, n, data->filename);
         if (!data->descriptions[i])
             return false;
     }
@@ -941,9 +2032,10 @@ resolve_node(struct fbp_data *data, struct type_store *common_store)
     return true;
 }
 
+/* Parses the fbp file and, recursively, the fbp files it declares.
+ * Types are resolved later, see resolve_fbp_data(). */
 static struct fbp_data *
-create_fbp_data(struct sol_vector *fbp_data_vector, struct sol_ptr_vector *file_readers,
-    struct type_store *common_store, const char *name, const char *fbp_basename)
+create_fbp_data(struct generator_job *job, const char *name, const char *fbp_basename, uint16_t depth)
 {
     struct fbp_data *data;
     struct sol_fbp_error *fbp_error;
@@ -951,7 +2043,7 @@ create_fbp_data(struct sol_vector *fbp_data_vector, struct sol_ptr_vector *file_
     char filename[2048];
     int r;
 
-    r = snprintf(filename, sizeof(filename), "%s/%s", args.fbp_dirname, fbp_basename);
+    r = snprintf(filename, sizeof(filename), "%s/%s", job->fbp_dirname, fbp_basename);
     if (r < 0 || r >= (int)sizeof(filename)) {
         SOL_ERR("Couldn't find file '%s': %s\n", filename, sol_util_strerrora(errno));
         return NULL;
@@ -963,18 +2055,23 @@ create_fbp_data(struct sol_vector *fbp_data_vector, struct sol_ptr_vector *file_
         return NULL;
     }
 
-    if (sol_ptr_vector_append(file_readers, fr) < 0) {
+    if (sol_ptr_vector_append(&job->file_readers, fr) < 0) {
         SOL_ERR("Couldn't handle file '%s': %s\n", filename, sol_util_strerrora(errno));
         sol_file_reader_close(fr);
         return NULL;
     }
 
-    data = sol_vector_append(fbp_data_vector);
+    data = sol_vector_append(&job->fbp_data_vector);
     if (!data) {
         SOL_ERR("Couldn't create fbp data.");
         return NULL;
     }
 
+    memset(data, 0, sizeof(*data));
+    data->job = job;
+    data->depth = depth;
+    sol_vector_init(&data->declared_fbp_types, sizeof(struct declared_fbp_type));
+
     if (sol_fbp_graph_init(&data->graph) != 0) {
         SOL_ERR("Couldn't initialize graph.");
         return NULL;
@@ -993,31 +2090,29 @@ create_fbp_data(struct sol_vector *fbp_data_vector, struct sol_ptr_vector *file_
         return NULL;
     }
 
-    sol_vector_init(&data->declared_fbp_types, sizeof(struct declared_fbp_type));
-
-    data->name = sol_arena_strdup(str_arena, name);
+    data->name = sol_arena_strdup(job->str_arena, name);
     if (!data->name) {
         SOL_ERR("Couldn't create fbp data.");
         return NULL;
     }
 
-    data->filename = sol_arena_strdup(str_arena, filename);
+    data->filename = sol_arena_strdup(job->str_arena, filename);
     if (!data->filename) {
         SOL_ERR("Couldn't create fbp data.");
         return NULL;
     }
 
-    data->id = fbp_id_count++;
+    data->id = job->fbp_id_count++;
 
     if (data->graph.declarations.len > 0) {
         struct declared_fbp_type *dec_type;
         struct fbp_data *d;
         struct sol_fbp_declaration *dec;
         char *dec_file, *dec_name;
-        uint16_t i, data_idx;
+        uint16_t i, data_idx, d_idx;
 
         /* Get data index in order to use it after we handle the declarations. */
-        data_idx = fbp_data_vector->len - 1;
+        data_idx = job->fbp_data_vector.len - 1;
 
         SOL_VECTOR_FOREACH_IDX (&data->graph.declarations, dec, i) {
             if (!sol_str_slice_str_eq(dec->kind, "fbp"))
@@ -1026,18 +2121,14 @@ create_fbp_data(struct sol_vector *fbp_data_vector, struct sol_ptr_vector *file_
             dec_file = strndupa(dec->contents.data, dec->contents.len);
             dec_name = strndupa(dec->name.data, dec->name.len);
 
-            d = create_fbp_data(fbp_data_vector, file_readers, common_store, dec_name, dec_file);
+            d_idx = job->fbp_data_vector.len;
+            d = create_fbp_data(job, dec_name, dec_file, depth + 1);
             if (!d)
                 return NULL;
 
             /* We need to do this because we may have appended new data to fbp_data_vector,
              * this changes the position of data pointers since it's a sol_vector. */
-            data = sol_vector_get(fbp_data_vector, data_idx);
-
-            if (!add_fbp_type_to_type_store(data->store, d)) {
-                SOL_ERR("Couldn't create fbp data.");
-                return NULL;
-            }
+            data = sol_vector_get(&job->fbp_data_vector, data_idx);
 
             dec_type = sol_vector_append(&data->declared_fbp_types);
             if (!dec_type) {
@@ -1047,26 +2138,164 @@ create_fbp_data(struct sol_vector *fbp_data_vector, struct sol_ptr_vector *file_
 
             dec_type->name = d->name;
             dec_type->id = d->id;
+            dec_type->data_idx = d_idx;
+        }
+    }
+
+    return data;
+}
+
+/* Adds the declared fbp types, already resolved, to the store of
+ * 'data' and then resolves its nodes. */
+static bool
+resolve_fbp_data(struct fbp_data *data, struct type_store *common_store)
+{
+    struct declared_fbp_type *dec_type;
+    struct fbp_data *d;
+    uint16_t i;
+
+    SOL_VECTOR_FOREACH_IDX (&data->declared_fbp_types, dec_type, i) {
+        d = sol_vector_get(&data->job->fbp_data_vector, dec_type->data_idx);
+        if (!add_fbp_type_to_type_store(data->store, d)) {
+            SOL_ERR("Couldn't create fbp data.");
+            return false;
         }
     }
 
     if (!resolve_node(data, common_store)) {
         SOL_ERR("Failed to resolve node type.");
-        return NULL;
+        return false;
     }
 
-    return data;
+    return true;
+}
+
+struct resolve_level_ctx {
+    struct sol_ptr_vector datas;
+    struct type_store *common_store;
+};
+
+static bool
+resolve_task(void *data, uint16_t idx)
+{
+    struct resolve_level_ctx *ctx = data;
+    struct fbp_data *fbp_data = sol_ptr_vector_get(&ctx->datas, idx);
+
+    if (!resolve_fbp_data(fbp_data, ctx->common_store)) {
+        __atomic_store_n(&fbp_data->job->failed, true, __ATOMIC_RELAXED);
+        return false;
+    }
+
+    return true;
+}
+
+/* Resolves every fbp of every job. All the fbps at the same depth are
+ * independent from each other and are resolved in parallel, deepest
+ * first, so declared fbp types are ready when their parents need
+ * them. */
+static bool
+resolve_jobs(struct sol_vector *jobs, struct type_store *common_store)
+{
+    struct resolve_level_ctx ctx = { .common_store = common_store };
+    struct generator_job *job;
+    struct fbp_data *data;
+    uint16_t i, j, max_depth = 0;
+    int depth;
+    bool ret = true;
+
+    SOL_VECTOR_FOREACH_IDX (jobs, job, i) {
+        if (job->failed)
+            continue;
+        SOL_VECTOR_FOREACH_IDX (&job->fbp_data_vector, data, j) {
+            if (data->depth > max_depth)
+                max_depth = data->depth;
+        }
+    }
+
+    sol_ptr_vector_init(&ctx.datas);
+    for (depth = max_depth; depth >= 0; depth--) {
+        SOL_VECTOR_FOREACH_IDX (jobs, job, i) {
+            if (job->failed)
+                continue;
+            SOL_VECTOR_FOREACH_IDX (&job->fbp_data_vector, data, j) {
+                if (data->depth == depth && sol_ptr_vector_append(&ctx.datas, data) < 0) {
+                    SOL_ERR("Couldn't resolve fbp data.");
+                    job->failed = true;
+                }
+            }
+        }
+
+        if (!run_parallel(sol_ptr_vector_get_len(&ctx.datas), resolve_task, &ctx))
+            ret = false;
+        sol_ptr_vector_clear(&ctx.datas);
+    }
+
+    return ret;
+}
+
+static bool
+load_job_task(void *data, uint16_t idx)
+{
+    struct generator_job *job = sol_vector_get(data, idx);
+
+    if (!create_fbp_data(job, "root", job->fbp_basename, 0)) {
+        job->failed = true;
+        return false;
+    }
+
+    return true;
+}
+
+static bool
+write_output(const char *output_file)
+{
+    char temp_file[] = "sol-generated.c.tmp-XXXXXX";
+    const char *p = output.data;
+    size_t remaining = output.used;
+    ssize_t w;
+    int fd;
+
+    fd = mkostemp(temp_file, O_RDWR | O_CLOEXEC);
+    if (fd == -1) {
+        SOL_ERR("Couldn't open file to write.");
+        return false;
+    }
+
+    while (remaining > 0) {
+        w = write(fd, p, remaining);
+        if (w < 0) {
+            if (errno == EINTR)
+                continue;
+            SOL_ERR("Couldn't write to %s. %s", temp_file, sol_util_strerrora(errno));
+            goto fail;
+        }
+        p += w;
+        remaining -= w;
+    }
+
+    close(fd);
+
+    if (rename((const char *)temp_file, output_file) != 0) {
+        SOL_ERR("Couldn't write to %s. %s", output_file, sol_util_strerrora(errno));
+        goto fail_rename;
+    }
+
+    return true;
+
+fail:
+    close(fd);
+fail_rename:
+    if (remove((const char *)temp_file) != 0)
+        SOL_ERR("Couldn't remove temporary file %s. %s", temp_file, sol_util_strerrora(errno));
+    return false;
 }
 
 int
 main(int argc, char *argv[])
 {
-    struct fbp_data *data;
-    struct sol_file_reader *fr;
-    struct sol_ptr_vector file_readers;
-    struct sol_vector fbp_data_vector;
+    struct generator_job *job;
+    struct sol_vector jobs;
     struct type_store *common_store;
-    char temp_file[] = "sol-generated.c.tmp-XXXXXX";
     uint16_t i;
     uint8_t result = EXIT_FAILURE;
 
@@ -1087,51 +2316,55 @@ main(int argc, char *argv[])
         goto fail_access;
     }
 
-    common_store = type_store_new();
+    common_store = sol_fbp_generator_type_store_load();
     if (!common_store)
         goto fail_store;
-    if (!sol_fbp_generator_type_store_load(common_store))
-        goto fail_store_load;
 
-    sol_vector_init(&fbp_data_vector, sizeof(struct fbp_data));
-    sol_ptr_vector_init(&file_readers);
-    if (!create_fbp_data(&fbp_data_vector, &file_readers, common_store, "root", args.fbp_basename))
-        goto fail_data;
+    sol_vector_init(&jobs, sizeof(struct generator_job));
+    for (i = 0; i < args.files_count / 2; i++) {
+        job = sol_vector_append(&jobs);
+        if (!job) {
+            SOL_ERR("Couldn't create job for '%s'", args.files[i * 2]);
+            goto fail_jobs;
+        }
 
-    fd = mkostemp(temp_file, O_RDWR | O_CLOEXEC);
-    if (fd == -1) {
-        SOL_ERR("Couldn't open file to write.");
-        goto fail_open;
+        if (!generator_job_init(job, args.files[i * 2], args.files[i * 2 + 1]))
+            goto fail_jobs;
     }
 
-    result = generate(&fbp_data_vector);
+    result = EXIT_SUCCESS;
 
-    if (result == EXIT_SUCCESS) {
-        if (rename((const char *)temp_file, args.output_file) != 0)
-            SOL_ERR("Couldn't write to %s. %s", args.output_file, sol_util_strerrora(errno));
-    } else {
-        if (remove((const char *)temp_file) != 0)
-            SOL_ERR("Couldn't remove temporary file %s. %s", temp_file, sol_util_strerrora(errno));
-    }
+    if (!run_parallel(jobs.len, load_job_task, &jobs))
+        result = EXIT_FAILURE;
 
-    close(fd);
-fail_open:
-fail_data:
-    SOL_VECTOR_FOREACH_IDX (&fbp_data_vector, data, i) {
-        free(data->descriptions);
-        type_store_del(data->store);
-        sol_fbp_graph_fini(&data->graph);
-        sol_vector_clear(&data->declared_fbp_types);
+    if (!resolve_jobs(&jobs, common_store))
+        result = EXIT_FAILURE;
+
+    SOL_VECTOR_FOREACH_IDX (&jobs, job, i) {
+        if (job->failed)
+            continue;
+
+        output.used = 0;
+        if (generate(&job->fbp_data_vector) != EXIT_SUCCESS || out_failed) {
+            result = EXIT_FAILURE;
+            out_failed = false;
+            continue;
+        }
+
+        if (!write_output(job->output_file))
+            result = EXIT_FAILURE;
     }
-    sol_vector_clear(&fbp_data_vector);
-    SOL_PTR_VECTOR_FOREACH_IDX (&file_readers, fr, i)
-        sol_file_reader_close(fr);
-    sol_ptr_vector_clear(&file_readers);
-fail_store_load:
+
+fail_jobs:
+    SOL_VECTOR_FOREACH_IDX (&jobs, job, i)
+        generator_job_fini(job);
+    sol_vector_clear(&jobs);
+    sol_buffer_fini(&output);
     type_store_del(common_store);
 fail_store:
 fail_access:
 fail_args:
+    sol_ptr_vector_clear(&args.json_files);
     sol_arena_del(str_arena);
 fail_arena:
     sol_shutdown();
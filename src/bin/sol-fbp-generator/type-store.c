@@ -31,8 +31,13 @@
  */
 
 #include <errno.h>
+#include <fcntl.h>
 #include <stdio.h>
+#include <sys/stat.h>
+#include <unistd.h>
 
+#include "sol-buffer.h"
+#include "sol-file-reader.h"
 #include "sol-json.h"
 #include "sol-log.h"
 #include "sol-str-slice.h"
@@ -51,6 +56,15 @@ struct decoder {
 
 struct type_store {
     struct sol_vector types;
+
+    /* Set when the store was loaded from a cache: the first
+     * 'cached_count' types point into the mapped file and into the
+     * ports and options arrays below, they aren't owned by the
+     * store. */
+    struct sol_file_reader *cache;
+    struct port_description *cached_ports;
+    struct option_description *cached_options;
+    uint16_t cached_count;
 };
 
 #define CONST_SLICE(NAME, VALUE) \
@@ -59,6 +73,7 @@ struct type_store {
 CONST_SLICE(NAME_SLICE, "name");
 CONST_SLICE(SYMBOL_SLICE, "symbol");
 CONST_SLICE(OPTIONS_SYMBOL_SLICE, "options_symbol");
+CONST_SLICE(PURE_SLICE, "pure");
 CONST_SLICE(IN_PORTS_SLICE, "in_ports");
 CONST_SLICE(OUT_PORTS_SLICE, "out_ports");
 CONST_SLICE(DATA_TYPE_SLICE, "data_type");
@@ -215,6 +230,7 @@ type_description_init(struct type_description *desc)
     desc->name = NULL;
     desc->symbol = NULL;
     desc->options_symbol = NULL;
+    desc->pure = NULL;
     sol_vector_init(&desc->in_ports, sizeof(struct port_description));
     sol_vector_init(&desc->out_ports, sizeof(struct port_description));
     sol_vector_init(&desc->options, sizeof(struct option_description));
@@ -292,6 +308,7 @@ type_description_fini(struct type_description *desc)
     free(desc->name);
     free(desc->symbol);
     free(desc->options_symbol);
+    free(desc->pure);
 }
 
 static bool
@@ -745,6 +762,11 @@ read_type(struct decoder *d, struct type_description *desc)
                 return false;
             desc->options_symbol = get_string(&value);
 
+        } else if (sol_str_slice_eq(key_slice, PURE_SLICE)) {
+            if (!read_string_property_value(d, &value))
+                return false;
+            desc->pure = get_string(&value);
+
         } else if (sol_str_slice_eq(key_slice, IN_PORTS_SLICE)) {
             if (!read_ports_array(d, &desc->in_ports))
                 return false;
@@ -872,6 +894,12 @@ type_store_add_type(struct type_store *store, const struct type_description *typ
     t->options_symbol = strdup(type->options_symbol);
     SOL_NULL_CHECK_GOTO(t->options_symbol, fail_options_symbol);
 
+    t->pure = NULL;
+    if (type->pure) {
+        t->pure = strdup(type->pure);
+        SOL_NULL_CHECK_GOTO(t->pure, fail_pure);
+    }
+
     sol_vector_init(&t->in_ports, sizeof(struct port_description));
     SOL_VECTOR_FOREACH_IDX (&type->in_ports, p, i) {
         port = sol_vector_append(&t->in_ports);
@@ -960,6 +988,9 @@ fail_in_ports:
         free(p->data_type);
     }
     sol_vector_clear(&t->in_ports);
+    free(t->pure);
+fail_pure:
+    free(t->options_symbol);
 fail_options_symbol:
     free(t->symbol);
 fail_symbol:
@@ -970,6 +1001,36 @@ fail_name:
     return false;
 }
 
+bool
+type_store_merge(struct type_store *dst, struct type_store *src)
+{
+    struct type_description *desc, *t;
+    uint16_t i, j;
+
+    SOL_NULL_CHECK(dst, false);
+    SOL_NULL_CHECK(src, false);
+
+    /* Cached types don't belong to the store holding them. */
+    if (src->cache)
+        return false;
+
+    SOL_VECTOR_FOREACH_IDX (&src->types, desc, i) {
+        t = sol_vector_append(&dst->types);
+        if (!t)
+            goto fail;
+        *t = *desc;
+    }
+
+    sol_vector_clear(&src->types);
+    return true;
+
+fail:
+    /* The copies made so far are still owned by 'src'. */
+    for (j = 0; j < i; j++)
+        sol_vector_del(&dst->types, dst->types.len - 1);
+    return false;
+}
+
 void
 type_store_del(struct type_store *store)
 {
@@ -977,13 +1038,580 @@ type_store_del(struct type_store *store)
     uint16_t i;
 
     SOL_VECTOR_FOREACH_IDX (&store->types, desc, i) {
-        type_description_fini(desc);
+        if (i >= store->cached_count)
+            type_description_fini(desc);
     }
 
     sol_vector_clear(&store->types);
+    free(store->cached_ports);
+    free(store->cached_options);
+    if (store->cache)
+        sol_file_reader_close(store->cache);
     free(store);
 }
 
+/* Type store cache: the header is followed by the sources, types,
+ * ports and options tables, then by the strings area. Strings are
+ * offsets into the strings area, pointing to nul terminated strings,
+ * or TYPE_CACHE_NULL. Ports and options of a type are consecutive
+ * entries of their tables. Caches are local files, integers are in
+ * host byte order. */
+#define TYPE_CACHE_MAGIC "SOLTYPEC"
+#define TYPE_CACHE_VERSION 1
+#define TYPE_CACHE_NULL UINT32_MAX
+#define TYPE_CACHE_OPTION_VALUES 6
+
+struct type_cache_header {
+    char magic[8];
+    uint32_t version;
+    uint32_t source_count;
+    uint32_t type_count;
+    uint32_t port_count;
+    uint32_t option_count;
+    uint32_t strings_size;
+    uint64_t key;
+};
+
+struct type_cache_source {
+    uint32_t path;
+    uint32_t reserved;
+    int64_t mtime_sec;
+    int64_t mtime_nsec;
+    uint64_t size;
+    uint64_t hash;
+};
+
+struct type_cache_type {
+    uint32_t name;
+    uint32_t symbol;
+    uint32_t options_symbol;
+    uint32_t pure;
+    uint32_t in_first;
+    uint32_t in_count;
+    uint32_t out_first;
+    uint32_t out_count;
+    uint32_t options_first;
+    uint32_t options_count;
+};
+
+struct type_cache_port {
+    uint32_t name;
+    uint32_t data_type;
+    int32_t array_size;
+    int32_t base_port_idx;
+};
+
+struct type_cache_option {
+    uint32_t name;
+    uint32_t data_type;
+    uint32_t default_value_type;
+    uint32_t values[TYPE_CACHE_OPTION_VALUES];
+};
+
+struct type_cache {
+    const struct type_cache_header *header;
+    const struct type_cache_source *sources;
+    const struct type_cache_type *types;
+    const struct type_cache_port *ports;
+    const struct type_cache_option *options;
+    const char *strings;
+};
+
+static uint64_t
+type_cache_key(void)
+{
+    uint64_t hash = SOL_UTIL_HASH_INIT;
+
+    hash = sol_util_hash_mem(hash, VERSION, sizeof(VERSION));
+    return hash;
+}
+
+/* The string fields holding the default value of an option, in the
+ * order they are saved. */
+static unsigned int
+option_value_fields(struct option_description *o, char **fields[TYPE_CACHE_OPTION_VALUES])
+{
+    struct option_direction_vector_value *direction_vector;
+    struct option_range_value *range;
+    struct option_rgb_value *rgb;
+
+    switch (o->default_value_type) {
+    case OPTION_VALUE_TYPE_STRING:
+        fields[0] = &o->default_value.string;
+        return 1;
+    case OPTION_VALUE_TYPE_RANGE:
+        range = &o->default_value.range;
+        fields[0] = &range->val;
+        fields[1] = &range->min;
+        fields[2] = &range->max;
+        fields[3] = &range->step;
+        return 4;
+    case OPTION_VALUE_TYPE_RGB:
+        rgb = &o->default_value.rgb;
+        fields[0] = &rgb->red;
+        fields[1] = &rgb->red_max;
+        fields[2] = &rgb->green;
+        fields[3] = &rgb->green_max;
+        fields[4] = &rgb->blue;
+        fields[5] = &rgb->blue_max;
+        return 6;
+    case OPTION_VALUE_TYPE_DIRECTION_VECTOR:
+        direction_vector = &o->default_value.direction_vector;
+        fields[0] = &direction_vector->x;
+        fields[1] = &direction_vector->y;
+        fields[2] = &direction_vector->z;
+        fields[3] = &direction_vector->min;
+        fields[4] = &direction_vector->max;
+        return 5;
+    default:
+        return 0;
+    }
+}
+
+void
+type_store_source_stamp(struct type_store_source *source, const char *path,
+    const struct stat *st, struct sol_str_slice contents)
+{
+    source->path = path;
+    source->mtime_sec = st->st_mtim.tv_sec;
+    source->mtime_nsec = st->st_mtim.tv_nsec;
+    source->size = st->st_size;
+    source->hash = sol_util_hash_mem(SOL_UTIL_HASH_INIT, contents.data, contents.len);
+}
+
+/* A source is current if its size and mtime didn't change or, when
+ * only the mtime did (e.g. a regenerated description), if its
+ * contents still hash the same. */
+static bool
+type_cache_source_current(const struct type_cache_source *cached, const char *path)
+{
+    struct sol_file_reader *fr;
+    struct stat st;
+    uint64_t hash;
+
+    if (stat(path, &st) < 0 || (uint64_t)st.st_size != cached->size)
+        return false;
+
+    if (st.st_mtim.tv_sec == cached->mtime_sec && st.st_mtim.tv_nsec == cached->mtime_nsec)
+        return true;
+
+    fr = sol_file_reader_open(path);
+    if (!fr)
+        return false;
+
+    hash = sol_util_hash_mem(SOL_UTIL_HASH_INIT, sol_file_reader_get_all(fr).data,
+        sol_file_reader_get_all(fr).len);
+    sol_file_reader_close(fr);
+
+    return hash == cached->hash;
+}
+
+static const char *
+type_cache_str(const struct type_cache *cache, uint32_t offset, bool *valid)
+{
+    if (offset == TYPE_CACHE_NULL)
+        return NULL;
+
+    if (offset >= cache->header->strings_size) {
+        *valid = false;
+        return NULL;
+    }
+
+    return cache->strings + offset;
+}
+
+static bool
+type_cache_map(struct type_cache *cache, struct sol_str_slice contents)
+{
+    const struct type_cache_header *header;
+    uint64_t size;
+
+    if (contents.len < sizeof(*header))
+        return false;
+
+    header = (const struct type_cache_header *)contents.data;
+    if (memcmp(header->magic, TYPE_CACHE_MAGIC, sizeof(header->magic)) != 0 ||
+        header->version != TYPE_CACHE_VERSION ||
+        header->key != type_cache_key() ||
+        header->type_count >= UINT16_MAX)
+        return false;
+
+    size = sizeof(*header) +
+        (uint64_t)header->source_count * sizeof(struct type_cache_source) +
+        (uint64_t)header->type_count * sizeof(struct type_cache_type) +
+        (uint64_t)header->port_count * sizeof(struct type_cache_port) +
+        (uint64_t)header->option_count * sizeof(struct type_cache_option) +
+        header->strings_size;
+    if (size != contents.len || header->strings_size == 0 ||
+        contents.data[contents.len - 1] != '\0')
+        return false;
+
+    cache->header = header;
+    cache->sources = (const struct type_cache_source *)(header + 1);
+    cache->types = (const struct type_cache_type *)(cache->sources + header->source_count);
+    cache->ports = (const struct type_cache_port *)(cache->types + header->type_count);
+    cache->options = (const struct type_cache_option *)(cache->ports + header->port_count);
+    cache->strings = (const char *)(cache->options + header->option_count);
+    return true;
+}
+
+static bool
+type_cache_check_sources(const struct type_cache *cache, const struct sol_ptr_vector *sources)
+{
+    const char *path, *cached_path;
+    bool valid = true;
+    uint16_t i;
+
+    if (cache->header->source_count != sol_ptr_vector_get_len(sources))
+        return false;
+
+    SOL_PTR_VECTOR_FOREACH_IDX (sources, path, i) {
+        cached_path = type_cache_str(cache, cache->sources[i].path, &valid);
+        if (!valid || !cached_path || !streq(path, cached_path))
+            return false;
+        if (!type_cache_source_current(&cache->sources[i], path))
+            return false;
+    }
+
+    return true;
+}
+
+static bool
+type_cache_read_vector(struct sol_vector *vector, void *array, size_t elem_size, uint32_t first, uint32_t count, uint32_t total)
+{
+    if (first > total || count > total - first || count >= UINT16_MAX)
+        return false;
+
+    vector->data = count ? (char *)array + first * elem_size : NULL;
+    vector->len = count;
+    vector->elem_size = elem_size;
+    return true;
+}
+
+static bool
+type_cache_read(struct type_store *store, const struct type_cache *cache)
+{
+    const struct type_cache_header *header = cache->header;
+    struct type_description *desc;
+    struct port_description *port;
+    struct option_description *option;
+    char **fields[TYPE_CACHE_OPTION_VALUES];
+    unsigned int n, k;
+    bool valid = true;
+    uint32_t i;
+
+    store->cached_ports = calloc(header->port_count + 1, sizeof(struct port_description));
+    store->cached_options = calloc(header->option_count + 1, sizeof(struct option_description));
+    if (!store->cached_ports || !store->cached_options)
+        return false;
+
+    for (i = 0; i < header->port_count; i++) {
+        port = &store->cached_ports[i];
+        port->name = (char *)type_cache_str(cache, cache->ports[i].name, &valid);
+        port->data_type = (char *)type_cache_str(cache, cache->ports[i].data_type, &valid);
+        port->array_size = cache->ports[i].array_size;
+        port->base_port_idx = cache->ports[i].base_port_idx;
+    }
+
+    for (i = 0; i < header->option_count; i++) {
+        option = &store->cached_options[i];
+        option->name = (char *)type_cache_str(cache, cache->options[i].name, &valid);
+        option->data_type = (char *)type_cache_str(cache, cache->options[i].data_type, &valid);
+        option->default_value_type = cache->options[i].default_value_type;
+        if (option->default_value_type == OPTION_VALUE_TYPE_UNPARSED_JSON)
+            return false;
+
+        n = option_value_fields(option, fields);
+        for (k = 0; k < n; k++)
+            *fields[k] = (char *)type_cache_str(cache, cache->options[i].values[k], &valid);
+    }
+
+    for (i = 0; i < header->type_count; i++) {
+        const struct type_cache_type *t = &cache->types[i];
+
+        desc = sol_vector_append(&store->types);
+        if (!desc)
+            return false;
+        store->cached_count++;
+
+        desc->name = (char *)type_cache_str(cache, t->name, &valid);
+        desc->symbol = (char *)type_cache_str(cache, t->symbol, &valid);
+        desc->options_symbol = (char *)type_cache_str(cache, t->options_symbol, &valid);
+        desc->pure = (char *)type_cache_str(cache, t->pure, &valid);
+
+        if (!type_cache_read_vector(&desc->in_ports, store->cached_ports,
+            sizeof(struct port_description), t->in_first, t->in_count, header->port_count) ||
+            !type_cache_read_vector(&desc->out_ports, store->cached_ports,
+            sizeof(struct port_description), t->out_first, t->out_count, header->port_count) ||
+            !type_cache_read_vector(&desc->options, store->cached_options,
+            sizeof(struct option_description), t->options_first, t->options_count, header->option_count))
+            return false;
+
+        if (!desc->name || !desc->symbol || !desc->options_symbol)
+            return false;
+    }
+
+    return valid;
+}
+
+struct type_store *
+type_store_new_from_cache(const char *cache_file, const struct sol_ptr_vector *sources)
+{
+    struct type_store *store;
+    struct type_cache cache;
+
+    SOL_NULL_CHECK(cache_file, NULL);
+    SOL_NULL_CHECK(sources, NULL);
+
+    store = type_store_new();
+    SOL_NULL_CHECK(store, NULL);
+
+    store->cache = sol_file_reader_open(cache_file);
+    if (!store->cache)
+        goto fail;
+
+    if (!type_cache_map(&cache, sol_file_reader_get_all(store->cache)) ||
+        !type_cache_check_sources(&cache, sources) ||
+        !type_cache_read(store, &cache)) {
+        SOL_DBG("Type store cache '%s' is stale or invalid", cache_file);
+        goto fail;
+    }
+
+    return store;
+
+fail:
+    type_store_del(store);
+    return NULL;
+}
+
+static int
+type_cache_add_string(struct sol_buffer *strings, const char *str, uint32_t *offset)
+{
+    int err;
+
+    if (!str) {
+        *offset = TYPE_CACHE_NULL;
+        return 0;
+    }
+
+    *offset = strings->used;
+    err = sol_buffer_append_slice(strings, sol_str_slice_from_str(str));
+    if (err < 0)
+        return err;
+
+    /* Keep the nul appended by the buffer. */
+    strings->used++;
+    return 0;
+}
+
+static int
+type_cache_add_ports(struct sol_buffer *strings, struct sol_buffer *ports,
+    const struct sol_vector *vector, uint32_t *first, uint32_t *count)
+{
+    struct type_cache_port *cp;
+    struct port_description *p;
+    uint16_t i;
+    int err;
+
+    *first = ports->used / sizeof(struct type_cache_port);
+    *count = vector->len;
+
+    err = sol_buffer_ensure(ports, ports->used + vector->len * sizeof(struct type_cache_port));
+    if (err < 0)
+        return err;
+
+    SOL_VECTOR_FOREACH_IDX (vector, p, i) {
+        cp = (struct type_cache_port *)((char *)ports->data + ports->used);
+        cp->array_size = p->array_size;
+        cp->base_port_idx = p->base_port_idx;
+        err = type_cache_add_string(strings, p->name, &cp->name);
+        if (err < 0)
+            return err;
+        err = type_cache_add_string(strings, p->data_type, &cp->data_type);
+        if (err < 0)
+            return err;
+        ports->used += sizeof(struct type_cache_port);
+    }
+
+    return 0;
+}
+
+static int
+type_cache_add_options(struct sol_buffer *strings, struct sol_buffer *options,
+    const struct sol_vector *vector, uint32_t *first, uint32_t *count)
+{
+    struct type_cache_option *co;
+    struct option_description *o;
+    char **fields[TYPE_CACHE_OPTION_VALUES];
+    unsigned int n, k;
+    uint16_t i;
+    int err;
+
+    *first = options->used / sizeof(struct type_cache_option);
+    *count = vector->len;
+
+    err = sol_buffer_ensure(options, options->used + vector->len * sizeof(struct type_cache_option));
+    if (err < 0)
+        return err;
+
+    SOL_VECTOR_FOREACH_IDX (vector, o, i) {
+        if (o->default_value_type == OPTION_VALUE_TYPE_UNPARSED_JSON)
+            return -EINVAL;
+
+        co = (struct type_cache_option *)((char *)options->data + options->used);
+        memset(co, 0, sizeof(*co));
+        co->default_value_type = o->default_value_type;
+        err = type_cache_add_string(strings, o->name, &co->name);
+        if (err < 0)
+            return err;
+        err = type_cache_add_string(strings, o->data_type, &co->data_type);
+        if (err < 0)
+            return err;
+
+        n = option_value_fields(o, fields);
+        for (k = 0; k < n; k++) {
+            err = type_cache_add_string(strings, *fields[k], &co->values[k]);
+            if (err < 0)
+                return err;
+        }
+        options->used += sizeof(struct type_cache_option);
+    }
+
+    return 0;
+}
+
+static int
+write_all(int fd, const void *data, size_t len)
+{
+    const char *p = data;
+    ssize_t w;
+
+    while (len > 0) {
+        w = write(fd, p, len);
+        if (w < 0) {
+            if (errno == EINTR)
+                continue;
+            return -errno;
+        }
+        p += w;
+        len -= w;
+    }
+
+    return 0;
+}
+
+int
+type_store_write_cache(struct type_store *store, const char *cache_file,
+    const struct type_store_source *sources, uint16_t source_count)
+{
+    struct type_cache_header header = {
+        .magic = TYPE_CACHE_MAGIC,
+        .version = TYPE_CACHE_VERSION,
+        .key = type_cache_key(),
+    };
+    struct type_cache_source *cs = NULL;
+    struct type_cache_type *types = NULL;
+    struct sol_buffer strings = SOL_BUFFER_EMPTY;
+    struct sol_buffer ports = SOL_BUFFER_EMPTY;
+    struct sol_buffer options = SOL_BUFFER_EMPTY;
+    struct type_description *desc;
+    char *tmp_path = NULL;
+    uint16_t i;
+    int fd, err;
+
+    SOL_NULL_CHECK(store, -EINVAL);
+    SOL_NULL_CHECK(cache_file, -EINVAL);
+
+    header.source_count = source_count;
+    header.type_count = store->types.len;
+
+    cs = calloc(source_count + 1, sizeof(*cs));
+    types = calloc(store->types.len + 1, sizeof(*types));
+    if (!cs || !types) {
+        err = -ENOMEM;
+        goto end;
+    }
+
+    for (i = 0; i < source_count; i++) {
+        cs[i].mtime_sec = sources[i].mtime_sec;
+        cs[i].mtime_nsec = sources[i].mtime_nsec;
+        cs[i].size = sources[i].size;
+        cs[i].hash = sources[i].hash;
+        err = type_cache_add_string(&strings, sources[i].path, &cs[i].path);
+        if (err < 0)
+            goto end;
+    }
+
+    SOL_VECTOR_FOREACH_IDX (&store->types, desc, i) {
+        err = type_cache_add_string(&strings, desc->name, &types[i].name);
+        if (err >= 0)
+            err = type_cache_add_string(&strings, desc->symbol, &types[i].symbol);
+        if (err >= 0)
+            err = type_cache_add_string(&strings, desc->options_symbol, &types[i].options_symbol);
+        if (err >= 0)
+            err = type_cache_add_string(&strings, desc->pure, &types[i].pure);
+        if (err >= 0)
+            err = type_cache_add_ports(&strings, &ports, &desc->in_ports,
+                &types[i].in_first, &types[i].in_count);
+        if (err >= 0)
+            err = type_cache_add_ports(&strings, &ports, &desc->out_ports,
+                &types[i].out_first, &types[i].out_count);
+        if (err >= 0)
+            err = type_cache_add_options(&strings, &options, &desc->options,
+                &types[i].options_first, &types[i].options_count);
+        if (err < 0)
+            goto end;
+    }
+
+    header.port_count = ports.used / sizeof(struct type_cache_port);
+    header.option_count = options.used / sizeof(struct type_cache_option);
+    header.strings_size = strings.used;
+    if (header.strings_size == 0) {
+        err = -EINVAL;
+        goto end;
+    }
+
+    err = asprintf(&tmp_path, "%s.XXXXXX", cache_file);
+    if (err < 0) {
+        tmp_path = NULL;
+        err = -ENOMEM;
+        goto end;
+    }
+
+    fd = mkstemp(tmp_path);
+    if (fd < 0) {
+        err = -errno;
+        goto end;
+    }
+
+    err = write_all(fd, &header, sizeof(header));
+    if (err >= 0)
+        err = write_all(fd, cs, source_count * sizeof(*cs));
+    if (err >= 0)
+        err = write_all(fd, types, header.type_count * sizeof(*types));
+    if (err >= 0)
+        err = write_all(fd, ports.data, ports.used);
+    if (err >= 0)
+        err = write_all(fd, options.data, options.used);
+    if (err >= 0)
+        err = write_all(fd, strings.data, strings.used);
+    if (close(fd) < 0 && err >= 0)
+        err = -errno;
+    if (err >= 0 && rename(tmp_path, cache_file) < 0)
+        err = -errno;
+    if (err < 0)
+        unlink(tmp_path);
+
+end:
+    free(tmp_path);
+    sol_buffer_fini(&strings);
+    sol_buffer_fini(&ports);
+    sol_buffer_fini(&options);
+    free(types);
+    free(cs);
+    return err;
+}
+
 static void
 type_description_print(struct type_description *desc)
 {
@@ -994,6 +1622,8 @@ type_description_print(struct type_description *desc)
     printf("name=%s\n", desc->name);
     printf("symbol=%s\n", desc->symbol);
     printf("options_symbol=%s\n", desc->options_symbol);
+    if (desc->pure)
+        printf("pure=%s\n", desc->pure);
     printf("in_ports\n");
     SOL_VECTOR_FOREACH_IDX (&desc->in_ports, p, i) {
         printf("  %s (%s)\n", p->name, p->data_type);
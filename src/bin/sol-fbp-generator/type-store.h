@@ -30,6 +30,8 @@
  * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
  */
 
+#include <sys/stat.h>
+
 #include "sol-json.h"
 #include "sol-str-slice.h"
 #include "sol-vector.h"
@@ -98,6 +100,9 @@ struct type_description {
     char *name;
     char *symbol;
     char *options_symbol;
+    /* C statements computing 'out' from 'in' (and 'opts'), only for
+     * node types that are pure functions of their single input. */
+    char *pure;
     struct sol_vector in_ports;
     struct sol_vector out_ports;
     struct sol_vector options;
@@ -113,6 +118,35 @@ struct type_description *type_store_find(struct type_store *store, const char *n
 /* All the information of this type description will be copied. */
 bool type_store_add_type(struct type_store *store, const struct type_description *type);
 
+/* Moves all the types of 'src' to the end of 'dst', leaving 'src'
+ * empty. On failure both stores are kept as they were. */
+bool type_store_merge(struct type_store *dst, struct type_store *src);
+
 void type_store_del(struct type_store *store);
 
+/* Identity of a JSON file types were read from, recorded in the
+ * cache to tell whether it is still valid. */
+struct type_store_source {
+    const char *path;
+    int64_t mtime_sec;
+    int64_t mtime_nsec;
+    uint64_t size;
+    uint64_t hash;
+};
+
+void type_store_source_stamp(struct type_store_source *source, const char *path,
+    const struct stat *st, struct sol_str_slice contents);
+
+/* Saves all the types of the store, read from 'sources' in that
+ * order, to a binary cache file. */
+int type_store_write_cache(struct type_store *store, const char *cache_file,
+    const struct type_store_source *sources, uint16_t source_count);
+
+/* Maps a cache saved by type_store_write_cache(). Returns NULL if the
+ * file is missing or invalid, or if 'sources' (paths of the JSON
+ * files, in order) aren't the ones it was saved from or changed since
+ * then. The cached descriptions point into the mapped file and must
+ * not be modified, but more types may be added to the store. */
+struct type_store *type_store_new_from_cache(const char *cache_file, const struct sol_ptr_vector *sources);
+
 void type_store_print(struct type_store *store);
@@ -30,6 +30,7 @@
  * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
  */
 
+#include <inttypes.h>
 #include <stdio.h>
 #include "sol-flow.h"
 #include "sol-flow-inspector.h"
@@ -173,7 +174,7 @@ inspector_show_packet(const struct sol_flow_packet *packet)
     } else if (type == SOL_FLOW_PACKET_TYPE_BLOB) {
         struct sol_blob *v;
         if (sol_flow_packet_get_blob(packet, &v) == 0) {
-            fprintf(stdout, "<mem=%p|size=%zd|refcnt=%hu|type=%p|parent=%p>",
+            fprintf(stdout, "<mem=%p|size=%zd|refcnt=%" PRIu32 "|type=%p|parent=%p>",
                 v->mem, v->size, v->refcnt, v->type, v->parent);
             return;
         }
@@ -45,6 +45,7 @@ static struct {
     const char *filename;
     bool check_only;
     bool provide_sim_nodes;
+    bool watch;
 } args;
 
 static struct runner *the_runner;
@@ -60,11 +61,14 @@ usage(const char *program)
     fprintf(stderr,
         "usage: %s [options] input_file [-- flow_arg1 flow_arg2 ...]\n"
         "\n"
-        "Executes the flow described in input_file.\n\n"
+        "Executes the flow described in input_file, read from the standard\n"
+        "input if input_file is '-'.\n\n"
         "Options:\n"
         "    -c  Check syntax only. The program will exit as soon as the flow\n"
         "        is built and the syntax is verified.\n"
         "    -s  Provide simulation nodes for flows with exported ports.\n"
+        "    -w  Watch input_file and update the running flow when it\n"
+        "        changes. Nodes that didn't change keep running.\n"
 #ifdef SOL_FLOW_INSPECTOR_ENABLED
         "    -D  Debug the flow by printing connections and packets to stdout.\n"
 #endif
@@ -76,7 +80,7 @@ static bool
 parse_args(int argc, char *argv[])
 {
     int opt;
-    const char known_opts[] = "chs"
+    const char known_opts[] = "chsw"
 #ifdef SOL_FLOW_INSPECTOR_ENABLED
         "D"
 #endif
@@ -90,6 +94,9 @@ parse_args(int argc, char *argv[])
         case 's':
             args.provide_sim_nodes = true;
             break;
+        case 'w':
+            args.watch = true;
+            break;
         case 'h':
             usage(argv[0]);
             exit(EXIT_SUCCESS);
@@ -135,6 +142,9 @@ startup(void *data)
         goto end;
     }
 
+    if (args.watch && runner_watch(the_runner) < 0)
+        SOL_WRN("Couldn't watch '%s', changes won't be applied", args.filename);
+
     finished = false;
 
 end:
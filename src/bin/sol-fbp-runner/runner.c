@@ -32,11 +32,16 @@
 
 #include <errno.h>
 #include <libgen.h>
+#include <limits.h>
+#include <sys/inotify.h>
+#include <unistd.h>
 
 #include "sol-file-reader.h"
 #include "sol-flow-parser.h"
 #include "sol-flow-builder.h"
+#include "sol-flow-static.h"
 #include "sol-log.h"
+#include "sol-mainloop.h"
 #include "sol-str-slice.h"
 #include "sol-util.h"
 #include "sol-vector.h"
@@ -53,6 +58,9 @@ struct runner {
     char *basename;
     char *dirname;
 
+    struct sol_fd *watch;
+    int watch_fd;
+
     struct sol_ptr_vector file_readers;
 
     struct sol_flow_parser_client parser_client;
@@ -97,6 +105,14 @@ error:
     return err;
 }
 
+static ssize_t
+read_stdin(void *data, char *buf, size_t len)
+{
+    ssize_t n = read(STDIN_FILENO, buf, len);
+
+    return n < 0 ? -errno : n;
+}
+
 static void
 close_files(struct runner *r)
 {
@@ -274,6 +290,7 @@ runner_new(const char *filename, bool provide_sim_nodes)
     r = calloc(1, sizeof(*r));
     SOL_NULL_CHECK(r, NULL);
 
+    r->watch_fd = -1;
     sol_ptr_vector_init(&r->file_readers);
 
     r->parser_client.api_version = SOL_FLOW_PARSER_CLIENT_API_VERSION;
@@ -288,13 +305,18 @@ runner_new(const char *filename, bool provide_sim_nodes)
     r->dirname = strdup(dirname(strdupa(filename)));
     r->basename = strdup(basename(strdupa(filename)));
 
-    err = read_file(r, r->basename, &buf, &size);
-    if (err < 0) {
-        errno = -err;
-        goto error;
-    }
+    /* Generated flows may be piped in, build them as they arrive. */
+    if (streq(filename, "-")) {
+        r->root_type = sol_flow_parse_stream(r->parser, read_stdin, NULL, "stdin");
+    } else {
+        err = read_file(r, r->basename, &buf, &size);
+        if (err < 0) {
+            errno = -err;
+            goto error;
+        }
 
-    r->root_type = sol_flow_parse_buffer(r->parser, buf, size, filename);
+        r->root_type = sol_flow_parse_buffer(r->parser, buf, size, filename);
+    }
     if (!r->root_type)
         goto error;
 
@@ -324,9 +346,111 @@ runner_run(struct runner *r)
     return 0;
 }
 
+/* Nodes that didn't change in the file keep running, see
+ * sol_flow_static_update(). When simulation nodes are provided, the
+ * flow from the file is the first node of the root. */
+int
+runner_reload(struct runner *r)
+{
+    struct sol_flow_node_type *type;
+    struct sol_flow_node *flow;
+    const char *buf;
+    size_t size;
+    int err;
+
+    SOL_NULL_CHECK(r->root, -EINVAL);
+
+    if (streq(r->filename, "-"))
+        return -ENOTSUP;
+
+    err = read_file(r, r->basename, &buf, &size);
+    if (err < 0)
+        return err;
+
+    /* The parser keeps the types it returns, the old one is only
+     * released with it. */
+    type = sol_flow_parse_buffer(r->parser, buf, size, r->filename);
+    close_files(r);
+    if (!type)
+        return -EINVAL;
+
+    flow = r->builder ? sol_flow_static_get_node(r->root, 0) : r->root;
+    err = sol_flow_static_update(flow, type);
+    if (err < 0) {
+        SOL_WRN("Couldn't update flow from '%s': %s", r->filename, sol_util_strerrora(-err));
+        return err;
+    }
+
+    if (!r->builder)
+        r->root_type = type;
+
+    return 0;
+}
+
+static bool
+on_watch(void *data, int fd, unsigned int active_flags)
+{
+    struct runner *r = data;
+    char buf[sizeof(struct inotify_event) + NAME_MAX + 1] __attribute__((aligned(__alignof__(struct inotify_event))));
+    const struct inotify_event *ev;
+    bool changed = false;
+    ssize_t len;
+    char *p;
+
+    while ((len = read(fd, buf, sizeof(buf))) > 0) {
+        for (p = buf; p < buf + len; p += sizeof(*ev) + ev->len) {
+            ev = (const struct inotify_event *)p;
+            if (ev->len > 0 && streq(ev->name, r->basename))
+                changed = true;
+        }
+    }
+
+    if (changed && runner_reload(r) == 0)
+        SOL_INF("Flow updated from '%s'", r->filename);
+
+    return true;
+}
+
+/* The directory is watched, editors often replace files instead of
+ * writing to them. */
+int
+runner_watch(struct runner *r)
+{
+    int err;
+
+    if (streq(r->filename, "-"))
+        return -ENOTSUP;
+
+    r->watch_fd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+    if (r->watch_fd < 0)
+        return -errno;
+
+    if (inotify_add_watch(r->watch_fd, r->dirname, IN_CLOSE_WRITE | IN_MOVED_TO) < 0) {
+        err = -errno;
+        goto error;
+    }
+
+    r->watch = sol_fd_add(r->watch_fd, SOL_FD_FLAGS_IN, on_watch, r);
+    if (!r->watch) {
+        err = -ENOMEM;
+        goto error;
+    }
+
+    return 0;
+
+error:
+    close(r->watch_fd);
+    r->watch_fd = -1;
+    return err;
+}
+
 void
 runner_del(struct runner *r)
 {
+    if (r->watch)
+        sol_fd_del(r->watch);
+    if (r->watch_fd >= 0)
+        close(r->watch_fd);
     if (r->root)
         sol_flow_node_del(r->root);
     if (r->builder) {
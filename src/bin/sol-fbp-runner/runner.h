@@ -36,4 +36,6 @@ struct runner;
 
 struct runner *runner_new(const char *filename, bool provide_sim_nodes);
 int runner_run(struct runner *r);
+int runner_reload(struct runner *r);
+int runner_watch(struct runner *r);
 void runner_del(struct runner *r);
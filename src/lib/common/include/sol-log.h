@@ -326,6 +326,14 @@ sol_log_domain_init_level(struct sol_log_domain *domain)
  *      function name in output. Enabled by default.
  * @li @c $SOL_LOG_SHOW_LINE=[0|1] will disable or enable the line
  *       number in output. Enabled by default.
+ * @li @c $SOL_LOG_ASYNC=[0|1] will disable or enable asynchronous
+ *      output for sol_log_print_function_stderr() and
+ *      sol_log_print_function_file() if threads are enabled. Each
+ *      thread formats its messages into its own buffer, without
+ *      locks, and a writer thread outputs them in batches. Messages
+ *      are dropped (and the amount reported) if a thread's buffer is
+ *      full, messages that would abort or that are too long are
+ *      written synchronously. Disabled by default.
  *
  * @note use the SOL_LOG(), SOL_CRI(), SOL_ERR(), SOL_WRN(), SOL_INF() or
  *       SOL_DBG() macros instead of this one, it should be easier to
@@ -407,6 +415,10 @@ sol_log_print_function_stderr(void *data, const struct sol_log_domain *domain, u
  * with fopen(), it should be set as the @c "data" parameter of
  * sol_log_set_print_function().
  *
+ * If @c $SOL_LOG_ASYNC is enabled the file descriptor is written
+ * later by the writer thread, so the file must be kept open until
+ * sol_shutdown().
+ *
  * @see sol_log_set_print_function()
  */
 void sol_log_print_function_file(void *data, const struct sol_log_domain *domain, uint8_t message_level, const char *file, const char *function, int line, const char *format, va_list args);
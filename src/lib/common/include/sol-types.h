@@ -186,7 +186,7 @@ struct sol_blob {
     struct sol_blob *parent;
     void *mem;
     size_t size;
-    uint16_t refcnt;
+    uint16_t refcnt; /* atomic if PTHREAD is enabled */
 };
 
 struct sol_blob_type {
@@ -201,12 +201,61 @@ struct sol_blob_type {
  */
 extern const struct sol_blob_type *SOL_BLOB_TYPE_DEFAULT;
 
+/**
+ * Blob type that doesn't release the blob's memory.
+ *
+ * Useful for blobs pointing to static memory or to a slice of their
+ * parent's memory. The blob itself is still released with free().
+ */
+extern const struct sol_blob_type *SOL_BLOB_TYPE_NOFREE;
+
 struct sol_blob *sol_blob_new(const struct sol_blob_type *type, struct sol_blob *parent, const void *mem, size_t size);
 int sol_blob_setup(struct sol_blob *blob, const struct sol_blob_type *type, const void *mem, size_t size);
 struct sol_blob *sol_blob_ref(struct sol_blob *blob);
 void sol_blob_unref(struct sol_blob *blob);
 void sol_blob_set_parent(struct sol_blob *blob, struct sol_blob *parent);
 
+/**
+ * Pool of blobs of a fixed size.
+ *
+ * It reuses the memory of blobs that come and go often, e.g. read
+ * buffers. Blobs are released back to the pool when their last
+ * reference is gone. Getting and releasing blobs is thread safe.
+ */
+struct sol_blob_pool;
+
+/**
+ * Creates a pool of blobs.
+ *
+ * @param blob_size The size, in bytes, of the memory of each blob.
+ * @param max_free How many released blobs are kept for reuse, the
+ *        ones released beyond that are freed.
+ *
+ * @return The new pool on success, otherwise @c NULL.
+ */
+struct sol_blob_pool *sol_blob_pool_new(size_t blob_size, uint16_t max_free);
+
+/**
+ * Deletes a pool.
+ *
+ * The blobs kept for reuse are freed. Blobs still referenced may be
+ * released after this call, the pool's memory is kept until the last
+ * of them is.
+ *
+ * @param pool The pool to delete.
+ */
+void sol_blob_pool_del(struct sol_blob_pool *pool);
+
+/**
+ * Gets a blob from a pool.
+ *
+ * @param pool The pool to get the blob from.
+ *
+ * @return A blob of the pool's size, with a single reference, on
+ *         success, otherwise @c NULL. Its memory is not cleared.
+ */
+struct sol_blob *sol_blob_pool_get(struct sol_blob_pool *pool);
+
 /**
  * @}
  */
@@ -33,6 +33,10 @@
 #include <stdlib.h>
 #include <errno.h>
 
+#ifdef PTHREAD
+#include <pthread.h>
+#endif
+
 #define SOL_LOG_DOMAIN &_sol_blob_log_domain
 #include "sol-log-internal.h"
 #include "sol-macros.h"
@@ -41,6 +45,49 @@
 
 SOL_LOG_INTERNAL_DECLARE_STATIC(_sol_blob_log_domain, "blob");
 
+/* With threads, references are atomic so blobs can be shared between
+ * them, e.g. by packets crossing flow threads or blobs read by worker
+ * threads. Without them, plain operations spare small targets from
+ * atomics support code. */
+static inline bool
+refcnt_inc(uint16_t *refcnt)
+{
+#ifdef PTHREAD
+    uint16_t old = __atomic_load_n(refcnt, __ATOMIC_RELAXED);
+
+    do {
+        if (old == UINT16_MAX)
+            return false;
+    } while (!__atomic_compare_exchange_n(refcnt, &old, old + 1,
+        true, __ATOMIC_RELAXED, __ATOMIC_RELAXED));
+#else
+    if (*refcnt == UINT16_MAX)
+        return false;
+    (*refcnt)++;
+#endif
+    return true;
+}
+
+static inline uint16_t
+refcnt_get(const uint16_t *refcnt)
+{
+#ifdef PTHREAD
+    return __atomic_load_n(refcnt, __ATOMIC_RELAXED);
+#else
+    return *refcnt;
+#endif
+}
+
+static inline uint16_t
+refcnt_dec(uint16_t *refcnt)
+{
+#ifdef PTHREAD
+    return __atomic_sub_fetch(refcnt, 1, __ATOMIC_ACQ_REL);
+#else
+    return --(*refcnt);
+#endif
+}
+
 #define SOL_BLOB_CHECK(blob, ...)                        \
     do {                                                \
         if (!(blob)) {                                  \
@@ -60,7 +107,7 @@ SOL_LOG_INTERNAL_DECLARE_STATIC(_sol_blob_log_domain, "blob");
                 SOL_BLOB_TYPE_API_VERSION);           \
             return __VA_ARGS__;                         \
         }                                               \
-        if ((blob)->refcnt == 0) {                      \
+        if (refcnt_get(&(blob)->refcnt) == 0) {         \
             SOL_WRN("" # blob "(%p)->refcnt == 0",       \
                 (blob));                             \
             return __VA_ARGS__;                         \
@@ -121,10 +168,12 @@ SOL_API struct sol_blob *
 sol_blob_ref(struct sol_blob *blob)
 {
     SOL_BLOB_CHECK(blob, NULL);
-    errno = ENOMEM;
-    SOL_INT_CHECK(blob->refcnt, == UINT16_MAX, NULL);
+    if (!refcnt_inc(&blob->refcnt)) {
+        SOL_WRN("blob(%p)->refcnt == UINT16_MAX", blob);
+        errno = ENOMEM;
+        return NULL;
+    }
     errno = 0;
-    blob->refcnt++;
     return blob;
 }
 
@@ -132,8 +181,7 @@ SOL_API void
 sol_blob_unref(struct sol_blob *blob)
 {
     SOL_BLOB_CHECK(blob);
-    blob->refcnt--;
-    if (blob->refcnt > 0)
+    if (refcnt_dec(&blob->refcnt) > 0)
         return;
 
     if (blob->parent)
@@ -176,3 +224,160 @@ static const struct sol_blob_type _SOL_BLOB_TYPE_DEFAULT = {
 };
 
 SOL_API const struct sol_blob_type *SOL_BLOB_TYPE_DEFAULT = &_SOL_BLOB_TYPE_DEFAULT;
+
+static const struct sol_blob_type _SOL_BLOB_TYPE_NOFREE = {
+    .api_version = SOL_BLOB_TYPE_API_VERSION,
+    .sub_api = 0,
+    .free = NULL,
+};
+
+SOL_API const struct sol_blob_type *SOL_BLOB_TYPE_NOFREE = &_SOL_BLOB_TYPE_NOFREE;
+
+struct sol_blob_pool {
+    struct sol_blob_type type;
+    struct pool_blob *free_list;
+    size_t blob_size;
+    unsigned int outstanding;
+    uint16_t free_count;
+    uint16_t max_free;
+    bool deleted;
+#ifdef PTHREAD
+    pthread_mutex_t lock;
+#endif
+};
+
+/* Blob memory follows the struct. */
+struct pool_blob {
+    struct sol_blob base;
+    struct pool_blob *next;
+};
+
+static inline void
+pool_lock(struct sol_blob_pool *pool)
+{
+#ifdef PTHREAD
+    pthread_mutex_lock(&pool->lock);
+#endif
+}
+
+static inline void
+pool_unlock(struct sol_blob_pool *pool)
+{
+#ifdef PTHREAD
+    pthread_mutex_unlock(&pool->lock);
+#endif
+}
+
+static void
+pool_destroy(struct sol_blob_pool *pool)
+{
+    while (pool->free_list) {
+        struct pool_blob *item = pool->free_list;
+
+        pool->free_list = item->next;
+        free(item);
+    }
+
+#ifdef PTHREAD
+    pthread_mutex_destroy(&pool->lock);
+#endif
+    free(pool);
+}
+
+static void
+pool_blob_free(struct sol_blob *blob)
+{
+    /* type is the first member of the pool */
+    struct sol_blob_pool *pool = (struct sol_blob_pool *)blob->type;
+    struct pool_blob *item = (struct pool_blob *)blob;
+    bool done;
+
+    pool_lock(pool);
+    if (!pool->deleted && pool->free_count < pool->max_free) {
+        item->next = pool->free_list;
+        pool->free_list = item;
+        pool->free_count++;
+        item = NULL;
+    }
+    pool->outstanding--;
+    done = pool->deleted && !pool->outstanding;
+    pool_unlock(pool);
+
+    free(item);
+    if (done)
+        pool_destroy(pool);
+}
+
+SOL_API struct sol_blob_pool *
+sol_blob_pool_new(size_t blob_size, uint16_t max_free)
+{
+    struct sol_blob_pool *pool;
+
+    pool = calloc(1, sizeof(*pool));
+    SOL_NULL_CHECK(pool, NULL);
+
+#ifdef PTHREAD
+    if (pthread_mutex_init(&pool->lock, NULL) != 0) {
+        free(pool);
+        errno = ENOMEM;
+        return NULL;
+    }
+#endif
+
+    pool->type.api_version = SOL_BLOB_TYPE_API_VERSION;
+    pool->type.free = pool_blob_free;
+    pool->blob_size = blob_size;
+    pool->max_free = max_free;
+
+    return pool;
+}
+
+SOL_API void
+sol_blob_pool_del(struct sol_blob_pool *pool)
+{
+    bool done;
+
+    SOL_NULL_CHECK(pool);
+
+    pool_lock(pool);
+    pool->deleted = true;
+    done = !pool->outstanding;
+    pool_unlock(pool);
+
+    /* Otherwise the last blob released destroys it. */
+    if (done)
+        pool_destroy(pool);
+}
+
+SOL_API struct sol_blob *
+sol_blob_pool_get(struct sol_blob_pool *pool)
+{
+    struct pool_blob *item;
+
+    SOL_NULL_CHECK(pool, NULL);
+
+    pool_lock(pool);
+    item = pool->free_list;
+    if (item) {
+        pool->free_list = item->next;
+        pool->free_count--;
+    }
+    pool->outstanding++;
+    pool_unlock(pool);
+
+    if (!item) {
+        item = malloc(sizeof(*item) + pool->blob_size);
+        if (!item) {
+            pool_lock(pool);
+            pool->outstanding--;
+            pool_unlock(pool);
+            errno = ENOMEM;
+            return NULL;
+        }
+    }
+
+    item->base.parent = NULL;
+    sol_blob_setup(&item->base, &pool->type, item + 1, pool->blob_size);
+
+    return &item->base;
+}
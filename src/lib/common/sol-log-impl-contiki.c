@@ -58,6 +58,12 @@ sol_log_impl_unlock(void)
 {
 }
 
+bool
+sol_log_impl_print_needs_lock(void (*print)(void *data, const struct sol_log_domain *domain, uint8_t message_level, const char *file, const char *function, int line, const char *format, va_list args))
+{
+    return true;
+}
+
 void
 sol_log_impl_domain_init_level(struct sol_log_domain *domain)
 {
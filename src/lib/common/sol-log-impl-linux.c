@@ -32,6 +32,8 @@
 
 #include <ctype.h>
 #include <errno.h>
+#include <inttypes.h>
+#include <signal.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
@@ -51,9 +53,51 @@ static struct sol_str_table *_env_levels = NULL;
 static char *_env_levels_str = NULL;
 
 #ifdef PTHREAD
+#include <fcntl.h>
+#include <limits.h>
 #include <pthread.h>
+#include <sys/uio.h>
 static pthread_t _main_thread;
 static pthread_mutex_t _mutex = PTHREAD_MUTEX_INITIALIZER;
+
+/* Asynchronous logging ($SOL_LOG_ASYNC=1): every thread formats its
+ * messages into its own single-producer/single-consumer ring, so
+ * logging threads never share a lock. A writer thread is woken through
+ * a pipe (at most once per batch) and drains all rings with writev().
+ * When a ring is full the message is dropped and accounted, the writer
+ * reports the amount of dropped messages.
+ */
+#define ASYNC_RING_SIZE (64 * 1024)
+#define ASYNC_LINE_MAX 2048
+#define ASYNC_IOV_MAX 64
+#define ASYNC_ALIGN(x) (((x) + 7) & ~(size_t)7)
+
+struct async_record {
+    uint32_t len; /* UINT32_MAX marks wrap around */
+    int32_t fd;
+};
+
+struct async_ring {
+    struct async_ring *next;
+    size_t head; /* written by producer */
+    size_t tail; /* written by consumer */
+    uint64_t dropped; /* written by producer */
+    uint64_t dropped_reported; /* written by consumer */
+    bool in_use;
+    char line[ASYNC_LINE_MAX];
+    char buf[ASYNC_RING_SIZE] __attribute__((aligned(8)));
+};
+
+static bool _async = false;
+static bool _async_running = false;
+static bool _async_quit;
+static bool _async_notified;
+static int _async_pipe[2] = { -1, -1 };
+static pthread_t _async_writer;
+static pthread_key_t _async_key;
+static pthread_mutex_t _async_drain_mutex = PTHREAD_MUTEX_INITIALIZER;
+static struct async_ring *_async_rings;
+static pthread_once_t _async_once = PTHREAD_ONCE_INIT;
 #endif
 
 static bool
@@ -313,6 +357,9 @@ _kcmdline_parse_var(const char *start, size_t len)
         SPEC("SHOW_FILE", &_show_file, _bool_parse_wrapper),
         SPEC("SHOW_FUNCTION", &_show_function, _bool_parse_wrapper),
         SPEC("SHOW_LINE", &_show_line, _bool_parse_wrapper),
+#ifdef PTHREAD
+        SPEC("ASYNC", &_async, _bool_parse_wrapper),
+#endif
 #undef SPEC
     };
     const struct spec *itr, *itr_end;
@@ -373,6 +420,468 @@ _kcmdline_load(void)
     return 0;
 }
 
+#ifdef PTHREAD
+static bool
+_async_append(char *buf, size_t size, size_t *len, const char *fmt, ...)
+{
+    va_list ap;
+    int r;
+
+    va_start(ap, fmt);
+    r = vsnprintf(buf + *len, size - *len, fmt, ap);
+    va_end(ap);
+    if (r < 0 || (size_t)r >= size - *len)
+        return false;
+    *len += r;
+    return true;
+}
+
+/* same layout as the synchronous stderr and file print functions,
+ * returns the line length or -1 if it does not fit @a size */
+static ssize_t
+_async_format(char *buf, size_t size, bool use_colors, const char *thread_prefix, const struct sol_log_domain *domain, uint8_t message_level, const char *file, const char *function, int line, const char *format, va_list args)
+{
+    const char *name = domain->name ? domain->name : "";
+    const char *level_color = "", *reset_color = "", *address_color = "",
+    *domain_color = "";
+    char level_str[4] = { 0 };
+    size_t len = 0, format_len;
+    int errno_bkp = errno;
+    int r;
+
+    sol_log_level_to_str(message_level, level_str, sizeof(level_str));
+
+    if (use_colors) {
+        level_color = sol_log_get_level_color(message_level);
+        reset_color = SOL_LOG_COLOR_RESET;
+        address_color = SOL_LOG_COLOR_HIGH;
+        domain_color = domain->color ? domain->color : "";
+    }
+
+    if (_main_thread != pthread_self() &&
+        !_async_append(buf, size, &len, "%s%lu ", thread_prefix, pthread_self()))
+        return -1;
+
+    if (_show_file && _show_function && _show_line) {
+        if (!_async_append(buf, size, &len, "%s%s%s:%s%s%s %s%s:%d %s()%s ",
+            level_color, level_str, reset_color,
+            domain_color, name, reset_color,
+            address_color, file, line, function, reset_color))
+            return -1;
+    } else {
+        if (!_async_append(buf, size, &len, "%s%s%s:%s%s%s ",
+            level_color, level_str, reset_color,
+            domain_color, name, reset_color))
+            return -1;
+
+        if (_show_file || _show_line || _show_function) {
+            if (!_async_append(buf, size, &len, "%s", address_color))
+                return -1;
+        }
+
+        if (_show_file && !_async_append(buf, size, &len, "%s", file))
+            return -1;
+        if (_show_file && _show_line && !_async_append(buf, size, &len, ":"))
+            return -1;
+        if (_show_line && !_async_append(buf, size, &len, "%d", line))
+            return -1;
+
+        if ((_show_file || _show_line) &&
+            !_async_append(buf, size, &len, " "))
+            return -1;
+
+        if (_show_function &&
+            !_async_append(buf, size, &len, "%s() ", function))
+            return -1;
+
+        if (_show_file || _show_line || _show_function) {
+            if (!_async_append(buf, size, &len, "%s", reset_color))
+                return -1;
+        }
+    }
+
+    errno = errno_bkp;
+    r = vsnprintf(buf + len, size - len, format, args);
+    if (r < 0 || (size_t)r >= size - len)
+        return -1;
+    len += r;
+
+    format_len = strlen(format);
+    if (format_len > 0 && format[format_len - 1] != '\n') {
+        if (len + 1 >= size)
+            return -1;
+        buf[len++] = '\n';
+    }
+
+    return len;
+}
+
+static bool
+_async_push(struct async_ring *ring, int fd, const char *data, size_t len)
+{
+    struct async_record *rec;
+    size_t need = ASYNC_ALIGN(sizeof(*rec) + len);
+    size_t head = ring->head;
+    size_t tail = __atomic_load_n(&ring->tail, __ATOMIC_ACQUIRE);
+    size_t off = head % ASYNC_RING_SIZE;
+    size_t skip = 0;
+
+    /* records are never split, skip the ring's end if it is too short */
+    if (ASYNC_RING_SIZE - off < need)
+        skip = ASYNC_RING_SIZE - off;
+
+    if (head + skip + need - tail > ASYNC_RING_SIZE) {
+        __atomic_store_n(&ring->dropped, ring->dropped + 1, __ATOMIC_RELAXED);
+        return false;
+    }
+
+    if (skip) {
+        rec = (struct async_record *)(ring->buf + off);
+        rec->len = UINT32_MAX;
+        head += skip;
+        off = 0;
+    }
+
+    rec = (struct async_record *)(ring->buf + off);
+    rec->len = len;
+    rec->fd = fd;
+    memcpy(rec + 1, data, len);
+
+    /* pairs with the writer clearing _async_notified before draining */
+    __atomic_store_n(&ring->head, head + need, __ATOMIC_SEQ_CST);
+    return true;
+}
+
+static void
+_async_notify(void)
+{
+    char tok = 'w';
+    ssize_t r;
+
+    if (__atomic_test_and_set(&_async_notified, __ATOMIC_SEQ_CST))
+        return;
+
+    do {
+        r = write(_async_pipe[1], &tok, sizeof(tok));
+    } while (r < 0 && errno == EINTR);
+}
+
+static void
+_async_writev(int fd, struct iovec *iov, int count)
+{
+    while (count > 0) {
+        ssize_t r = writev(fd, iov, count);
+
+        if (r < 0) {
+            if (errno == EINTR)
+                continue;
+            return;
+        }
+
+        while (count > 0 && (size_t)r >= iov->iov_len) {
+            r -= iov->iov_len;
+            iov++;
+            count--;
+        }
+        if (count > 0) {
+            iov->iov_base = (char *)iov->iov_base + r;
+            iov->iov_len -= r;
+        }
+    }
+}
+
+struct async_batch {
+    struct iovec iov[ASYNC_IOV_MAX];
+    int fd[ASYNC_IOV_MAX];
+    unsigned int count;
+};
+
+static void
+_async_batch_flush(struct async_batch *batch)
+{
+    unsigned int i, j;
+
+    /* one writev() per run of records going to the same fd */
+    for (i = 0; i < batch->count; i = j) {
+        for (j = i + 1; j < batch->count; j++) {
+            if (batch->fd[j] != batch->fd[i])
+                break;
+        }
+        _async_writev(batch->fd[i], batch->iov + i, j - i);
+    }
+    batch->count = 0;
+}
+
+static void
+_async_dropped_report(struct async_ring *ring)
+{
+    uint64_t dropped = __atomic_load_n(&ring->dropped, __ATOMIC_RELAXED);
+    char msg[128];
+    int len;
+
+    if (dropped == ring->dropped_reported)
+        return;
+
+    len = snprintf(msg, sizeof(msg),
+        "WRN: log buffer overflow, dropped %" PRIu64 " messages\n",
+        dropped - ring->dropped_reported);
+    ring->dropped_reported = dropped;
+    if (len > 0 && (size_t)len < sizeof(msg)) {
+        struct iovec iov = { .iov_base = msg, .iov_len = len };
+        _async_writev(STDERR_FILENO, &iov, 1);
+    }
+}
+
+/* must be called with _async_drain_mutex held */
+static void
+_async_drain(void)
+{
+    struct async_batch batch;
+    struct async_ring *ring;
+
+    batch.count = 0;
+    for (ring = __atomic_load_n(&_async_rings, __ATOMIC_ACQUIRE); ring;
+        ring = ring->next) {
+        size_t head = __atomic_load_n(&ring->head, __ATOMIC_SEQ_CST);
+        size_t tail = ring->tail;
+
+        while (tail != head) {
+            size_t off = tail % ASYNC_RING_SIZE;
+            struct async_record *rec;
+
+            rec = (struct async_record *)(ring->buf + off);
+            if (rec->len == UINT32_MAX) {
+                tail += ASYNC_RING_SIZE - off;
+                continue;
+            }
+
+            batch.iov[batch.count].iov_base = rec + 1;
+            batch.iov[batch.count].iov_len = rec->len;
+            batch.fd[batch.count] = rec->fd;
+            batch.count++;
+            tail += ASYNC_ALIGN(sizeof(*rec) + rec->len);
+
+            if (batch.count == ASYNC_IOV_MAX) {
+                _async_batch_flush(&batch);
+                __atomic_store_n(&ring->tail, tail, __ATOMIC_RELEASE);
+            }
+        }
+
+        _async_batch_flush(&batch);
+        __atomic_store_n(&ring->tail, tail, __ATOMIC_RELEASE);
+        _async_dropped_report(ring);
+    }
+}
+
+static void *
+_async_writer_run(void *data)
+{
+    char tok[64];
+
+    while (true) {
+        ssize_t r = read(_async_pipe[0], tok, sizeof(tok));
+
+        if (r < 0 && errno == EINTR)
+            continue;
+
+        __atomic_clear(&_async_notified, __ATOMIC_SEQ_CST);
+
+        pthread_mutex_lock(&_async_drain_mutex);
+        _async_drain();
+        pthread_mutex_unlock(&_async_drain_mutex);
+
+        if (r <= 0 || __atomic_load_n(&_async_quit, __ATOMIC_SEQ_CST))
+            break;
+    }
+
+    return NULL;
+}
+
+static void
+_async_ring_release(void *data)
+{
+    struct async_ring *ring = data;
+
+    __atomic_clear(&ring->in_use, __ATOMIC_SEQ_CST);
+}
+
+static struct async_ring *
+_async_ring_get(void)
+{
+    struct async_ring *ring = pthread_getspecific(_async_key);
+
+    if (ring)
+        return ring;
+
+    /* reuse the ring of a thread that is gone, pending data is kept */
+    for (ring = __atomic_load_n(&_async_rings, __ATOMIC_ACQUIRE); ring;
+        ring = ring->next) {
+        if (!__atomic_test_and_set(&ring->in_use, __ATOMIC_SEQ_CST))
+            goto end;
+    }
+
+    ring = calloc(1, sizeof(*ring));
+    if (!ring)
+        return NULL;
+
+    ring->in_use = true;
+    ring->next = __atomic_load_n(&_async_rings, __ATOMIC_RELAXED);
+    while (!__atomic_compare_exchange_n(&_async_rings, &ring->next, ring,
+        true, __ATOMIC_RELEASE, __ATOMIC_RELAXED)) ;
+
+end:
+    pthread_setspecific(_async_key, ring);
+    return ring;
+}
+
+/* returns false if the message must go through the synchronous path:
+ * it may abort() the process, it is too long or there is no memory */
+static bool
+_async_print(int fd, bool use_colors, const char *thread_prefix, const struct sol_log_domain *domain, uint8_t message_level, const char *file, const char *function, int line, const char *format, va_list args)
+{
+    struct async_ring *ring;
+    va_list ap;
+    ssize_t len;
+
+    if (message_level <= _abort_level)
+        return false;
+
+    ring = _async_ring_get();
+    if (!ring)
+        return false;
+
+    va_copy(ap, args);
+    len = _async_format(ring->line, sizeof(ring->line), use_colors,
+        thread_prefix, domain, message_level, file, function, line,
+        format, ap);
+    va_end(ap);
+    if (len < 0)
+        return false;
+
+    if (_async_push(ring, fd, ring->line, len))
+        _async_notify();
+    return true;
+}
+
+/* flush what is queued so the synchronous message keeps the order */
+static void
+_async_sync_lock(void)
+{
+    pthread_mutex_lock(&_async_drain_mutex);
+    _async_drain();
+}
+
+static void
+_async_sync_unlock(void)
+{
+    pthread_mutex_unlock(&_async_drain_mutex);
+}
+
+static void
+_async_atexit(void)
+{
+    if (!_async_running)
+        return;
+
+    _async_sync_lock();
+    _async_sync_unlock();
+}
+
+static void
+_async_atfork_child(void)
+{
+    /* the writer thread does not exist in the child, log synchronously */
+    _async_running = false;
+    _async_rings = NULL;
+    _async_pipe[0] = -1;
+    _async_pipe[1] = -1;
+    pthread_mutex_init(&_async_drain_mutex, NULL);
+}
+
+static void
+_async_register(void)
+{
+    atexit(_async_atexit);
+    pthread_atfork(NULL, NULL, _async_atfork_child);
+}
+
+static int
+_async_start(void)
+{
+    sigset_t all, old;
+    int r;
+
+    pthread_once(&_async_once, _async_register);
+
+    r = pthread_key_create(&_async_key, _async_ring_release);
+    if (r)
+        return -r;
+
+    if (pipe(_async_pipe) < 0) {
+        r = -errno;
+        goto err_pipe;
+    }
+    fcntl(_async_pipe[0], F_SETFD, FD_CLOEXEC);
+    fcntl(_async_pipe[1], F_SETFD, FD_CLOEXEC);
+    fcntl(_async_pipe[1], F_SETFL, O_NONBLOCK);
+
+    _async_quit = false;
+    _async_notified = false;
+
+    /* signals must be delivered to the application threads */
+    sigfillset(&all);
+    pthread_sigmask(SIG_SETMASK, &all, &old);
+    r = pthread_create(&_async_writer, NULL, _async_writer_run, NULL);
+    pthread_sigmask(SIG_SETMASK, &old, NULL);
+    if (r) {
+        r = -r;
+        goto err_thread;
+    }
+
+    _async_running = true;
+    return 0;
+
+err_thread:
+    close(_async_pipe[0]);
+    close(_async_pipe[1]);
+    _async_pipe[0] = -1;
+    _async_pipe[1] = -1;
+err_pipe:
+    pthread_key_delete(_async_key);
+    return r;
+}
+
+static void
+_async_stop(void)
+{
+    struct async_ring *ring, *next;
+    char tok = 'q';
+
+    if (!_async_running)
+        return;
+
+    _async_running = false;
+    __atomic_store_n(&_async_quit, true, __ATOMIC_SEQ_CST);
+    while (write(_async_pipe[1], &tok, sizeof(tok)) < 0 && errno == EINTR) ;
+    pthread_join(_async_writer, NULL);
+
+    pthread_mutex_lock(&_async_drain_mutex);
+    _async_drain();
+    for (ring = _async_rings; ring; ring = next) {
+        next = ring->next;
+        free(ring);
+    }
+    _async_rings = NULL;
+    pthread_mutex_unlock(&_async_drain_mutex);
+
+    close(_async_pipe[0]);
+    close(_async_pipe[1]);
+    _async_pipe[0] = -1;
+    _async_pipe[1] = -1;
+    pthread_key_delete(_async_key);
+}
+#endif
+
 int
 sol_log_impl_init(void)
 {
@@ -411,6 +920,9 @@ sol_log_impl_init(void)
     _env_bool_get("SOL_LOG_SHOW_FILE", &_show_file);
     _env_bool_get("SOL_LOG_SHOW_FUNCTION", &_show_function);
     _env_bool_get("SOL_LOG_SHOW_LINE", &_show_line);
+#ifdef PTHREAD
+    _env_bool_get("SOL_LOG_ASYNC", &_async);
+#endif
 
     if (_main_pid == 1)
         _kcmdline_load();
@@ -440,12 +952,20 @@ sol_log_impl_init(void)
         }
     }
 
+#ifdef PTHREAD
+    if (_async && _async_start() < 0)
+        fputs("ERROR: could not start asynchronous logging\n", stderr);
+#endif
+
     return 0;
 }
 
 void
 sol_log_impl_shutdown(void)
 {
+#ifdef PTHREAD
+    _async_stop();
+#endif
     _env_levels_unload();
     _main_pid = 0;
 #ifdef PTHREAD
@@ -477,6 +997,18 @@ sol_log_impl_unlock(void)
 #endif
 }
 
+bool
+sol_log_impl_print_needs_lock(void (*print)(void *data, const struct sol_log_domain *domain, uint8_t message_level, const char *file, const char *function, int line, const char *format, va_list args))
+{
+#ifdef PTHREAD
+    /* asynchronous print functions only touch per-thread buffers */
+    if (_async_running && (print == sol_log_print_function_stderr ||
+        print == sol_log_print_function_file))
+        return false;
+#endif
+    return true;
+}
+
 void
 sol_log_impl_domain_init_level(struct sol_log_domain *domain)
 {
@@ -497,6 +1029,18 @@ sol_log_impl_print_function_stderr(void *data, const struct sol_log_domain *doma
     char level_str[4] = { 0 };
     size_t len;
     int errno_bkp = errno;
+#ifdef PTHREAD
+    bool async_locked = false;
+
+    if (_async_running) {
+        if (_async_print(STDERR_FILENO, _show_colors, "T", domain,
+            message_level, file, function, line, format, args))
+            return;
+        _async_sync_lock();
+        async_locked = true;
+        errno = errno_bkp;
+    }
+#endif
 
     sol_log_level_to_str(message_level, level_str, sizeof(level_str));
 
@@ -562,6 +1106,11 @@ sol_log_impl_print_function_stderr(void *data, const struct sol_log_domain *doma
     if (len > 0 && format[len - 1] != '\n')
         fputc('\n', stderr);
     fflush(stderr);
+
+#ifdef PTHREAD
+    if (async_locked)
+        _async_sync_unlock();
+#endif
 }
 
 SOL_API void
@@ -572,6 +1121,18 @@ sol_log_print_function_file(void *data, const struct sol_log_domain *domain, uin
     char level_str[4] = { 0 };
     size_t len;
     int errno_bkp = errno;
+#ifdef PTHREAD
+    bool async_locked = false;
+
+    if (_async_running) {
+        if (_async_print(fileno(fp), false, "T:", domain,
+            message_level, file, function, line, format, args))
+            return;
+        _async_sync_lock();
+        async_locked = true;
+        errno = errno_bkp;
+    }
+#endif
 
     sol_log_level_to_str(message_level, level_str, sizeof(level_str));
 
@@ -608,6 +1169,11 @@ sol_log_print_function_file(void *data, const struct sol_log_domain *domain, uin
     if (len > 0 && format[len - 1] != '\n')
         fputc('\n', fp);
     fflush(fp);
+
+#ifdef PTHREAD
+    if (async_locked)
+        _async_sync_unlock();
+#endif
 }
 
 static int
@@ -48,4 +48,5 @@ void sol_log_impl_shutdown(void);
 void sol_log_impl_domain_init_level(struct sol_log_domain *domain);
 bool sol_log_impl_lock(void);
 void sol_log_impl_unlock(void);
+bool sol_log_impl_print_needs_lock(void (*print)(void *data, const struct sol_log_domain *domain, uint8_t message_level, const char *file, const char *function, int line, const char *format, va_list args));
 void sol_log_impl_print_function_stderr(void *data, const struct sol_log_domain *domain, uint8_t message_level, const char *file, const char *function, int line, const char *format, va_list args);
@@ -121,7 +121,10 @@ sol_log_print(const struct sol_log_domain *domain, uint8_t message_level, const
 SOL_API void
 sol_log_vprint(const struct sol_log_domain *domain, uint8_t message_level, const char *file, const char *function, int line, const char *format, va_list args)
 {
+    void (*print)(void *data, const struct sol_log_domain *domain, uint8_t message_level, const char *file, const char *function, int line, const char *format, va_list args);
+    const void *print_data;
     int errno_bkp = errno;
+    bool needs_lock;
 
     SOL_LOG_INIT_CHECK("domain=%p, file=%s, function=%s, line=%d, fomart=%s",
         domain, file, function, line, format);
@@ -143,7 +146,11 @@ sol_log_vprint(const struct sol_log_domain *domain, uint8_t message_level, const
 
     errno = errno_bkp;
 
-    if (!sol_log_impl_lock()) {
+    print = _print_function;
+    print_data = _print_function_data;
+    needs_lock = sol_log_impl_print_needs_lock(print);
+
+    if (needs_lock && !sol_log_impl_lock()) {
         fprintf(stderr,
             "ERROR: sol_log_print() cannot lock "
             "from function=%s, file=%s, line=%d\n",
@@ -151,9 +158,10 @@ sol_log_vprint(const struct sol_log_domain *domain, uint8_t message_level, const
         abort();
         return;
     }
-    _print_function((void *)_print_function_data,
+    print((void *)print_data,
         domain, message_level, file, function, line, format, args);
-    sol_log_impl_unlock();
+    if (needs_lock)
+        sol_log_impl_unlock();
 
     if (message_level <= _abort_level)
         abort();
@@ -376,12 +376,23 @@ signals_process(void)
     SIGPROCMASK(SIG_UNBLOCK, &sig_blockset, NULL);
 
     do {
+        struct child_exit_status *cs;
         int status = 0;
         pid_t pid = waitpid(-1, &status, WNOHANG);
         if (pid <= 0)
             break;
         SOL_DBG("collected finished pid=%" PRIu64 ", status=%d",
             (uint64_t)pid, status);
+
+        /* SIGCHLD of children exiting together may be coalesced, keep
+         * their status as if it came from siginfo */
+        if (find_child_exit_status(pid))
+            continue;
+        cs = sol_vector_append(&child_exit_status_vector);
+        if (!cs)
+            continue;
+        cs->pid = pid;
+        cs->status = WIFEXITED(status) ? WEXITSTATUS(status) : WTERMSIG(status);
     } while (1);
 }
 
@@ -642,11 +653,18 @@ fd_process(void)
     if (!sol_mainloop_common_loop_check())
         return;
 
+    /* Signals are caught asynchronously, so one arriving right before
+     * ppoll() would only be processed after the next wake up, e.g. a
+     * child exiting right after being spawned. Block them until ppoll()
+     * atomically unblocks them, and don't sleep if some were caught
+     * meanwhile. */
+    SIGPROCMASK(SIG_BLOCK, &sig_blockset, NULL);
+
     sol_mainloop_impl_lock();
 
     fd_prepare();
 
-    if (sol_mainloop_common_idler_first()) {
+    if (sol_mainloop_common_idler_first() || siginfo_storage_used) {
         use_diff = true;
         diff.tv_sec = 0;
         diff.tv_nsec = 0;
@@ -669,6 +687,7 @@ fd_process(void)
     sol_mainloop_impl_unlock();
 
     nfds = ppoll(pollfds, pollfds_used, use_diff ? &diff : NULL, &emptyset);
+    SIGPROCMASK(SIG_UNBLOCK, &sig_blockset, NULL);
 
     sol_mainloop_impl_lock();
     sol_ptr_vector_steal(&FD_PROCESS, &FD_ACUM);
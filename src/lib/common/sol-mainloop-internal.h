@@ -0,0 +1,51 @@
+/*
+ * This file is part of the Soletta Project
+ *
+ * Copyright (C) 2015 Intel Corporation. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above copyright
+ *     notice, this list of conditions and the following disclaimer in
+ *     the documentation and/or other materials provided with the
+ *     distribution.
+ *   * Neither the name of Intel Corporation nor the names of its
+ *     contributors may be used to endorse or promote products derived
+ *     from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ * OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#pragma once
+
+#include "sol-mainloop.h"
+
+/* Lets the calling thread take over the main loop sources it adds,
+ * used by flow threads (see sol-flow-thread.h) to dispatch the
+ * sources of the nodes they run in their own thread. The hooks only
+ * apply to the thread setting them. del() returns false for handles
+ * it doesn't know, which are then given to the main loop. */
+struct sol_mainloop_source_hooks {
+    void *(*timeout_add)(void *data, unsigned int timeout_ms, bool (*cb)(void *data), const void *cb_data);
+    void *(*idle_add)(void *data, bool (*cb)(void *data), const void *cb_data);
+    void *(*fd_add)(void *data, int fd, unsigned int flags, bool (*cb)(void *data, int fd, unsigned int active_flags), const void *cb_data);
+    void *(*child_watch_add)(void *data, uint64_t pid, void (*cb)(void *data, uint64_t pid, int status), const void *cb_data);
+    bool (*del)(void *data, void *handle);
+};
+
+/* Returns the previous hooks, with their data in @a prev_data. */
+const struct sol_mainloop_source_hooks *sol_mainloop_set_source_hooks(const struct sol_mainloop_source_hooks *hooks, void *data, void **prev_data);
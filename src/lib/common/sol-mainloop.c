@@ -33,6 +33,7 @@
 #include <stdlib.h>
 
 #include "sol-mainloop-impl.h"
+#include "sol-mainloop-internal.h"
 #include "sol-macros.h"
 #include "sol-util.h"
 
@@ -222,10 +223,42 @@ sol_shutdown(void)
     sol_log_shutdown();
 }
 
+#ifdef FLOW_THREAD
+static __thread const struct sol_mainloop_source_hooks *source_hooks;
+static __thread void *source_hooks_data;
+
+const struct sol_mainloop_source_hooks *
+sol_mainloop_set_source_hooks(const struct sol_mainloop_source_hooks *hooks, void *data, void **prev_data)
+{
+    const struct sol_mainloop_source_hooks *prev = source_hooks;
+
+    *prev_data = source_hooks_data;
+    source_hooks = hooks;
+    source_hooks_data = data;
+    return prev;
+}
+
+#define SOURCE_HOOKS_ADD(_func, ...) \
+    do { \
+        if (source_hooks) \
+            return source_hooks->_func(source_hooks_data, __VA_ARGS__); \
+    } while (0)
+
+#define SOURCE_HOOKS_DEL(_handle) \
+    do { \
+        if (source_hooks && source_hooks->del(source_hooks_data, _handle)) \
+            return true; \
+    } while (0)
+#else
+#define SOURCE_HOOKS_ADD(_func, ...)
+#define SOURCE_HOOKS_DEL(_handle)
+#endif
+
 SOL_API struct sol_timeout *
 sol_timeout_add(unsigned int timeout_ms, bool (*cb)(void *data), const void *data)
 {
     SOL_NULL_CHECK(cb, NULL);
+    SOURCE_HOOKS_ADD(timeout_add, timeout_ms, cb, data);
     return sol_mainloop_impl_timeout_add(timeout_ms, cb, data);
 }
 
@@ -233,6 +266,7 @@ SOL_API bool
 sol_timeout_del(struct sol_timeout *handle)
 {
     SOL_NULL_CHECK(handle, false);
+    SOURCE_HOOKS_DEL(handle);
     return sol_mainloop_impl_timeout_del(handle);
 }
 
@@ -240,6 +274,7 @@ SOL_API struct sol_idle *
 sol_idle_add(bool (*cb)(void *data), const void *data)
 {
     SOL_NULL_CHECK(cb, NULL);
+    SOURCE_HOOKS_ADD(idle_add, cb, data);
     return sol_mainloop_impl_idle_add(cb, data);
 }
 
@@ -247,6 +282,7 @@ SOL_API bool
 sol_idle_del(struct sol_idle *handle)
 {
     SOL_NULL_CHECK(handle, false);
+    SOURCE_HOOKS_DEL(handle);
     return sol_mainloop_impl_idle_del(handle);
 }
 
@@ -255,6 +291,7 @@ SOL_API struct sol_fd *
 sol_fd_add(int fd, unsigned int flags, bool (*cb)(void *data, int fd, unsigned int active_flags), const void *data)
 {
     SOL_NULL_CHECK(cb, NULL);
+    SOURCE_HOOKS_ADD(fd_add, fd, flags, cb, data);
     return sol_mainloop_impl_fd_add(fd, flags, cb, data);
 }
 
@@ -262,6 +299,7 @@ SOL_API bool
 sol_fd_del(struct sol_fd *handle)
 {
     SOL_NULL_CHECK(handle, false);
+    SOURCE_HOOKS_DEL(handle);
     return sol_mainloop_impl_fd_del(handle);
 }
 #endif
@@ -272,6 +310,7 @@ sol_child_watch_add(uint64_t pid, void (*cb)(void *data, uint64_t pid, int statu
 {
     SOL_INT_CHECK(pid, < 1, NULL);
     SOL_NULL_CHECK(cb, NULL);
+    SOURCE_HOOKS_ADD(child_watch_add, pid, cb, data);
     return sol_mainloop_impl_child_watch_add(pid, cb, data);
 }
 
@@ -279,6 +318,7 @@ SOL_API bool
 sol_child_watch_del(struct sol_child_watch *handle)
 {
     SOL_NULL_CHECK(handle, false);
+    SOURCE_HOOKS_DEL(handle);
     return sol_mainloop_impl_child_watch_del(handle);
 }
 #endif
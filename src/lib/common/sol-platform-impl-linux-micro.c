@@ -48,6 +48,7 @@
 #include "sol-mainloop.h"
 #include "sol-platform-impl.h"
 #include "sol-platform-linux-micro.h"
+#include "sol-platform-linux-micro-boot.h"
 #include "sol-platform.h"
 #include "sol-util.h"
 #include "sol-vector.h"
@@ -171,8 +172,10 @@ new_external_service_module(const char *name)
             path, dlerror());
         goto error;
     }
-    if ((*p_sym)->api_version != SOL_PLATFORM_LINUX_MICRO_MODULE_API_VERSION) {
-        SOL_WRN("module '%s' has incorrect api_version: %lu expected %lu",
+    /* version 2 only appended fields, version 1 modules still work */
+    if ((*p_sym)->api_version < 1 ||
+        (*p_sym)->api_version > SOL_PLATFORM_LINUX_MICRO_MODULE_API_VERSION) {
+        SOL_WRN("module '%s' has incorrect api_version: %lu expected 1 to %lu",
             path, (*p_sym)->api_version, SOL_PLATFORM_LINUX_MICRO_MODULE_API_VERSION);
         goto error;
     }
@@ -272,12 +275,30 @@ platform_state_set(enum sol_platform_state state)
 }
 
 #if (SOL_PLATFORM_LINUX_MICRO_MODULE_COUNT > 0) || defined(ENABLE_DYNAMIC_MODULES)
+static struct sol_platform_linux_micro_boot *boot;
+
+static const struct sol_platform_linux_micro_module *
+boot_find_module(void *data, const char *service)
+{
+    return find_service_module(service);
+}
+
+static int
+boot_start(void *data, const char *service)
+{
+    return sol_platform_start_service(service);
+}
+
+static const struct sol_platform_linux_micro_boot_ops boot_ops = {
+    .find_module = boot_find_module,
+    .start = boot_start,
+};
+
 static int
 load_initial_services_entry(const char *start, size_t len)
 {
     char *name;
     bool required = true;
-    int err = 0;
 
     if (len > 1 && start[len - 1] == '?') {
         required = false;
@@ -285,18 +306,7 @@ load_initial_services_entry(const char *start, size_t len)
     }
 
     name = strndupa(start, len);
-    SOL_DBG("loading initial service '%s'", name);
-    err = sol_platform_start_service(name);
-    if (err < 0) {
-        if (!required) {
-            SOL_INF("failed to load initial service '%s'", name);
-            err = 0;
-        } else {
-            SOL_WRN("failed to load initial service '%s'", name);
-        }
-    }
-
-    return err;
+    return sol_platform_linux_micro_boot_add(boot, name, required);
 }
 
 static int
@@ -330,6 +340,9 @@ load_initial_services(void)
     };
     int err = 0;
 
+    boot = sol_platform_linux_micro_boot_new(&boot_ops, NULL);
+    SOL_NULL_CHECK(boot, -ENOMEM);
+
     for (itr = paths; itr < paths + ARRAY_SIZE(paths); itr++) {
         struct sol_file_reader *reader = sol_file_reader_open(*itr);
         if (!reader && errno == ENOENT) {
@@ -338,14 +351,24 @@ load_initial_services(void)
         }
         if (!reader) {
             SOL_WRN("could not load initial services '%s': %s", *itr, sol_util_strerrora(errno));
-            return -errno;
+            err = -errno;
+            goto end;
         }
         err = load_initial_services_internal(reader);
         sol_file_reader_close(reader);
         if (err < 0)
-            break;
+            goto end;
     }
 
+    /* services are started as their dependencies are done, some may
+     * be left to be started from the main loop */
+    err = sol_platform_linux_micro_boot_run(boot);
+
+end:
+    if (err < 0 || sol_platform_linux_micro_boot_is_finished(boot)) {
+        sol_platform_linux_micro_boot_del(boot);
+        boot = NULL;
+    }
     return err;
 }
 #endif
@@ -592,6 +615,13 @@ sol_platform_impl_shutdown(void)
 {
     platform_state_set(SOL_PLATFORM_STATE_STOPPING);
 
+#if (SOL_PLATFORM_LINUX_MICRO_MODULE_COUNT > 0) || defined(ENABLE_DYNAMIC_MODULES)
+    if (boot) {
+        sol_platform_linux_micro_boot_del(boot);
+        boot = NULL;
+    }
+#endif
+
     service_instances_cleanup();
     service_modules_cleanup();
     builtins_cleanup();
@@ -801,6 +831,14 @@ sol_platform_linux_micro_inform_service_state(const char *service, enum sol_plat
         return;
 
     inst->state = state;
+
+    if (boot) {
+        sol_platform_linux_micro_boot_inform(boot, service, state);
+        if (sol_platform_linux_micro_boot_is_finished(boot)) {
+            sol_platform_linux_micro_boot_del(boot);
+            boot = NULL;
+        }
+    }
 #endif
     sol_platform_inform_service_monitors(service, state);
 }
@@ -32,6 +32,7 @@
 
 #include <errno.h>
 #include <signal.h>
+#include <spawn.h>
 #include <stdlib.h>
 #include <sys/types.h>
 #include <sys/wait.h>
@@ -171,6 +172,87 @@ error_malloc:
     }
 }
 
+SOL_API struct sol_platform_linux_fork_run *
+sol_platform_linux_spawn(const char *const argv[], const int fds[3], void (*on_child_exit)(void *data, uint64_t pid, int status), const void *data)
+{
+    struct sol_platform_linux_fork_run *handle;
+    posix_spawn_file_actions_t actions;
+    posix_spawnattr_t attr;
+    sigset_t emptyset;
+    pid_t pid;
+    int i, r;
+
+    errno = EINVAL;
+    SOL_NULL_CHECK(argv, NULL);
+    SOL_NULL_CHECK(argv[0], NULL);
+
+    handle = malloc(sizeof(*handle));
+    SOL_NULL_CHECK(handle, NULL);
+
+    r = posix_spawn_file_actions_init(&actions);
+    SOL_INT_CHECK_GOTO(r, != 0, error_actions);
+
+    for (i = 0; fds && i < 3; i++) {
+        if (fds[i] < 0)
+            continue;
+        r = posix_spawn_file_actions_adddup2(&actions, fds[i], i);
+        SOL_INT_CHECK_GOTO(r, != 0, error_attr);
+    }
+
+    r = posix_spawnattr_init(&attr);
+    SOL_INT_CHECK_GOTO(r, != 0, error_attr);
+
+    /* the main loop blocks the signals it handles, like on fork the
+     * child starts with none blocked */
+    sigemptyset(&emptyset);
+    r = posix_spawnattr_setsigmask(&attr, &emptyset);
+    SOL_INT_CHECK_GOTO(r, != 0, error_spawn);
+    r = posix_spawnattr_setflags(&attr, POSIX_SPAWN_SETSIGMASK);
+    SOL_INT_CHECK_GOTO(r, != 0, error_spawn);
+
+    r = posix_spawnp(&pid, argv[0], &actions, &attr,
+        (char *const *)argv, environ);
+    if (r != 0) {
+        SOL_WRN("could not spawn %s: %s", argv[0], sol_util_strerrora(r));
+        goto error_spawn;
+    }
+
+    posix_spawnattr_destroy(&attr);
+    posix_spawn_file_actions_destroy(&actions);
+
+    handle->pid = pid;
+    handle->on_child_exit = on_child_exit;
+    handle->data = data;
+    handle->watch = sol_child_watch_add(pid, on_child, handle);
+    SOL_NULL_CHECK_GOTO(handle->watch, error_watch);
+
+    r = sol_ptr_vector_append(&fork_runs, handle);
+    if (r < 0) {
+        sol_child_watch_del(handle->watch);
+        r = -r;
+        goto error_watch;
+    }
+
+    errno = 0;
+    return handle;
+
+error_watch:
+    kill(pid, SIGKILL);
+    waitpid(pid, NULL, 0);
+    free(handle);
+    errno = r ? r : ENOMEM;
+    return NULL;
+
+error_spawn:
+    posix_spawnattr_destroy(&attr);
+error_attr:
+    posix_spawn_file_actions_destroy(&actions);
+error_actions:
+    free(handle);
+    errno = r;
+    return NULL;
+}
+
 SOL_API void
 sol_platform_linux_fork_run_stop(struct sol_platform_linux_fork_run *handle)
 {
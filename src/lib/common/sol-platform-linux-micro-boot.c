@@ -0,0 +1,547 @@
+/*
+ * This file is part of the Soletta Project
+ *
+ * Copyright (C) 2015 Intel Corporation. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above copyright
+ *     notice, this list of conditions and the following disclaimer in
+ *     the documentation and/or other materials provided with the
+ *     distribution.
+ *   * Neither the name of Intel Corporation nor the names of its
+ *     contributors may be used to endorse or promote products derived
+ *     from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ * OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <errno.h>
+#include <stdlib.h>
+
+#include "sol-buffer.h"
+#include "sol-mainloop.h"
+#include "sol-platform-impl.h"
+#include "sol-platform-linux-micro-boot.h"
+#include "sol-util.h"
+#include "sol-vector.h"
+
+/* Modules must inform the state of the services they start, this is
+ * only a safety net against the ones that don't. */
+#define INFORM_TIMEOUT_MS_DEFAULT 30000
+
+enum boot_state {
+    BOOT_WAITING,
+    BOOT_STARTING,
+    BOOT_DONE,
+    BOOT_FAILED
+};
+
+struct boot_entry {
+    char *name;
+    const struct sol_platform_linux_micro_module *module;
+    struct timespec started;
+    struct timespec ready;
+    uint16_t blocker; /* dependency that was ready last, or UINT16_MAX */
+    enum boot_state state;
+    bool required;
+};
+
+struct sol_platform_linux_micro_boot {
+    const struct sol_platform_linux_micro_boot_ops *ops;
+    const void *data;
+    struct sol_vector entries;
+    struct timespec begin;
+    struct sol_timeout *inform_timeout;
+    unsigned int inform_timeout_ms;
+    unsigned int pending;
+    int error;
+    bool running;
+    bool scheduling;
+    bool again;
+};
+
+static int
+boot_find(const struct sol_platform_linux_micro_boot *boot, const char *name)
+{
+    const struct boot_entry *e;
+    uint16_t i;
+
+    SOL_VECTOR_FOREACH_IDX (&boot->entries, e, i) {
+        if (streq(e->name, name))
+            return i;
+    }
+
+    return -ENOENT;
+}
+
+static int
+boot_append(struct sol_platform_linux_micro_boot *boot, const char *name, bool required)
+{
+    struct boot_entry *e;
+
+    e = sol_vector_append(&boot->entries);
+    SOL_NULL_CHECK(e, -ENOMEM);
+
+    e->name = strdup(name);
+    if (!e->name) {
+        sol_vector_del(&boot->entries, boot->entries.len - 1);
+        return -ENOMEM;
+    }
+    e->module = NULL;
+    e->blocker = UINT16_MAX;
+    e->state = BOOT_WAITING;
+    e->required = required;
+    boot->pending++;
+
+    return boot->entries.len - 1;
+}
+
+/* version 1 modules end before the dependency lists */
+static const char *const *
+module_requires(const struct sol_platform_linux_micro_module *module)
+{
+    return module->api_version < 2 ? NULL : module->requires;
+}
+
+static const char *const *
+module_after(const struct sol_platform_linux_micro_module *module)
+{
+    return module->api_version < 2 ? NULL : module->after;
+}
+
+static int
+msec_since(struct timespec begin, struct timespec ts)
+{
+    struct timespec diff;
+
+    sol_util_timespec_sub(&ts, &begin, &diff);
+    return sol_util_msec_from_timespec(&diff);
+}
+
+static void
+boot_report(const struct sol_platform_linux_micro_boot *boot)
+{
+    const struct boot_entry *e;
+    char *path;
+    uint16_t i;
+
+    SOL_VECTOR_FOREACH_IDX (&boot->entries, e, i) {
+        SOL_DBG("initial service '%s' %s: started at %dms, took %dms",
+            e->name, e->state == BOOT_DONE ? "done" : "failed",
+            msec_since(boot->begin, e->started),
+            msec_since(e->started, e->ready));
+    }
+
+    path = sol_platform_linux_micro_boot_get_critical_path(boot);
+    SOL_INF("initial services finished in %dms, critical path: %s",
+        msec_since(boot->begin, sol_util_timespec_get_current()),
+        path ? path : "");
+    free(path);
+}
+
+static void
+boot_entry_finish(struct sol_platform_linux_micro_boot *boot, uint16_t idx, enum boot_state state, int err)
+{
+    struct boot_entry *e = sol_vector_get(&boot->entries, idx);
+
+    if (e->state == BOOT_WAITING)
+        e->started = sol_util_timespec_get_current();
+    e->ready = sol_util_timespec_get_current();
+    e->state = state;
+    boot->pending--;
+    /* others may be able to start now */
+    boot->again = true;
+
+    if (state == BOOT_DONE)
+        return;
+
+    if (!e->required) {
+        SOL_INF("failed to load initial service '%s'", e->name);
+        return;
+    }
+
+    SOL_WRN("failed to load initial service '%s'", e->name);
+    if (!boot->error)
+        boot->error = err < 0 ? err : -EIO;
+}
+
+/* Returns 1 if the entry can start, 0 if it must wait and a negative
+ * errno if it can't ever start. */
+static int
+boot_entry_check(struct sol_platform_linux_micro_boot *boot, uint16_t idx)
+{
+    const struct sol_platform_linux_micro_module *module;
+    const struct timespec *last = NULL;
+    const char *const *itr;
+    struct boot_entry *e = sol_vector_get(&boot->entries, idx);
+    bool required = e->required;
+    uint16_t blocker = UINT16_MAX;
+
+    if (!e->module) {
+        e->module = boot->ops->find_module((void *)boot->data, e->name);
+        if (!e->module)
+            return -ENOENT;
+    }
+    module = e->module;
+
+    for (itr = module_requires(module); itr && *itr; itr++) {
+        const struct boot_entry *dep;
+        int r = boot_find(boot, *itr);
+
+        if (r < 0) {
+            /* pulled in, checked later in this same pass */
+            r = boot_append(boot, *itr, required);
+            SOL_INT_CHECK(r, < 0, r);
+        }
+
+        dep = sol_vector_get(&boot->entries, r);
+        if (dep->state == BOOT_FAILED) {
+            SOL_WRN("initial service '%s' requires '%s', that failed",
+                module->name, dep->name);
+            return -ENOENT;
+        }
+        if (dep->state != BOOT_DONE)
+            return 0;
+        if (!last || sol_util_timespec_compare(&dep->ready, last) > 0) {
+            last = &dep->ready;
+            blocker = r;
+        }
+    }
+
+    for (itr = module_after(module); itr && *itr; itr++) {
+        const struct boot_entry *dep;
+        int r = boot_find(boot, *itr);
+
+        if (r < 0)
+            continue;
+
+        dep = sol_vector_get(&boot->entries, r);
+        if (dep->state == BOOT_WAITING || dep->state == BOOT_STARTING)
+            return 0;
+        if (!last || sol_util_timespec_compare(&dep->ready, last) > 0) {
+            last = &dep->ready;
+            blocker = r;
+        }
+    }
+
+    e = sol_vector_get(&boot->entries, idx);
+    e->blocker = blocker;
+    return 1;
+}
+
+static void boot_schedule(struct sol_platform_linux_micro_boot *boot);
+static void boot_inform_timeout_add(struct sol_platform_linux_micro_boot *boot);
+
+static bool
+on_inform_timeout(void *data)
+{
+    struct sol_platform_linux_micro_boot *boot = data;
+    struct timespec now = sol_util_timespec_get_current();
+    const struct boot_entry *e;
+    bool finished = false;
+    uint16_t i;
+
+    boot->inform_timeout = NULL;
+
+    for (i = 0; i < boot->entries.len; i++) {
+        e = sol_vector_get(&boot->entries, i);
+        if (e->state != BOOT_STARTING ||
+            msec_since(e->started, now) < (int)boot->inform_timeout_ms)
+            continue;
+
+        SOL_WRN("initial service '%s' didn't inform its state in %ums, "
+            "assuming it's done", e->name, boot->inform_timeout_ms);
+        boot_entry_finish(boot, i, BOOT_DONE, 0);
+        finished = true;
+    }
+
+    if (finished)
+        boot_schedule(boot);
+    boot_inform_timeout_add(boot);
+
+    return false;
+}
+
+/* Fires when the service started first, among the ones that didn't
+ * inform their state yet, runs out of time. */
+static void
+boot_inform_timeout_add(struct sol_platform_linux_micro_boot *boot)
+{
+    const struct boot_entry *e, *first = NULL;
+    int remaining;
+    uint16_t i;
+
+    if (boot->inform_timeout)
+        return;
+
+    SOL_VECTOR_FOREACH_IDX (&boot->entries, e, i) {
+        if (e->state != BOOT_STARTING)
+            continue;
+        if (!first || sol_util_timespec_compare(&e->started, &first->started) < 0)
+            first = e;
+    }
+    if (!first)
+        return;
+
+    remaining = (int)boot->inform_timeout_ms -
+        msec_since(first->started, sol_util_timespec_get_current());
+    boot->inform_timeout = sol_timeout_add(remaining > 0 ? remaining : 0,
+        on_inform_timeout, boot);
+    if (!boot->inform_timeout)
+        SOL_WRN("couldn't watch initial services' states");
+}
+
+static void
+boot_entry_start(struct sol_platform_linux_micro_boot *boot, uint16_t idx)
+{
+    struct boot_entry *e = sol_vector_get(&boot->entries, idx);
+    int r;
+
+    SOL_DBG("loading initial service '%s'", e->name);
+    e->state = BOOT_STARTING;
+    e->started = sol_util_timespec_get_current();
+
+    /* may inform its state right away */
+    r = boot->ops->start((void *)boot->data, e->name);
+
+    e = sol_vector_get(&boot->entries, idx);
+    if (e->state != BOOT_STARTING)
+        return;
+
+    if (r < 0)
+        boot_entry_finish(boot, idx, BOOT_FAILED, r);
+    else
+        boot_inform_timeout_add(boot);
+}
+
+static void
+boot_fail_cycles(struct sol_platform_linux_micro_boot *boot)
+{
+    struct boot_entry *e;
+    uint16_t i;
+
+    SOL_VECTOR_FOREACH_IDX (&boot->entries, e, i) {
+        if (e->state == BOOT_STARTING)
+            return;
+    }
+
+    /* nothing will inform a state anymore, the waiting ones depend on
+     * each other */
+    SOL_VECTOR_FOREACH_IDX (&boot->entries, e, i) {
+        if (e->state != BOOT_WAITING)
+            continue;
+        SOL_WRN("initial service '%s' has circular dependencies", e->name);
+        boot_entry_finish(boot, i, BOOT_FAILED, -ELOOP);
+    }
+}
+
+static void
+boot_schedule(struct sol_platform_linux_micro_boot *boot)
+{
+    uint16_t i;
+
+    if (boot->scheduling) {
+        boot->again = true;
+        return;
+    }
+
+    boot->scheduling = true;
+    do {
+        boot->again = false;
+
+        for (i = 0; i < boot->entries.len; i++) {
+            const struct boot_entry *e = sol_vector_get(&boot->entries, i);
+            int r;
+
+            if (e->state != BOOT_WAITING)
+                continue;
+
+            r = boot_entry_check(boot, i);
+            if (r < 0)
+                boot_entry_finish(boot, i, BOOT_FAILED, r);
+            else if (r > 0)
+                boot_entry_start(boot, i);
+        }
+
+        if (!boot->again && boot->pending)
+            boot_fail_cycles(boot);
+    } while (boot->again);
+    boot->scheduling = false;
+
+    if (!boot->pending)
+        boot_report(boot);
+}
+
+struct sol_platform_linux_micro_boot *
+sol_platform_linux_micro_boot_new(const struct sol_platform_linux_micro_boot_ops *ops, const void *data)
+{
+    struct sol_platform_linux_micro_boot *boot;
+
+    SOL_NULL_CHECK(ops, NULL);
+    SOL_NULL_CHECK(ops->find_module, NULL);
+    SOL_NULL_CHECK(ops->start, NULL);
+
+    boot = calloc(1, sizeof(*boot));
+    SOL_NULL_CHECK(boot, NULL);
+
+    boot->ops = ops;
+    boot->data = data;
+    boot->inform_timeout_ms = INFORM_TIMEOUT_MS_DEFAULT;
+    sol_vector_init(&boot->entries, sizeof(struct boot_entry));
+
+    return boot;
+}
+
+void
+sol_platform_linux_micro_boot_del(struct sol_platform_linux_micro_boot *boot)
+{
+    struct boot_entry *e;
+    uint16_t i;
+
+    SOL_NULL_CHECK(boot);
+
+    if (boot->inform_timeout)
+        sol_timeout_del(boot->inform_timeout);
+
+    SOL_VECTOR_FOREACH_IDX (&boot->entries, e, i)
+        free(e->name);
+    sol_vector_clear(&boot->entries);
+    free(boot);
+}
+
+void
+sol_platform_linux_micro_boot_set_inform_timeout(struct sol_platform_linux_micro_boot *boot, unsigned int timeout_ms)
+{
+    SOL_NULL_CHECK(boot);
+
+    boot->inform_timeout_ms = timeout_ms;
+}
+
+int
+sol_platform_linux_micro_boot_add(struct sol_platform_linux_micro_boot *boot, const char *service, bool required)
+{
+    int r;
+
+    SOL_NULL_CHECK(boot, -EINVAL);
+    SOL_NULL_CHECK(service, -EINVAL);
+
+    r = boot_find(boot, service);
+    if (r >= 0) {
+        struct boot_entry *e = sol_vector_get(&boot->entries, r);
+        e->required |= required;
+        return 0;
+    }
+
+    r = boot_append(boot, service, required);
+    SOL_INT_CHECK(r, < 0, r);
+
+    if (boot->running)
+        boot_schedule(boot);
+
+    return 0;
+}
+
+int
+sol_platform_linux_micro_boot_run(struct sol_platform_linux_micro_boot *boot)
+{
+    SOL_NULL_CHECK(boot, -EINVAL);
+
+    boot->begin = sol_util_timespec_get_current();
+    boot->running = true;
+    boot_schedule(boot);
+
+    return boot->error;
+}
+
+void
+sol_platform_linux_micro_boot_inform(struct sol_platform_linux_micro_boot *boot, const char *service, enum sol_platform_service_state state)
+{
+    const struct boot_entry *e;
+    enum boot_state new_state;
+    int r;
+
+    SOL_NULL_CHECK(boot);
+    SOL_NULL_CHECK(service);
+
+    if (state == SOL_PLATFORM_SERVICE_STATE_ACTIVE ||
+        state == SOL_PLATFORM_SERVICE_STATE_INACTIVE)
+        new_state = BOOT_DONE;
+    else if (state == SOL_PLATFORM_SERVICE_STATE_FAILED)
+        new_state = BOOT_FAILED;
+    else
+        return;
+
+    r = boot_find(boot, service);
+    if (r < 0)
+        return;
+
+    e = sol_vector_get(&boot->entries, r);
+    if (e->state != BOOT_STARTING)
+        return;
+
+    boot_entry_finish(boot, r, new_state, -EIO);
+    boot_schedule(boot);
+}
+
+bool
+sol_platform_linux_micro_boot_is_finished(const struct sol_platform_linux_micro_boot *boot)
+{
+    SOL_NULL_CHECK(boot, true);
+
+    return boot->running && !boot->pending && !boot->scheduling;
+}
+
+char *
+sol_platform_linux_micro_boot_get_critical_path(const struct sol_platform_linux_micro_boot *boot)
+{
+    struct sol_buffer buf = SOL_BUFFER_EMPTY;
+    const struct boot_entry *e, *last = NULL;
+    uint16_t i, *path, len = 0;
+
+    SOL_NULL_CHECK(boot, NULL);
+
+    SOL_VECTOR_FOREACH_IDX (&boot->entries, e, i) {
+        if (e->state != BOOT_DONE && e->state != BOOT_FAILED)
+            continue;
+        if (!last || sol_util_timespec_compare(&e->ready, &last->ready) > 0)
+            last = e;
+    }
+    if (!last)
+        return strdup("");
+
+    path = malloc(boot->entries.len * sizeof(*path));
+    SOL_NULL_CHECK(path, NULL);
+
+    for (e = last; len < boot->entries.len; e = sol_vector_get(&boot->entries, e->blocker)) {
+        path[len++] = e - (const struct boot_entry *)boot->entries.data;
+        if (e->blocker == UINT16_MAX)
+            break;
+    }
+
+    while (len--) {
+        e = sol_vector_get(&boot->entries, path[len]);
+        if (sol_buffer_append_slice(&buf, sol_str_slice_from_str(e->name)) < 0 ||
+            (len && sol_buffer_append_slice(&buf, sol_str_slice_from_str(" > ")) < 0)) {
+            sol_buffer_fini(&buf);
+            break;
+        }
+    }
+
+    free(path);
+    return buf.data;
+}
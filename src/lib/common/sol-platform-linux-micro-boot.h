@@ -0,0 +1,85 @@
+/*
+ * This file is part of the Soletta Project
+ *
+ * Copyright (C) 2015 Intel Corporation. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above copyright
+ *     notice, this list of conditions and the following disclaimer in
+ *     the documentation and/or other materials provided with the
+ *     distribution.
+ *   * Neither the name of Intel Corporation nor the names of its
+ *     contributors may be used to endorse or promote products derived
+ *     from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ * OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#pragma once
+
+#include <stdbool.h>
+
+#include "sol-platform-linux-micro.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Starts the initial services on boot, each as soon as the ones it
+ * depends on (see sol_platform_linux_micro_module::requires and
+ * ::after) are done. The start() calls themselves are made one at a
+ * time, from the main loop: a service whose start() returns before
+ * it's done doesn't hold back the ones not depending on it, but a
+ * start() that blocks still blocks all the others.
+ *
+ * A service is done when its module informs it's active or inactive,
+ * and failed when it informs so or start() fails. A service that
+ * doesn't inform its state in time (30s by default) is assumed done,
+ * with a warning, so a module missing it won't hang the boot. When
+ * all services are done or failed, the critical path, the chain of
+ * services that delayed the last one, is logged.
+ */
+struct sol_platform_linux_micro_boot;
+
+struct sol_platform_linux_micro_boot_ops {
+    const struct sol_platform_linux_micro_module *(*find_module)(void *data, const char *service);
+    int (*start)(void *data, const char *service);
+};
+
+struct sol_platform_linux_micro_boot *sol_platform_linux_micro_boot_new(const struct sol_platform_linux_micro_boot_ops *ops, const void *data);
+void sol_platform_linux_micro_boot_del(struct sol_platform_linux_micro_boot *boot);
+
+void sol_platform_linux_micro_boot_set_inform_timeout(struct sol_platform_linux_micro_boot *boot, unsigned int timeout_ms);
+
+/* Services that are not required only log failures at info level. */
+int sol_platform_linux_micro_boot_add(struct sol_platform_linux_micro_boot *boot, const char *service, bool required);
+
+/* Starts the services that don't have to wait. Returns the error of
+ * the first required service that failed meanwhile, if any. */
+int sol_platform_linux_micro_boot_run(struct sol_platform_linux_micro_boot *boot);
+
+void sol_platform_linux_micro_boot_inform(struct sol_platform_linux_micro_boot *boot, const char *service, enum sol_platform_service_state state);
+bool sol_platform_linux_micro_boot_is_finished(const struct sol_platform_linux_micro_boot *boot);
+
+/* Returns the services in the critical path, separated by " > ", to
+ * be freed by the caller. */
+char *sol_platform_linux_micro_boot_get_critical_path(const struct sol_platform_linux_micro_boot *boot);
+
+#ifdef __cplusplus
+}
+#endif
@@ -44,7 +44,7 @@ extern "C" {
 
 struct sol_platform_linux_micro_module {
     unsigned long int api_version;
-#define SOL_PLATFORM_LINUX_MICRO_MODULE_API_VERSION (1UL)
+#define SOL_PLATFORM_LINUX_MICRO_MODULE_API_VERSION (2UL)
     const char *name;
     int (*init)(const struct sol_platform_linux_micro_module *module, const char *service);
     void (*shutdown)(const struct sol_platform_linux_micro_module *module, const char *service);
@@ -53,6 +53,15 @@ struct sol_platform_linux_micro_module {
     int (*restart)(const struct sol_platform_linux_micro_module *module, const char *service);
     int (*start_monitor)(const struct sol_platform_linux_micro_module *module, const char *service);
     int (*stop_monitor)(const struct sol_platform_linux_micro_module *module, const char *service);
+    /* NULL terminated lists of services to be done before this one
+     * is started on boot. Required services are started as well, and
+     * if they fail this one fails too. The ones this should start
+     * after are only waited for if they are also started on boot.
+     * Either way, the module must inform the service state once it's
+     * done starting. Only read from modules of api_version 2 or
+     * newer, older ones are taken as having no dependencies. */
+    const char *const *requires;
+    const char *const *after;
 };
 
 void sol_platform_linux_micro_inform_service_state(const char *service, enum sol_platform_service_state state);
@@ -45,6 +45,23 @@ struct sol_platform_linux_fork_run *sol_platform_linux_fork_run(void (*on_fork)(
 void sol_platform_linux_fork_run_stop(struct sol_platform_linux_fork_run *handle);
 pid_t sol_platform_linux_fork_run_get_pid(const struct sol_platform_linux_fork_run *handle);
 
+/*
+ * Runs the program argv[0] (searched in PATH if it has no slash) with
+ * the given arguments, without forking the calling process: it's
+ * spawned with posix_spawn(), so the cost doesn't grow with the size
+ * of the caller. Prefer it over sol_platform_linux_fork_run() when
+ * the child just execs.
+ *
+ * fds are dup'ed to the child's stdin, stdout and stderr, -1 keeps
+ * the caller's one. fds may be NULL to keep all three. Other
+ * descriptors are inherited unless they are close-on-exec.
+ *
+ * The returned handle works with sol_platform_linux_fork_run_stop()
+ * and sol_platform_linux_fork_run_get_pid(), and on_child_exit is
+ * called like for sol_platform_linux_fork_run().
+ */
+struct sol_platform_linux_fork_run *sol_platform_linux_spawn(const char *const argv[], const int fds[3], void (*on_child_exit)(void *data, uint64_t pid, int status), const void *data);
+
 #ifdef __cplusplus
 }
 #endif
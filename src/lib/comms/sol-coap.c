@@ -52,6 +52,10 @@
 
 #include "sol-coap.h"
 
+#ifdef OIC
+extern void sol_oic_client_coap_server_destroyed(const struct sol_coap_server *server);
+#endif
+
 SOL_LOG_INTERNAL_DECLARE(_sol_coap_log_domain, "coap");
 
 #define IPV4_ALL_COAP_NODES_GROUP "224.0.1.187"
@@ -344,7 +348,12 @@ sol_coap_packet_ref(struct sol_coap_packet *pkt)
 {
     SOL_NULL_CHECK(pkt, NULL);
 
+#ifdef PTHREAD
+    /* packets may be shared with worker threads */
+    __atomic_add_fetch(&pkt->refcnt, 1, __ATOMIC_RELAXED);
+#else
     pkt->refcnt++;
+#endif
     return pkt;
 }
 
@@ -359,10 +368,15 @@ sol_coap_packet_unref(struct sol_coap_packet *pkt)
 {
     SOL_NULL_CHECK(pkt);
 
+#ifdef PTHREAD
+    if (__atomic_sub_fetch(&pkt->refcnt, 1, __ATOMIC_ACQ_REL) > 0)
+        return;
+#else
     if (pkt->refcnt > 1) {
         pkt->refcnt--;
         return;
     }
+#endif
 
     coap_packet_free(pkt);
 }
@@ -1305,6 +1319,9 @@ sol_coap_server_destroy(struct sol_coap_server *server)
     }
 
     sol_vector_clear(&server->contexts);
+#ifdef OIC
+    sol_oic_client_coap_server_destroyed(server);
+#endif
     free(server);
 }
 
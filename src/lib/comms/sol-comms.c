@@ -38,6 +38,9 @@ extern void sol_http_client_shutdown(void);
 extern int sol_network_init(void);
 extern void sol_network_shutdown(void);
 #endif
+#ifdef OIC
+extern void sol_oic_client_shutdown(void);
+#endif
 
 int sol_comms_init(void);
 void sol_comms_shutdown(void);
@@ -74,6 +77,9 @@ network_error:
 void
 sol_comms_shutdown(void)
 {
+#ifdef OIC
+    sol_oic_client_shutdown();
+#endif
 #ifdef HTTP_CLIENT
     sol_http_client_shutdown();
 #endif
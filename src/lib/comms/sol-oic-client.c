@@ -41,6 +41,7 @@
 #include <sys/ioctl.h>
 #include <sys/socket.h>
 
+#include "sol-buffer.h"
 #include "sol-coap.h"
 #include "sol-json.h"
 #include "sol-log-internal.h"
@@ -52,6 +53,11 @@
 
 #define POLL_OBSERVE_TIMEOUT_MS 10000
 
+/* How long replies are kept around and handed to new callers without
+ * hitting the network again. */
+#define DISCOVERY_CACHE_TTL_MS 5000
+#define REQUEST_CACHE_TTL_MS 1000
+
 #define IOTIVITY_CON_REQ_MID 0xd42
 #define IOTIVITY_CON_REQ_OBS_MID 0x7d44
 #define IOTIVITY_NONCON_REQ_MID 0x7d40
@@ -77,12 +83,6 @@
         } \
     } while (0)
 
-struct find_resource_ctx {
-    struct sol_oic_client *client;
-    void (*cb)(struct sol_oic_client *cli, struct sol_oic_resource *res, void *data);
-    void *data;
-};
-
 struct resource_request_ctx {
     struct sol_oic_client *client;
     struct sol_oic_resource *res;
@@ -91,8 +91,53 @@ struct resource_request_ctx {
     void *data;
 };
 
+/* 'server' is the client's, waiters go away with it as requests made
+ * directly through it would. */
+struct cache_waiter {
+    struct sol_oic_client *client;
+    struct sol_coap_server *server;
+    union {
+        void (*found)(struct sol_oic_client *cli, struct sol_oic_resource *res, void *data);
+        void (*response)(struct sol_oic_client *cli, const struct sol_network_link_addr *addr,
+            const struct sol_str_slice *href, const struct sol_str_slice *payload, void *data);
+    } cb;
+    void *data;
+};
+
+/* Replies are cached per device address and key, the key being the
+ * resource type filter for discoveries and the href for GET requests.
+ * Replies of this protocol version carry no device id, so the address
+ * is what identifies a device. While a request is in flight through
+ * 'server', identical requests are queued in 'waiters' and share its
+ * reply. */
+struct cache_entry {
+    struct sol_network_link_addr addr;
+    struct sol_network_link_addr reply_addr;
+    struct sol_coap_server *server;
+    struct sol_vector waiters;
+    struct sol_buffer payload;
+    struct sol_oic_resource *res;
+    struct timespec expire;
+    char *key;
+    int refcnt;
+    uint16_t res_payload_len;
+    bool in_flight : 1;
+    bool valid : 1;
+};
+
+struct cache_delivery_ctx {
+    struct cache_entry *entry;
+    struct cache_waiter waiter;
+    struct sol_idle *idle;
+};
+
 static const char json_type[] = "application/json";
 
+static struct sol_ptr_vector discovery_cache = SOL_PTR_VECTOR_INIT;
+static struct sol_ptr_vector request_cache = SOL_PTR_VECTOR_INIT;
+/* Cache hits waiting for the main loop, see _cache_entry_deliver(). */
+static struct sol_ptr_vector pending_deliveries = SOL_PTR_VECTOR_INIT;
+
 SOL_LOG_INTERNAL_DECLARE(_sol_oic_client_log_domain, "oic-client");
 
 static bool
@@ -241,57 +286,404 @@ _has_observable_option(struct sol_coap_packet *pkt)
     return ptr && len == 1 && *ptr;
 }
 
+static struct sol_oic_resource *
+_resource_new(const uint8_t *payload, uint16_t payload_len)
+{
+    struct sol_oic_resource *res;
+
+    res = malloc(sizeof(*res) + payload_len);
+    SOL_NULL_CHECK(res, NULL);
+
+    memcpy(res + 1, payload, payload_len);
+    res->api_version = SOL_OIC_RESOURCE_API_VERSION;
+    res->href = (struct sol_str_slice)SOL_STR_SLICE_EMPTY;
+    sol_vector_init(&res->types, sizeof(struct sol_str_slice));
+    sol_vector_init(&res->interfaces, sizeof(struct sol_str_slice));
+
+    res->observe.timeout = NULL;
+    res->observe.clear_data = 0;
+
+    res->refcnt = 1;
+    res->observable = false;
+
+    return res;
+}
+
+static bool
+_rebase_slice_vector(struct sol_vector *dst, const struct sol_vector *src,
+    const char *old_base, const char *new_base)
+{
+    struct sol_str_slice *slice, *new_slice;
+    uint16_t idx;
+
+    SOL_VECTOR_FOREACH_IDX (src, slice, idx) {
+        new_slice = sol_vector_append(dst);
+        SOL_NULL_CHECK(new_slice, false);
+
+        *new_slice = SOL_STR_SLICE_STR(new_base + (slice->data - old_base), slice->len);
+    }
+
+    return true;
+}
+
+/* Resources handed to users are independent objects, as their
+ * observation state is per-instance. Copy an already parsed resource
+ * by rebasing its slices into the new payload copy. */
+static struct sol_oic_resource *
+_resource_dup(const struct sol_oic_resource *res, uint16_t payload_len)
+{
+    const char *old_base = (const char *)(res + 1);
+    const char *new_base;
+    struct sol_oic_resource *dup;
+
+    dup = _resource_new((const uint8_t *)old_base, payload_len);
+    SOL_NULL_CHECK(dup, NULL);
+
+    new_base = (const char *)(dup + 1);
+    dup->addr = res->addr;
+    dup->observable = res->observable;
+    dup->href = SOL_STR_SLICE_STR(new_base + (res->href.data - old_base), res->href.len);
+
+    if (!_rebase_slice_vector(&dup->types, &res->types, old_base, new_base) ||
+        !_rebase_slice_vector(&dup->interfaces, &res->interfaces, old_base, new_base)) {
+        sol_oic_resource_unref(dup);
+        return NULL;
+    }
+
+    return dup;
+}
+
+static struct cache_entry *
+_cache_entry_ref(struct cache_entry *entry)
+{
+    entry->refcnt++;
+    return entry;
+}
+
+static void
+_cache_entry_unref(struct cache_entry *entry)
+{
+    entry->refcnt--;
+    if (entry->refcnt)
+        return;
+
+    if (entry->res)
+        sol_oic_resource_unref(entry->res);
+    sol_buffer_fini(&entry->payload);
+    sol_vector_clear(&entry->waiters);
+    free(entry->key);
+    free(entry);
+}
+
+static void
+_cache_entry_set_expire(struct cache_entry *entry, int ttl_ms)
+{
+    struct timespec now = sol_util_timespec_get_current();
+    struct timespec ttl = sol_util_timespec_from_msec(ttl_ms);
+
+    sol_util_timespec_sum(&now, &ttl, &entry->expire);
+}
+
+static bool
+_cache_entry_expired(const struct cache_entry *entry, const struct timespec *now)
+{
+    return sol_util_timespec_compare(now, &entry->expire) >= 0;
+}
+
+/* Looks up the entry for 'addr' and 'key', dropping expired entries
+ * that are not waiting for a reply anymore along the way. */
+static struct cache_entry *
+_cache_entry_find(struct sol_ptr_vector *cache, const struct sol_network_link_addr *addr,
+    const struct sol_str_slice key)
+{
+    struct timespec now = sol_util_timespec_get_current();
+    struct cache_entry *entry, *found = NULL;
+    uint16_t idx;
+
+    SOL_PTR_VECTOR_FOREACH_REVERSE_IDX (cache, entry, idx) {
+        if (!entry->in_flight && _cache_entry_expired(entry, &now)) {
+            sol_ptr_vector_del(cache, idx);
+            _cache_entry_unref(entry);
+            continue;
+        }
+
+        if (!found && entry->addr.port == addr->port &&
+            sol_network_link_addr_eq(&entry->addr, addr) &&
+            sol_str_slice_str_eq(key, entry->key))
+            found = entry;
+    }
+
+    return found;
+}
+
+static struct cache_entry *
+_cache_entry_new(struct sol_ptr_vector *cache, const struct sol_network_link_addr *addr,
+    const struct sol_str_slice key)
+{
+    struct cache_entry *entry;
+
+    entry = calloc(1, sizeof(*entry));
+    SOL_NULL_CHECK(entry, NULL);
+
+    entry->key = strndup(key.data, key.len);
+    SOL_NULL_CHECK_GOTO(entry->key, err_key);
+
+    if (sol_ptr_vector_append(cache, entry) < 0)
+        goto err_append;
+
+    entry->addr = *addr;
+    entry->refcnt = 1;
+    sol_vector_init(&entry->waiters, sizeof(struct cache_waiter));
+    sol_buffer_init(&entry->payload);
+
+    return entry;
+
+err_append:
+    free(entry->key);
+err_key:
+    free(entry);
+    return NULL;
+}
+
+static bool
+_cache_entry_add_waiter(struct cache_entry *entry, const struct cache_waiter *waiter)
+{
+    struct cache_waiter *w = sol_vector_append(&entry->waiters);
+
+    SOL_NULL_CHECK(w, false);
+    *w = *waiter;
+    return true;
+}
+
+static void
+_cache_entry_invalidate(struct sol_ptr_vector *cache, const struct sol_network_link_addr *addr,
+    const struct sol_str_slice key)
+{
+    struct cache_entry *entry = _cache_entry_find(cache, addr, key);
+
+    if (entry)
+        entry->valid = false;
+}
+
+static void
+_deliver_found_resource(struct cache_entry *entry, const struct cache_waiter *waiter)
+{
+    struct sol_oic_resource *res;
+
+    res = _resource_dup(entry->res, entry->res_payload_len);
+    if (!res) {
+        SOL_WRN("Could not copy resource");
+        return;
+    }
+
+    waiter->cb.found(waiter->client, res, waiter->data);
+    sol_oic_resource_unref(res);
+}
+
+static void _call_waiters_for_response_array(const struct cache_waiter *waiters, uint16_t n_waiters,
+    const struct sol_network_link_addr *cliaddr, const struct sol_str_slice request_href,
+    const uint8_t *payload, uint16_t payload_len);
+
+static void
+_cache_delivery_del(struct cache_delivery_ctx *ctx)
+{
+    struct cache_delivery_ctx *itr;
+    uint16_t idx;
+
+    SOL_PTR_VECTOR_FOREACH_IDX (&pending_deliveries, itr, idx) {
+        if (itr == ctx) {
+            sol_ptr_vector_del(&pending_deliveries, idx);
+            break;
+        }
+    }
+}
+
+static bool
+_deliver_cached_reply(void *data)
+{
+    struct cache_delivery_ctx *ctx = data;
+    struct cache_entry *entry = ctx->entry;
+
+    _cache_delivery_del(ctx);
+
+    if (entry->res)
+        _deliver_found_resource(entry, &ctx->waiter);
+    else
+        _call_waiters_for_response_array(&ctx->waiter, 1, &entry->reply_addr,
+            sol_str_slice_from_str(entry->key), entry->payload.data, entry->payload.used);
+
+    _cache_entry_unref(entry);
+    free(ctx);
+    return false;
+}
+
+/* Cache hits are still delivered from the main loop, so callers
+ * always see callbacks happening after the request call returns. */
+static bool
+_cache_entry_deliver(struct cache_entry *entry, const struct cache_waiter *waiter)
+{
+    struct cache_delivery_ctx *ctx;
+
+    ctx = malloc(sizeof(*ctx));
+    SOL_NULL_CHECK(ctx, false);
+
+    ctx->entry = entry;
+    ctx->waiter = *waiter;
+
+    if (sol_ptr_vector_append(&pending_deliveries, ctx) < 0)
+        goto err_append;
+
+    ctx->idle = sol_idle_add(_deliver_cached_reply, ctx);
+    if (!ctx->idle) {
+        SOL_WRN("Could not schedule delivery of cached reply");
+        goto err_idle;
+    }
+
+    _cache_entry_ref(entry);
+    return true;
+
+err_idle:
+    _cache_delivery_del(ctx);
+err_append:
+    free(ctx);
+    return false;
+}
+
+/* Steals the list of waiters from 'entry', as callbacks might issue
+ * new requests for the same entry while it is being dispatched. */
+static struct cache_waiter *
+_cache_entry_take_waiters(struct cache_entry *entry, uint16_t *n_waiters)
+{
+    *n_waiters = entry->waiters.len;
+    entry->in_flight = false;
+    entry->server = NULL;
+    return sol_vector_take_data(&entry->waiters);
+}
+
+static void
+_cache_clear(struct sol_ptr_vector *cache)
+{
+    struct cache_entry *entry;
+    uint16_t idx;
+
+    SOL_PTR_VECTOR_FOREACH_IDX (cache, entry, idx)
+        _cache_entry_unref(entry);
+    sol_ptr_vector_clear(cache);
+}
+
+/* Drops the waiters and pending deliveries of clients using 'server',
+ * or all of them if 'server' is NULL. */
+static void
+_cache_forget_server(const struct sol_coap_server *server)
+{
+    struct cache_delivery_ctx *ctx;
+    struct cache_entry *entry;
+    struct cache_waiter *waiter;
+    struct sol_ptr_vector *caches[] = { &discovery_cache, &request_cache };
+    uint16_t idx, i, n, c;
+
+    SOL_PTR_VECTOR_FOREACH_REVERSE_IDX (&pending_deliveries, ctx, idx) {
+        if (server && ctx->waiter.server != server)
+            continue;
+        sol_ptr_vector_del(&pending_deliveries, idx);
+        sol_idle_del(ctx->idle);
+        _cache_entry_unref(ctx->entry);
+        free(ctx);
+    }
+
+    if (!server)
+        return;
+
+    for (c = 0; c < ARRAY_SIZE(caches); c++) {
+        SOL_PTR_VECTOR_FOREACH_IDX (caches[c], entry, idx) {
+            for (i = entry->waiters.len; i > 0; i--) {
+                waiter = sol_vector_get(&entry->waiters, i - 1);
+                if (waiter->server == server)
+                    sol_vector_del(&entry->waiters, i - 1);
+            }
+
+            /* its request went away without a reply, and so did the
+             * reference the reply callback had */
+            if (entry->in_flight && entry->server == server) {
+                free(_cache_entry_take_waiters(entry, &n));
+                entry->server = NULL;
+                _cache_entry_unref(entry);
+            }
+        }
+    }
+}
+
+/* Clients have no destructor of their own: releasing the CoAP server
+ * they use is what stops requests from calling them back. */
+void sol_oic_client_coap_server_destroyed(const struct sol_coap_server *server);
+
+void
+sol_oic_client_coap_server_destroyed(const struct sol_coap_server *server)
+{
+    _cache_forget_server(server);
+}
+
+void sol_oic_client_shutdown(void);
+
+void
+sol_oic_client_shutdown(void)
+{
+    _cache_forget_server(NULL);
+    _cache_clear(&discovery_cache);
+    _cache_clear(&request_cache);
+}
+
 static int
 _find_resource_reply_cb(struct sol_coap_packet *req, const struct sol_network_link_addr *cliaddr,
     void *data)
 {
-    struct find_resource_ctx *ctx = data;
+    struct cache_entry *entry = data;
+    struct cache_waiter *waiters;
+    uint16_t n_waiters, i;
     uint8_t *payload;
     uint16_t payload_len;
     struct sol_oic_resource *res;
     int error = 0;
 
-    if (!ctx->cb) {
-        SOL_WRN("No user callback provided");
-        error = -ENOENT;
-        goto free_ctx;
-    }
-
     if (sol_coap_packet_get_payload(req, &payload, &payload_len) < 0) {
         SOL_WRN("Could not get pkt payload");
         error = -ENOMEM;
-        goto free_ctx;
+        goto out;
     }
-    res = malloc(sizeof(*res) + payload_len);
+
+    res = _resource_new(payload, payload_len);
     if (!res) {
         SOL_WRN("Not enough memory");
         error = -errno;
-        goto free_ctx;
+        goto out;
     }
 
-    payload = memcpy(res + 1, payload, payload_len);
-    res->href = (struct sol_str_slice)SOL_STR_SLICE_EMPTY;
-    sol_vector_init(&res->types, sizeof(struct sol_str_slice));
-    sol_vector_init(&res->interfaces, sizeof(struct sol_str_slice));
-
-    res->observe.timeout = NULL;
-    res->observe.clear_data = 0;
-
-    res->refcnt = 1;
-
-    if (_parse_resource_reply_payload(res, payload, payload_len)) {
-        res->observable = res->observable || _has_observable_option(req);
-        res->addr = *cliaddr;
-        ctx->cb(ctx->client, res, ctx->data);
-    } else {
+    if (!_parse_resource_reply_payload(res, (uint8_t *)(res + 1), payload_len)) {
         SOL_WRN("Could not parse payload");
+        sol_oic_resource_unref(res);
         error = -1;
+        goto out;
     }
 
-    sol_oic_resource_unref(res);
+    res->observable = res->observable || _has_observable_option(req);
+    res->addr = *cliaddr;
 
-free_ctx:
-    free(ctx);
+    if (entry->res)
+        sol_oic_resource_unref(entry->res);
+    entry->res = res;
+    entry->res_payload_len = payload_len;
+    entry->valid = true;
+    _cache_entry_set_expire(entry, DISCOVERY_CACHE_TTL_MS);
+
+    waiters = _cache_entry_take_waiters(entry, &n_waiters);
+    for (i = 0; i < n_waiters; i++)
+        _deliver_found_resource(entry, &waiters[i]);
+    free(waiters);
+
+out:
+    if (error < 0)
+        free(_cache_entry_take_waiters(entry, &n_waiters));
+    _cache_entry_unref(entry);
     return error;
 }
 
@@ -304,8 +696,15 @@ sol_oic_client_find_resource(struct sol_oic_client *client,
     void *data)
 {
     static const char oc_core_uri[] = "/oc/core";
+    const struct cache_waiter waiter = {
+        .client = client,
+        .server = client->server,
+        .cb.found = resource_found_cb,
+        .data = data
+    };
+    struct sol_str_slice key;
     struct sol_coap_packet *req;
-    struct find_resource_ctx *ctx;
+    struct cache_entry *entry;
     int r;
 
     SOL_LOG_INTERNAL_INIT_ONCE;
@@ -313,18 +712,30 @@ sol_oic_client_find_resource(struct sol_oic_client *client,
     SOL_NULL_CHECK(client, false);
     OIC_CLIENT_CHECK_API(client, false);
 
-    ctx = sol_util_memdup(&(struct find_resource_ctx) {
-            .client = client,
-            .cb = resource_found_cb,
-            .data = data
-        }, sizeof(*ctx));
-    SOL_NULL_CHECK(ctx, false);
+    if (!resource_found_cb) {
+        SOL_WRN("No user callback provided");
+        return false;
+    }
+
+    key = sol_str_slice_from_str(resource_type ? resource_type : "");
+    entry = _cache_entry_find(&discovery_cache, cliaddr, key);
+    if (entry) {
+        struct timespec now = sol_util_timespec_get_current();
+
+        if (!entry->in_flight && entry->valid)
+            return _cache_entry_deliver(entry, &waiter);
+        if (entry->in_flight && !_cache_entry_expired(entry, &now))
+            return _cache_entry_add_waiter(entry, &waiter);
+    } else {
+        entry = _cache_entry_new(&discovery_cache, cliaddr, key);
+        SOL_NULL_CHECK(entry, false);
+    }
 
     /* Multicast discovery should be non-confirmable */
     req = sol_coap_packet_request_new(SOL_COAP_METHOD_GET, SOL_COAP_TYPE_NONCON);
     if (!req) {
         SOL_WRN("Could not create CoAP packet");
-        goto out_no_pkt;
+        return false;
     }
 
     sol_coap_header_set_id(req, IOTIVITY_NONCON_REQ_MID);
@@ -346,30 +757,43 @@ sol_oic_client_find_resource(struct sol_oic_client *client,
 
     sol_coap_add_option(req, SOL_COAP_OPTION_ACCEPT, json_type, sizeof(json_type) - 1);
 
-    r = sol_coap_send_packet_with_reply(client->server, req, cliaddr, _find_resource_reply_cb, ctx);
-    if (!r)
-        return true;
+    if (!_cache_entry_add_waiter(entry, &waiter))
+        goto out;
 
-    goto out_no_pkt;
+    r = sol_coap_send_packet_with_reply(client->server, req, cliaddr, _find_resource_reply_cb,
+        _cache_entry_ref(entry));
+    if (r < 0) {
+        _cache_entry_unref(entry);
+        sol_vector_del(&entry->waiters, entry->waiters.len - 1);
+        return false;
+    }
+
+    /* An unanswered discovery does not hold back new ones forever */
+    entry->in_flight = true;
+    entry->server = client->server;
+    _cache_entry_set_expire(entry, DISCOVERY_CACHE_TTL_MS);
+    return true;
 
 out:
     sol_coap_packet_unref(req);
-out_no_pkt:
-    free(ctx);
     return false;
 }
 
+/* Replies to plain requests may omit the href of the representation,
+ * in which case it refers to the requested one. */
 static void
-_call_request_context_for_response_array(struct resource_request_ctx *ctx,
-    const struct sol_network_link_addr *cliaddr, uint8_t *payload, uint16_t payload_len)
+_call_waiters_for_response_array(const struct cache_waiter *waiters, uint16_t n_waiters,
+    const struct sol_network_link_addr *cliaddr, const struct sol_str_slice request_href,
+    const uint8_t *payload, uint16_t payload_len)
 {
     struct sol_json_scanner scanner;
     struct sol_json_token token;
     enum sol_json_loop_reason reason;
+    uint16_t i;
 
     sol_json_scanner_init(&scanner, payload, payload_len);
     SOL_JSON_SCANNER_ARRAY_LOOP (&scanner, &token, SOL_JSON_TYPE_OBJECT_START, reason) {
-        struct sol_str_slice href = SOL_STR_SLICE_EMPTY;
+        struct sol_str_slice href = request_href;
         struct sol_str_slice rep = SOL_STR_SLICE_EMPTY;
         struct sol_json_token key, value;
 
@@ -381,18 +805,54 @@ _call_request_context_for_response_array(struct resource_request_ctx *ctx,
             }
         }
 
-        if (reason == SOL_JSON_LOOP_REASON_OK && href.len && rep.len)
-            ctx->cb(ctx->client, cliaddr, &href, &rep, ctx->data);
+        if (reason == SOL_JSON_LOOP_REASON_OK && href.len && rep.len) {
+            for (i = 0; i < n_waiters; i++)
+                waiters[i].cb.response(waiters[i].client, cliaddr, &href, &rep, waiters[i].data);
+        }
     }
     if (reason != SOL_JSON_LOOP_REASON_OK)
         SOL_WRN("Invalid JSON");
 }
 
+static void
+_call_request_context_for_response_array(struct resource_request_ctx *ctx,
+    const struct sol_network_link_addr *cliaddr, uint8_t *payload, uint16_t payload_len)
+{
+    const struct cache_waiter waiter = {
+        .client = ctx->client,
+        .cb.response = ctx->cb,
+        .data = ctx->data
+    };
+
+    _call_waiters_for_response_array(&waiter, 1, cliaddr, ctx->res->href, payload, payload_len);
+}
+
+/* Observation notifications carry the current representation of a
+ * resource, so use them to refresh a cached GET reply, if any. */
+static void
+_request_cache_refresh(const struct sol_oic_resource *res,
+    const struct sol_network_link_addr *cliaddr, uint8_t *payload, uint16_t payload_len)
+{
+    struct cache_entry *entry;
+
+    entry = _cache_entry_find(&request_cache, &res->addr, res->href);
+    if (!entry)
+        return;
+
+    if (sol_buffer_set_slice(&entry->payload, SOL_STR_SLICE_STR((const char *)payload, payload_len)) < 0) {
+        entry->valid = false;
+        return;
+    }
+
+    entry->reply_addr = *cliaddr;
+    entry->valid = true;
+    _cache_entry_set_expire(entry, REQUEST_CACHE_TTL_MS);
+}
+
 static int
-_resource_request_cb(struct sol_coap_packet *req, const struct sol_network_link_addr *cliaddr,
-    void *data)
+_dispatch_resource_reply(struct sol_coap_packet *req, const struct sol_network_link_addr *cliaddr,
+    struct resource_request_ctx *ctx, bool refresh_cache)
 {
-    struct resource_request_ctx *ctx = data;
     uint8_t *payload;
     uint16_t payload_len;
 
@@ -402,44 +862,72 @@ _resource_request_cb(struct sol_coap_packet *req, const struct sol_network_link_
         return 0;
     if (sol_coap_packet_get_payload(req, &payload, &payload_len) < 0)
         return 0;
-    if (_get_oc_response_array_from_payload(&payload, &payload_len))
+    if (_get_oc_response_array_from_payload(&payload, &payload_len)) {
+        if (refresh_cache)
+            _request_cache_refresh(ctx->res, cliaddr, payload, payload_len);
         _call_request_context_for_response_array(ctx, cliaddr, payload, payload_len);
+    }
 
     return 0;
 }
 
+static int
+_resource_request_cb(struct sol_coap_packet *req, const struct sol_network_link_addr *cliaddr,
+    void *data)
+{
+    return _dispatch_resource_reply(req, cliaddr, data, true);
+}
+
 static int
 _one_shot_resource_request_cb(struct sol_coap_packet *req, const struct sol_network_link_addr *cliaddr,
     void *data)
 {
-    int ret = _resource_request_cb(req, cliaddr, data);
+    int ret = _dispatch_resource_reply(req, cliaddr, data, false);
 
     free(data);
     return ret;
 }
 
-static bool
-_resource_request(struct sol_oic_client *client, struct sol_oic_resource *res,
-    sol_coap_method_t method, uint8_t *payload, size_t payload_len,
-    void (*callback)(struct sol_oic_client *cli, const struct sol_network_link_addr *addr,
-    const struct sol_str_slice *href, const struct sol_str_slice *payload, void *data),
-    void *data, bool observe)
+static int
+_cached_request_reply_cb(struct sol_coap_packet *req, const struct sol_network_link_addr *cliaddr,
+    void *data)
 {
-    int (*cb)(struct sol_coap_packet *req, const struct sol_network_link_addr *cliaddr, void *data);
-    struct sol_coap_packet *req;
-    struct resource_request_ctx *ctx = sol_util_memdup(&(struct resource_request_ctx) {
-            .client = client,
-            .cb = callback,
-            .data = data,
-            .res = res
-        }, sizeof(*ctx));
+    struct cache_entry *entry = data;
+    struct cache_waiter *waiters;
+    uint16_t n_waiters;
+    uint8_t *payload;
+    uint16_t payload_len;
 
-    SOL_NULL_CHECK(ctx, false);
+    if (sol_coap_packet_has_payload(req) &&
+        sol_coap_packet_get_payload(req, &payload, &payload_len) >= 0 &&
+        _get_oc_response_array_from_payload(&payload, &payload_len) &&
+        sol_buffer_set_slice(&entry->payload, SOL_STR_SLICE_STR((const char *)payload, payload_len)) >= 0) {
+        entry->reply_addr = *cliaddr;
+        entry->valid = true;
+        _cache_entry_set_expire(entry, REQUEST_CACHE_TTL_MS);
+
+        waiters = _cache_entry_take_waiters(entry, &n_waiters);
+        _call_waiters_for_response_array(waiters, n_waiters, cliaddr,
+            sol_str_slice_from_str(entry->key), entry->payload.data, entry->payload.used);
+    } else {
+        waiters = _cache_entry_take_waiters(entry, &n_waiters);
+    }
+
+    free(waiters);
+    _cache_entry_unref(entry);
+    return 0;
+}
+
+static struct sol_coap_packet *
+_resource_request_packet_new(struct sol_oic_resource *res, sol_coap_method_t method,
+    uint8_t *payload, size_t payload_len, bool observe)
+{
+    struct sol_coap_packet *req;
 
     req = sol_coap_packet_request_new(method, SOL_COAP_TYPE_CON);
     if (!req) {
         SOL_WRN("Could not create CoAP packet");
-        goto out_no_req;
+        return NULL;
     }
 
     if (observe) {
@@ -447,10 +935,8 @@ _resource_request(struct sol_oic_client *client, struct sol_oic_resource *res,
 
         sol_coap_header_set_id(req, IOTIVITY_CON_REQ_OBS_MID);
         sol_coap_add_option(req, SOL_COAP_OPTION_OBSERVE, &reg, sizeof(reg));
-        cb = _resource_request_cb;
     } else {
         sol_coap_header_set_id(req, IOTIVITY_CON_REQ_MID);
-        cb = _one_shot_resource_request_cb;
     }
 
     if (sol_coap_packet_add_uri_path_option(req, strndupa(res->href.data, res->href.len)) < 0) {
@@ -483,15 +969,94 @@ _resource_request(struct sol_oic_client *client, struct sol_oic_resource *res,
         }
     }
 
-    return sol_coap_send_packet_with_reply(client->server, req, &res->addr, cb, ctx) == 0;
+    return req;
 
 out:
     sol_coap_packet_unref(req);
-out_no_req:
+    return NULL;
+}
+
+static bool
+_resource_request(struct sol_oic_client *client, struct sol_oic_resource *res,
+    sol_coap_method_t method, uint8_t *payload, size_t payload_len,
+    void (*callback)(struct sol_oic_client *cli, const struct sol_network_link_addr *addr,
+    const struct sol_str_slice *href, const struct sol_str_slice *payload, void *data),
+    void *data, bool observe)
+{
+    int (*cb)(struct sol_coap_packet *req, const struct sol_network_link_addr *cliaddr, void *data);
+    struct sol_coap_packet *req;
+    struct resource_request_ctx *ctx = sol_util_memdup(&(struct resource_request_ctx) {
+            .client = client,
+            .cb = callback,
+            .data = data,
+            .res = res
+        }, sizeof(*ctx));
+
+    SOL_NULL_CHECK(ctx, false);
+
+    req = _resource_request_packet_new(res, method, payload, payload_len, observe);
+    SOL_NULL_CHECK_GOTO(req, out);
+
+    cb = observe ? _resource_request_cb : _one_shot_resource_request_cb;
+    if (sol_coap_send_packet_with_reply(client->server, req, &res->addr, cb, ctx) == 0)
+        return true;
+
+out:
     free(ctx);
     return false;
 }
 
+/* Plain GETs are answered from the cache when possible, and
+ * concurrent identical GETs share a single request and reply. */
+static bool
+_cached_resource_get(struct sol_oic_client *client, struct sol_oic_resource *res,
+    void (*callback)(struct sol_oic_client *cli, const struct sol_network_link_addr *addr,
+    const struct sol_str_slice *href, const struct sol_str_slice *payload, void *data),
+    void *data)
+{
+    const struct cache_waiter waiter = {
+        .client = client,
+        .server = client->server,
+        .cb.response = callback,
+        .data = data
+    };
+    struct sol_coap_packet *req;
+    struct cache_entry *entry;
+
+    entry = _cache_entry_find(&request_cache, &res->addr, res->href);
+    if (entry) {
+        struct timespec now = sol_util_timespec_get_current();
+
+        if (!entry->in_flight && entry->valid)
+            return _cache_entry_deliver(entry, &waiter);
+        if (entry->in_flight && !_cache_entry_expired(entry, &now))
+            return _cache_entry_add_waiter(entry, &waiter);
+    } else {
+        entry = _cache_entry_new(&request_cache, &res->addr, res->href);
+        SOL_NULL_CHECK(entry, false);
+    }
+
+    req = _resource_request_packet_new(res, SOL_COAP_METHOD_GET, NULL, 0, false);
+    SOL_NULL_CHECK(req, false);
+
+    if (!_cache_entry_add_waiter(entry, &waiter)) {
+        sol_coap_packet_unref(req);
+        return false;
+    }
+
+    if (sol_coap_send_packet_with_reply(client->server, req, &res->addr,
+        _cached_request_reply_cb, _cache_entry_ref(entry)) < 0) {
+        _cache_entry_unref(entry);
+        sol_vector_del(&entry->waiters, entry->waiters.len - 1);
+        return false;
+    }
+
+    entry->in_flight = true;
+    entry->server = client->server;
+    _cache_entry_set_expire(entry, REQUEST_CACHE_TTL_MS);
+    return true;
+}
+
 SOL_API bool
 sol_oic_client_resource_request(struct sol_oic_client *client, struct sol_oic_resource *res,
     sol_coap_method_t method, uint8_t *payload, size_t payload_len,
@@ -504,6 +1069,12 @@ sol_oic_client_resource_request(struct sol_oic_client *client, struct sol_oic_re
     SOL_NULL_CHECK(res, false);
     OIC_RESOURCE_CHECK_API(res, false);
 
+    if (method == SOL_COAP_METHOD_GET && !(payload && payload_len) && callback)
+        return _cached_resource_get(client, res, callback, data);
+
+    /* Anything else may change the resource: forget what we know */
+    _cache_entry_invalidate(&request_cache, &res->addr, res->href);
+
     return _resource_request(client, res, method, payload, payload_len, callback, data, false);
 }
 
@@ -32,16 +32,22 @@
 
 #include <errno.h>
 #include <stdio.h>
+#include <string.h>
 
 #include "sol-log.h"
 #include "sol-arena.h"
 #include "sol-util.h"
 
-/* TODO: check if it's worthwhile to implement this as a single
- * growing buffer. */
+/* Strings are carved from blocks, so a string costs no allocation
+ * of its own and the arena isn't limited by the number of strings
+ * it holds. Strings bigger than a fraction of a block get a block of
+ * their own, so they don't waste the room left in the current one. */
+#define ARENA_BLOCK_SIZE 4096
 
 struct sol_arena {
-    struct sol_ptr_vector str_vector;
+    struct sol_ptr_vector blocks;
+    char *cur;
+    size_t left;
 };
 
 SOL_API struct sol_arena *
@@ -52,46 +58,89 @@ sol_arena_new(void)
     arena = calloc(1, sizeof(struct sol_arena));
     SOL_NULL_CHECK(arena, NULL);
 
-    sol_ptr_vector_init(&arena->str_vector);
+    sol_ptr_vector_init(&arena->blocks);
     return arena;
 }
 
 SOL_API void
 sol_arena_del(struct sol_arena *arena)
 {
-    char *s;
+    char *block;
     uint16_t i;
 
     SOL_NULL_CHECK(arena);
 
-    SOL_PTR_VECTOR_FOREACH_IDX (&arena->str_vector, s, i)
-        free(s);
+    SOL_PTR_VECTOR_FOREACH_IDX (&arena->blocks, block, i)
+        free(block);
 
-    sol_ptr_vector_clear(&arena->str_vector);
+    sol_ptr_vector_clear(&arena->blocks);
     free(arena);
 }
 
+static char *
+arena_alloc(struct sol_arena *arena, size_t size)
+{
+    char *block;
+    int r;
+
+    if (size <= arena->left) {
+        block = arena->cur;
+        arena->cur += size;
+        arena->left -= size;
+        return block;
+    }
+
+    if (size > ARENA_BLOCK_SIZE / 4) {
+        block = malloc(size);
+        SOL_NULL_CHECK(block, NULL);
+    } else {
+        block = malloc(ARENA_BLOCK_SIZE);
+        SOL_NULL_CHECK(block, NULL);
+    }
+
+    r = sol_ptr_vector_append(&arena->blocks, block);
+    if (r < 0) {
+        free(block);
+        errno = -r;
+        return NULL;
+    }
+
+    if (size <= ARENA_BLOCK_SIZE / 4) {
+        arena->cur = block + size;
+        arena->left = ARENA_BLOCK_SIZE - size;
+    }
+
+    return block;
+}
+
+static char *
+arena_strndup(struct sol_arena *arena, const char *str, size_t n)
+{
+    char *result;
+
+    result = arena_alloc(arena, n + 1);
+    if (!result)
+        return NULL;
+
+    memcpy(result, str, n);
+    result[n] = '\0';
+    return result;
+}
+
 SOL_API int
 sol_arena_slice_dup_str_n(struct sol_arena *arena, struct sol_str_slice *dst, const char *str, size_t n)
 {
     struct sol_str_slice slice;
-    int r;
 
     SOL_NULL_CHECK(arena, -EINVAL);
     SOL_NULL_CHECK(str, -EINVAL);
     SOL_INT_CHECK(n, <= 0, -EINVAL);
 
-    slice.data = strndup(str, n);
+    slice.data = arena_strndup(arena, str, strnlen(str, n));
     SOL_NULL_CHECK(slice.data, -errno);
 
     slice.len = n;
 
-    r = sol_ptr_vector_append(&arena->str_vector, (char *)slice.data);
-    if (r < 0) {
-        free((char *)slice.data);
-        return r;
-    }
-
     *dst = slice;
     return 0;
 }
@@ -116,20 +165,23 @@ sol_arena_slice_sprintf(struct sol_arena *arena, struct sol_str_slice *dst, cons
     char *str;
     int r;
 
+    SOL_NULL_CHECK(arena, -EINVAL);
+
     va_start(ap, fmt);
-    r = vasprintf(&str, fmt, ap);
+    r = vsnprintf(NULL, 0, fmt, ap);
     va_end(ap);
     SOL_INT_CHECK(r, < 0, r);
 
+    str = arena_alloc(arena, r + 1);
+    SOL_NULL_CHECK(str, -errno);
+
+    va_start(ap, fmt);
+    vsnprintf(str, r + 1, fmt, ap);
+    va_end(ap);
+
     dst->data = str;
     dst->len = r;
 
-    r = sol_ptr_vector_append(&arena->str_vector, str);
-    if (r < 0) {
-        free(str);
-        return r;
-    }
-
     return 0;
 }
 
@@ -143,23 +195,11 @@ sol_arena_strdup(struct sol_arena *arena, const char *str)
 SOL_API char *
 sol_arena_strndup(struct sol_arena *arena, const char *str, size_t n)
 {
-    char *result;
-    int r;
-
     SOL_NULL_CHECK(arena, NULL);
     SOL_NULL_CHECK(str, NULL);
     SOL_INT_CHECK(n, <= 0, NULL);
 
-    result = strndup(str, n);
-    SOL_NULL_CHECK(result, NULL);
-
-    r = sol_ptr_vector_append(&arena->str_vector, result);
-    if (r < 0) {
-        free(result);
-        return NULL;
-    }
-
-    return result;
+    return arena_strndup(arena, str, strnlen(str, n));
 }
 
 SOL_API char *
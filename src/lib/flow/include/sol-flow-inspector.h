@@ -64,6 +64,14 @@ struct sol_flow_inspector {
 
 bool sol_flow_set_inspector(const struct sol_flow_inspector *inspector);
 
+/**
+ * Get the inspector in use, if any.
+ *
+ * @return The inspector given to sol_flow_set_inspector() or @c NULL
+ *         if there is none (or inspector support was not built).
+ */
+const struct sol_flow_inspector *sol_flow_get_inspector(void);
+
 /**
  * @}
  */
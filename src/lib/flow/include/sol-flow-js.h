@@ -72,6 +72,11 @@ extern "C" {
  *           out: [ { name: 'OUT', type: 'int' } ]
  *       };
  *
+ * The process() function of 'int' and 'float' input ports receives an
+ * object with the value and its range ('val', 'min', 'max' and
+ * 'step'). Ports declared with 'valueOnly: true' receive just the
+ * number instead, sparing the creation of an object per packet.
+ *
  * @param buf A buffer containing the Javascript code in which will be used
  *            in this new JS node type.
  * @param len The size of the buffer.
@@ -35,6 +35,7 @@
 #include <stdbool.h>
 #include <stddef.h>
 
+#include "sol-str-slice.h"
 #include "sol-types.h"
 
 #ifdef __cplusplus
@@ -114,6 +115,16 @@ struct sol_flow_packet *sol_flow_packet_new_string(const char *value);
 int sol_flow_packet_get_string(const struct sol_flow_packet *packet, const char **value);
 struct sol_flow_packet *sol_flow_packet_new_string_take(char *value);
 
+/* Creates a string packet out of a slice of 'parent' blob's memory.
+ * If the slice is followed by a NUL byte still inside the blob, no
+ * copy is made and the packet holds a reference to 'parent' instead,
+ * otherwise (or if 'parent' is NULL) the slice is copied. */
+struct sol_flow_packet *sol_flow_packet_new_string_slice(struct sol_blob *parent, const struct sol_str_slice slice);
+
+/* Gets the string as a slice, avoiding strlen(), and the blob it is
+ * stored in, if any. 'parent' may be NULL, no reference is taken. */
+int sol_flow_packet_get_string_slice(const struct sol_flow_packet *packet, struct sol_str_slice *slice, struct sol_blob **parent);
+
 struct sol_flow_packet *sol_flow_packet_new_blob(const struct sol_blob *value);
 int sol_flow_packet_get_blob(const struct sol_flow_packet *packet, struct sol_blob **value);
 
@@ -33,6 +33,7 @@
 #pragma once
 
 #include <stdbool.h>
+#include <sys/types.h>
 
 #include "sol-flow.h"
 #include "sol-flow-resolver.h"
@@ -94,6 +95,17 @@ struct sol_flow_node_type *sol_flow_parse_string(
     const char *str,
     const char *filename);
 
+/* Same as sol_flow_parse_buffer(), but the input is pulled with
+ * read() as the graph is built, e.g. from a pipe or a socket. read()
+ * works like read(2): returns the number of bytes copied to buf, 0 at
+ * the end of the input or a negative errno. Only the pending tokens
+ * are buffered, the input is never kept as a whole. */
+struct sol_flow_node_type *sol_flow_parse_stream(
+    struct sol_flow_parser *parser,
+    ssize_t (*read)(void *data, char *buf, size_t len),
+    void *data,
+    const char *filename);
+
 /**
  * @}
  */
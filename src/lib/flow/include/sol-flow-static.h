@@ -177,6 +177,97 @@ struct sol_flow_node *sol_flow_static_get_node(struct sol_flow_node *node, uint1
 struct sol_flow_node_type *sol_flow_static_new_type(
     const struct sol_flow_static_spec *spec);
 
+/**
+ * Updates a running static flow to a new type, in place.
+ *
+ * The node specs of both types are compared: nodes with the same
+ * name (unnamed nodes: the same index), the same type and the same
+ * options pointer are kept, together with their private data and
+ * the connections between them. Only the nodes that are not kept are
+ * closed, and only the new ones are opened. Then connections are
+ * rewired. Packets queued by kept nodes are still delivered. Child
+ * flows are compared by their type, so a child flow with a new type
+ * is replaced as a whole.
+ *
+ * New nodes get their exported options from the options @a flow was
+ * opened with, so @a new_type must export options with the same
+ * members as the current type (i.e. a type from a builder declaring
+ * the same options). If @a flow has a parent, the exported ports of
+ * @a new_type must map to kept nodes exactly like the ones of the
+ * current type.
+ *
+ * On success @a flow uses @a new_type, which must outlive it. The
+ * old type may be deleted by the caller, unless the flow owned it
+ * (see sol_flow_static_new()), in which case it's deleted here. On
+ * failure the flow keeps its current type and the nodes closed so
+ * far are opened again.
+ *
+ * @param flow A node of a static flow type.
+ * @param new_type A static flow type.
+ *
+ * @return @c 0 on success, @c -ENOTSUP if the exported ports or
+ *         options don't match and a negative errno on other errors.
+ */
+int sol_flow_static_update(struct sol_flow_node *flow, const struct sol_flow_node_type *new_type);
+
+/** Per node information computed from a static flow specification. */
+struct sol_flow_static_node_info {
+    uint16_t first_conn_idx; /**< index of the first connection having this node as source */
+    uint16_t ports_count_in; /**< number of input ports of the node type */
+    uint16_t ports_count_out; /**< number of output ports of the node type */
+};
+
+/** Per connection information computed from a static flow specification. */
+struct sol_flow_static_conn_info {
+    uint16_t out_conn_id; /**< connection id in the source output port */
+    uint16_t in_conn_id; /**< connection id in the destination input port */
+};
+
+#define SOL_FLOW_STATIC_PRECOMPUTED_API_VERSION (1)
+
+/** Tables that sol_flow_static_new_type() would compute from a
+ * #sol_flow_static_spec, computed ahead of time (usually by
+ * sol-fbp-generator). Like the spec, the arrays are assumed to be
+ * available and valid while the type created from them is used. */
+struct sol_flow_static_precomputed {
+    uint16_t api_version;
+    uint16_t node_count; /**< number of nodes in the spec, without the guard */
+    uint16_t conn_count; /**< number of connections in the spec, without the guard */
+
+    /** Array with node_count elements, in the order of the nodes in the spec. */
+    const struct sol_flow_static_node_info *node_infos;
+
+    /** Array with conn_count elements, in the order of the
+     * connections in the spec. May be @c NULL if there are no
+     * connections. */
+    const struct sol_flow_static_conn_info *conn_infos;
+
+    /** Connection id that the first connection to each exported
+     * port will have in the child node port. One element per
+     * exported port, may be @c NULL if there are none. */
+    const uint16_t *exported_in_base_conn_ids;
+    const uint16_t *exported_out_base_conn_ids;
+};
+
+/**
+ * Creates a new "static flow" (container) type from precomputed
+ * tables.
+ *
+ * Works like sol_flow_static_new_type(), but the connection
+ * validation and the computation of connection ids are skipped, and
+ * the given tables are used as they are. Only the node and connection
+ * counts and the nodes' ports counts are checked, so the tables @b
+ * must have been computed from exactly the same @a spec.
+ *
+ * @param spec A specification of the type to be created.
+ * @param precomputed Tables computed from @a spec.
+ *
+ * @return A new container node type on success, otherwise @c NULL.
+ */
+struct sol_flow_node_type *sol_flow_static_new_type_precomputed(
+    const struct sol_flow_static_spec *spec,
+    const struct sol_flow_static_precomputed *precomputed);
+
 #ifdef __cplusplus
 }
 #endif
@@ -0,0 +1,86 @@
+/*
+ * This file is part of the Soletta Project
+ *
+ * Copyright (C) 2015 Intel Corporation. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above copyright
+ *     notice, this list of conditions and the following disclaimer in
+ *     the documentation and/or other materials provided with the
+ *     distribution.
+ *   * Neither the name of Intel Corporation nor the names of its
+ *     contributors may be used to endorse or promote products derived
+ *     from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ * OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+#pragma once
+
+#include "sol-flow.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Flow threads let CPU bound parts of a flow use other cores. A flow
+ * thread node wraps a node of another type, usually a static flow
+ * (a subflow), and runs it in a dedicated thread: its ports are
+ * called there, and packets sent inside a wrapped static flow are
+ * delivered there too. The wrapped node is opened before the thread
+ * starts and closed after it stops. The flow thread node has the same
+ * ports and options as the wrapped type.
+ *
+ * Packets reaching the flow thread node are copied and queued to its
+ * thread, and packets sent by the wrapped node are queued back to the
+ * main thread, where the flow thread node sends them. Order is kept
+ * in both directions.
+ *
+ * Timeouts, idlers, file descriptor and child watches added by the
+ * wrapped nodes are watched by the main loop, but their callbacks are
+ * called in the thread too. Idlers and file descriptor watches are
+ * not watched while their callback runs, and a timeout firing again
+ * before its callback got to run is only called once. Nodes sharing
+ * state with nodes out of the flow thread must stay in the main
+ * thread.
+ *
+ * Flow inspectors (see sol-flow-inspector.h) are only called from the
+ * main thread: they see packets delivered to the wrapped node, but
+ * nothing inside it.
+ *
+ * In FBP files, a subflow is run in a thread when declared with the
+ * "thread" kind, e.g. DECLARE=Heavy:thread:heavy.fbp
+ */
+
+/**
+ * Creates a new flow thread node type.
+ *
+ * Each node of the returned type runs a node of @a child_type in a
+ * thread of its own.
+ *
+ * @param child_type The type of the node to be run in the thread. It
+ *        must outlive the returned type.
+ *
+ * @return A new node type on success, otherwise @c NULL.
+ */
+struct sol_flow_node_type *sol_flow_thread_new_type(const struct sol_flow_node_type *child_type);
+
+#ifdef __cplusplus
+}
+#endif
@@ -179,6 +179,9 @@ int sol_flow_send_string_packet(struct sol_flow_node *src, uint16_t src_port, co
 
 int sol_flow_send_string_take_packet(struct sol_flow_node *src, uint16_t src_port, char *value);
 
+/* See sol_flow_packet_new_string_slice(). */
+int sol_flow_send_string_slice_packet(struct sol_flow_node *src, uint16_t src_port, struct sol_blob *parent, const struct sol_str_slice slice);
+
 /**
  * Get a node's type.
  *
@@ -357,6 +360,27 @@ const struct sol_flow_port_type_out *sol_flow_node_type_get_port_out(const struc
  */
 void sol_flow_node_type_del(struct sol_flow_node_type *type);
 
+/**
+ * Add a function to be called by sol_shutdown(), for node types that
+ * have work to finish before the application exits, like writing
+ * data they keep in memory, even if their nodes are never deleted.
+ * Functions are called in the reverse order they were added and then
+ * forgotten, they must not add or remove functions themselves.
+ *
+ * @param cb The function to be called
+ * @param data The user data to forward to @a cb
+ * @return 0 on success, a negative errno otherwise
+ */
+int sol_flow_add_shutdown_callback(void (*cb)(void *data), const void *data);
+
+/**
+ * Remove a function added with sol_flow_add_shutdown_callback() that
+ * wasn't called yet.
+ *
+ * @return 0 on success, -ENOENT if it's not there
+ */
+int sol_flow_del_shutdown_callback(void (*cb)(void *data), const void *data);
+
 #ifdef SOL_FLOW_NODE_TYPE_DESCRIPTION_ENABLED
 /**
  * Iterator on all node types that were compiled as built-in.
@@ -63,6 +63,11 @@ struct sol_flow_builder {
 
     struct sol_vector node_extras;
 
+    /* Open addressing table mapping node names to their index in
+     * nodes, stored as index + 1 so 0 means an empty slot. */
+    uint16_t *node_index;
+    uint32_t node_index_size;
+
     /* Used to build the data structures that will compose the type
      * description. */
     struct sol_ptr_vector ports_in_desc;
@@ -77,7 +82,8 @@ struct sol_flow_builder {
 struct node_extra {
     struct sol_vector exported_options;
 
-    /* Whether builder owns the options for this node. */
+    /* Whether builder holds a reference to the (shared) options for
+     * this node, see sol_flow_node_options_ref_from_strv(). */
     bool owns_opts;
 };
 
@@ -160,10 +166,8 @@ dispose_node_options(struct builder_type_data *type_data)
 
     for (node_spec = (void *)type_data->spec.nodes, node_extra = type_data->node_extras;
         node_spec->type != NULL; node_spec++, node_extra++) {
-        if (node_extra->owns_opts && node_spec->opts) {
-            sol_flow_node_options_del(node_spec->type,
-                (struct sol_flow_node_options *)node_spec->opts);
-        }
+        if (node_extra->owns_opts && node_spec->opts)
+            sol_flow_node_options_unref(node_spec->type, node_spec->opts);
         sol_vector_clear(&node_extra->exported_options);
     }
 }
@@ -241,10 +245,8 @@ sol_flow_builder_del(struct sol_flow_builder *builder)
         if (node_extra->owns_opts) {
             struct sol_flow_static_node_spec *node_spec;
             node_spec = sol_vector_get(&builder->nodes, i);
-            if (node_spec->opts) {
-                sol_flow_node_options_del(node_spec->type,
-                    (struct sol_flow_node_options *)node_spec->opts);
-            }
+            if (node_spec->opts)
+                sol_flow_node_options_unref(node_spec->type, node_spec->opts);
         }
         sol_vector_clear(&node_extra->exported_options);
     }
@@ -259,6 +261,7 @@ sol_flow_builder_del(struct sol_flow_builder *builder)
     free(builder->type_data);
 
 end:
+    free(builder->node_index);
     free(builder);
     return 0;
 }
@@ -437,13 +440,74 @@ find_duplicated_port_names(const struct sol_flow_port_description *const *ports,
     return false;
 }
 
+static uint16_t
+node_index_find(const struct sol_flow_builder *builder, const char *name)
+{
+    uint32_t mask, i;
+
+    if (!builder->node_index)
+        return UINT16_MAX;
+
+    mask = builder->node_index_size - 1;
+    for (i = sol_flow_name_hash(name) & mask; builder->node_index[i]; i = (i + 1) & mask) {
+        const struct sol_flow_static_node_spec *node_spec;
+
+        node_spec = sol_vector_get(&builder->nodes, builder->node_index[i] - 1);
+        if (streq(name, node_spec->name))
+            return builder->node_index[i] - 1;
+    }
+
+    return UINT16_MAX;
+}
+
+static void
+node_index_insert(struct sol_flow_builder *builder, const char *name, uint16_t idx)
+{
+    uint32_t mask = builder->node_index_size - 1;
+    uint32_t i;
+
+    for (i = sol_flow_name_hash(name) & mask; builder->node_index[i]; i = (i + 1) & mask) ;
+    builder->node_index[i] = idx + 1;
+}
+
+/* Keep the load factor at most 1/2 for count nodes. */
+static int
+node_index_grow(struct sol_flow_builder *builder, uint32_t count)
+{
+    const struct sol_flow_static_node_spec *node_spec;
+    uint16_t *old_index = builder->node_index;
+    uint32_t size = builder->node_index_size;
+    uint16_t i;
+
+    if (count * 2 <= size)
+        return 0;
+
+    if (!size)
+        size = 16;
+    while (count * 2 > size)
+        size *= 2;
+
+    builder->node_index = calloc(size, sizeof(uint16_t));
+    if (!builder->node_index) {
+        builder->node_index = old_index;
+        return -ENOMEM;
+    }
+    builder->node_index_size = size;
+    free(old_index);
+
+    SOL_VECTOR_FOREACH_IDX (&builder->nodes, node_spec, i)
+        node_index_insert(builder, node_spec->name, i);
+
+    return 0;
+}
+
 SOL_API int
 sol_flow_builder_add_node(struct sol_flow_builder *builder, const char *name, const struct sol_flow_node_type *type, const struct sol_flow_node_options *option)
 {
     struct sol_flow_static_node_spec *node_spec;
     struct node_extra *node_extra;
     char *node_name;
-    uint16_t i;
+    int r;
 
     SOL_NULL_CHECK(builder, -EINVAL);
     SOL_NULL_CHECK(name, -EINVAL);
@@ -457,11 +521,19 @@ sol_flow_builder_add_node(struct sol_flow_builder *builder, const char *name, co
     }
 
     /* check if name is unique, it'll be used for connections */
-    SOL_VECTOR_FOREACH_IDX (&builder->nodes, node_spec, i)
-        if (!strcmp(name, node_spec->name)) {
-            SOL_WRN("Node not added, name %s already exists.", name);
-            return -ENOTUNIQ;
-        }
+    if (node_index_find(builder, name) != UINT16_MAX) {
+        SOL_WRN("Node not added, name %s already exists.", name);
+        return -ENOTUNIQ;
+    }
+
+    if (builder->nodes.len >= UINT16_MAX - 1) {
+        SOL_WRN("Node not added, too many nodes");
+        return -E2BIG;
+    }
+
+    r = node_index_grow(builder, builder->nodes.len + 1);
+    if (r < 0)
+        return r;
 
     /* check if port names are unique */
     if (type->description &&
@@ -495,6 +567,8 @@ sol_flow_builder_add_node(struct sol_flow_builder *builder, const char *name, co
     node_extra->owns_opts = false;
     sol_vector_init(&node_extra->exported_options, sizeof(struct sol_flow_builder_node_exported_option));
 
+    node_index_insert(builder, node_name, builder->nodes.len - 1);
+
     SOL_DBG("Node %s added: type=%p, opts=%p.", name, type, option);
 
     return 0;
@@ -531,28 +605,17 @@ conn_spec_add(struct sol_flow_builder *builder, uint16_t src, uint16_t dst, uint
 static int
 get_node(struct sol_flow_builder *builder, const char *node_name, uint16_t *out_index, struct sol_flow_static_node_spec **out_spec)
 {
-    struct sol_flow_static_node_spec *node_spec;
-    uint16_t i;
-
     SOL_NULL_CHECK(node_name, -EINVAL);
     SOL_NULL_CHECK(out_index, -EINVAL);
     SOL_NULL_CHECK(out_spec, -EINVAL);
 
-    *out_index = UINT16_MAX;
-
-    SOL_VECTOR_FOREACH_IDX (&builder->nodes, node_spec, i) {
-        if (streq(node_name, node_spec->name)) {
-            *out_index = i;
-            *out_spec = node_spec;
-            break;
-        }
-    }
-
+    *out_index = node_index_find(builder, node_name);
     if (*out_index == UINT16_MAX) {
         SOL_ERR("Failed to find node with name '%s'", node_name);
         return -EINVAL;
     }
 
+    *out_spec = sol_vector_get(&builder->nodes, *out_index);
     return 0;
 }
 
@@ -756,18 +819,18 @@ builder_type_free_options(const struct sol_flow_node_type *type, struct sol_flow
 static struct sol_flow_node_options *
 builder_type_new_options(const struct sol_flow_node_type *type, const struct sol_flow_node_options *copy_from)
 {
-    struct sol_flow_builder *builder = (struct sol_flow_builder *)type->type_data;
+    struct builder_type_data *type_data = (struct builder_type_data *)type->type_data;
     struct sol_flow_builder_options *opts;
     const struct sol_flow_node_options_member_description *member;
 
-    SOL_NULL_CHECK(builder, NULL);
+    SOL_NULL_CHECK(type_data, NULL);
 
     if (copy_from) {
         SOL_FLOW_NODE_OPTIONS_API_CHECK(copy_from, SOL_FLOW_NODE_OPTIONS_API_VERSION, NULL);
         SOL_FLOW_NODE_OPTIONS_SUB_API_CHECK(copy_from, SOL_FLOW_BUILDER_OPTIONS_API_VERSION, NULL);
     }
 
-    opts = calloc(1, builder->type_data->options_size);
+    opts = calloc(1, type_data->options_size);
     SOL_NULL_CHECK(opts, NULL);
 
     opts->base.api_version = SOL_FLOW_NODE_OPTIONS_API_VERSION;
@@ -1065,7 +1128,7 @@ find_type(const struct sol_flow_resolver *resolver, const char *id, const char *
     struct sol_flow_node_type const **type, struct sol_flow_node_options const **opts)
 {
     const struct sol_flow_node_type *tmp_type;
-    struct sol_flow_node_options *tmp_opts;
+    const struct sol_flow_node_options *tmp_opts;
     const char **opts_strv, **joined_strv = NULL;
     const char *const *strv;
     int err;
@@ -1092,7 +1155,8 @@ find_type(const struct sol_flow_resolver *resolver, const char *id, const char *
         strv = opts_strv;
     }
 
-    tmp_opts = sol_flow_node_options_new_from_strv(tmp_type, strv);
+    /* Nodes of the same type and options share them. */
+    tmp_opts = sol_flow_node_options_ref_from_strv(tmp_type, strv);
     if (!tmp_opts) {
         err = -EINVAL;
         goto end;
@@ -1145,7 +1209,8 @@ sol_flow_builder_add_node_by_type(struct sol_flow_builder *builder, const char *
 
     r = sol_flow_builder_add_node(builder, name, node_type, opts);
     if (r < 0) {
-        sol_flow_node_options_del(node_type, (struct sol_flow_node_options *)opts);
+        if (opts)
+            sol_flow_node_options_unref(node_type, opts);
     } else {
         mark_own_opts(builder, builder->nodes.len - 1);
     }
@@ -47,16 +47,75 @@
 
 extern struct sol_log_domain _sol_flow_log_domain;
 
+/* FNV-1a, used by the name indexes. The on-disk node type index
+ * generated at build time relies on this exact function. */
+static inline uint32_t
+sol_flow_name_hash(const char *name)
+{
+    uint32_t hash = 2166136261u;
+
+    for (; *name; name++) {
+        hash ^= (uint8_t)*name;
+        hash *= 16777619u;
+    }
+
+    return hash;
+}
+
+#ifdef SOL_FLOW_NODE_TYPE_DESCRIPTION_ENABLED
+const struct sol_flow_node_type *sol_flow_builtin_node_type_find(const char *name);
+#endif
+
+/* Calls deferred to the next iteration of the loop running the
+ * calling node: a 0 timeout in the main loop, or a call from the
+ * flow thread loop for nodes run by a flow thread (see
+ * sol-flow-thread.h). Must be deleted from the same thread. */
+struct sol_flow_defer;
+
+#ifdef FLOW_THREAD
+struct sol_flow_defer *sol_flow_defer_add(bool (*cb)(void *data), const void *data);
+void sol_flow_defer_del(struct sol_flow_defer *defer);
+
+/* Whether the calling thread is a flow thread. */
+bool sol_flow_thread_is_worker(void);
+#else
+#include "sol-mainloop.h"
+
+static inline struct sol_flow_defer *
+sol_flow_defer_add(bool (*cb)(void *data), const void *data)
+{
+    return (struct sol_flow_defer *)sol_timeout_add(0, cb, data);
+}
+
+static inline void
+sol_flow_defer_del(struct sol_flow_defer *defer)
+{
+    sol_timeout_del((struct sol_timeout *)defer);
+}
+#endif
+
 #ifdef SOL_FLOW_INSPECTOR_ENABLED
 #include "sol-flow-inspector.h"
 extern const struct sol_flow_inspector *_sol_flow_inspector;
 #endif
 
+/* Inspectors are called from the main thread only, nodes run by flow
+ * threads are seen up to the packets delivered to the flow thread. */
+static inline bool
+inspector_muted(void)
+{
+#ifdef FLOW_THREAD
+    return sol_flow_thread_is_worker();
+#else
+    return false;
+#endif
+}
+
 static inline void
 inspector_did_open_node(const struct sol_flow_node *node, const struct sol_flow_node_options *options)
 {
 #ifdef SOL_FLOW_INSPECTOR_ENABLED
-    if (!_sol_flow_inspector || !_sol_flow_inspector->did_open_node)
+    if (!_sol_flow_inspector || !_sol_flow_inspector->did_open_node || inspector_muted())
         return;
     _sol_flow_inspector->did_open_node(_sol_flow_inspector, node, options);
 #endif
@@ -66,7 +125,7 @@ static inline void
 inspector_will_close_node(const struct sol_flow_node *node)
 {
 #ifdef SOL_FLOW_INSPECTOR_ENABLED
-    if (!_sol_flow_inspector || !_sol_flow_inspector->will_close_node)
+    if (!_sol_flow_inspector || !_sol_flow_inspector->will_close_node || inspector_muted())
         return;
     _sol_flow_inspector->will_close_node(_sol_flow_inspector, node);
 #endif
@@ -76,7 +135,7 @@ static inline void
 inspector_did_connect_port(const struct sol_flow_node *src_node, uint16_t src_port, uint16_t src_conn_id, const struct sol_flow_node *dst_node, uint16_t dst_port, uint16_t dst_conn_id)
 {
 #ifdef SOL_FLOW_INSPECTOR_ENABLED
-    if (!_sol_flow_inspector || !_sol_flow_inspector->did_connect_port)
+    if (!_sol_flow_inspector || !_sol_flow_inspector->did_connect_port || inspector_muted())
         return;
     _sol_flow_inspector->did_connect_port(_sol_flow_inspector, src_node, src_port, src_conn_id, dst_node, dst_port, dst_conn_id);
 #endif
@@ -86,7 +145,7 @@ static inline void
 inspector_will_disconnect_port(const struct sol_flow_node *src_node, uint16_t src_port, uint16_t src_conn_id, const struct sol_flow_node *dst_node, uint16_t dst_port, uint16_t dst_conn_id)
 {
 #ifdef SOL_FLOW_INSPECTOR_ENABLED
-    if (!_sol_flow_inspector || !_sol_flow_inspector->will_disconnect_port)
+    if (!_sol_flow_inspector || !_sol_flow_inspector->will_disconnect_port || inspector_muted())
         return;
     _sol_flow_inspector->will_disconnect_port(_sol_flow_inspector, src_node, src_port, src_conn_id, dst_node, dst_port, dst_conn_id);
 #endif
@@ -97,7 +156,7 @@ static inline void
 inspector_will_send_packet(const struct sol_flow_node *src_node, uint16_t src_port, const struct sol_flow_packet *packet)
 {
 #ifdef SOL_FLOW_INSPECTOR_ENABLED
-    if (!_sol_flow_inspector || !_sol_flow_inspector->will_send_packet)
+    if (!_sol_flow_inspector || !_sol_flow_inspector->will_send_packet || inspector_muted())
         return;
     _sol_flow_inspector->will_send_packet(_sol_flow_inspector, src_node, src_port, packet);
 #endif
@@ -108,7 +167,7 @@ static inline void
 inspector_will_deliver_packet(const struct sol_flow_node *dst_node, uint16_t dst_port, uint16_t dst_conn_id, const struct sol_flow_packet *packet)
 {
 #ifdef SOL_FLOW_INSPECTOR_ENABLED
-    if (!_sol_flow_inspector || !_sol_flow_inspector->will_deliver_packet)
+    if (!_sol_flow_inspector || !_sol_flow_inspector->will_deliver_packet || inspector_muted())
         return;
     _sol_flow_inspector->will_deliver_packet(_sol_flow_inspector, dst_node, dst_port, dst_conn_id, packet);
 #endif
@@ -134,6 +193,12 @@ void sol_flow_node_fini(struct sol_flow_node *node);
 struct sol_flow_node_options *sol_flow_node_get_options(const struct sol_flow_node_type *type, const struct sol_flow_node_options *copy_from);
 void sol_flow_node_free_options(const struct sol_flow_node_type *type, struct sol_flow_node_options *options);
 
+/* Shared, immutable options parsed from strv: every reference to the
+ * same type and strv contents gets the same object, parsed once.
+ * Must not be modified, copy them to override members. */
+const struct sol_flow_node_options *sol_flow_node_options_ref_from_strv(const struct sol_flow_node_type *type, const char *const *strv);
+void sol_flow_node_options_unref(const struct sol_flow_node_type *type, const struct sol_flow_node_options *opts);
+
 #define SOL_FLOW_NODE_CHECK(handle, ...)                 \
     do {                                                \
         if (!(handle)) {                                \
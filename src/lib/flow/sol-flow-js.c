@@ -37,8 +37,15 @@
 #include "sol-arena.h"
 #include "sol-flow-internal.h"
 #include "sol-flow-js.h"
+#include "sol-mainloop.h"
 #include "sol-str-table.h"
 
+/* duk_def_prop() and the heap pointer calls came with Duktape 1.1,
+ * the rest of the API used here is in 1.0. */
+#if DUK_VERSION < 10100
+#error "Duktape 1.1 or newer is needed"
+#endif
+
 /* Contains information specific to a type based on JS. */
 struct flow_js_type {
     struct sol_flow_node_type base;
@@ -50,12 +57,25 @@ struct flow_js_type {
 
     char *js_content_buf;
     size_t js_content_buf_len;
+
+#ifdef JAVASCRIPT_SHARED_HEAP
+    /* Heap shared by all the nodes of the type, each of them runs in
+     * its own thread. The threads are kept alive by the heap stash,
+     * indexed by thread_idx, next to the compiled script (see
+     * compile_script()). */
+    struct duk_context *heap;
+    struct sol_idle *gc_idle;
+    uint32_t next_thread_idx;
+#endif
 };
 
 struct flow_js_port_in {
     struct sol_flow_port_type_in type;
     char *name;
     char *type_name;
+    /* process() gets just the value instead of an object with value
+     * and range, for int and float ports declared with 'valueOnly'. */
+    bool value_only;
 };
 
 struct flow_js_port_out {
@@ -66,8 +86,15 @@ struct flow_js_port_out {
 
 /* Contains information specific to a node of a JS node type. */
 struct flow_js_data {
-    /* Each node keeps its own JavaScript context and global object. */
+    /* Each node keeps its own JavaScript context, see create_context(). */
     struct duk_context *duk_ctx;
+    /* Port methods, in the same order they are kept in the methods
+     * stash (see setup_ports_methods()), as heap pointers. NULL if not
+     * implemented. The stash keeps them alive. */
+    void **methods;
+#ifdef JAVASCRIPT_SHARED_HEAP
+    uint32_t thread_idx;
+#endif
 };
 
 enum {
@@ -274,12 +301,12 @@ get_node_from_duk_ctx(duk_context *ctx)
 {
     struct sol_flow_node *n;
 
-    duk_push_global_object(ctx);
+    duk_push_current_function(ctx);
 
     duk_get_prop_string(ctx, -1, "\xFF" "Soletta_node_pointer");
     n = duk_require_pointer(ctx, -1);
 
-    duk_pop_2(ctx); /* Soletta_node_pointer, global object values */
+    duk_pop_2(ctx); /* Soletta_node_pointer, current function values */
 
     return n;
 }
@@ -385,8 +412,15 @@ send_error_packet(duk_context *ctx)
     return r;
 }
 
+static void
+put_port_method(struct duk_context *duk_ctx, void **methods, duk_uarridx_t idx)
+{
+    methods[idx] = duk_is_function(duk_ctx, -1) ? duk_get_heapptr(duk_ctx, -1) : NULL;
+    duk_put_prop_index(duk_ctx, -3, idx);
+}
+
 static bool
-setup_ports_in_methods(struct duk_context *duk_ctx, uint16_t ports_in_len, uint16_t base)
+setup_ports_in_methods(struct duk_context *duk_ctx, void **methods, uint16_t ports_in_len, uint16_t base)
 {
     uint16_t i;
 
@@ -400,7 +434,7 @@ setup_ports_in_methods(struct duk_context *duk_ctx, uint16_t ports_in_len, uint1
         return false;
     }
 
-    duk_push_global_stash(duk_ctx);
+    duk_dup(duk_ctx, 0); /* methods stash */
 
     for (i = 0; i < ports_in_len; i++) {
         if (!duk_get_prop_index(duk_ctx, -2, i)) {
@@ -423,24 +457,24 @@ setup_ports_in_methods(struct duk_context *duk_ctx, uint16_t ports_in_len, uint1
          */
 
         duk_get_prop_string(duk_ctx, -1, "connect");
-        duk_put_prop_index(duk_ctx, -3, base + i * PORTS_IN_METHODS_LENGTH + PORTS_IN_CONNECT_INDEX);
+        put_port_method(duk_ctx, methods, base + i * PORTS_IN_METHODS_LENGTH + PORTS_IN_CONNECT_INDEX);
 
         duk_get_prop_string(duk_ctx, -1, "disconnect");
-        duk_put_prop_index(duk_ctx, -3, base + i * PORTS_IN_METHODS_LENGTH + PORTS_IN_DISCONNECT_INDEX);
+        put_port_method(duk_ctx, methods, base + i * PORTS_IN_METHODS_LENGTH + PORTS_IN_DISCONNECT_INDEX);
 
         duk_get_prop_string(duk_ctx, -1, "process");
-        duk_put_prop_index(duk_ctx, -3, base + i * PORTS_IN_METHODS_LENGTH + PORTS_IN_PROCESS_INDEX);
+        put_port_method(duk_ctx, methods, base + i * PORTS_IN_METHODS_LENGTH + PORTS_IN_PROCESS_INDEX);
 
         duk_pop(duk_ctx); /* array entry */
     }
 
-    duk_pop_2(duk_ctx); /* in array and global_stash value */
+    duk_pop_2(duk_ctx); /* in array and methods stash */
 
     return true;
 }
 
 static bool
-setup_ports_out_methods(struct duk_context *duk_ctx, uint16_t ports_out_len, uint16_t base)
+setup_ports_out_methods(struct duk_context *duk_ctx, void **methods, uint16_t ports_out_len, uint16_t base)
 {
     uint16_t i;
 
@@ -454,7 +488,7 @@ setup_ports_out_methods(struct duk_context *duk_ctx, uint16_t ports_out_len, uin
         return false;
     }
 
-    duk_push_global_stash(duk_ctx);
+    duk_dup(duk_ctx, 0); /* methods stash */
 
     for (i = 0; i < ports_out_len; i++) {
         if (!duk_get_prop_index(duk_ctx, -2, i)) {
@@ -477,80 +511,185 @@ setup_ports_out_methods(struct duk_context *duk_ctx, uint16_t ports_out_len, uin
          */
 
         duk_get_prop_string(duk_ctx, -1, "connect");
-        duk_put_prop_index(duk_ctx, -3, base + i * PORTS_OUT_METHODS_LENGTH + PORTS_OUT_CONNECT_INDEX);
+        put_port_method(duk_ctx, methods, base + i * PORTS_OUT_METHODS_LENGTH + PORTS_OUT_CONNECT_INDEX);
 
         duk_get_prop_string(duk_ctx, -1, "disconnect");
-        duk_put_prop_index(duk_ctx, -3, base + i * PORTS_OUT_METHODS_LENGTH + PORTS_OUT_DISCONNECT_INDEX);
+        put_port_method(duk_ctx, methods, base + i * PORTS_OUT_METHODS_LENGTH + PORTS_OUT_DISCONNECT_INDEX);
 
         duk_pop(duk_ctx); /* array entry */
     }
 
-    duk_pop_2(duk_ctx); /* out array and global_stash value */
+    duk_pop_2(duk_ctx); /* out array and methods stash */
 
     return true;
 }
 
 static bool
-setup_ports_methods(duk_context *duk_ctx, uint16_t ports_in_len, uint16_t ports_out_len)
+setup_ports_methods(duk_context *duk_ctx, void **methods, uint16_t ports_in_len, uint16_t ports_out_len)
 {
-    /* We're using duktape global stash to keep reference to some JS
-     * port methods: connect(), disconnect() and process() in order
-     * to call it directly when receive a port number.
+    /* We're using an object at the bottom of the node's stack as a
+     * stash to keep reference to some JS port methods: connect(),
+     * disconnect() and process(), and their heap pointers in order to
+     * push them directly when receive a port number. It's not the
+     * global stash, as the nodes of a type may share a global
+     * environment.
      */
 
-    if (!setup_ports_in_methods(duk_ctx, ports_in_len, 0))
+    if (!setup_ports_in_methods(duk_ctx, methods, ports_in_len, 0))
         return false;
 
-    if (!setup_ports_out_methods(duk_ctx, ports_out_len, ports_in_len * PORTS_IN_METHODS_LENGTH))
+    if (!setup_ports_out_methods(duk_ctx, methods, ports_out_len, ports_in_len * PORTS_IN_METHODS_LENGTH))
         return false;
 
     return true;
 }
 
-/* open() method on JS may throw exceptions. */
-static int
-flow_js_open(struct sol_flow_node *node, void *data, const struct sol_flow_node_options *options)
+#ifdef JAVASCRIPT_SHARED_HEAP
+#define SCRIPT_STASH_KEY "\xFF" "Soletta_script"
+
+/* Closed nodes leave garbage behind in the shared heap, it's
+ * collected when the main loop is idle instead of on each close. */
+static bool
+collect_garbage(void *data)
 {
-    const struct flow_js_type *type = (struct flow_js_type *)node->type;
-    struct flow_js_data *mdata = data;
+    struct flow_js_type *type = data;
 
-    mdata->duk_ctx = duk_create_heap_default();
-    if (!mdata->duk_ctx) {
-        SOL_ERR("Failed to create a Duktape heap");
-        return -1;
-    }
+    type->gc_idle = NULL;
+    duk_gc(type->heap, 0);
+    return false;
+}
 
-    /* TODO: Check if there's a "already parsed" representation that we can use. */
-    if (duk_peval_lstring(mdata->duk_ctx, type->js_content_buf, type->js_content_buf_len) != 0) {
-        SOL_ERR("Failed to read from javascript content buffer: %s", duk_safe_to_string(mdata->duk_ctx, -1));
-        duk_destroy_heap(mdata->duk_ctx);
-        return -1;
-    }
-    duk_pop(mdata->duk_ctx); /* duk_peval_lstring() result */
+/* The threads share the global environment, nodes keep their own
+ * state in the scope of their call to the compiled script. */
+static duk_context *
+create_context(struct flow_js_type *type, struct flow_js_data *mdata)
+{
+    duk_context *ctx;
+
+    duk_push_thread(type->heap);
+    ctx = duk_get_context(type->heap, -1);
 
-    duk_push_global_object(mdata->duk_ctx);
+    mdata->thread_idx = type->next_thread_idx++;
+    duk_push_heap_stash(type->heap);
+    duk_dup(type->heap, -2);
+    duk_put_prop_index(type->heap, -2, mdata->thread_idx);
+    duk_pop_2(type->heap); /* heap stash, thread */
+
+    return ctx;
+}
+
+static void
+destroy_context(struct flow_js_type *type, struct flow_js_data *mdata)
+{
+    duk_push_heap_stash(type->heap);
+    duk_del_prop_index(type->heap, -1, mdata->thread_idx);
+    duk_pop(type->heap); /* heap stash */
+
+    if (!type->gc_idle)
+        type->gc_idle = sol_idle_add(collect_garbage, type);
+}
+#else
+static duk_context *
+create_context(struct flow_js_type *type, struct flow_js_data *mdata)
+{
+    return duk_create_heap_default();
+}
+
+static void
+destroy_context(struct flow_js_type *type, struct flow_js_data *mdata)
+{
+    duk_destroy_heap(mdata->duk_ctx);
+}
+#endif
+
+static void
+push_send_function(duk_context *ctx, duk_c_function func, struct sol_flow_node *node)
+{
+    duk_push_c_function(ctx, func, 2);
 
     /* "Soletta_node_pointer" is a hidden property. \xFF is used to give one extra level of hiding */
-    duk_push_string(mdata->duk_ctx, "\xFF" "Soletta_node_pointer");
-    duk_push_pointer(mdata->duk_ctx, node);
-    duk_def_prop(mdata->duk_ctx, -3,
+    duk_push_string(ctx, "\xFF" "Soletta_node_pointer");
+    duk_push_pointer(ctx, node);
+    duk_def_prop(ctx, -3,
         DUK_DEFPROP_HAVE_VALUE |
         DUK_DEFPROP_HAVE_WRITABLE |
         DUK_DEFPROP_HAVE_ENUMERABLE |
         DUK_DEFPROP_HAVE_CONFIGURABLE);
+}
 
-    duk_push_c_function(mdata->duk_ctx, send_packet, 2);
-    duk_put_prop_string(mdata->duk_ctx, -2, "sendPacket");
+#ifdef JAVASCRIPT_SHARED_HEAP
+static bool
+push_node_object(struct flow_js_type *type, duk_context *ctx, struct sol_flow_node *node)
+{
+    duk_push_heap_stash(ctx);
+    duk_get_prop_string(ctx, -1, SCRIPT_STASH_KEY);
+    duk_remove(ctx, -2); /* heap stash */
 
-    duk_push_c_function(mdata->duk_ctx, send_error_packet, 2);
-    duk_put_prop_string(mdata->duk_ctx, -2, "sendErrorPacket");
+    push_send_function(ctx, send_packet, node);
+    push_send_function(ctx, send_error_packet, node);
+
+    return duk_pcall(ctx, 2) == DUK_EXEC_SUCCESS;
+}
+#else
+static bool
+push_node_object(struct flow_js_type *type, duk_context *ctx, struct sol_flow_node *node)
+{
+    if (duk_peval_lstring(ctx, type->js_content_buf, type->js_content_buf_len) != 0)
+        return false;
+    duk_pop(ctx); /* duk_peval_lstring() result */
+
+    duk_push_global_object(ctx);
+
+    push_send_function(ctx, send_packet, node);
+    duk_put_prop_string(ctx, -2, "sendPacket");
+
+    push_send_function(ctx, send_error_packet, node);
+    duk_put_prop_string(ctx, -2, "sendErrorPacket");
+
+    duk_get_prop_string(ctx, -1, "node");
+    duk_remove(ctx, -2); /* global object */
+
+    return true;
+}
+#endif
+
+/* open() method on JS may throw exceptions. */
+static int
+flow_js_open(struct sol_flow_node *node, void *data, const struct sol_flow_node_options *options)
+{
+    struct flow_js_type *type = (struct flow_js_type *)node->type;
+    struct flow_js_data *mdata = data;
+    size_t methods_len;
+
+    methods_len = type->ports_in.len * PORTS_IN_METHODS_LENGTH +
+        type->ports_out.len * PORTS_OUT_METHODS_LENGTH;
+    if (methods_len > 0) {
+        mdata->methods = calloc(methods_len, sizeof(void *));
+        SOL_NULL_CHECK(mdata->methods, -ENOMEM);
+    }
+
+    mdata->duk_ctx = create_context(type, mdata);
+    if (!mdata->duk_ctx) {
+        SOL_ERR("Failed to create a Duktape context");
+        free(mdata->methods);
+        return -1;
+    }
+
+    /* Methods stash, see setup_ports_methods(). */
+    duk_push_object(mdata->duk_ctx);
 
     /* From this point node JS object is always in the top of the stack. */
-    duk_get_prop_string(mdata->duk_ctx, -1, "node");
+    if (!push_node_object(type, mdata->duk_ctx, node)) {
+        SOL_ERR("Failed to read from javascript content buffer: %s", duk_safe_to_string(mdata->duk_ctx, -1));
+        destroy_context(type, mdata);
+        free(mdata->methods);
+        return -1;
+    }
 
-    if (!setup_ports_methods(mdata->duk_ctx, type->ports_in.len, type->ports_out.len)) {
+    if (!setup_ports_methods(mdata->duk_ctx, mdata->methods, type->ports_in.len, type->ports_out.len)) {
         SOL_ERR("Failed to handle ports methods: %s", duk_safe_to_string(mdata->duk_ctx, -1));
-        duk_destroy_heap(mdata->duk_ctx);
+        destroy_context(type, mdata);
+        free(mdata->methods);
         return -1;
     }
 
@@ -572,7 +711,7 @@ flow_js_open(struct sol_flow_node *node, void *data, const struct sol_flow_node_
 static void
 flow_js_close(struct sol_flow_node *node, void *data)
 {
-    const struct flow_js_data *mdata = (struct flow_js_data *)data;
+    struct flow_js_data *mdata = data;
 
     if (duk_has_prop_string(mdata->duk_ctx, -1, "close")) {
         duk_push_string(mdata->duk_ctx, "close");
@@ -585,29 +724,25 @@ flow_js_close(struct sol_flow_node *node, void *data)
         duk_pop(mdata->duk_ctx); /* close() result */
     }
 
-    duk_destroy_heap(mdata->duk_ctx);
+    destroy_context((struct flow_js_type *)node->type, mdata);
+    free(mdata->methods);
 }
 
 static int
-process_boilerplate_pre(duk_context *ctx, struct sol_flow_node *node, uint16_t port)
+process_boilerplate_pre(const struct flow_js_data *mdata, struct sol_flow_node *node, uint16_t port)
 {
-    duk_push_global_stash(ctx);
+    void *process = mdata->methods[port * PORTS_IN_METHODS_LENGTH + PORTS_IN_PROCESS_INDEX];
 
-    if (!duk_get_prop_index(ctx, -1, port * PORTS_IN_METHODS_LENGTH + PORTS_IN_PROCESS_INDEX)) {
-        SOL_ERR("Couldn't handle '%s' process().", get_in_port_name((struct flow_js_type *)node->type, port));
-        duk_pop_2(ctx); /* get_prop() value and global_stash */
-        return -1;
-    }
-
-    if (duk_is_null_or_undefined(ctx, -1)) {
+    if (!process) {
         SOL_WRN("'%s' process() callback not implemented in javascript, ignoring incoming packets for this port",
             get_in_port_name((struct flow_js_type *)node->type, port));
-        duk_pop_2(ctx); /* get_prop() value and global_stash */
         return 0;
     }
 
+    duk_push_heapptr(mdata->duk_ctx, process);
+
     /* In order to use 'node' object as 'this' binding. */
-    duk_dup(ctx, -3);
+    duk_dup(mdata->duk_ctx, -2);
 
     return 1;
 }
@@ -618,15 +753,24 @@ process_boilerplate_post(duk_context *ctx, struct sol_flow_node *node, uint16_t
     if (duk_pcall_method(ctx, js_method_nargs) != DUK_EXEC_SUCCESS) {
         duk_error(ctx, DUK_ERR_ERROR, "Javascript %s process() function error: %s\n",
             get_in_port_name((struct flow_js_type *)node->type, port), duk_safe_to_string(ctx, -1));
-        duk_pop_2(ctx); /* process() result and global_stash */
+        duk_pop(ctx); /* process() result */
         return -1;
     }
 
-    duk_pop_2(ctx); /* process() result and global_stash */
+    duk_pop(ctx); /* process() result */
 
     return 0;
 }
 
+static bool
+in_port_is_value_only(struct sol_flow_node *node, uint16_t port)
+{
+    const struct flow_js_port_in *p;
+
+    p = sol_vector_get(&((struct flow_js_type *)node->type)->ports_in, port);
+    return p && p->value_only;
+}
+
 static int
 boolean_process(struct sol_flow_node *node, void *data, uint16_t port,
     uint16_t conn_id, const struct sol_flow_packet *packet)
@@ -638,7 +782,7 @@ boolean_process(struct sol_flow_node *node, void *data, uint16_t port,
     r = sol_flow_packet_get_boolean(packet, &value);
     SOL_INT_CHECK(r, < 0, r);
 
-    r = process_boilerplate_pre(mdata->duk_ctx, node, port);
+    r = process_boilerplate_pre(mdata, node, port);
     SOL_INT_CHECK(r, <= 0, r);
 
     duk_push_boolean(mdata->duk_ctx, value);
@@ -657,7 +801,7 @@ byte_process(struct sol_flow_node *node, void *data, uint16_t port,
     r = sol_flow_packet_get_byte(packet, &value);
     SOL_INT_CHECK(r, < 0, r);
 
-    r = process_boilerplate_pre(mdata->duk_ctx, node, port);
+    r = process_boilerplate_pre(mdata, node, port);
     SOL_INT_CHECK(r, <= 0, r);
 
     duk_push_int(mdata->duk_ctx, value);
@@ -676,7 +820,7 @@ error_process(struct sol_flow_node *node, void *data, uint16_t port,
     r = sol_flow_packet_get_error(packet, &value_code, &value_msg);
     SOL_INT_CHECK(r, < 0, r);
 
-    r = process_boilerplate_pre(mdata->duk_ctx, node, port);
+    r = process_boilerplate_pre(mdata, node, port);
     SOL_INT_CHECK(r, <= 0, r);
 
     duk_push_int(mdata->duk_ctx, value_code);
@@ -697,9 +841,14 @@ float_process(struct sol_flow_node *node, void *data, uint16_t port,
     r = sol_flow_packet_get_drange(packet, &value);
     SOL_INT_CHECK(r, < 0, r);
 
-    r = process_boilerplate_pre(mdata->duk_ctx, node, port);
+    r = process_boilerplate_pre(mdata, node, port);
     SOL_INT_CHECK(r, <= 0, r);
 
+    if (in_port_is_value_only(node, port)) {
+        duk_push_number(mdata->duk_ctx, value.val);
+        return process_boilerplate_post(mdata->duk_ctx, node, port, 1);
+    }
+
     obj_idx = duk_push_object(mdata->duk_ctx);
     duk_push_number(mdata->duk_ctx, value.val);
     duk_put_prop_string(mdata->duk_ctx, obj_idx, "val");
@@ -725,9 +874,14 @@ int_process(struct sol_flow_node *node, void *data, uint16_t port,
     r = sol_flow_packet_get_irange(packet, &value);
     SOL_INT_CHECK(r, < 0, r);
 
-    r = process_boilerplate_pre(mdata->duk_ctx, node, port);
+    r = process_boilerplate_pre(mdata, node, port);
     SOL_INT_CHECK(r, <= 0, r);
 
+    if (in_port_is_value_only(node, port)) {
+        duk_push_int(mdata->duk_ctx, value.val);
+        return process_boilerplate_post(mdata->duk_ctx, node, port, 1);
+    }
+
     obj_idx = duk_push_object(mdata->duk_ctx);
     duk_push_int(mdata->duk_ctx, value.val);
     duk_put_prop_string(mdata->duk_ctx, obj_idx, "val");
@@ -753,7 +907,7 @@ rgb_process(struct sol_flow_node *node, void *data, uint16_t port, uint16_t conn
     r = sol_flow_packet_get_rgb(packet, &value);
     SOL_INT_CHECK(r, < 0, r);
 
-    r = process_boilerplate_pre(mdata->duk_ctx, node, port);
+    r = process_boilerplate_pre(mdata, node, port);
     SOL_INT_CHECK(r, <= 0, r);
 
     obj_idx = duk_push_object(mdata->duk_ctx);
@@ -784,7 +938,7 @@ string_process(struct sol_flow_node *node, void *data, uint16_t port,
     r = sol_flow_packet_get_string(packet, &value);
     SOL_INT_CHECK(r, < 0, r);
 
-    r = process_boilerplate_pre(mdata->duk_ctx, node, port);
+    r = process_boilerplate_pre(mdata, node, port);
     SOL_INT_CHECK(r, <= 0, r);
 
     duk_push_string(mdata->duk_ctx, value);
@@ -824,30 +978,21 @@ handle_js_port_activity(struct sol_flow_node *node, void *data, uint16_t port, u
     uint16_t base, uint16_t methods_length, uint16_t method_index)
 {
     const struct flow_js_data *mdata = (struct flow_js_data *)data;
+    void *method = mdata->methods[base + port * methods_length + method_index];
 
-    duk_push_global_stash(mdata->duk_ctx);
-
-    if (!duk_get_prop_index(mdata->duk_ctx, -1, base + port * methods_length + method_index)) {
-        duk_error(mdata->duk_ctx, DUK_ERR_ERROR, "Couldn't handle '%s' %s().",
-            get_in_port_name((struct flow_js_type *)node->type, port),
-            method_index == PORTS_IN_CONNECT_INDEX ? "connect" : "disconnect");
-        duk_pop_2(mdata->duk_ctx); /* get_prop() value and global_stash */
-        return -1;
-    }
-
-    if (duk_is_null_or_undefined(mdata->duk_ctx, -1)) {
-        duk_pop_2(mdata->duk_ctx); /* get_prop() value and global_stash */
+    if (!method)
         return 0;
-    }
+
+    duk_push_heapptr(mdata->duk_ctx, method);
 
     if (duk_pcall(mdata->duk_ctx, 0) != DUK_EXEC_SUCCESS) {
         duk_error(mdata->duk_ctx, DUK_ERR_ERROR, "Javascript function error: %s\n",
             duk_safe_to_string(mdata->duk_ctx, -1));
-        duk_pop_2(mdata->duk_ctx); /* method() result and global_stash */
+        duk_pop(mdata->duk_ctx); /* method() result */
         return -1;
     }
 
-    duk_pop_2(mdata->duk_ctx); /* method() result and global_stash */
+    duk_pop(mdata->duk_ctx); /* method() result */
 
     return 0;
 }
@@ -1108,6 +1253,15 @@ setup_ports_in(struct duk_context *duk_ctx, struct sol_arena *str_arena, struct
         port_type = sol_vector_append(ports_in);
         SOL_NULL_CHECK(port_type, false);
 
+        duk_get_prop_string(duk_ctx, -3, "valueOnly");
+        port_type->value_only = duk_to_boolean(duk_ctx, -1);
+        duk_pop(duk_ctx); /* valueOnly value */
+        if (port_type->value_only && packet_type != SOL_FLOW_PACKET_TYPE_IRANGE &&
+            packet_type != SOL_FLOW_PACKET_TYPE_DRANGE) {
+            SOL_WRN("'valueOnly' is only supported by int and float ports, ignoring it on 'ports.in[%d]'", i);
+            port_type->value_only = false;
+        }
+
         port_type->type.api_version = SOL_FLOW_PORT_TYPE_IN_API_VERSION;
         port_type->type.packet_type = packet_type;
         port_type->type.process = flow_js_port_process;
@@ -1212,20 +1366,48 @@ setup_ports_out(struct duk_context *duk_ctx, struct sol_arena *str_arena, struct
     return true;
 }
 
+#ifdef JAVASCRIPT_SHARED_HEAP
+/* The script is compiled once per type, as the body of a function
+ * that gets sendPacket() and sendErrorPacket() and returns 'node'.
+ * Each node calls it (see push_node_object()), so what the script
+ * declares belongs to that call and is not seen by the other nodes.
+ * The function is kept in the heap stash and 'node' of a first call,
+ * without sendPacket(), is left on the stack to read the ports from. */
 static bool
-setup_ports(struct flow_js_type *type, const char *buf, size_t len)
+compile_script(struct duk_context *duk_ctx, const char *buf, size_t len)
 {
-    struct duk_context *duk_ctx;
+    char *wrapped;
+    int r;
 
-    duk_ctx = duk_create_heap_default();
-    if (!duk_ctx) {
-        SOL_ERR("Failed to create a Duktape heap");
+    r = asprintf(&wrapped, "(function (sendPacket, sendErrorPacket) {%.*s\nreturn node;\n})",
+        (int)len, buf);
+    SOL_INT_CHECK(r, < 0, false);
+
+    r = duk_peval_lstring(duk_ctx, wrapped, r);
+    free(wrapped);
+    if (r != 0) {
+        SOL_ERR("Failed to parse javascript content: %s", duk_safe_to_string(duk_ctx, -1));
+        return false;
+    }
+
+    duk_push_heap_stash(duk_ctx);
+    duk_dup(duk_ctx, -2);
+    duk_put_prop_string(duk_ctx, -2, SCRIPT_STASH_KEY);
+    duk_pop(duk_ctx); /* heap stash */
+
+    if (duk_pcall(duk_ctx, 0) != DUK_EXEC_SUCCESS) {
+        SOL_ERR("'node' variable not found in javascript file: %s", duk_safe_to_string(duk_ctx, -1));
         return false;
     }
 
+    return true;
+}
+#else
+static bool
+compile_script(struct duk_context *duk_ctx, const char *buf, size_t len)
+{
     if (duk_peval_lstring(duk_ctx, buf, len) != 0) {
         SOL_ERR("Failed to parse javascript content: %s", duk_safe_to_string(duk_ctx, -1));
-        duk_destroy_heap(duk_ctx);
         return false;
     }
     duk_pop(duk_ctx); /* duk_peval_lstring() result */
@@ -1234,6 +1416,25 @@ setup_ports(struct flow_js_type *type, const char *buf, size_t len)
 
     if (!duk_get_prop_string(duk_ctx, -1, "node")) {
         SOL_ERR("'node' variable not found in javascript file.");
+        return false;
+    }
+
+    return true;
+}
+#endif
+
+static bool
+setup_ports(struct flow_js_type *type, const char *buf, size_t len)
+{
+    struct duk_context *duk_ctx;
+
+    duk_ctx = duk_create_heap_default();
+    if (!duk_ctx) {
+        SOL_ERR("Failed to create a Duktape heap");
+        return false;
+    }
+
+    if (!compile_script(duk_ctx, buf, len)) {
         duk_destroy_heap(duk_ctx);
         return false;
     }
@@ -1255,7 +1456,13 @@ setup_ports(struct flow_js_type *type, const char *buf, size_t len)
         return false;
     }
 
+#ifdef JAVASCRIPT_SHARED_HEAP
+    /* Nodes call the compiled script again, this 'node' is not used. */
+    duk_set_top(duk_ctx, 0);
+    type->heap = duk_ctx;
+#else
     duk_destroy_heap(duk_ctx);
+#endif
     return true;
 }
 
@@ -1274,6 +1481,13 @@ flow_js_type_fini(struct flow_js_type *type)
     sol_vector_clear(&type->ports_out);
 
     free(type->js_content_buf);
+
+#ifdef JAVASCRIPT_SHARED_HEAP
+    if (type->gc_idle)
+        sol_idle_del(type->gc_idle);
+    if (type->heap)
+        duk_destroy_heap(type->heap);
+#endif
 }
 
 static void
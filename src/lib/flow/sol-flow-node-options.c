@@ -35,6 +35,7 @@
 #include <limits.h>
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 
 #include "sol-flow-internal.h"
 #include "sol-str-slice.h"
@@ -663,6 +664,213 @@ sol_flow_node_options_new_from_strv(const struct sol_flow_node_type *type, const
 #endif
 }
 
+#ifdef SOL_FLOW_NODE_TYPE_DESCRIPTION_ENABLED
+/* Options parsed from a strv are interned by type and strv contents,
+ * so all the nodes of a type given the same options share a single
+ * immutable object, parsed once. Entries are found by key when taking
+ * a reference and by the options pointer when releasing it, each
+ * through its own chained table. The tables go away with the last
+ * entry. */
+struct shared_options {
+    struct shared_options *next_by_key;
+    struct shared_options *next_by_opts;
+    const struct sol_flow_node_type *type;
+    struct sol_flow_node_options *opts;
+    uint64_t hash;
+    unsigned int refcnt;
+    size_t key_len;
+    char key[]; /* strv entries, each followed by its nul byte */
+};
+
+static struct shared_options **shared_by_key, **shared_by_opts;
+static unsigned int shared_size, shared_count;
+
+static uint64_t
+shared_key_hash(const struct sol_flow_node_type *type, const char *const *strv, size_t *key_len)
+{
+    uint64_t hash = sol_util_hash_mem(SOL_UTIL_HASH_INIT, &type, sizeof(type));
+    size_t len = 0;
+
+    for (; strv && *strv; strv++) {
+        size_t n = strlen(*strv) + 1;
+
+        hash = sol_util_hash_mem(hash, *strv, n);
+        len += n;
+    }
+
+    *key_len = len;
+    return hash;
+}
+
+static inline unsigned int
+shared_opts_slot(const struct sol_flow_node_options *opts)
+{
+    return sol_util_hash_mem(SOL_UTIL_HASH_INIT, &opts, sizeof(opts)) & (shared_size - 1);
+}
+
+static bool
+shared_key_eq(const struct shared_options *entry, const char *const *strv)
+{
+    const char *k = entry->key, *end = entry->key + entry->key_len;
+
+    for (; strv && *strv; strv++) {
+        size_t n = strlen(*strv) + 1;
+
+        if ((size_t)(end - k) < n || memcmp(k, *strv, n) != 0)
+            return false;
+        k += n;
+    }
+
+    return k == end;
+}
+
+static int
+shared_grow(void)
+{
+    struct shared_options **by_key, **by_opts, *entry, *next;
+    unsigned int old_size = shared_size, i;
+
+    shared_size = old_size ? old_size * 2 : 64;
+    by_key = calloc(shared_size, sizeof(*by_key));
+    by_opts = calloc(shared_size, sizeof(*by_opts));
+    if (!by_key || !by_opts) {
+        free(by_key);
+        free(by_opts);
+        shared_size = old_size;
+        return -ENOMEM;
+    }
+
+    for (i = 0; i < old_size; i++) {
+        for (entry = shared_by_key[i]; entry; entry = next) {
+            unsigned int slot;
+
+            next = entry->next_by_key;
+            slot = entry->hash & (shared_size - 1);
+            entry->next_by_key = by_key[slot];
+            by_key[slot] = entry;
+
+            slot = shared_opts_slot(entry->opts);
+            entry->next_by_opts = by_opts[slot];
+            by_opts[slot] = entry;
+        }
+    }
+
+    free(shared_by_key);
+    free(shared_by_opts);
+    shared_by_key = by_key;
+    shared_by_opts = by_opts;
+    return 0;
+}
+
+const struct sol_flow_node_options *
+sol_flow_node_options_ref_from_strv(const struct sol_flow_node_type *type, const char *const *strv)
+{
+    struct shared_options *entry;
+    unsigned int slot;
+    size_t key_len;
+    uint64_t hash;
+    char *k;
+
+    SOL_NULL_CHECK(type, NULL);
+
+    hash = shared_key_hash(type, strv, &key_len);
+    if (shared_size) {
+        for (entry = shared_by_key[hash & (shared_size - 1)]; entry; entry = entry->next_by_key) {
+            if (entry->hash == hash && entry->type == type
+                && entry->key_len == key_len && shared_key_eq(entry, strv)) {
+                entry->refcnt++;
+                return entry->opts;
+            }
+        }
+    }
+
+    if (shared_count >= shared_size && shared_grow() < 0)
+        return NULL;
+
+    entry = malloc(sizeof(*entry) + key_len);
+    SOL_NULL_CHECK(entry, NULL);
+
+    entry->opts = sol_flow_node_options_new_from_strv(type, strv);
+    if (!entry->opts) {
+        free(entry);
+        return NULL;
+    }
+
+    entry->type = type;
+    entry->hash = hash;
+    entry->refcnt = 1;
+    entry->key_len = key_len;
+    for (k = entry->key; strv && *strv; strv++) {
+        size_t n = strlen(*strv) + 1;
+
+        memcpy(k, *strv, n);
+        k += n;
+    }
+
+    slot = hash & (shared_size - 1);
+    entry->next_by_key = shared_by_key[slot];
+    shared_by_key[slot] = entry;
+
+    slot = shared_opts_slot(entry->opts);
+    entry->next_by_opts = shared_by_opts[slot];
+    shared_by_opts[slot] = entry;
+
+    shared_count++;
+    return entry->opts;
+}
+
+void
+sol_flow_node_options_unref(const struct sol_flow_node_type *type, const struct sol_flow_node_options *opts)
+{
+    struct shared_options **link, *entry;
+
+    SOL_NULL_CHECK(opts);
+
+    for (link = shared_size ? &shared_by_opts[shared_opts_slot(opts)] : NULL;
+        link && *link; link = &(*link)->next_by_opts) {
+        if ((*link)->opts == opts)
+            break;
+    }
+
+    if (!link || !*link) {
+        SOL_WRN("Options %p of type %p were not taken with sol_flow_node_options_ref_from_strv()",
+            opts, type);
+        return;
+    }
+
+    entry = *link;
+    if (--entry->refcnt > 0)
+        return;
+
+    *link = entry->next_by_opts;
+    for (link = &shared_by_key[entry->hash & (shared_size - 1)]; *link != entry;
+        link = &(*link)->next_by_key) ;
+    *link = entry->next_by_key;
+
+    sol_flow_node_options_del(entry->type, entry->opts);
+    free(entry);
+
+    if (--shared_count == 0) {
+        free(shared_by_key);
+        free(shared_by_opts);
+        shared_by_key = shared_by_opts = NULL;
+        shared_size = 0;
+    }
+}
+#else
+const struct sol_flow_node_options *
+sol_flow_node_options_ref_from_strv(const struct sol_flow_node_type *type, const char *const *strv)
+{
+    return sol_flow_node_options_new_from_strv(type, strv);
+}
+
+void
+sol_flow_node_options_unref(const struct sol_flow_node_type *type, const struct sol_flow_node_options *opts)
+{
+    sol_flow_node_options_del(type, (struct sol_flow_node_options *)opts);
+}
+#endif
+
 SOL_API struct sol_flow_node_options *
 sol_flow_node_options_copy(const struct sol_flow_node_type *type, const struct sol_flow_node_options *opts)
 {
@@ -327,29 +327,61 @@ sol_flow_packet_get_irange_value(const struct sol_flow_packet *packet, int32_t *
     return ret_val;
 }
 
+/* Strings either own their memory or point inside a parent blob they
+ * hold a reference to, so substrings can be sent without copies. */
+struct string_data {
+    char *str;
+    size_t len;
+    struct sol_blob *parent;
+};
+
 static int
 string_packet_init(const struct sol_flow_packet_type *packet_type, void *mem, const void *input)
 {
     const char *const *pin_string = input;
-    char **pstring = mem;
+    struct string_data *string = mem;
+
+    string->parent = NULL;
+    if (!*pin_string) {
+        string->str = NULL;
+        string->len = 0;
+        return 0;
+    }
+
+    string->len = strlen(*pin_string);
+    string->str = strndup(*pin_string, string->len);
+    SOL_NULL_CHECK(string->str, -ENOMEM);
+
+    return 0;
+}
+
+static int
+string_packet_get(const struct sol_flow_packet_type *packet_type, const void *mem, void *output)
+{
+    const struct string_data *string = mem;
+    const char **pout_string = output;
 
-    *pstring = (*pin_string) ? strdup(*pin_string) : NULL;
+    *pout_string = string->str;
     return 0;
 }
 
 static void
 string_packet_dispose(const struct sol_flow_packet_type *packet_type, void *mem)
 {
-    char **pstring = mem;
+    struct string_data *string = mem;
 
-    free(*pstring);
+    if (string->parent)
+        sol_blob_unref(string->parent);
+    else
+        free(string->str);
 }
 
 static const struct sol_flow_packet_type _SOL_FLOW_PACKET_TYPE_STRING = {
     .api_version = SOL_FLOW_PACKET_TYPE_API_VERSION,
     .name = "String",
-    .data_size = sizeof(char *),
+    .data_size = sizeof(struct string_data),
     .init = string_packet_init,
+    .get = string_packet_get,
     .dispose = string_packet_dispose,
 };
 
@@ -373,19 +405,20 @@ sol_flow_packet *
 sol_flow_packet_new_string_take(char *value)
 {
     struct sol_flow_packet *packet;
-    char **pstring;
+    struct string_data *string;
 
     packet = allocate_packet(SOL_FLOW_PACKET_TYPE_STRING);
     if (!packet) {
         goto error;
     }
 
-    pstring = sol_flow_packet_get_memory(packet);
-    if (!pstring) {
+    string = sol_flow_packet_get_memory(packet);
+    if (!string) {
         goto string_error;
     }
 
-    *pstring = value;
+    string->str = value;
+    string->len = value ? strlen(value) : 0;
 
     return packet;
 string_error:
@@ -396,6 +429,69 @@ error:
     return NULL;
 }
 
+static bool
+slice_is_cstr_in_blob(const struct sol_blob *blob, const struct sol_str_slice slice)
+{
+    const char *mem = blob->mem;
+
+    if (!mem || slice.data < mem || slice.data >= mem + blob->size)
+        return false;
+    if (slice.len >= (size_t)(mem + blob->size - slice.data))
+        return false;
+    return slice.data[slice.len] == '\0';
+}
+
+SOL_API struct sol_flow_packet *
+sol_flow_packet_new_string_slice(struct sol_blob *parent, const struct sol_str_slice slice)
+{
+    struct sol_flow_packet *packet;
+    struct string_data *string;
+
+    SOL_NULL_CHECK(slice.data, NULL);
+
+    packet = allocate_packet(SOL_FLOW_PACKET_TYPE_STRING);
+    SOL_NULL_CHECK(packet, NULL);
+
+    string = sol_flow_packet_get_memory(packet);
+    string->len = slice.len;
+
+    if (parent && slice_is_cstr_in_blob(parent, slice)) {
+        string->parent = sol_blob_ref(parent);
+        SOL_NULL_CHECK_GOTO(string->parent, error);
+        string->str = (char *)slice.data;
+        return packet;
+    }
+
+    /* not terminated inside the blob, needs a copy */
+    string->str = strndup(slice.data, slice.len);
+    SOL_NULL_CHECK_GOTO(string->str, error);
+
+    return packet;
+
+error:
+    free(packet);
+    return NULL;
+}
+
+SOL_API int
+sol_flow_packet_get_string_slice(const struct sol_flow_packet *packet, struct sol_str_slice *slice, struct sol_blob **parent)
+{
+    const struct string_data *string;
+
+    SOL_FLOW_PACKET_CHECK(packet, SOL_FLOW_PACKET_TYPE_STRING, -EINVAL);
+    SOL_NULL_CHECK(slice, -EINVAL);
+
+    string = sol_flow_packet_get_memory(packet);
+    SOL_NULL_CHECK(string, -EINVAL);
+
+    slice->data = string->str;
+    slice->len = string->len;
+    if (parent)
+        *parent = string->parent;
+
+    return 0;
+}
+
 static int
 blob_packet_init(const struct sol_flow_packet_type *packet_type, void *mem, const void *input)
 {
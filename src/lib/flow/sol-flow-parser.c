@@ -47,6 +47,10 @@
 #include "sol-flow-js.h"
 #endif
 
+#ifdef FLOW_THREAD
+#include "sol-flow-thread.h"
+#endif
+
 #define SOL_FLOW_PARSER_CLIENT_API_CHECK(client, expected, ...)          \
     do {                                                                \
         if ((client)->api_version != (expected)) {                      \
@@ -83,6 +87,10 @@ struct parse_state {
     struct sol_str_slice input;
     const char *filename;
 
+    /* Set when parsing from a stream instead of input. */
+    ssize_t (*read)(void *data, char *buf, size_t len);
+    void *read_data;
+
     struct sol_fbp_graph graph;
 
     /* Keep node names indexed by position to be used when making
@@ -140,6 +148,8 @@ parse_state_init(
     state->parser = parser;
     state->input = input;
     state->filename = filename;
+    state->read = NULL;
+    state->read_data = NULL;
     state->node_names = NULL;
 
     err = sol_fbp_graph_init(&state->graph);
@@ -440,10 +450,43 @@ create_js_type(
 }
 #endif
 
+#ifdef FLOW_THREAD
+static int
+create_thread_type(
+    struct parse_state *state,
+    struct sol_str_slice name,
+    struct sol_str_slice contents,
+    const struct sol_flow_node_type **type)
+{
+    const struct sol_flow_node_type *child_type;
+    struct sol_flow_node_type *result;
+    int err;
+
+    err = create_fbp_type(state, name, contents, &child_type);
+    if (err < 0)
+        return err;
+
+    result = sol_flow_thread_new_type(child_type);
+    if (!result)
+        return -EINVAL;
+
+    if (sol_ptr_vector_append(&state->parser->types, result) < 0) {
+        sol_flow_node_type_del(result);
+        return -ENOMEM;
+    }
+
+    *type = result;
+    return 0;
+}
+#endif
+
 static const struct sol_str_table_ptr creator_table[] = {
     SOL_STR_TABLE_PTR_ITEM("fbp", create_fbp_type),
 #ifdef JAVASCRIPT
     SOL_STR_TABLE_PTR_ITEM("js", create_js_type),
+#endif
+#ifdef FLOW_THREAD
+    SOL_STR_TABLE_PTR_ITEM("thread", create_thread_type),
 #endif
     { }
 };
@@ -504,7 +547,10 @@ build_flow(struct parse_state *state)
     struct sol_buffer opt_name_buf = SOL_BUFFER_EMPTY;
     int i, err = 0;
 
-    fbp_error = sol_fbp_parse(state->input, &state->graph);
+    if (state->read)
+        fbp_error = sol_fbp_parse_stream(state->read, state->read_data, &state->graph);
+    else
+        fbp_error = sol_fbp_parse(state->input, &state->graph);
     if (fbp_error) {
         sol_fbp_log_print(state->filename, fbp_error->position.line, fbp_error->position.column, fbp_error->msg);
         sol_fbp_error_free(fbp_error);
@@ -620,6 +666,33 @@ end:
     return type;
 }
 
+static struct sol_flow_node_type *
+parse_state_run(struct parse_state *state)
+{
+    struct sol_flow_parser *parser = state->parser;
+    struct sol_flow_node_type *type;
+    int err = 0;
+
+    type = build_flow(state);
+    if (!type) {
+        err = -errno;
+        goto end;
+    }
+
+    err = sol_ptr_vector_append(&parser->types, type);
+    if (err < 0) {
+        sol_flow_node_type_del(type);
+        type = NULL;
+        goto end;
+    }
+
+end:
+    parse_state_fini(state);
+    if (err < 0)
+        errno = -err;
+    return type;
+}
+
 SOL_API struct sol_flow_node_type *
 sol_flow_parse_buffer(
     struct sol_flow_parser *parser,
@@ -628,7 +701,6 @@ sol_flow_parse_buffer(
     const char *filename)
 {
     struct parse_state state;
-    struct sol_flow_node_type *type = NULL;
     int err;
 
     struct sol_str_slice input = { .data = buf, .len = len };
@@ -637,27 +709,37 @@ sol_flow_parse_buffer(
     SOL_INT_CHECK(len, == 0, NULL);
 
     err = parse_state_init(&state, parser, input, filename);
-    if (err < 0)
+    if (err < 0) {
+        errno = -err;
         return NULL;
-
-    type = build_flow(&state);
-    if (!type) {
-        err = -errno;
-        goto end;
     }
 
-    err = sol_ptr_vector_append(&parser->types, type);
+    return parse_state_run(&state);
+}
+
+SOL_API struct sol_flow_node_type *
+sol_flow_parse_stream(
+    struct sol_flow_parser *parser,
+    ssize_t (*read)(void *data, char *buf, size_t len),
+    void *data,
+    const char *filename)
+{
+    struct parse_state state;
+    int err;
+
+    SOL_NULL_CHECK(parser, NULL);
+    SOL_NULL_CHECK(read, NULL);
+
+    err = parse_state_init(&state, parser, (struct sol_str_slice)SOL_STR_SLICE_EMPTY, filename);
     if (err < 0) {
-        sol_flow_node_type_del(type);
-        type = NULL;
-        goto end;
+        errno = -err;
+        return NULL;
     }
 
-end:
-    parse_state_fini(&state);
-    if (err < 0)
-        errno = -err;
-    return type;
+    state.read = read;
+    state.read_data = data;
+
+    return parse_state_run(&state);
 }
 
 SOL_API struct sol_flow_node_type *
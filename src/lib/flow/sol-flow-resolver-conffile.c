@@ -32,9 +32,11 @@
 
 #include <assert.h>
 #include <dlfcn.h>
+#include <endian.h>
 #include <glib.h>
 
 #include "sol-conffile.h"
+#include "sol-file-reader.h"
 #include "sol-flow-internal.h"
 #include "sol-flow-resolver.h"
 #include "sol-str-slice.h"
@@ -86,6 +88,50 @@ struct resolver_conffile_dlopen {
 
 static struct sol_vector resolver_conffile_dlopens = SOL_VECTOR_INIT(struct resolver_conffile_dlopen);
 
+/* Index of the node types in the external modules, generated at build
+ * time by sol-flow-node-type-index-gen.py and mapped from
+ * FLOWMODULESDIR. All integers are little endian, offsets are from the
+ * start of the file and point to nul terminated strings. The buckets
+ * hold entry index + 1 (0 is empty), probed linearly from
+ * sol_flow_name_hash(type name). */
+#define TYPE_INDEX_FILE "node-types.index"
+#define TYPE_INDEX_MAGIC "SOLFTIDX"
+#define TYPE_INDEX_VERSION 1
+
+struct type_index_header {
+    char magic[8];
+    uint32_t version;
+    uint32_t bucket_count;
+    uint32_t entry_count;
+};
+
+struct type_index_entry {
+    uint32_t hash;
+    uint32_t name;
+    uint32_t module;
+    uint32_t symbol;
+};
+
+static struct {
+    struct sol_file_reader *reader;
+    const char *mem;
+    const uint32_t *buckets;
+    const struct type_index_entry *entries;
+    uint32_t bucket_count;
+    uint32_t entry_count;
+    bool loaded;
+} type_index;
+
+/* Types already resolved from modules, so a type used by many nodes
+ * is looked up only once. Open addressing, load factor at most 1/2. */
+struct resolved_type {
+    char *name;
+    const struct sol_flow_node_type *type;
+};
+
+static struct resolved_type *resolved_types;
+static uint32_t resolved_types_size, resolved_types_count;
+
 static void
 resolver_conffile_dlopen_free(struct resolver_conffile_dlopen *entry)
 {
@@ -104,6 +150,28 @@ resolver_conffile_clear_data(void)
     }
 
     sol_vector_clear(&resolver_conffile_dlopens);
+
+    for (i = 0; i < resolved_types_size; i++)
+        free(resolved_types[i].name);
+    free(resolved_types);
+    resolved_types = NULL;
+    resolved_types_size = 0;
+    resolved_types_count = 0;
+
+    if (type_index.reader)
+        sol_file_reader_close(type_index.reader);
+    memset(&type_index, 0, sizeof(type_index));
+}
+
+static void
+resolver_conffile_register_cleanup(void)
+{
+    static bool registered;
+
+    if (registered)
+        return;
+    registered = true;
+    atexit(resolver_conffile_clear_data);
 }
 
 const char MODULE_NAME_SEPARATOR = '/';
@@ -135,13 +203,122 @@ find_entry_by_match(struct sol_vector *entries,
 }
 
 static struct resolver_conffile_dlopen *
-find_entry_by_name(struct sol_vector *entries, const char *name)
+find_entry_by_name(struct sol_vector *entries, const struct sol_str_slice name)
 {
     struct resolver_conffile_dlopen *entry;
     unsigned int i;
 
     SOL_VECTOR_FOREACH_IDX (entries, entry, i) {
-        if (streq(name, entry->name))
+        if (sol_str_slice_str_eq(name, entry->name))
+            return entry;
+    }
+
+    return NULL;
+}
+
+static bool
+type_index_offset_valid(uint32_t offset, size_t size)
+{
+    return offset >= sizeof(struct type_index_header) && offset < size;
+}
+
+static bool
+type_index_validate(const char *mem, size_t size)
+{
+    const struct type_index_header *header = (const struct type_index_header *)mem;
+    const struct type_index_entry *entries;
+    uint32_t bucket_count, entry_count, i;
+    size_t tables_size;
+
+    if (size < sizeof(*header) || memcmp(header->magic, TYPE_INDEX_MAGIC, sizeof(header->magic)))
+        return false;
+    if (le32toh(header->version) != TYPE_INDEX_VERSION)
+        return false;
+
+    bucket_count = le32toh(header->bucket_count);
+    entry_count = le32toh(header->entry_count);
+    if (bucket_count == 0 || (bucket_count & (bucket_count - 1)) || entry_count >= bucket_count)
+        return false;
+
+    tables_size = sizeof(*header) + (size_t)bucket_count * sizeof(uint32_t)
+        + (size_t)entry_count * sizeof(struct type_index_entry);
+    /* Strings follow the tables and the last one ends the file. */
+    if (tables_size >= size || mem[size - 1] != '\0')
+        return false;
+
+    entries = (const struct type_index_entry *)(mem + sizeof(*header) + bucket_count * sizeof(uint32_t));
+    for (i = 0; i < entry_count; i++) {
+        if (!type_index_offset_valid(le32toh(entries[i].name), size)
+            || !type_index_offset_valid(le32toh(entries[i].module), size)
+            || !type_index_offset_valid(le32toh(entries[i].symbol), size))
+            return false;
+    }
+
+    for (i = 0; i < bucket_count; i++) {
+        const uint32_t *buckets = (const uint32_t *)(mem + sizeof(*header));
+        if (le32toh(buckets[i]) > entry_count)
+            return false;
+    }
+
+    return true;
+}
+
+static void
+type_index_load(void)
+{
+    char path[PATH_MAX], install_rootdir[PATH_MAX] = { 0 };
+    struct sol_str_slice contents;
+    int r;
+
+    type_index.loaded = true;
+    resolver_conffile_register_cleanup();
+
+    r = sol_util_get_rootdir(install_rootdir, sizeof(install_rootdir));
+    if (r < 0 || r >= (int)sizeof(install_rootdir))
+        return;
+
+    r = snprintf(path, sizeof(path), "%s%s/%s",
+        install_rootdir, FLOWMODULESDIR, TYPE_INDEX_FILE);
+    if (r < 0 || r >= (int)sizeof(path))
+        return;
+
+    type_index.reader = sol_file_reader_open(path);
+    if (!type_index.reader) {
+        SOL_DBG("no node type index at '%s', modules will be searched", path);
+        return;
+    }
+
+    contents = sol_file_reader_get_all(type_index.reader);
+    if (!type_index_validate(contents.data, contents.len)) {
+        SOL_WRN("invalid node type index '%s', ignoring it", path);
+        sol_file_reader_close(type_index.reader);
+        type_index.reader = NULL;
+        return;
+    }
+
+    type_index.mem = contents.data;
+    type_index.bucket_count = le32toh(((const struct type_index_header *)contents.data)->bucket_count);
+    type_index.entry_count = le32toh(((const struct type_index_header *)contents.data)->entry_count);
+    type_index.buckets = (const uint32_t *)(contents.data + sizeof(struct type_index_header));
+    type_index.entries = (const struct type_index_entry *)(type_index.buckets + type_index.bucket_count);
+}
+
+static const struct type_index_entry *
+type_index_find(const char *name)
+{
+    uint32_t hash, mask, i, b;
+
+    if (!type_index.loaded)
+        type_index_load();
+    if (!type_index.mem)
+        return NULL;
+
+    hash = sol_flow_name_hash(name);
+    mask = type_index.bucket_count - 1;
+    for (i = hash & mask; (b = le32toh(type_index.buckets[i])); i = (i + 1) & mask) {
+        const struct type_index_entry *entry = &type_index.entries[b - 1];
+
+        if (le32toh(entry->hash) == hash && streq(name, type_index.mem + le32toh(entry->name)))
             return entry;
     }
 
@@ -149,34 +326,82 @@ find_entry_by_name(struct sol_vector *entries, const char *name)
 }
 
 static const struct sol_flow_node_type *
-_resolver_conffile_get_module(const char *type)
+resolved_type_find(const char *name)
+{
+    uint32_t mask, i;
+
+    if (!resolved_types)
+        return NULL;
+
+    mask = resolved_types_size - 1;
+    for (i = sol_flow_name_hash(name) & mask; resolved_types[i].name; i = (i + 1) & mask) {
+        if (streq(name, resolved_types[i].name))
+            return resolved_types[i].type;
+    }
+
+    return NULL;
+}
+
+static void
+resolved_type_insert_at(struct resolved_type *table, uint32_t size, char *name,
+    const struct sol_flow_node_type *type)
+{
+    uint32_t mask = size - 1;
+    uint32_t i;
+
+    for (i = sol_flow_name_hash(name) & mask; table[i].name; i = (i + 1) & mask) ;
+    table[i].name = name;
+    table[i].type = type;
+}
+
+static void
+resolved_type_add(const char *name, const struct sol_flow_node_type *type)
+{
+    char *dup;
+
+    if ((resolved_types_count + 1) * 2 > resolved_types_size) {
+        uint32_t size = resolved_types_size ? resolved_types_size * 2 : 32;
+        struct resolved_type *table;
+        uint32_t i;
+
+        table = calloc(size, sizeof(struct resolved_type));
+        SOL_NULL_CHECK(table);
+
+        for (i = 0; i < resolved_types_size; i++) {
+            if (resolved_types[i].name)
+                resolved_type_insert_at(table, size, resolved_types[i].name, resolved_types[i].type);
+        }
+
+        free(resolved_types);
+        resolved_types = table;
+        resolved_types_size = size;
+    }
+
+    dup = strdup(name);
+    SOL_NULL_CHECK(dup);
+
+    resolver_conffile_register_cleanup();
+    resolved_type_insert_at(resolved_types, resolved_types_size, dup, type);
+    resolved_types_count++;
+}
+
+static struct resolver_conffile_dlopen *
+get_module_entry(const struct sol_str_slice module_name)
 {
     struct resolver_conffile_dlopen *entry;
-    const struct sol_flow_node_type *ret;
-    struct sol_str_slice module_name;
     char path[PATH_MAX], install_rootdir[PATH_MAX] = { 0 };
     char *name;
     int r, index;
 
-    module_name = get_module_for_type(type);
-    if (module_name.len == 0) {
-        SOL_DBG("Invalid empty name");
-        return NULL;
-    }
+    /* the hash entry keys are the type part only */
+    entry = find_entry_by_name(&resolver_conffile_dlopens, module_name);
+    if (entry)
+        return entry;
 
     name = strndup(module_name.data, module_name.len);
     SOL_NULL_CHECK(name, NULL);
 
-    /* the hash entry keys are the type part only */
-    entry = find_entry_by_name(&resolver_conffile_dlopens, name);
-    if (entry) {
-        free(name);
-        goto found;
-    }
-
-    if (resolver_conffile_dlopens.len == 0) {
-        atexit(resolver_conffile_clear_data);
-    }
+    resolver_conffile_register_cleanup();
 
     entry = sol_vector_append(&resolver_conffile_dlopens);
     SOL_NULL_CHECK_GOTO(entry, entry_error);
@@ -205,10 +430,7 @@ _resolver_conffile_get_module(const char *type)
         goto error;
     }
 
-found:
-    ret = resolve_module_type_by_component(type, entry->foreach);
-    SOL_NULL_CHECK_GOTO(ret, error);
-    return ret;
+    return entry;
 
 entry_error:
     free(name);
@@ -224,6 +446,78 @@ error:
     return NULL;
 }
 
+static const struct sol_flow_node_type *
+resolve_indexed_type(const char *type)
+{
+    const struct type_index_entry *index_entry;
+    const struct sol_flow_node_type *const *symbol;
+    const struct sol_flow_node_type *ret;
+    struct resolver_conffile_dlopen *entry;
+    const char *module;
+
+    index_entry = type_index_find(type);
+    if (!index_entry)
+        return NULL;
+
+    module = type_index.mem + le32toh(index_entry->module);
+    entry = get_module_entry(sol_str_slice_from_str(module));
+    if (!entry)
+        return NULL;
+
+    symbol = dlsym(entry->handle, type_index.mem + le32toh(index_entry->symbol));
+    if (!symbol || !*symbol) {
+        SOL_DBG("node type index points '%s' to missing symbol '%s' in module '%s'",
+            type, type_index.mem + le32toh(index_entry->symbol), module);
+        return NULL;
+    }
+
+    ret = *symbol;
+    SOL_FLOW_NODE_TYPE_API_CHECK(ret, SOL_FLOW_NODE_TYPE_API_VERSION, NULL);
+
+    /* The module foreach does this for every type it walks. */
+    if (ret->init_type)
+        ret->init_type();
+
+    /* Stale index, let the module search handle it. */
+    if (!ret->description || !ret->description->name || !streq(ret->description->name, type))
+        return NULL;
+
+    return ret;
+}
+
+static const struct sol_flow_node_type *
+_resolver_conffile_get_module(const char *type)
+{
+    struct resolver_conffile_dlopen *entry;
+    const struct sol_flow_node_type *ret;
+    struct sol_str_slice module_name;
+
+    ret = resolved_type_find(type);
+    if (ret)
+        return ret;
+
+    module_name = get_module_for_type(type);
+    if (module_name.len == 0) {
+        SOL_DBG("Invalid empty name");
+        return NULL;
+    }
+
+    ret = resolve_indexed_type(type);
+    if (ret)
+        goto found;
+
+    entry = get_module_entry(module_name);
+    if (!entry)
+        return NULL;
+
+    ret = resolve_module_type_by_component(type, entry->foreach);
+    SOL_NULL_CHECK(ret, NULL);
+
+found:
+    resolved_type_add(type, ret);
+    return ret;
+}
+
 static int
 resolver_conffile_resolve_by_type_name(const char *id,
     struct sol_flow_node_type const **node_type,
@@ -254,8 +548,7 @@ resolver_conffile_get_strv(const char *id,
 
     }
 
-    *node_type = resolve_module_type_by_component
-            (type_name, sol_flow_foreach_builtin_node_type);
+    *node_type = sol_flow_builtin_node_type_find(type_name);
     if (!*node_type) {
         *node_type = _resolver_conffile_get_module(type_name);
         if (!*node_type) {
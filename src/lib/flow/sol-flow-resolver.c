@@ -74,34 +74,16 @@ sol_flow_resolve(
     return 0;
 }
 
-struct find_type_ctx {
-    const char *name;
-    const struct sol_flow_node_type *type;
-};
-
-static bool
-find_type_cb(void *data, const struct sol_flow_node_type *type)
-{
-    struct find_type_ctx *ctx = data;
-
-    if (streq(ctx->name, type->description->name)) {
-        ctx->type = type;
-        return false;
-    }
-    return true;
-}
-
 static int
 builtins_resolve(void *data, const char *id, struct sol_flow_node_type const **type,
     const char ***opts_strv)
 {
-    struct find_type_ctx ctx = {};
+    const struct sol_flow_node_type *found;
 
-    ctx.name = id;
-    sol_flow_foreach_builtin_node_type(find_type_cb, &ctx);
-    if (!ctx.type)
+    found = sol_flow_builtin_node_type_find(id);
+    if (!found)
         return -ENOENT;
-    *type = ctx.type;
+    *type = found;
     /* When resolving to a type, no options are set. */
     *opts_strv = NULL;
     return 0;
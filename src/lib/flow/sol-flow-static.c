@@ -42,27 +42,14 @@
 #include "sol-mainloop.h"
 #include "sol-util.h"
 
-struct node_info {
-    uint16_t first_conn_idx;
-
-    /* TODO: check if we can move this to be per-type instead of per-node. */
-    uint16_t ports_count_in;
-    uint16_t ports_count_out;
-};
-
-struct conn_info {
-    uint16_t out_conn_id;
-    uint16_t in_conn_id;
-};
-
 struct flow_static_type {
     struct sol_flow_node_container_type base;
 
     const struct sol_flow_static_node_spec *node_specs;
     const struct sol_flow_static_conn_spec *conn_specs;
 
-    struct node_info *node_infos;
-    struct conn_info *conn_infos;
+    struct sol_flow_static_node_info *node_infos;
+    struct sol_flow_static_conn_info *conn_infos;
 
     unsigned int node_storage_size;
 
@@ -91,13 +78,25 @@ struct flow_static_type {
     /* This type was created for a single node, so when the node goes
      * down, the type will be finalized. */
     bool owned_by_node;
+
+    /* node_infos, conn_infos and the exported ports base conn ids
+     * point to the (const) tables given by the user, not to memory
+     * owned by the type. */
+    bool precomputed;
 };
 
 struct flow_static_data {
     struct sol_flow_node **nodes;
+    /* Nodes opened with the flow live here, the ones added by
+     * sol_flow_static_update() have their own allocations. */
     void *node_storage;
-    struct sol_timeout *delay_send;
+    unsigned int node_storage_size;
+    struct sol_flow_defer *delay_send;
     struct sol_list delayed_packets;
+    /* Copy of the options the flow was opened with, kept for types
+     * exporting children options so nodes added by
+     * sol_flow_static_update() get them too. */
+    struct sol_flow_node_options *options;
 };
 
 struct delayed_packet {
@@ -173,61 +172,97 @@ match_packets(const struct sol_flow_packet_type *a, const struct sol_flow_packet
     dst_id, spec->dst, spec->dst_port, ## __VA_ARGS__)
 
 static int
-connect_nodes(struct flow_static_type *type, struct flow_static_data *fsd)
+connect_conn(struct flow_static_type *type, struct flow_static_data *fsd, uint16_t idx)
 {
-    const struct sol_flow_static_conn_spec *spec;
-    int i, r;
+    const struct sol_flow_static_conn_spec *spec = &type->conn_specs[idx];
+    const struct sol_flow_static_conn_info *ci = &type->conn_infos[idx];
+    const struct sol_flow_port_type_out *src_port_type;
+    const struct sol_flow_port_type_in *dst_port_type;
+    struct sol_flow_node *src, *dst;
+    int r;
 
-    for (i = 0, spec = type->conn_specs; i < type->conn_count; i++, spec++) {
-        const struct sol_flow_port_type_out *src_port_type;
-        const struct sol_flow_port_type_in *dst_port_type;
-        struct sol_flow_node *src, *dst;
-        struct conn_info *ci;
+    src = fsd->nodes[spec->src];
+    dst = fsd->nodes[spec->dst];
 
-        src = fsd->nodes[spec->src];
-        dst = fsd->nodes[spec->dst];
-        ci = &type->conn_infos[i];
+    /* Only after a failed update, see sol_flow_static_update(). */
+    if (!src || !dst)
+        return 0;
 
-        src_port_type = sol_flow_node_type_get_port_out(src->type, spec->src_port);
-        dst_port_type = sol_flow_node_type_get_port_in(dst->type, spec->dst_port);
+    src_port_type = sol_flow_node_type_get_port_out(src->type, spec->src_port);
+    dst_port_type = sol_flow_node_type_get_port_in(dst->type, spec->dst_port);
 
+    SOL_FLOW_PORT_TYPE_OUT_API_CHECK(src_port_type, SOL_FLOW_PORT_TYPE_OUT_API_VERSION, -EINVAL);
+    SOL_FLOW_PORT_TYPE_IN_API_CHECK(dst_port_type, SOL_FLOW_PORT_TYPE_IN_API_VERSION, -EINVAL);
 
-        SOL_FLOW_PORT_TYPE_OUT_API_CHECK(src_port_type, SOL_FLOW_PORT_TYPE_OUT_API_VERSION, -EINVAL);
-        SOL_FLOW_PORT_TYPE_IN_API_CHECK(dst_port_type, SOL_FLOW_PORT_TYPE_IN_API_VERSION, -EINVAL);
+    if (!src_port_type->packet_type) {
+        CONNECT_NODES_WRN(spec, src->id, dst->id, "Invalid packet type for source port");
+        return -EINVAL;
+    }
+    if (!dst_port_type->packet_type) {
+        CONNECT_NODES_WRN(spec, src->id, dst->id, "Invalid packet type for destination port");
+        return -EINVAL;
+    }
 
-        if (!src_port_type->packet_type) {
-            CONNECT_NODES_WRN(spec, src->id, dst->id, "Invalid packet type for source port");
-            return -EINVAL;
-        }
-        if (!dst_port_type->packet_type) {
-            CONNECT_NODES_WRN(spec, src->id, dst->id, "Invalid packet type for destination port");
-            return -EINVAL;
-        }
+    if (!match_packets(src_port_type->packet_type, dst_port_type->packet_type)) {
+        CONNECT_NODES_WRN(spec, src->id, dst->id,
+            "Error matching source and destination packet types: %s != %s: %s",
+            src_port_type->packet_type->name, dst_port_type->packet_type->name,
+            sol_util_strerrora(EINVAL));
+        return -EINVAL;
+    }
 
-        if (!match_packets(src_port_type->packet_type, dst_port_type->packet_type)) {
-            CONNECT_NODES_WRN(spec, src->id, dst->id,
-                "Error matching source and destination packet types: %s != %s: %s",
-                src_port_type->packet_type->name, dst_port_type->packet_type->name,
-                sol_util_strerrora(EINVAL));
-            r = -EINVAL;
-            goto dispatch_error;
-        }
+    r = dispatch_connect_out(src, spec->src_port, ci->out_conn_id, src_port_type);
+    if (r < 0) {
+        CONNECT_NODES_WRN(spec, src->id, dst->id, "Error connecting source: %s", sol_util_strerrora(-r));
+        return r;
+    }
 
-        r = dispatch_connect_out(src, spec->src_port, ci->out_conn_id, src_port_type);
-        if (r < 0) {
-            CONNECT_NODES_WRN(spec, src->id, dst->id, "Error connecting source: %s", sol_util_strerrora(-r));
-            goto dispatch_error;
-        }
+    r = dispatch_connect_in(dst, spec->dst_port, ci->in_conn_id, dst_port_type);
+    if (r < 0) {
+        CONNECT_NODES_WRN(spec, src->id, dst->id, "Error connecting destination: %s", sol_util_strerrora(-r));
+        dispatch_disconnect_out(src, spec->src_port, ci->out_conn_id, src_port_type);
+        return r;
+    }
 
-        r = dispatch_connect_in(dst, spec->dst_port, ci->in_conn_id, dst_port_type);
-        if (r < 0) {
-            CONNECT_NODES_WRN(spec, src->id, dst->id, "Error connecting destination: %s", sol_util_strerrora(-r));
-            dispatch_disconnect_out(src, spec->src_port, ci->out_conn_id, src_port_type);
-            goto dispatch_error;
-        }
+    inspector_did_connect_port(src, spec->src_port, ci->out_conn_id,
+        dst, spec->dst_port, ci->in_conn_id);
+
+    return 0;
+}
 
-        inspector_did_connect_port(src, spec->src_port, ci->out_conn_id,
-            dst, spec->dst_port, ci->in_conn_id);
+static void
+disconnect_conn(struct flow_static_type *type, struct flow_static_data *fsd, uint16_t idx)
+{
+    const struct sol_flow_static_conn_spec *spec = &type->conn_specs[idx];
+    const struct sol_flow_static_conn_info *ci = &type->conn_infos[idx];
+    const struct sol_flow_port_type_out *src_port_type;
+    const struct sol_flow_port_type_in *dst_port_type;
+    struct sol_flow_node *src, *dst;
+
+    src = fsd->nodes[spec->src];
+    dst = fsd->nodes[spec->dst];
+    if (!src || !dst)
+        return;
+
+    src_port_type = sol_flow_node_type_get_port_out(src->type, spec->src_port);
+    dst_port_type = sol_flow_node_type_get_port_in(dst->type, spec->dst_port);
+
+    inspector_will_disconnect_port(src, spec->src_port, ci->out_conn_id,
+        dst, spec->dst_port, ci->in_conn_id);
+
+    dispatch_disconnect_out(src, spec->src_port, ci->out_conn_id, src_port_type);
+    dispatch_disconnect_in(dst, spec->dst_port, ci->in_conn_id, dst_port_type);
+}
+
+static int
+connect_nodes(struct flow_static_type *type, struct flow_static_data *fsd)
+{
+    int i, r;
+
+    for (i = 0; i < type->conn_count; i++) {
+        r = connect_conn(type, fsd, i);
+        if (r < 0)
+            goto dispatch_error;
     }
     SOL_DBG("Making %u connections.", i);
 
@@ -235,25 +270,9 @@ connect_nodes(struct flow_static_type *type, struct flow_static_data *fsd)
 
 dispatch_error:
     /* Dispatch disconnections in reverse order. Skip current failed
-     * iteration since it was handled inside the loop. */
-    i--;
-    spec--;
-    for (; i >= 0; i--, spec--) {
-        const struct sol_flow_port_type_out *src_port_type;
-        const struct sol_flow_port_type_in *dst_port_type;
-        struct sol_flow_node *src, *dst;
-        struct conn_info *ci;
-
-        src = fsd->nodes[spec->src];
-        dst = fsd->nodes[spec->dst];
-        ci = &type->conn_infos[i];
-
-        dst_port_type = sol_flow_node_type_get_port_in(dst->type, spec->dst_port);
-        dispatch_disconnect_in(dst, spec->dst_port, ci->in_conn_id, dst_port_type);
-
-        src_port_type = sol_flow_node_type_get_port_out(src->type, spec->src_port);
-        dispatch_disconnect_out(src, spec->src_port, ci->out_conn_id, src_port_type);
-    }
+     * iteration since it was handled by connect_conn(). */
+    for (i--; i >= 0; i--)
+        disconnect_conn(type, fsd, i);
 
     return r;
 }
@@ -278,6 +297,14 @@ calc_node_size(const struct sol_flow_static_node_spec *spec)
     return align_to_ptr(sizeof(struct sol_flow_node) + spec->type->data_size);
 }
 
+static bool
+node_in_storage(const struct flow_static_data *fsd, const struct sol_flow_node *node)
+{
+    uintptr_t start = (uintptr_t)fsd->node_storage;
+
+    return (uintptr_t)node >= start && (uintptr_t)node < start + fsd->node_storage_size;
+}
+
 static void
 flow_send_do(struct sol_flow_node *flow, struct flow_static_data *fsd, uint16_t src_idx, uint16_t source_out_port_idx, struct sol_flow_packet *packet)
 {
@@ -292,12 +319,14 @@ flow_send_do(struct sol_flow_node *flow, struct flow_static_data *fsd, uint16_t
     for (i = type->node_infos[src_idx].first_conn_idx, spec = type->conn_specs + i; spec->src == src_idx; spec++, i++) {
         const struct sol_flow_port_type_in *dst_port_type;
         struct sol_flow_node *dst;
-        struct conn_info *ci;
+        struct sol_flow_static_conn_info *ci;
 
         if (spec->src_port != source_out_port_idx)
             continue;
 
         dst = fsd->nodes[spec->dst];
+        if (!dst)
+            continue;
         dst_port_type = sol_flow_node_type_get_port_in(dst->type, spec->dst_port);
         ci = &type->conn_infos[i];
 
@@ -362,15 +391,51 @@ flow_delay_send(struct sol_flow_node *flow, struct flow_static_data *fsd)
         /* We want to ensure that all packets will be processed in the
          * main loop iteration immediately following the current one, even
          * when the system is loaded enough that it barely has any idle time,
-         * thus a timeout with a 0 value instead of an idler.
+         * thus a timeout with a 0 value instead of an idler. Inside a flow
+         * thread, its own loop delivers them instead.
          */
-        fsd->delay_send = sol_timeout_add(0, flow_send_idle, flow);
+        fsd->delay_send = sol_flow_defer_add(flow_send_idle, flow);
         SOL_NULL_CHECK(fsd->delay_send, -ENOMEM);
     }
 
     return 0;
 }
 
+static int
+init_child(struct sol_flow_node *flow, struct flow_static_type *type, struct flow_static_data *fsd, uint16_t idx, const struct sol_flow_node_options *options)
+{
+    const struct sol_flow_static_node_spec *spec = &type->node_specs[idx];
+    struct sol_flow_node *child_node = fsd->nodes[idx];
+    struct sol_flow_node_options *child_opts;
+    int r;
+
+    /* Nodes only read their options while opening, so the ones in
+     * the spec are used as is. A copy is needed only to fill in
+     * defaults or when the type overrides members. */
+    if (spec->opts && !type->child_opts_set) {
+        r = sol_flow_node_init(child_node, flow, spec->name, spec->type,
+            spec->opts);
+    } else {
+        child_opts = sol_flow_node_get_options(spec->type, spec->opts);
+        if (!child_opts) {
+            SOL_WRN("failed to get options for node #%u, type=%p: %s",
+                idx, spec->type, sol_util_strerrora(errno));
+        }
+
+        if (type->child_opts_set)
+            type->child_opts_set(&type->base.base, idx, options, child_opts);
+        r = sol_flow_node_init(child_node, flow, spec->name, spec->type,
+            child_opts);
+        sol_flow_node_free_options(spec->type, child_opts);
+    }
+    if (r < 0) {
+        SOL_WRN("failed to init node #%u, type=%p, opts=%p: %s",
+            idx, spec->type, spec->opts, sol_util_strerrora(-r));
+    }
+
+    return r;
+}
+
 static int
 flow_node_open(struct sol_flow_node *node, void *data, const struct sol_flow_node_options *options)
 {
@@ -385,6 +450,7 @@ flow_node_open(struct sol_flow_node *node, void *data, const struct sol_flow_nod
 
     fsd->nodes = calloc(type->node_count, sizeof(struct sol_flow_node *));
     fsd->node_storage = calloc(1, type->node_storage_size);
+    fsd->node_storage_size = type->node_storage_size;
     if (!fsd->nodes || !fsd->node_storage) {
         r = -ENOMEM;
         goto error_alloc;
@@ -398,6 +464,15 @@ flow_node_open(struct sol_flow_node *node, void *data, const struct sol_flow_nod
 
     sol_list_init(&fsd->delayed_packets);
 
+    fsd->options = NULL;
+    if (type->child_opts_set && options && node->type->new_options) {
+        fsd->options = sol_flow_node_get_options(node->type, options);
+        if (!fsd->options) {
+            r = -ENOMEM;
+            goto error_options;
+        }
+    }
+
     /* Set all pointers before calling nodes methods */
     node_storage_it = fsd->node_storage;
     for (spec = type->node_specs, i = 0; spec->type != NULL; spec++, i++) {
@@ -408,28 +483,10 @@ flow_node_open(struct sol_flow_node *node, void *data, const struct sol_flow_nod
         node_storage_it += calc_node_size(spec);
     }
 
-    for (spec = type->node_specs, i = 0; spec->type != NULL; spec++, i++) {
-        struct sol_flow_node *child_node = fsd->nodes[i];
-        struct sol_flow_node_options *child_opts;
-
-        child_opts = sol_flow_node_get_options(spec->type, spec->opts);
-        if (!child_opts) {
-            SOL_WRN("failed to get options for node #%u, type=%p: %s",
-                (unsigned)(spec - type->node_specs), spec->type,
-                sol_util_strerrora(errno));
-        }
-
-        if (type->child_opts_set)
-            type->child_opts_set(node->type, i, options, child_opts);
-        r = sol_flow_node_init(child_node, node, spec->name, spec->type,
-            child_opts);
-        sol_flow_node_free_options(spec->type, child_opts);
-        if (r < 0) {
-            SOL_WRN("failed to init node #%u, type=%p, opts=%p: %s",
-                (unsigned)(spec - type->node_specs), spec->type, spec->opts,
-                sol_util_strerrora(-r));
+    for (i = 0; i < type->node_count; i++) {
+        r = init_child(node, type, fsd, i, options);
+        if (r < 0)
             goto error_nodes;
-        }
     }
 
     r = connect_nodes(type, fsd);
@@ -444,7 +501,10 @@ error_nodes:
     for (i--; i >= 0; i--)
         sol_flow_node_fini(fsd->nodes[i]);
 
-    sol_timeout_del(fsd->delay_send);
+    sol_flow_node_free_options(node->type, fsd->options);
+
+error_options:
+    sol_flow_defer_del(fsd->delay_send);
 
 error_alloc:
     free(fsd->node_storage);
@@ -456,28 +516,10 @@ error_alloc:
 static void
 teardown_connections(struct flow_static_type *type, struct flow_static_data *fsd)
 {
-    const struct sol_flow_static_conn_spec *spec;
     int i;
 
-    for (i = type->conn_count - 1, spec = type->conn_specs + i; i >= 0; i--, spec--) {
-        const struct sol_flow_port_type_out *src_port_type;
-        const struct sol_flow_port_type_in *dst_port_type;
-        struct sol_flow_node *src, *dst;
-        struct conn_info *ci;
-
-        src = fsd->nodes[spec->src];
-        dst = fsd->nodes[spec->dst];
-        ci = &type->conn_infos[i];
-
-        src_port_type = sol_flow_node_type_get_port_out(src->type, spec->src_port);
-        dst_port_type = sol_flow_node_type_get_port_in(dst->type, spec->dst_port);
-
-        inspector_will_disconnect_port(src, spec->src_port, ci->out_conn_id,
-            dst, spec->dst_port, ci->in_conn_id);
-
-        dispatch_disconnect_out(src, spec->src_port, ci->out_conn_id, src_port_type);
-        dispatch_disconnect_in(dst, spec->dst_port, ci->in_conn_id, dst_port_type);
-    }
+    for (i = type->conn_count - 1; i >= 0; i--)
+        disconnect_conn(type, fsd, i);
 }
 
 static void flow_static_type_fini(struct flow_static_type *type);
@@ -490,7 +532,7 @@ flow_node_close(struct sol_flow_node *node, void *data)
     int i;
 
     if (fsd->delay_send)
-        sol_timeout_del(fsd->delay_send);
+        sol_flow_defer_del(fsd->delay_send);
     while (!sol_list_is_empty(&fsd->delayed_packets)) {
         struct delayed_packet *dp;
         struct sol_list *itr = fsd->delayed_packets.next;
@@ -502,18 +544,25 @@ flow_node_close(struct sol_flow_node *node, void *data)
 
     teardown_connections(type, fsd);
 
-    for (i = type->node_count - 1; i >= 0; i--)
+    for (i = type->node_count - 1; i >= 0; i--) {
+        if (!fsd->nodes[i])
+            continue;
         sol_flow_node_fini(fsd->nodes[i]);
+        if (!node_in_storage(fsd, fsd->nodes[i]))
+            free(fsd->nodes[i]);
+    }
 
     free(fsd->node_storage);
     free(fsd->nodes);
 
+    sol_flow_node_free_options(node->type, fsd->options);
+
     if (type->owned_by_node)
         sol_flow_node_type_del(&type->base.base);
 }
 
 static bool
-flow_port_out_is_valid(struct node_info *ninfo, uint16_t port_idx)
+flow_port_out_is_valid(struct sol_flow_static_node_info *ninfo, uint16_t port_idx)
 {
     if (port_idx == SOL_FLOW_NODE_PORT_ERROR)
         return true;
@@ -522,7 +571,7 @@ flow_port_out_is_valid(struct node_info *ninfo, uint16_t port_idx)
 }
 
 static bool
-flow_port_in_is_valid(struct node_info *ninfo, uint16_t port_idx)
+flow_port_in_is_valid(struct sol_flow_static_node_info *ninfo, uint16_t port_idx)
 {
     SOL_INT_CHECK(port_idx, >= ninfo->ports_count_in, false);
     return true;
@@ -623,12 +672,12 @@ setup_node_specs(struct flow_static_type *type)
         return -EINVAL;
     }
 
-    type->node_infos = calloc(count, sizeof(struct node_info));
+    type->node_infos = calloc(count, sizeof(struct sol_flow_static_node_info));
     if (!type->node_infos)
         return -ENOMEM;
 
     for (u = 0, spec = type->node_specs; u < count; u++, spec++) {
-        struct node_info *ni;
+        struct sol_flow_static_node_info *ni;
         ni = &type->node_infos[u];
         spec->type->get_ports_counts(spec->type, &ni->ports_count_in, &ni->ports_count_out);
     }
@@ -641,7 +690,8 @@ setup_node_specs(struct flow_static_type *type)
 static void
 teardown_node_specs(struct flow_static_type *type)
 {
-    free(type->node_infos);
+    if (!type->precomputed)
+        free(type->node_infos);
 }
 
 #define INVALID_SPEC_WRN(spec, reason, ...)                     \
@@ -679,42 +729,84 @@ is_valid_spec(struct flow_static_type *type, const struct sol_flow_static_conn_s
 
 #undef INVALID_SPEC_WRN
 
-static void
+/* Connection ids are given per port, in the order connections appear
+ * in conn_specs. Exported ports get ids after the internal
+ * connections of the port they export. Counting is done in a single
+ * pass over the connections, using per-port counters laid out by node
+ * (offsets are the prefix sums of the nodes' ports counts). */
+static int
 setup_conn_ids(struct flow_static_type *type)
 {
-    uint16_t node, exported_in = 0, exported_out = 0;
+    const struct sol_flow_static_conn_spec *spec;
+    uint32_t *in_offsets, *out_offsets, in_total = 0, out_total = 0;
+    uint16_t *in_counts, *out_counts;
+    uint16_t node, i;
+    int r = -ENOMEM;
+
+    in_offsets = malloc(type->node_count * sizeof(uint32_t));
+    out_offsets = malloc(type->node_count * sizeof(uint32_t));
+    if (!in_offsets || !out_offsets)
+        goto end_offsets;
 
     for (node = 0; node < type->node_count; node++) {
-        uint16_t port, port_count;
-        port_count = type->node_infos[node].ports_count_out;
-
-        for (port = 0; port < port_count; port++) {
-            const struct sol_flow_static_conn_spec *spec;
-            unsigned int i;
-            uint16_t in_conn_id = 0, out_conn_id = 0;
-
-            for (spec = type->conn_specs, i = 0; i < type->conn_count; spec++, i++) {
-                if (spec->dst == node && spec->dst_port == port)
-                    type->conn_infos[i].in_conn_id = in_conn_id++;
-                if (spec->src == node && spec->src_port == port)
-                    type->conn_infos[i].out_conn_id = out_conn_id++;
-            }
+        in_offsets[node] = in_total;
+        out_offsets[node] = out_total;
+        in_total += type->node_infos[node].ports_count_in;
+        out_total += type->node_infos[node].ports_count_out;
+    }
 
-            if (exported_in < type->ports_in_count) {
-                const struct sol_flow_static_port_spec *pspec;
-                pspec = &type->exported_in_specs[exported_in];
-                if (pspec->node == node && pspec->port == port)
-                    type->ports_in_base_conn_id[exported_in++] = in_conn_id;
-            }
+    in_counts = calloc(in_total ? in_total : 1, sizeof(uint16_t));
+    out_counts = calloc(out_total ? out_total : 1, sizeof(uint16_t));
+    if (!in_counts || !out_counts)
+        goto end_counts;
 
-            if (exported_out < type->ports_out_count) {
-                const struct sol_flow_static_port_spec *pspec;
-                pspec = &type->exported_out_specs[exported_out];
-                if (pspec->node == node && pspec->port == port)
-                    type->ports_out_base_conn_id[exported_out++] = out_conn_id;
-            }
+    for (spec = type->conn_specs, i = 0; i < type->conn_count; spec++, i++) {
+        struct sol_flow_static_conn_info *ci = &type->conn_infos[i];
+
+        ci->in_conn_id = in_counts[in_offsets[spec->dst] + spec->dst_port]++;
+
+        /* the error port is not a regular port, its ids are all 0 */
+        if (spec->src_port < type->node_infos[spec->src].ports_count_out)
+            ci->out_conn_id = out_counts[out_offsets[spec->src] + spec->src_port]++;
+        else
+            ci->out_conn_id = 0;
+    }
+
+    for (i = 0; i < type->ports_in_count; i++) {
+        const struct sol_flow_static_port_spec *pspec = &type->exported_in_specs[i];
+
+        if (pspec->node >= type->node_count ||
+            pspec->port >= type->node_infos[pspec->node].ports_count_in) {
+            SOL_WRN("Invalid exported in port { .node=%hu, .port=%hu }",
+                pspec->node, pspec->port);
+            r = -EINVAL;
+            goto end_counts;
         }
+        type->ports_in_base_conn_id[i] = in_counts[in_offsets[pspec->node] + pspec->port];
     }
+
+    for (i = 0; i < type->ports_out_count; i++) {
+        const struct sol_flow_static_port_spec *pspec = &type->exported_out_specs[i];
+
+        if (pspec->node >= type->node_count ||
+            pspec->port >= type->node_infos[pspec->node].ports_count_out) {
+            SOL_WRN("Invalid exported out port { .node=%hu, .port=%hu }",
+                pspec->node, pspec->port);
+            r = -EINVAL;
+            goto end_counts;
+        }
+        type->ports_out_base_conn_id[i] = out_counts[out_offsets[pspec->node] + pspec->port];
+    }
+
+    r = 0;
+
+end_counts:
+    free(in_counts);
+    free(out_counts);
+end_offsets:
+    free(in_offsets);
+    free(out_offsets);
+    return r;
 }
 
 static int
@@ -750,7 +842,7 @@ setup_conn_specs(struct flow_static_type *type)
     }
 
     if (count > 0) {
-        type->conn_infos = calloc(count, sizeof(struct conn_info));
+        type->conn_infos = calloc(count, sizeof(struct sol_flow_static_conn_info));
         if (!type->conn_infos)
             return -ENOMEM;
     } else {
@@ -759,15 +851,14 @@ setup_conn_specs(struct flow_static_type *type)
 
     type->conn_count = count;
 
-    setup_conn_ids(type);
-
     return 0;
 }
 
 static void
 teardown_conn_specs(struct flow_static_type *type)
 {
-    free(type->conn_infos);
+    if (!type->precomputed)
+        free(type->conn_infos);
 }
 
 static int
@@ -808,6 +899,7 @@ flow_exported_port_process(struct sol_flow_node *node, void *data, uint16_t port
 
     child_port = type->exported_in_specs[port].port;
     child_node = fsd->nodes[type->exported_in_specs[port].node];
+    SOL_NULL_CHECK(child_node, -ENOENT);
     child_conn_id = type->ports_in_base_conn_id[port] + conn_id;
 
     dispatch_process(child_node, child_port, child_conn_id,
@@ -829,6 +921,7 @@ flow_exported_port_in_connect(struct sol_flow_node *node, void *data, uint16_t p
 
     child_port = type->exported_in_specs[port].port;
     child_node = fsd->nodes[type->exported_in_specs[port].node];
+    SOL_NULL_CHECK(child_node, -ENOENT);
     child_conn_id = type->ports_in_base_conn_id[port] + conn_id;
 
     return dispatch_connect_in(child_node, child_port, child_conn_id,
@@ -848,6 +941,7 @@ flow_exported_port_in_disconnect(struct sol_flow_node *node, void *data, uint16_
 
     child_port = type->exported_in_specs[port].port;
     child_node = fsd->nodes[type->exported_in_specs[port].node];
+    SOL_NULL_CHECK(child_node, -ENOENT);
     child_conn_id = type->ports_in_base_conn_id[port] + conn_id;
 
     return dispatch_disconnect_in(child_node, child_port, child_conn_id,
@@ -867,6 +961,7 @@ flow_exported_port_out_connect(struct sol_flow_node *node, void *data, uint16_t
 
     child_port = type->exported_out_specs[port].port;
     child_node = fsd->nodes[type->exported_out_specs[port].node];
+    SOL_NULL_CHECK(child_node, -ENOENT);
     child_conn_id = type->ports_out_base_conn_id[port] + conn_id;
 
     return dispatch_connect_out(child_node, child_port, child_conn_id,
@@ -886,6 +981,7 @@ flow_exported_port_out_disconnect(struct sol_flow_node *node, void *data, uint16
 
     child_port = type->exported_out_specs[port].port;
     child_node = fsd->nodes[type->exported_out_specs[port].node];
+    SOL_NULL_CHECK(child_node, -ENOENT);
     child_conn_id = type->ports_out_base_conn_id[port] + conn_id;
 
     return dispatch_disconnect_out(child_node, child_port, child_conn_id,
@@ -895,12 +991,10 @@ flow_exported_port_out_disconnect(struct sol_flow_node *node, void *data, uint16
 static void
 teardown_exported_ports_specs(struct flow_static_type *type)
 {
-    if (type->ports_in_count > 0) {
-        free(type->ports_in);
+    free(type->ports_in);
+    free(type->ports_out);
+    if (!type->precomputed) {
         free(type->ports_in_base_conn_id);
-    }
-    if (type->ports_out_count > 0) {
-        free(type->ports_out);
         free(type->ports_out_base_conn_id);
     }
 }
@@ -938,9 +1032,13 @@ setup_exported_ports_specs(struct flow_static_type *type)
         struct sol_flow_port_type_in *port_type;
         type->ports_in_count = in_count;
         type->ports_in = calloc(in_count, sizeof(struct sol_flow_port_type_in));
-        type->ports_in_base_conn_id = calloc(in_count, sizeof(uint16_t));
-        if (!type->ports_in || !type->ports_in_base_conn_id)
+        if (!type->ports_in)
             goto fail_nomem;
+        if (!type->precomputed) {
+            type->ports_in_base_conn_id = calloc(in_count, sizeof(uint16_t));
+            if (!type->ports_in_base_conn_id)
+                goto fail_nomem;
+        }
 
         for (u = 0; u < in_count; u++) {
             node = type->exported_in_specs[u].node;
@@ -958,9 +1056,13 @@ setup_exported_ports_specs(struct flow_static_type *type)
         struct sol_flow_port_type_out *port_type;
         type->ports_out_count = out_count;
         type->ports_out = calloc(out_count, sizeof(struct sol_flow_port_type_out));
-        type->ports_out_base_conn_id = calloc(out_count, sizeof(uint16_t));
-        if (!type->ports_out || !type->ports_out_base_conn_id)
+        if (!type->ports_out)
             goto fail_nomem;
+        if (!type->precomputed) {
+            type->ports_out_base_conn_id = calloc(out_count, sizeof(uint16_t));
+            if (!type->ports_out_base_conn_id)
+                goto fail_nomem;
+        }
 
         for (u = 0; u < out_count; u++) {
             node = type->exported_out_specs[u].node;
@@ -992,10 +1094,87 @@ flow_dispose_type(struct sol_flow_node_type *type)
     free(fst);
 }
 
+/* Precomputed tables replace the connection validation and the
+ * connection ids computation, only the parts that depend on the
+ * runtime node types (storage size, ports counts check and exported
+ * port types) are done here. */
+static int
+setup_precomputed(struct flow_static_type *type, const struct sol_flow_static_precomputed *precomputed)
+{
+    const struct sol_flow_static_node_spec *spec;
+    unsigned int storage_size = 0;
+    uint16_t u;
+    int r;
+
+    SOL_INT_CHECK(precomputed->node_count, == 0, -EINVAL);
+    SOL_INT_CHECK(precomputed->node_count, == UINT16_MAX, -EINVAL);
+    SOL_INT_CHECK(precomputed->conn_count, == UINT16_MAX, -EINVAL);
+    SOL_NULL_CHECK(precomputed->node_infos, -EINVAL);
+    if (precomputed->conn_count > 0)
+        SOL_NULL_CHECK(precomputed->conn_infos, -EINVAL);
+
+    if (type->node_specs[precomputed->node_count].type != NULL) {
+        SOL_WRN("precomputed node_count=%hu doesn't match the node specs",
+            precomputed->node_count);
+        return -EINVAL;
+    }
+
+    if (type->conn_specs[precomputed->conn_count].src != UINT16_MAX) {
+        SOL_WRN("precomputed conn_count=%hu doesn't match the conn specs",
+            precomputed->conn_count);
+        return -EINVAL;
+    }
+
+    for (u = 0, spec = type->node_specs; u < precomputed->node_count; u++, spec++) {
+        const struct sol_flow_static_node_info *ni = &precomputed->node_infos[u];
+        unsigned int node_size = calc_node_size(spec);
+        uint16_t in, out;
+
+        if (UINT_MAX - node_size < storage_size) {
+            SOL_WRN("no memory to fit node size: %u in %u", node_size, storage_size);
+            return -ENOMEM;
+        }
+        storage_size += node_size;
+
+        /* Node types may set up their port types when asked for the
+         * ports counts, so this can't be skipped. */
+        spec->type->get_ports_counts(spec->type, &in, &out);
+        if (in != ni->ports_count_in || out != ni->ports_count_out) {
+            SOL_WRN("precomputed ports counts for node %hu (in=%hu, out=%hu) "
+                "don't match its type (in=%hu, out=%hu)",
+                u, ni->ports_count_in, ni->ports_count_out, in, out);
+            return -EINVAL;
+        }
+    }
+
+    /* The tables are never written to when the type is precomputed. */
+    type->node_infos = (struct sol_flow_static_node_info *)precomputed->node_infos;
+    type->conn_infos = (struct sol_flow_static_conn_info *)precomputed->conn_infos;
+    type->node_count = precomputed->node_count;
+    type->conn_count = precomputed->conn_count;
+    type->node_storage_size = storage_size;
+
+    r = setup_exported_ports_specs(type);
+    SOL_INT_CHECK(r, < 0, r);
+
+    if ((type->ports_in_count > 0 && !precomputed->exported_in_base_conn_ids) ||
+        (type->ports_out_count > 0 && !precomputed->exported_out_base_conn_ids)) {
+        SOL_WRN("missing precomputed base connection ids for exported ports");
+        teardown_exported_ports_specs(type);
+        return -EINVAL;
+    }
+
+    type->ports_in_base_conn_id = (uint16_t *)precomputed->exported_in_base_conn_ids;
+    type->ports_out_base_conn_id = (uint16_t *)precomputed->exported_out_base_conn_ids;
+
+    return 0;
+}
+
 static int
 flow_static_type_init(
     struct flow_static_type *type,
-    const struct sol_flow_static_spec *spec)
+    const struct sol_flow_static_spec *spec,
+    const struct sol_flow_static_precomputed *precomputed)
 {
     int r;
 
@@ -1020,8 +1199,12 @@ flow_static_type_init(
         .exported_out_specs = spec->exported_out,
         .child_opts_set = spec->child_opts_set,
         .dispose = spec->dispose,
+        .precomputed = !!precomputed,
     };
 
+    if (precomputed)
+        return setup_precomputed(type, precomputed);
+
     r = setup_node_specs(type);
     if (r < 0)
         return r;
@@ -1039,7 +1222,13 @@ flow_static_type_init(
         return r;
     }
 
-    setup_conn_ids(type);
+    r = setup_conn_ids(type);
+    if (r < 0) {
+        teardown_exported_ports_specs(type);
+        teardown_conn_specs(type);
+        teardown_node_specs(type);
+        return r;
+    }
 
     return 0;
 }
@@ -1116,9 +1305,398 @@ sol_flow_static_get_node(struct sol_flow_node *flow, uint16_t index)
     return fsd->nodes[index];
 }
 
-SOL_API struct sol_flow_node_type *
-sol_flow_static_new_type(
-    const struct sol_flow_static_spec *spec)
+struct node_name_idx {
+    const char *name;
+    uint16_t idx;
+};
+
+static int
+compare_node_names(const void *a, const void *b)
+{
+    const struct node_name_idx *na = a, *nb = b;
+
+    return strcmp(na->name, nb->name);
+}
+
+/* A node is kept by an update if the new type has a node with the
+ * same name (or, for unnamed nodes, at the same index), the same node
+ * type and the very same options. Most nodes keep their index, so it's
+ * tried first, the names are only sorted for the ones that moved.
+ * Indexes of nodes that are not kept are set to UINT16_MAX in both
+ * maps. */
+static int
+match_nodes(const struct flow_static_type *old_type, const struct flow_static_type *new_type, uint16_t *old_to_new, uint16_t *new_to_old)
+{
+    const struct sol_flow_static_node_spec *old_spec, *new_spec;
+    struct node_name_idx *names = NULL, key, *found;
+    uint16_t i, j, named = 0;
+
+    for (j = 0; j < new_type->node_count; j++)
+        new_to_old[j] = UINT16_MAX;
+
+    for (i = 0; i < old_type->node_count; i++) {
+        old_spec = &old_type->node_specs[i];
+        old_to_new[i] = UINT16_MAX;
+
+        if (i < new_type->node_count &&
+            (old_spec->name == new_type->node_specs[i].name ||
+            (old_spec->name && new_type->node_specs[i].name &&
+            streq(old_spec->name, new_type->node_specs[i].name)))) {
+            j = i;
+        } else if (old_spec->name) {
+            if (!names) {
+                names = malloc(new_type->node_count * sizeof(*names));
+                SOL_NULL_CHECK(names, -ENOMEM);
+
+                for (j = 0; j < new_type->node_count; j++) {
+                    if (!new_type->node_specs[j].name)
+                        continue;
+                    names[named].name = new_type->node_specs[j].name;
+                    names[named].idx = j;
+                    named++;
+                }
+                qsort(names, named, sizeof(*names), compare_node_names);
+            }
+
+            key.name = old_spec->name;
+            found = bsearch(&key, names, named, sizeof(*names), compare_node_names);
+            if (!found)
+                continue;
+            j = found->idx;
+        } else {
+            continue;
+        }
+
+        new_spec = &new_type->node_specs[j];
+        if (new_spec->type != old_spec->type || new_spec->opts != old_spec->opts)
+            continue;
+        if (new_to_old[j] != UINT16_MAX)
+            continue;
+
+        old_to_new[i] = j;
+        new_to_old[j] = i;
+    }
+
+    free(names);
+    return 0;
+}
+
+/* Connections from the enclosing flow are left alone, so the exported
+ * ports must map to the same kept nodes, ports and connection ids. */
+static bool
+exported_ports_match(const struct flow_static_type *old_type, const struct flow_static_type *new_type, const uint16_t *new_to_old)
+{
+    uint16_t u;
+
+    if (old_type->ports_in_count != new_type->ports_in_count ||
+        old_type->ports_out_count != new_type->ports_out_count)
+        return false;
+
+    for (u = 0; u < new_type->ports_in_count; u++) {
+        const struct sol_flow_static_port_spec *o = &old_type->exported_in_specs[u];
+        const struct sol_flow_static_port_spec *n = &new_type->exported_in_specs[u];
+
+        if (new_to_old[n->node] != o->node || n->port != o->port ||
+            new_type->ports_in_base_conn_id[u] != old_type->ports_in_base_conn_id[u])
+            return false;
+    }
+
+    for (u = 0; u < new_type->ports_out_count; u++) {
+        const struct sol_flow_static_port_spec *o = &old_type->exported_out_specs[u];
+        const struct sol_flow_static_port_spec *n = &new_type->exported_out_specs[u];
+
+        if (new_to_old[n->node] != o->node || n->port != o->port ||
+            new_type->ports_out_base_conn_id[u] != old_type->ports_out_base_conn_id[u])
+            return false;
+    }
+
+    return true;
+}
+
+/* Nodes added by an update get their exported options from the ones
+ * the flow was opened with, so the new type must lay them out the
+ * very same way. */
+static bool
+exported_options_match(const struct flow_static_type *old_type, const struct flow_static_type *new_type, const struct sol_flow_node_options *options)
+{
+#ifdef SOL_FLOW_NODE_TYPE_DESCRIPTION_ENABLED
+    const struct sol_flow_node_type *o = &old_type->base.base, *n = &new_type->base.base;
+    const struct sol_flow_node_options_member_description *om, *nm;
+
+    if (!new_type->child_opts_set)
+        return true;
+    if (!options || !n->new_options)
+        return false;
+    if (!o->description || !o->description->options ||
+        !n->description || !n->description->options)
+        return false;
+    if (o->description->options->sub_api != n->description->options->sub_api)
+        return false;
+
+    for (om = o->description->options->members, nm = n->description->options->members;
+        om->name && nm->name; om++, nm++) {
+        if (!streq(om->name, nm->name) || !streq(om->data_type, nm->data_type) ||
+            om->offset != nm->offset || om->size != nm->size)
+            return false;
+    }
+
+    return !om->name && !nm->name;
+#else
+    return !new_type->child_opts_set;
+#endif
+}
+
+/* A connection is kept if both its ends are kept and it has the same
+ * ports and connection ids in both types, nodes never notice it. */
+static void
+match_conns(const struct flow_static_type *old_type, const struct flow_static_type *new_type, const uint16_t *new_to_old, bool *old_kept, bool *new_kept)
+{
+    const struct sol_flow_static_conn_spec *old_spec, *new_spec;
+    const struct sol_flow_static_conn_info *old_ci, *new_ci;
+    uint16_t i, j, src, dst;
+
+    for (j = 0, new_spec = new_type->conn_specs; j < new_type->conn_count; j++, new_spec++) {
+        src = new_to_old[new_spec->src];
+        dst = new_to_old[new_spec->dst];
+        if (src == UINT16_MAX || dst == UINT16_MAX)
+            continue;
+
+        new_ci = &new_type->conn_infos[j];
+        for (i = old_type->node_infos[src].first_conn_idx, old_spec = old_type->conn_specs + i;
+            old_spec->src == src; old_spec++, i++) {
+            old_ci = &old_type->conn_infos[i];
+            if (old_kept[i] ||
+                old_spec->src_port != new_spec->src_port ||
+                old_spec->dst != dst ||
+                old_spec->dst_port != new_spec->dst_port ||
+                old_ci->out_conn_id != new_ci->out_conn_id ||
+                old_ci->in_conn_id != new_ci->in_conn_id)
+                continue;
+
+            old_kept[i] = true;
+            new_kept[j] = true;
+            break;
+        }
+    }
+}
+
+/* Packets queued by nodes that are gone are dropped, the others follow
+ * their source node to its new index. */
+static void
+remap_delayed_packets(struct flow_static_data *fsd, const uint16_t *map)
+{
+    struct sol_list *itr, *itr_next;
+
+    SOL_LIST_FOREACH_SAFE (&fsd->delayed_packets, itr, itr_next) {
+        struct delayed_packet *dp;
+
+        dp = SOL_LIST_GET_CONTAINER(itr, struct delayed_packet, list);
+        if (map[dp->source_idx] != UINT16_MAX) {
+            dp->source_idx = map[dp->source_idx];
+            continue;
+        }
+
+        sol_list_remove(itr);
+        sol_flow_packet_del(dp->packet);
+        free(dp);
+    }
+}
+
+SOL_API int
+sol_flow_static_update(struct sol_flow_node *flow, const struct sol_flow_node_type *new_type)
+{
+    struct flow_static_type *old_type, *type;
+    struct flow_static_data *fsd;
+    struct sol_flow_node **nodes = NULL, **old_nodes;
+    struct sol_flow_node_options *options = NULL;
+    uint16_t *old_to_new = NULL, *new_to_old = NULL;
+    bool *old_conn_kept = NULL, *new_conn_kept = NULL;
+    int i, j, r;
+
+    SOL_NULL_CHECK(flow, -EINVAL);
+    SOL_FLOW_STATIC_TYPE_CHECK(flow->type, -EINVAL);
+    SOL_FLOW_STATIC_TYPE_CHECK(new_type, -EINVAL);
+
+    if (flow->type == new_type)
+        return 0;
+
+    old_type = (struct flow_static_type *)flow->type;
+    type = (struct flow_static_type *)new_type;
+    fsd = sol_flow_node_get_private_data(flow);
+    old_nodes = fsd->nodes;
+
+    r = -ENOMEM;
+    old_to_new = malloc(old_type->node_count * sizeof(uint16_t));
+    new_to_old = malloc(type->node_count * sizeof(uint16_t));
+    old_conn_kept = calloc(old_type->conn_count + 1, sizeof(bool));
+    new_conn_kept = calloc(type->conn_count + 1, sizeof(bool));
+    nodes = calloc(type->node_count, sizeof(struct sol_flow_node *));
+    if (!old_to_new || !new_to_old || !old_conn_kept || !new_conn_kept || !nodes)
+        goto end;
+
+    r = match_nodes(old_type, type, old_to_new, new_to_old);
+    if (r < 0)
+        goto end;
+
+    /* Nodes lost by a failed update can't be kept. */
+    for (i = 0; i < old_type->node_count; i++) {
+        if (!old_nodes[i] && old_to_new[i] != UINT16_MAX) {
+            new_to_old[old_to_new[i]] = UINT16_MAX;
+            old_to_new[i] = UINT16_MAX;
+        }
+    }
+
+    if (flow->parent && !exported_ports_match(old_type, type, new_to_old)) {
+        SOL_WRN("Exported ports of flow '%s' (%p) changed, it can't be updated in place",
+            flow->id, flow);
+        r = -ENOTSUP;
+        goto end;
+    }
+
+    if (!exported_options_match(old_type, type, fsd->options)) {
+        SOL_WRN("Exported options of flow '%s' (%p) changed, it can't be updated in place",
+            flow->id, flow);
+        r = -ENOTSUP;
+        goto end;
+    }
+
+    match_conns(old_type, type, new_to_old, old_conn_kept, new_conn_kept);
+
+    /* Allocate everything before touching the nodes, so running out
+     * of memory leaves the flow as it was. */
+    r = -ENOMEM;
+    if (type->child_opts_set) {
+        options = sol_flow_node_get_options(new_type, fsd->options);
+        if (!options)
+            goto end;
+    }
+    for (j = 0; j < type->node_count; j++) {
+        if (new_to_old[j] != UINT16_MAX) {
+            nodes[j] = old_nodes[new_to_old[j]];
+            continue;
+        }
+        nodes[j] = calloc(1, calc_node_size(&type->node_specs[j]));
+        if (!nodes[j])
+            goto free_added;
+    }
+
+    for (i = old_type->conn_count - 1; i >= 0; i--) {
+        if (!old_conn_kept[i])
+            disconnect_conn(old_type, fsd, i);
+    }
+    for (i = old_type->node_count - 1; i >= 0; i--) {
+        if (old_to_new[i] == UINT16_MAX && old_nodes[i])
+            sol_flow_node_fini(old_nodes[i]);
+    }
+    remap_delayed_packets(fsd, old_to_new);
+
+    /* New nodes may send packets when opening, they must find the
+     * flow already in its new shape. */
+    fsd->nodes = nodes;
+    flow->type = new_type;
+    for (j = 0; j < type->node_count; j++)
+        nodes[j]->parent_data = INT_TO_PTR(j);
+
+    for (j = 0; j < type->node_count; j++) {
+        if (new_to_old[j] != UINT16_MAX)
+            continue;
+        r = init_child(flow, type, fsd, j, options);
+        if (r < 0)
+            goto error_nodes;
+    }
+
+    for (j = 0; j < type->conn_count; j++) {
+        if (new_conn_kept[j])
+            continue;
+        r = connect_conn(type, fsd, j);
+        if (r < 0)
+            goto error_conns;
+    }
+
+    SOL_DBG("Updated flow '%s' (%p): %hu nodes and %hu connections, was %hu and %hu",
+        flow->id, flow, type->node_count, type->conn_count,
+        old_type->node_count, old_type->conn_count);
+
+    for (i = 0; i < old_type->node_count; i++) {
+        if (old_to_new[i] == UINT16_MAX && !node_in_storage(fsd, old_nodes[i]))
+            free(old_nodes[i]);
+    }
+    free(old_nodes);
+    nodes = NULL;
+
+    sol_flow_node_free_options(&old_type->base.base, fsd->options);
+    fsd->options = options;
+    options = NULL;
+
+    if (old_type->owned_by_node)
+        sol_flow_node_type_del(&old_type->base.base);
+
+    r = 0;
+    goto end;
+
+error_conns:
+    for (j--; j >= 0; j--) {
+        if (!new_conn_kept[j])
+            disconnect_conn(type, fsd, j);
+    }
+    j = type->node_count;
+
+error_nodes:
+    /* Skip the failed index, since it doesn't need fini. */
+    for (j--; j >= 0; j--) {
+        if (new_to_old[j] == UINT16_MAX)
+            sol_flow_node_fini(nodes[j]);
+    }
+    remap_delayed_packets(fsd, new_to_old);
+
+    fsd->nodes = old_nodes;
+    flow->type = &old_type->base.base;
+    for (i = 0; i < old_type->node_count; i++) {
+        if (old_nodes[i])
+            old_nodes[i]->parent_data = INT_TO_PTR(i);
+    }
+
+    /* Bring back what was closed. A node that fails to reopen is
+     * gone for good, connections to it are skipped from now on. */
+    for (i = 0; i < old_type->node_count; i++) {
+        if (old_to_new[i] != UINT16_MAX || !old_nodes[i])
+            continue;
+
+        memset(old_nodes[i], 0, calc_node_size(&old_type->node_specs[i]));
+        old_nodes[i]->parent_data = INT_TO_PTR(i);
+        if (init_child(flow, old_type, fsd, i, fsd->options) < 0) {
+            SOL_WRN("Failed to reopen node #%d of flow '%s' (%p), removing it",
+                i, flow->id, flow);
+            if (!node_in_storage(fsd, old_nodes[i]))
+                free(old_nodes[i]);
+            old_nodes[i] = NULL;
+        }
+    }
+    for (i = 0; i < old_type->conn_count; i++) {
+        if (!old_conn_kept[i])
+            connect_conn(old_type, fsd, i);
+    }
+
+free_added:
+    for (j = 0; j < type->node_count; j++) {
+        if (new_to_old[j] == UINT16_MAX)
+            free(nodes[j]);
+    }
+
+end:
+    sol_flow_node_free_options(new_type, options);
+    free(nodes);
+    free(new_conn_kept);
+    free(old_conn_kept);
+    free(new_to_old);
+    free(old_to_new);
+    return r;
+}
+
+static struct sol_flow_node_type *
+flow_static_new_type(
+    const struct sol_flow_static_spec *spec,
+    const struct sol_flow_static_precomputed *precomputed)
 {
     struct flow_static_type *type;
     int r;
@@ -1136,7 +1714,7 @@ sol_flow_static_new_type(
     if (!type)
         return NULL;
 
-    r = flow_static_type_init(type, spec);
+    r = flow_static_type_init(type, spec, precomputed);
     if (r < 0) {
         free(type);
         return NULL;
@@ -1144,3 +1722,28 @@ sol_flow_static_new_type(
 
     return &type->base.base;
 }
+
+SOL_API struct sol_flow_node_type *
+sol_flow_static_new_type(
+    const struct sol_flow_static_spec *spec)
+{
+    return flow_static_new_type(spec, NULL);
+}
+
+SOL_API struct sol_flow_node_type *
+sol_flow_static_new_type_precomputed(
+    const struct sol_flow_static_spec *spec,
+    const struct sol_flow_static_precomputed *precomputed)
+{
+    SOL_NULL_CHECK(precomputed, NULL);
+
+    if (precomputed->api_version != SOL_FLOW_STATIC_PRECOMPUTED_API_VERSION) {
+        SOL_WRN("precomputed(%p)->api_version(%u) != "
+            "SOL_FLOW_STATIC_PRECOMPUTED_API_VERSION(%u)",
+            precomputed, precomputed->api_version,
+            SOL_FLOW_STATIC_PRECOMPUTED_API_VERSION);
+        return NULL;
+    }
+
+    return flow_static_new_type(spec, precomputed);
+}
@@ -0,0 +1,1176 @@
+/*
+ * This file is part of the Soletta Project
+ *
+ * Copyright (C) 2015 Intel Corporation. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above copyright
+ *     notice, this list of conditions and the following disclaimer in
+ *     the documentation and/or other materials provided with the
+ *     distribution.
+ *   * Neither the name of Intel Corporation nor the names of its
+ *     contributors may be used to endorse or promote products derived
+ *     from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ * OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <errno.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <sys/eventfd.h>
+
+#include "sol-flow-internal.h"
+#include "sol-flow-thread.h"
+#include "sol-list.h"
+#include "sol-mainloop-internal.h"
+#include "sol-util.h"
+#include "sol-vector.h"
+#include "sol-worker-thread.h"
+
+struct flow_thread_type {
+    struct sol_flow_node_container_type base;
+    const struct sol_flow_node_type *child_type;
+    struct sol_flow_port_type_in *ports_in;
+    struct sol_flow_port_type_out *ports_out;
+    uint16_t ports_in_count;
+    uint16_t ports_out_count;
+};
+
+enum msg_kind {
+    MSG_PROCESS,
+    MSG_CONNECT_IN,
+    MSG_DISCONNECT_IN,
+    MSG_CONNECT_OUT,
+    MSG_DISCONNECT_OUT,
+    MSG_SEND,
+    MSG_SOURCE_ADD,
+    MSG_SOURCE_DEL,
+    MSG_SOURCE_FIRE,
+};
+
+/* Messages about sources are embedded in them, see struct source. */
+struct msg {
+    struct msg *next;
+    struct sol_flow_packet *packet;
+    struct source *source;
+    uint16_t port;
+    uint16_t conn_id;
+    enum msg_kind kind;
+};
+
+/* Lock free, unbounded, multiple producers and single consumer
+ * queue. Producers only exchange the head, the consumer owns the
+ * tail, and the stub keeps the queue from ever being empty. The
+ * consumer is woken by fd, only when it's idle, so bursts of packets
+ * cost a single wake up. */
+struct msg_queue {
+    struct msg *head;
+    struct msg *tail;
+    struct msg stub;
+    int fd;
+    bool idle;
+};
+
+struct flow_thread_data {
+    struct sol_flow_node *node;
+    struct sol_flow_node *child; /* NULL once closed, see thread_finished() */
+    struct sol_worker_thread *worker;
+    struct sol_fd *out_watch;
+
+    /* Why the thread stopped by itself, set before it returns and
+     * read by the main thread once it's joined. */
+    int thread_error;
+
+    /* Packets and port events to the thread. */
+    struct msg_queue in_queue;
+
+    /* Packets sent by the child, to the main thread. */
+    struct msg_queue out_queue;
+
+    /* Deferred calls (see sol_flow_defer_add()) run by the thread. */
+    struct sol_list defers;
+    struct sol_flow_defer *running_defer;
+    bool running_defer_deleted;
+
+    /* Main loop sources added by the child, only touched where the
+     * child runs. */
+    struct sol_ptr_vector sources;
+};
+
+enum source_kind {
+    SOURCE_TIMEOUT,
+    SOURCE_IDLE,
+    SOURCE_FD,
+    SOURCE_CHILD_WATCH,
+};
+
+/* A main loop source added by the child. The main thread (or the
+ * outer flow thread, when nested) owns the actual source, added and
+ * deleted when it gets MSG_SOURCE_ADD and MSG_SOURCE_DEL, and queues
+ * MSG_SOURCE_FIRE to the thread when it's dispatched. Idlers and fd
+ * watches are re-added by the thread after their callback, so they're
+ * never dispatched concurrently with it. Each message is queued at
+ * most once at a time. */
+struct source {
+    struct flow_thread_data *ftd;
+    union {
+        bool (*plain)(void *data);
+        bool (*fd)(void *data, int fd, unsigned int active_flags);
+        void (*child_watch)(void *data, uint64_t pid, int status);
+    } cb;
+    const void *data;
+    void *handle; /* of the loop running the flow thread node */
+    uint64_t pid;
+    unsigned int timeout_ms;
+    unsigned int flags;
+    unsigned int active_flags;
+    int fd;
+    int status;
+    int refcnt;
+    bool pending;
+    bool deleted;
+    enum source_kind kind;
+    struct msg add_msg;
+    struct msg del_msg;
+    struct msg fire_msg;
+};
+
+struct sol_flow_defer {
+    struct sol_list list;
+    bool (*cb)(void *data);
+    const void *data;
+};
+
+/* The flow thread whose child is being run by the calling thread, be
+ * it the flow thread itself or the main thread opening or closing
+ * the child. */
+static __thread struct flow_thread_data *current;
+static __thread bool in_worker;
+
+/* What running the child of another flow thread replaced. */
+struct scope {
+    struct flow_thread_data *ftd;
+    const struct sol_mainloop_source_hooks *hooks;
+    void *hooks_data;
+};
+
+static const struct sol_mainloop_source_hooks source_hooks;
+
+static void
+msg_queue_init(struct msg_queue *q)
+{
+    q->stub.next = NULL;
+    q->head = &q->stub;
+    q->tail = &q->stub;
+    q->fd = -1;
+    q->idle = true;
+}
+
+static void
+msg_queue_push(struct msg_queue *q, struct msg *msg)
+{
+    struct msg *prev;
+
+    msg->next = NULL;
+    prev = __atomic_exchange_n(&q->head, msg, __ATOMIC_ACQ_REL);
+    __atomic_store_n(&prev->next, msg, __ATOMIC_RELEASE);
+}
+
+/* Returns NULL both when empty and when a producer is half way
+ * through a push, the producer wakes the consumer again after it. */
+static struct msg *
+msg_queue_pop(struct msg_queue *q)
+{
+    struct msg *tail = q->tail;
+    struct msg *next = __atomic_load_n(&tail->next, __ATOMIC_ACQUIRE);
+
+    if (tail == &q->stub) {
+        if (!next)
+            return NULL;
+        q->tail = next;
+        tail = next;
+        next = __atomic_load_n(&next->next, __ATOMIC_ACQUIRE);
+    }
+
+    if (next) {
+        q->tail = next;
+        return tail;
+    }
+
+    if (tail != __atomic_load_n(&q->head, __ATOMIC_ACQUIRE))
+        return NULL;
+
+    msg_queue_push(q, &q->stub);
+    next = __atomic_load_n(&tail->next, __ATOMIC_ACQUIRE);
+    if (next) {
+        q->tail = next;
+        return tail;
+    }
+
+    return NULL;
+}
+
+static void
+wake(int fd)
+{
+    uint64_t one = 1;
+
+    if (write(fd, &one, sizeof(one)) < 0)
+        SOL_WRN("Couldn't wake flow thread queue: %s", sol_util_strerrora(errno));
+}
+
+static void
+queue_msg(struct msg_queue *q, struct msg *msg)
+{
+    msg_queue_push(q, msg);
+    if (__atomic_exchange_n(&q->idle, false, __ATOMIC_SEQ_CST))
+        wake(q->fd);
+}
+
+static int
+push_msg(struct msg_queue *q, enum msg_kind kind, uint16_t port, uint16_t conn_id, struct sol_flow_packet *packet)
+{
+    struct msg *msg;
+
+    msg = malloc(sizeof(*msg));
+    if (!msg) {
+        if (packet)
+            sol_flow_packet_del(packet);
+        return -ENOMEM;
+    }
+
+    msg->kind = kind;
+    msg->port = port;
+    msg->conn_id = conn_id;
+    msg->packet = packet;
+    msg->source = NULL;
+
+    queue_msg(q, msg);
+
+    return 0;
+}
+
+/* Pops a message, marking the queue idle when it's empty. The queue
+ * is checked again after that, as a producer may have missed the
+ * mark. */
+static struct msg *
+msg_queue_take(struct msg_queue *q)
+{
+    struct msg *msg;
+
+    msg = msg_queue_pop(q);
+    if (msg)
+        return msg;
+
+    __atomic_store_n(&q->idle, true, __ATOMIC_SEQ_CST);
+    msg = msg_queue_pop(q);
+    if (msg)
+        __atomic_store_n(&q->idle, false, __ATOMIC_SEQ_CST);
+
+    return msg;
+}
+
+/* Packets given to process() belong to the sender, so the thread gets
+ * its own copy. */
+static struct sol_flow_packet *
+packet_dup(const struct sol_flow_packet *packet)
+{
+    const struct sol_flow_packet_type *type = sol_flow_packet_get_type(packet);
+    void *value;
+    int r;
+
+    SOL_NULL_CHECK(type, NULL);
+
+    if (!type->data_size)
+        return sol_flow_packet_new(type, NULL);
+
+    value = alloca(type->data_size);
+    r = sol_flow_packet_get(packet, value);
+    SOL_INT_CHECK(r, < 0, NULL);
+
+    return sol_flow_packet_new(type, value);
+}
+
+bool
+sol_flow_thread_is_worker(void)
+{
+    return in_worker;
+}
+
+static void
+scope_enter(struct flow_thread_data *ftd, struct scope *prev)
+{
+    prev->ftd = current;
+    current = ftd;
+    prev->hooks = sol_mainloop_set_source_hooks(&source_hooks, ftd, &prev->hooks_data);
+}
+
+static void
+scope_leave(const struct scope *prev)
+{
+    void *hooks_data;
+
+    current = prev->ftd;
+    sol_mainloop_set_source_hooks(prev->hooks, prev->hooks_data, &hooks_data);
+}
+
+static void
+source_unref(struct source *source)
+{
+    if (__atomic_sub_fetch(&source->refcnt, 1, __ATOMIC_ACQ_REL) == 0)
+        free(source);
+}
+
+static void *
+source_add(struct flow_thread_data *ftd, struct source *source)
+{
+    struct msg *msgs[] = { &source->add_msg, &source->del_msg, &source->fire_msg };
+    enum msg_kind kinds[] = { MSG_SOURCE_ADD, MSG_SOURCE_DEL, MSG_SOURCE_FIRE };
+    unsigned int i;
+
+    if (sol_ptr_vector_append(&ftd->sources, source) < 0) {
+        free(source);
+        return NULL;
+    }
+
+    source->ftd = ftd;
+    source->refcnt = 1;
+    for (i = 0; i < ARRAY_SIZE(msgs); i++) {
+        msgs[i]->kind = kinds[i];
+        msgs[i]->source = source;
+    }
+
+    queue_msg(&ftd->out_queue, &source->add_msg);
+    return source;
+}
+
+/* The main thread deletes the actual source and drops the reference
+ * of the child. */
+static void
+source_drop(struct source *source)
+{
+    __atomic_store_n(&source->deleted, true, __ATOMIC_RELEASE);
+    queue_msg(&source->ftd->out_queue, &source->del_msg);
+}
+
+static bool
+source_remove(struct flow_thread_data *ftd, struct source *source)
+{
+    struct source *itr;
+    uint16_t i;
+
+    SOL_PTR_VECTOR_FOREACH_REVERSE_IDX (&ftd->sources, itr, i) {
+        if (itr == source) {
+            sol_ptr_vector_del(&ftd->sources, i);
+            source_drop(source);
+            return true;
+        }
+    }
+
+    return false;
+}
+
+static void
+sources_drop_all(struct flow_thread_data *ftd)
+{
+    struct source *source;
+    uint16_t i;
+
+    SOL_PTR_VECTOR_FOREACH_IDX (&ftd->sources, source, i)
+        source_drop(source);
+    sol_ptr_vector_clear(&ftd->sources);
+}
+
+static void *
+hook_timeout_add(void *data, unsigned int timeout_ms, bool (*cb)(void *data), const void *cb_data)
+{
+    struct source *source = calloc(1, sizeof(*source));
+
+    SOL_NULL_CHECK(source, NULL);
+    source->kind = SOURCE_TIMEOUT;
+    source->cb.plain = cb;
+    source->data = cb_data;
+    source->timeout_ms = timeout_ms;
+    return source_add(data, source);
+}
+
+static void *
+hook_idle_add(void *data, bool (*cb)(void *data), const void *cb_data)
+{
+    struct source *source = calloc(1, sizeof(*source));
+
+    SOL_NULL_CHECK(source, NULL);
+    source->kind = SOURCE_IDLE;
+    source->cb.plain = cb;
+    source->data = cb_data;
+    return source_add(data, source);
+}
+
+static void *
+hook_fd_add(void *data, int fd, unsigned int flags, bool (*cb)(void *data, int fd, unsigned int active_flags), const void *cb_data)
+{
+    struct source *source = calloc(1, sizeof(*source));
+
+    SOL_NULL_CHECK(source, NULL);
+    source->kind = SOURCE_FD;
+    source->cb.fd = cb;
+    source->data = cb_data;
+    source->fd = fd;
+    source->flags = flags;
+    return source_add(data, source);
+}
+
+static void *
+hook_child_watch_add(void *data, uint64_t pid, void (*cb)(void *data, uint64_t pid, int status), const void *cb_data)
+{
+    struct source *source = calloc(1, sizeof(*source));
+
+    SOL_NULL_CHECK(source, NULL);
+    source->kind = SOURCE_CHILD_WATCH;
+    source->cb.child_watch = cb;
+    source->data = cb_data;
+    source->pid = pid;
+    return source_add(data, source);
+}
+
+static bool
+hook_del(void *data, void *handle)
+{
+    return source_remove(data, handle);
+}
+
+static const struct sol_mainloop_source_hooks source_hooks = {
+    .timeout_add = hook_timeout_add,
+    .idle_add = hook_idle_add,
+    .fd_add = hook_fd_add,
+    .child_watch_add = hook_child_watch_add,
+    .del = hook_del,
+};
+
+/* Main thread side */
+
+static void
+source_fire(struct source *source)
+{
+    if (__atomic_load_n(&source->deleted, __ATOMIC_ACQUIRE))
+        return;
+    if (__atomic_exchange_n(&source->pending, true, __ATOMIC_ACQ_REL))
+        return;
+
+    __atomic_add_fetch(&source->refcnt, 1, __ATOMIC_ACQ_REL);
+    queue_msg(&source->ftd->in_queue, &source->fire_msg);
+}
+
+static bool
+on_source_timeout(void *data)
+{
+    source_fire(data);
+    return true;
+}
+
+static bool
+on_source_idle(void *data)
+{
+    struct source *source = data;
+
+    source->handle = NULL;
+    source_fire(source);
+    return false;
+}
+
+static bool
+on_source_fd(void *data, int fd, unsigned int active_flags)
+{
+    struct source *source = data;
+
+    source->handle = NULL;
+    source->active_flags = active_flags;
+    source_fire(source);
+    return false;
+}
+
+#ifdef SOL_MAINLOOP_FORK_WATCH_ENABLED
+static void
+on_source_child_watch(void *data, uint64_t pid, int status)
+{
+    struct source *source = data;
+
+    source->handle = NULL;
+    source->status = status;
+    source_fire(source);
+}
+#endif
+
+static void
+source_arm(struct source *source)
+{
+    if (__atomic_load_n(&source->deleted, __ATOMIC_ACQUIRE))
+        return;
+
+    switch (source->kind) {
+    case SOURCE_TIMEOUT:
+        source->handle = sol_timeout_add(source->timeout_ms, on_source_timeout, source);
+        break;
+    case SOURCE_IDLE:
+        source->handle = sol_idle_add(on_source_idle, source);
+        break;
+    case SOURCE_FD:
+        source->handle = sol_fd_add(source->fd, source->flags, on_source_fd, source);
+        break;
+    case SOURCE_CHILD_WATCH:
+#ifdef SOL_MAINLOOP_FORK_WATCH_ENABLED
+        source->handle = sol_child_watch_add(source->pid, on_source_child_watch, source);
+#endif
+        break;
+    }
+
+    if (!source->handle)
+        SOL_WRN("Couldn't add main loop source %p of flow thread", source);
+}
+
+static void
+source_disarm(struct source *source)
+{
+    if (source->handle) {
+        switch (source->kind) {
+        case SOURCE_TIMEOUT:
+            sol_timeout_del(source->handle);
+            break;
+        case SOURCE_IDLE:
+            sol_idle_del(source->handle);
+            break;
+        case SOURCE_FD:
+            sol_fd_del(source->handle);
+            break;
+        case SOURCE_CHILD_WATCH:
+#ifdef SOL_MAINLOOP_FORK_WATCH_ENABLED
+            sol_child_watch_del(source->handle);
+#endif
+            break;
+        }
+    }
+
+    source_unref(source);
+}
+
+/* Thread side */
+
+static void
+source_run(struct flow_thread_data *ftd, struct source *source)
+{
+    bool keep = false;
+
+    __atomic_store_n(&source->pending, false, __ATOMIC_RELEASE);
+    if (__atomic_load_n(&source->deleted, __ATOMIC_ACQUIRE))
+        goto end;
+
+    switch (source->kind) {
+    case SOURCE_TIMEOUT:
+    case SOURCE_IDLE:
+        keep = source->cb.plain((void *)source->data);
+        break;
+    case SOURCE_FD:
+        keep = source->cb.fd((void *)source->data, source->fd, source->active_flags);
+        break;
+    case SOURCE_CHILD_WATCH:
+        source->cb.child_watch((void *)source->data, source->pid, source->status);
+        break;
+    }
+
+    /* The callback may have deleted it already. */
+    if (__atomic_load_n(&source->deleted, __ATOMIC_ACQUIRE))
+        goto end;
+
+    if (!keep)
+        source_remove(ftd, source);
+    else if (source->kind == SOURCE_IDLE || source->kind == SOURCE_FD)
+        queue_msg(&ftd->out_queue, &source->add_msg);
+
+end:
+    source_unref(source);
+}
+
+static void
+run_msg(struct flow_thread_data *ftd, struct msg *msg)
+{
+    struct sol_flow_node *child = ftd->child;
+    void *child_data = sol_flow_node_get_private_data(child);
+    const struct sol_flow_port_type_in *port_in = NULL;
+    const struct sol_flow_port_type_out *port_out = NULL;
+
+    if (msg->kind == MSG_CONNECT_OUT || msg->kind == MSG_DISCONNECT_OUT)
+        port_out = sol_flow_node_type_get_port_out(child->type, msg->port);
+    else
+        port_in = sol_flow_node_type_get_port_in(child->type, msg->port);
+
+    switch (msg->kind) {
+    case MSG_PROCESS:
+        if (port_in && port_in->process)
+            port_in->process(child, child_data, msg->port, msg->conn_id, msg->packet);
+        sol_flow_packet_del(msg->packet);
+        break;
+    case MSG_CONNECT_IN:
+        if (port_in && port_in->connect)
+            port_in->connect(child, child_data, msg->port, msg->conn_id);
+        break;
+    case MSG_DISCONNECT_IN:
+        if (port_in && port_in->disconnect)
+            port_in->disconnect(child, child_data, msg->port, msg->conn_id);
+        break;
+    case MSG_CONNECT_OUT:
+        if (port_out && port_out->connect)
+            port_out->connect(child, child_data, msg->port, msg->conn_id);
+        break;
+    case MSG_DISCONNECT_OUT:
+        if (port_out && port_out->disconnect)
+            port_out->disconnect(child, child_data, msg->port, msg->conn_id);
+        break;
+    default:
+        SOL_WRN("Unexpected message %d to flow thread", msg->kind);
+        if (msg->packet)
+            sol_flow_packet_del(msg->packet);
+    }
+}
+
+static void
+run_msgs(struct flow_thread_data *ftd)
+{
+    struct msg *msg;
+
+    while ((msg = msg_queue_take(&ftd->in_queue))) {
+        if (msg->kind == MSG_SOURCE_FIRE) {
+            source_run(ftd, msg->source);
+            continue;
+        }
+        run_msg(ftd, msg);
+        free(msg);
+    }
+}
+
+static void
+run_defers(struct flow_thread_data *ftd)
+{
+    struct sol_list tmplist;
+
+    /* Calls added while running wait for the next round, like
+     * timeouts added from a timeout callback. */
+    sol_list_steal(&ftd->defers, &tmplist);
+    while (!sol_list_is_empty(&tmplist)) {
+        struct sol_flow_defer *defer;
+        bool keep;
+
+        defer = SOL_LIST_GET_CONTAINER(tmplist.next, struct sol_flow_defer, list);
+        sol_list_remove(&defer->list);
+
+        ftd->running_defer = defer;
+        ftd->running_defer_deleted = false;
+        keep = defer->cb((void *)defer->data);
+        ftd->running_defer = NULL;
+
+        if (keep && !ftd->running_defer_deleted) {
+            sol_list_append(&ftd->defers, &defer->list);
+            wake(ftd->in_queue.fd);
+        } else
+            free(defer);
+    }
+}
+
+struct sol_flow_defer *
+sol_flow_defer_add(bool (*cb)(void *data), const void *data)
+{
+    struct sol_flow_defer *defer;
+
+    if (!current)
+        return (struct sol_flow_defer *)sol_timeout_add(0, cb, data);
+
+    defer = malloc(sizeof(*defer));
+    SOL_NULL_CHECK(defer, NULL);
+
+    defer->cb = cb;
+    defer->data = data;
+    sol_list_append(&current->defers, &defer->list);
+    wake(current->in_queue.fd);
+
+    return defer;
+}
+
+void
+sol_flow_defer_del(struct sol_flow_defer *defer)
+{
+    if (!current) {
+        sol_timeout_del((struct sol_timeout *)defer);
+        return;
+    }
+
+    if (defer == current->running_defer) {
+        current->running_defer_deleted = true;
+        return;
+    }
+
+    sol_list_remove(&defer->list);
+    free(defer);
+}
+
+/* Main loop sources added by the child while it runs in the thread
+ * are routed back to the thread, see struct source. */
+static bool
+thread_setup(void *data)
+{
+    void *hooks_data;
+
+    current = data;
+    in_worker = true;
+    sol_mainloop_set_source_hooks(&source_hooks, data, &hooks_data);
+    return true;
+}
+
+static void
+thread_cleanup(void *data)
+{
+    void *hooks_data;
+
+    sol_mainloop_set_source_hooks(NULL, NULL, &hooks_data);
+}
+
+static bool
+thread_iterate(void *data)
+{
+    struct flow_thread_data *ftd = data;
+    uint64_t count;
+
+    if (read(ftd->in_queue.fd, &count, sizeof(count)) < 0 && errno != EINTR) {
+        SOL_WRN("Couldn't wait for flow thread queue: %s", sol_util_strerrora(errno));
+        ftd->thread_error = errno;
+        return false;
+    }
+
+    run_msgs(ftd);
+    run_defers(ftd);
+
+    return true;
+}
+
+static void
+thread_cancel(void *data)
+{
+    struct flow_thread_data *ftd = data;
+
+    wake(ftd->in_queue.fd);
+}
+
+static bool
+on_out_ready(void *data, int fd, unsigned int active_flags)
+{
+    struct sol_flow_node *node = data;
+    struct flow_thread_data *ftd = sol_flow_node_get_private_data(node);
+    struct msg *msg;
+    uint64_t count;
+
+    if (read(fd, &count, sizeof(count)) < 0 && errno != EAGAIN && errno != EINTR)
+        SOL_WRN("Couldn't read flow thread queue: %s", sol_util_strerrora(errno));
+
+    while ((msg = msg_queue_take(&ftd->out_queue))) {
+        if (msg->kind == MSG_SOURCE_ADD) {
+            source_arm(msg->source);
+        } else if (msg->kind == MSG_SOURCE_DEL) {
+            source_disarm(msg->source);
+        } else {
+            sol_flow_send_packet(node, msg->port, msg->packet);
+            free(msg);
+        }
+    }
+
+    return true;
+}
+
+static void
+drop_msgs(struct msg_queue *q)
+{
+    struct msg *msg;
+
+    while ((msg = msg_queue_pop(q))) {
+        if (msg->kind == MSG_SOURCE_FIRE) {
+            source_unref(msg->source);
+            continue;
+        }
+        if (msg->source)
+            continue;
+        if (msg->packet)
+            sol_flow_packet_del(msg->packet);
+        free(msg);
+    }
+}
+
+/* Once the child is gone, its sources are deleted by the main thread
+ * and its packets dropped. */
+static void
+flush_out_queue(struct flow_thread_data *ftd)
+{
+    struct msg *msg;
+
+    while ((msg = msg_queue_pop(&ftd->out_queue))) {
+        if (msg->kind == MSG_SOURCE_ADD) {
+            source_arm(msg->source);
+        } else if (msg->kind == MSG_SOURCE_DEL) {
+            source_disarm(msg->source);
+        } else {
+            sol_flow_packet_del(msg->packet);
+            free(msg);
+        }
+    }
+}
+
+/* The thread is gone, whatever it left is run here, so the child
+ * gets its pending port disconnections. */
+static void
+child_close(struct flow_thread_data *ftd)
+{
+    struct scope prev;
+
+    scope_enter(ftd, &prev);
+    run_msgs(ftd);
+    run_defers(ftd);
+    sol_flow_node_fini(ftd->child);
+    scope_leave(&prev);
+    sources_drop_all(ftd);
+    flush_out_queue(ftd);
+    free(ftd->child);
+    ftd->child = NULL;
+
+    while (!sol_list_is_empty(&ftd->defers)) {
+        struct sol_flow_defer *defer;
+
+        defer = SOL_LIST_GET_CONTAINER(ftd->defers.next, struct sol_flow_defer, list);
+        sol_list_remove(&defer->list);
+        free(defer);
+    }
+}
+
+/* If the thread stopped by itself, nothing would run the child
+ * anymore: what it sent is delivered, the node reports the failure
+ * and the child is closed right away. */
+static void
+thread_finished(void *data)
+{
+    struct flow_thread_data *ftd = data;
+
+    ftd->worker = NULL;
+    if (!ftd->thread_error)
+        return;
+
+    on_out_ready(ftd->node, ftd->out_queue.fd, SOL_FD_FLAGS_IN);
+    sol_flow_send_error_packet(ftd->node, ftd->thread_error,
+        "Flow thread stopped: %s", sol_util_strerrora(ftd->thread_error));
+    child_close(ftd);
+}
+
+static int
+flow_thread_open(struct sol_flow_node *node, void *data, const struct sol_flow_node_options *options)
+{
+    const struct flow_thread_type *type = (const struct flow_thread_type *)node->type;
+    struct flow_thread_data *ftd = data;
+    struct sol_worker_thread_spec spec = {
+        .api_version = SOL_WORKER_THREAD_SPEC_API_VERSION,
+        .data = ftd,
+        .setup = thread_setup,
+        .iterate = thread_iterate,
+        .cleanup = thread_cleanup,
+        .cancel = thread_cancel,
+        .finished = thread_finished,
+    };
+    struct scope prev;
+    int r;
+
+    msg_queue_init(&ftd->in_queue);
+    msg_queue_init(&ftd->out_queue);
+    sol_list_init(&ftd->defers);
+    sol_ptr_vector_init(&ftd->sources);
+
+    ftd->in_queue.fd = eventfd(0, EFD_CLOEXEC);
+    SOL_INT_CHECK(ftd->in_queue.fd, < 0, -errno);
+
+    ftd->out_queue.fd = eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK);
+    if (ftd->out_queue.fd < 0) {
+        r = -errno;
+        goto error_out_fd;
+    }
+
+    ftd->out_watch = sol_fd_add(ftd->out_queue.fd, SOL_FD_FLAGS_IN, on_out_ready, node);
+    if (!ftd->out_watch) {
+        r = -ENOMEM;
+        goto error_watch;
+    }
+
+    ftd->node = node;
+    ftd->child = calloc(1, sizeof(struct sol_flow_node) + type->child_type->data_size);
+    if (!ftd->child) {
+        r = -ENOMEM;
+        goto error_child;
+    }
+
+    /* The thread doesn't run yet, so the child is opened here, as if
+     * it was the thread. This may happen inside another flow thread,
+     * whose child is the current one until the call returns. */
+    scope_enter(ftd, &prev);
+    r = sol_flow_node_init(ftd->child, node, node->id, type->child_type, options);
+    scope_leave(&prev);
+    if (r < 0)
+        goto error_init;
+
+    ftd->worker = sol_worker_thread_new(&spec);
+    if (!ftd->worker) {
+        r = errno ? -errno : -ENOMEM;
+        goto error_worker;
+    }
+
+    return 0;
+
+error_worker:
+    scope_enter(ftd, &prev);
+    sol_flow_node_fini(ftd->child);
+    scope_leave(&prev);
+error_init:
+    sources_drop_all(ftd);
+    flush_out_queue(ftd);
+    free(ftd->child);
+error_child:
+    sol_fd_del(ftd->out_watch);
+error_watch:
+    close(ftd->out_queue.fd);
+error_out_fd:
+    close(ftd->in_queue.fd);
+    drop_msgs(&ftd->in_queue);
+    drop_msgs(&ftd->out_queue);
+    return r;
+}
+
+static void
+flow_thread_close(struct sol_flow_node *node, void *data)
+{
+    struct flow_thread_data *ftd = data;
+
+    if (ftd->worker)
+        sol_worker_thread_cancel(ftd->worker);
+
+    if (ftd->child)
+        child_close(ftd);
+
+    sol_fd_del(ftd->out_watch);
+    drop_msgs(&ftd->out_queue);
+    close(ftd->out_queue.fd);
+    close(ftd->in_queue.fd);
+}
+
+static int
+flow_thread_send(struct sol_flow_node *container, struct sol_flow_node *source_node, uint16_t source_out_port_idx, struct sol_flow_packet *packet)
+{
+    struct flow_thread_data *ftd = sol_flow_node_get_private_data(container);
+
+    return push_msg(&ftd->out_queue, MSG_SEND, source_out_port_idx, 0, packet);
+}
+
+static int
+flow_thread_port_process(struct sol_flow_node *node, void *data, uint16_t port, uint16_t conn_id, const struct sol_flow_packet *packet)
+{
+    struct flow_thread_data *ftd = data;
+    struct sol_flow_packet *copy;
+
+    if (!ftd->child)
+        return -ENOTCONN;
+
+    inspector_will_deliver_packet(ftd->child, port, conn_id, packet);
+
+    copy = packet_dup(packet);
+    SOL_NULL_CHECK(copy, -ENOMEM);
+
+    return push_msg(&ftd->in_queue, MSG_PROCESS, port, conn_id, copy);
+}
+
+static int
+flow_thread_port_in_connect(struct sol_flow_node *node, void *data, uint16_t port, uint16_t conn_id)
+{
+    struct flow_thread_data *ftd = data;
+
+    if (!ftd->child)
+        return -ENOTCONN;
+
+    return push_msg(&ftd->in_queue, MSG_CONNECT_IN, port, conn_id, NULL);
+}
+
+static int
+flow_thread_port_in_disconnect(struct sol_flow_node *node, void *data, uint16_t port, uint16_t conn_id)
+{
+    struct flow_thread_data *ftd = data;
+
+    if (!ftd->child)
+        return 0;
+
+    return push_msg(&ftd->in_queue, MSG_DISCONNECT_IN, port, conn_id, NULL);
+}
+
+static int
+flow_thread_port_out_connect(struct sol_flow_node *node, void *data, uint16_t port, uint16_t conn_id)
+{
+    struct flow_thread_data *ftd = data;
+
+    if (!ftd->child)
+        return -ENOTCONN;
+
+    return push_msg(&ftd->in_queue, MSG_CONNECT_OUT, port, conn_id, NULL);
+}
+
+static int
+flow_thread_port_out_disconnect(struct sol_flow_node *node, void *data, uint16_t port, uint16_t conn_id)
+{
+    struct flow_thread_data *ftd = data;
+
+    if (!ftd->child)
+        return 0;
+
+    return push_msg(&ftd->in_queue, MSG_DISCONNECT_OUT, port, conn_id, NULL);
+}
+
+static void
+flow_thread_get_ports_counts(const struct sol_flow_node_type *type, uint16_t *ports_in_count, uint16_t *ports_out_count)
+{
+    const struct flow_thread_type *ftt = (const struct flow_thread_type *)type;
+
+    if (ports_in_count)
+        *ports_in_count = ftt->ports_in_count;
+    if (ports_out_count)
+        *ports_out_count = ftt->ports_out_count;
+}
+
+static const struct sol_flow_port_type_in *
+flow_thread_get_port_in(const struct sol_flow_node_type *type, uint16_t port)
+{
+    const struct flow_thread_type *ftt = (const struct flow_thread_type *)type;
+
+    return &ftt->ports_in[port];
+}
+
+static const struct sol_flow_port_type_out *
+flow_thread_get_port_out(const struct sol_flow_node_type *type, uint16_t port)
+{
+    const struct flow_thread_type *ftt = (const struct flow_thread_type *)type;
+
+    return &ftt->ports_out[port];
+}
+
+static struct sol_flow_node_options *
+flow_thread_new_options(const struct sol_flow_node_type *type, const struct sol_flow_node_options *copy_from)
+{
+    const struct flow_thread_type *ftt = (const struct flow_thread_type *)type;
+
+    return ftt->child_type->new_options(ftt->child_type, copy_from);
+}
+
+static void
+flow_thread_free_options(const struct sol_flow_node_type *type, struct sol_flow_node_options *opts)
+{
+    const struct flow_thread_type *ftt = (const struct flow_thread_type *)type;
+
+    ftt->child_type->free_options(ftt->child_type, opts);
+}
+
+static void
+flow_thread_dispose_type(struct sol_flow_node_type *type)
+{
+    struct flow_thread_type *ftt = (struct flow_thread_type *)type;
+
+    free(ftt->ports_in);
+    free(ftt->ports_out);
+    free(ftt);
+}
+
+SOL_API struct sol_flow_node_type *
+sol_flow_thread_new_type(const struct sol_flow_node_type *child_type)
+{
+    struct flow_thread_type *ftt;
+    uint16_t i;
+
+    SOL_NULL_CHECK(child_type, NULL);
+    SOL_NULL_CHECK(child_type->get_ports_counts, NULL);
+
+    ftt = calloc(1, sizeof(*ftt));
+    SOL_NULL_CHECK(ftt, NULL);
+
+    if (child_type->init_type)
+        child_type->init_type();
+
+    ftt->child_type = child_type;
+    child_type->get_ports_counts(child_type, &ftt->ports_in_count, &ftt->ports_out_count);
+
+    if (ftt->ports_in_count > 0) {
+        ftt->ports_in = calloc(ftt->ports_in_count, sizeof(*ftt->ports_in));
+        SOL_NULL_CHECK_GOTO(ftt->ports_in, error);
+    }
+
+    for (i = 0; i < ftt->ports_in_count; i++) {
+        const struct sol_flow_port_type_in *p = sol_flow_node_type_get_port_in(child_type, i);
+
+        SOL_NULL_CHECK_GOTO(p, error);
+        ftt->ports_in[i].api_version = SOL_FLOW_PORT_TYPE_IN_API_VERSION;
+        ftt->ports_in[i].packet_type = p->packet_type;
+        ftt->ports_in[i].process = flow_thread_port_process;
+        ftt->ports_in[i].connect = flow_thread_port_in_connect;
+        ftt->ports_in[i].disconnect = flow_thread_port_in_disconnect;
+    }
+
+    if (ftt->ports_out_count > 0) {
+        ftt->ports_out = calloc(ftt->ports_out_count, sizeof(*ftt->ports_out));
+        SOL_NULL_CHECK_GOTO(ftt->ports_out, error);
+    }
+
+    for (i = 0; i < ftt->ports_out_count; i++) {
+        const struct sol_flow_port_type_out *p = sol_flow_node_type_get_port_out(child_type, i);
+
+        SOL_NULL_CHECK_GOTO(p, error);
+        ftt->ports_out[i].api_version = SOL_FLOW_PORT_TYPE_OUT_API_VERSION;
+        ftt->ports_out[i].packet_type = p->packet_type;
+        ftt->ports_out[i].connect = flow_thread_port_out_connect;
+        ftt->ports_out[i].disconnect = flow_thread_port_out_disconnect;
+    }
+
+    ftt->base.base = (struct sol_flow_node_type) {
+        .api_version = SOL_FLOW_NODE_TYPE_API_VERSION,
+        .data_size = sizeof(struct flow_thread_data),
+        .flags = SOL_FLOW_NODE_TYPE_FLAGS_CONTAINER,
+        .new_options = child_type->new_options ? flow_thread_new_options : NULL,
+        .free_options = child_type->free_options ? flow_thread_free_options : NULL,
+        .get_ports_counts = flow_thread_get_ports_counts,
+        .get_port_in = flow_thread_get_port_in,
+        .get_port_out = flow_thread_get_port_out,
+        .open = flow_thread_open,
+        .close = flow_thread_close,
+        .dispose_type = flow_thread_dispose_type,
+#ifdef SOL_FLOW_NODE_TYPE_DESCRIPTION_ENABLED
+        .description = child_type->description,
+#endif
+    };
+    ftt->base.send = flow_thread_send;
+
+    return &ftt->base.base;
+
+error:
+    free(ftt->ports_in);
+    free(ftt->ports_out);
+    free(ftt);
+    return NULL;
+}
@@ -34,6 +34,7 @@
 #include <stdlib.h>
 
 #include "sol-flow-internal.h"
+#include "sol-flow-inspector.h"
 #include "sol-flow-resolver.h"
 #include "sol-util.h"
 
@@ -42,6 +43,20 @@ SOL_LOG_INTERNAL_DECLARE(_sol_flow_log_domain, "flow");
 int sol_flow_init(void);
 void sol_flow_shutdown(void);
 
+#ifdef SOL_FLOW_NODE_TYPE_DESCRIPTION_ENABLED
+/* Open addressing table (load factor at most 1/2) from builtin node
+ * type names to their types, built at the first lookup. */
+static const struct sol_flow_node_type **builtin_index;
+static uint32_t builtin_index_size;
+#endif
+
+struct shutdown_callback {
+    void (*cb)(void *data);
+    const void *data;
+};
+
+static struct sol_vector shutdown_callbacks = SOL_VECTOR_INIT(struct shutdown_callback);
+
 int
 sol_flow_init(void)
 {
@@ -52,6 +67,19 @@ sol_flow_init(void)
 void
 sol_flow_shutdown(void)
 {
+    struct shutdown_callback *sc;
+    uint16_t i;
+
+    /* callbacks may not add or remove others while being called */
+    SOL_VECTOR_FOREACH_REVERSE_IDX (&shutdown_callbacks, sc, i)
+        sc->cb((void *)sc->data);
+    sol_vector_clear(&shutdown_callbacks);
+
+#ifdef SOL_FLOW_NODE_TYPE_DESCRIPTION_ENABLED
+    free(builtin_index);
+    builtin_index = NULL;
+    builtin_index_size = 0;
+#endif
 }
 
 #ifdef SOL_FLOW_INSPECTOR_ENABLED
@@ -72,6 +100,18 @@ sol_flow_set_inspector(const struct sol_flow_inspector *inspector)
     _sol_flow_inspector = inspector;
     return true;
 }
+
+SOL_API const struct sol_flow_inspector *
+sol_flow_get_inspector(void)
+{
+    return _sol_flow_inspector;
+}
+#else
+SOL_API const struct sol_flow_inspector *
+sol_flow_get_inspector(void)
+{
+    return NULL;
+}
 #endif
 
 SOL_API void *
@@ -372,6 +412,17 @@ sol_flow_send_string_take_packet(struct sol_flow_node *src, uint16_t src_port, c
     return sol_flow_send_packet(src, src_port, string_packet);
 }
 
+SOL_API int
+sol_flow_send_string_slice_packet(struct sol_flow_node *src, uint16_t src_port, struct sol_blob *parent, const struct sol_str_slice slice)
+{
+    struct sol_flow_packet *string_packet;
+
+    string_packet = sol_flow_packet_new_string_slice(parent, slice);
+    SOL_NULL_CHECK(string_packet, -ENOMEM);
+
+    return sol_flow_send_packet(src, src_port, string_packet);
+}
+
 SOL_API int
 sol_flow_send_empty_packet(struct sol_flow_node *src, uint16_t src_port)
 {
@@ -443,6 +494,34 @@ sol_flow_node_type_del(struct sol_flow_node_type *type)
     type->dispose_type(type);
 }
 
+SOL_API int
+sol_flow_add_shutdown_callback(void (*cb)(void *data), const void *data)
+{
+    struct shutdown_callback *sc;
+
+    SOL_NULL_CHECK(cb, -EINVAL);
+
+    sc = sol_vector_append(&shutdown_callbacks);
+    SOL_NULL_CHECK(sc, -ENOMEM);
+    sc->cb = cb;
+    sc->data = data;
+    return 0;
+}
+
+SOL_API int
+sol_flow_del_shutdown_callback(void (*cb)(void *data), const void *data)
+{
+    struct shutdown_callback *sc;
+    uint16_t i;
+
+    SOL_VECTOR_FOREACH_REVERSE_IDX (&shutdown_callbacks, sc, i) {
+        if (sc->cb == cb && sc->data == data)
+            return sol_vector_del(&shutdown_callbacks, i);
+    }
+
+    return -ENOENT;
+}
+
 #ifdef SOL_FLOW_NODE_TYPE_DESCRIPTION_ENABLED
 #include "sol-flow-builtins-gen.h"
 
@@ -466,6 +545,70 @@ sol_flow_foreach_builtin_node_type(bool (*cb)(void *data, const struct sol_flow_
 #endif
 }
 
+static bool
+builtin_index_count_cb(void *data, const struct sol_flow_node_type *type)
+{
+    uint32_t *count = data;
+
+    (*count)++;
+    return true;
+}
+
+static bool
+builtin_index_insert_cb(void *data, const struct sol_flow_node_type *type)
+{
+    uint32_t mask = builtin_index_size - 1;
+    uint32_t i;
+
+    if (!type->description || !type->description->name)
+        return true;
+
+    for (i = sol_flow_name_hash(type->description->name) & mask; builtin_index[i]; i = (i + 1) & mask) {
+        /* The first type with a given name wins, as in a linear search. */
+        if (streq(builtin_index[i]->description->name, type->description->name))
+            return true;
+    }
+
+    builtin_index[i] = type;
+    return true;
+}
+
+static bool
+builtin_index_build(void)
+{
+    uint32_t count = 0, size;
+
+    sol_flow_foreach_builtin_node_type(builtin_index_count_cb, &count);
+
+    for (size = 4; size < count * 2; size *= 2) ;
+
+    builtin_index = calloc(size, sizeof(*builtin_index));
+    SOL_NULL_CHECK(builtin_index, false);
+    builtin_index_size = size;
+
+    sol_flow_foreach_builtin_node_type(builtin_index_insert_cb, NULL);
+    return true;
+}
+
+const struct sol_flow_node_type *
+sol_flow_builtin_node_type_find(const char *name)
+{
+    uint32_t mask, i;
+
+    SOL_NULL_CHECK(name, NULL);
+
+    if (!builtin_index && !builtin_index_build())
+        return NULL;
+
+    mask = builtin_index_size - 1;
+    for (i = sol_flow_name_hash(name) & mask; builtin_index[i]; i = (i + 1) & mask) {
+        if (streq(name, builtin_index[i]->description->name))
+            return builtin_index[i];
+    }
+
+    return NULL;
+}
+
 static const struct sol_flow_port_description *
 sol_flow_node_type_get_port_description(const struct sol_flow_port_description *const *ports, uint16_t port)
 {
@@ -31,10 +31,15 @@
  */
 
 #include "console-gen.h"
+#include "sol-buffer.h"
 #include "sol-flow-internal.h"
+#include "sol-mainloop.h"
 #include "sol-types.h"
 
 #include <ctype.h>
+#include <inttypes.h>
+#include <math.h>
+#include <stdarg.h>
 #include <stdio.h>
 #include <stdlib.h>
 
@@ -42,116 +47,304 @@ struct console_data {
     FILE *fp;
     char *prefix;
     char *suffix;
+    struct sol_buffer buf;
+    struct sol_timeout *timer;
+    size_t buffer_size;
+    uint32_t flush_interval;
     bool flush;
 };
 
+/* Packets are formatted into a reusable buffer, with hand written
+ * formatters for the common numeric types, and written with a single
+ * call, possibly batching many packets together. */
+
 static int
-console_in_process(struct sol_flow_node *node, void *data, uint16_t port, uint16_t conn_id, const struct sol_flow_packet *packet)
+append_str(struct sol_buffer *buf, const char *str)
+{
+    if (!str)
+        return 0;
+    return sol_buffer_append_slice(buf, sol_str_slice_from_str(str));
+}
+
+static int
+append_uint(struct sol_buffer *buf, uint64_t value, bool negative)
+{
+    char tmp[24];
+    char *p = tmp + sizeof(tmp);
+
+    do {
+        *--p = '0' + value % 10;
+        value /= 10;
+    } while (value);
+
+    if (negative)
+        *--p = '-';
+
+    return sol_buffer_append_slice(buf,
+        SOL_STR_SLICE_STR(p, tmp + sizeof(tmp) - p));
+}
+
+static int
+append_int(struct sol_buffer *buf, int64_t value)
+{
+    if (value < 0)
+        return append_uint(buf, -(uint64_t)value, true);
+    return append_uint(buf, value, false);
+}
+
+/* Same as "%02x" */
+static int
+append_hex02(struct sol_buffer *buf, uint32_t value)
+{
+    static const char digits[] = "0123456789abcdef";
+    char tmp[8];
+    char *p = tmp + sizeof(tmp);
+
+    do {
+        *--p = digits[value & 0xf];
+        value >>= 4;
+    } while (value);
+
+    if (p == tmp + sizeof(tmp) - 1)
+        *--p = '0';
+
+    return sol_buffer_append_slice(buf,
+        SOL_STR_SLICE_STR(p, tmp + sizeof(tmp) - p));
+}
+
+static int
+append_printf(struct sol_buffer *buf, const char *fmt, ...)
+{
+    va_list ap;
+    size_t available;
+    int len, r;
+
+    available = buf->reserved - buf->used;
+    va_start(ap, fmt);
+    len = vsnprintf((char *)buf->data + buf->used, available, fmt, ap);
+    va_end(ap);
+    SOL_INT_CHECK(len, < 0, len);
+
+    if ((size_t)len >= available) {
+        r = sol_buffer_ensure(buf, buf->used + len + 1);
+        SOL_INT_CHECK(r, < 0, r);
+
+        va_start(ap, fmt);
+        len = vsnprintf((char *)buf->data + buf->used, len + 1, fmt, ap);
+        va_end(ap);
+        SOL_INT_CHECK(len, < 0, len);
+    }
+
+    buf->used += len;
+    return 0;
+}
+
+/* Same output as "%f". Values are scaled to an integer number of
+ * millionths, which is exact while they fit in 43 bits. Anything
+ * else, or a scaled value too close to a rounding tie to be sure of
+ * the direction printf() would round, goes through stdio. */
+#define DOUBLE_FAST_MAX ((double)(1ULL << 43))
+#define DOUBLE_TIE_MARGIN (1.0 / 64)
+
+static int
+append_double(struct sol_buffer *buf, double value)
+{
+    double scaled, integral, fraction;
+    uint64_t millionths;
+    char tmp[8];
+    int i, r;
+
+    scaled = fabs(value) * 1e6;
+    if (!(scaled < DOUBLE_FAST_MAX))
+        return append_printf(buf, "%f", value);
+
+    integral = floor(scaled);
+    fraction = scaled - integral;
+    if (fabs(fraction - 0.5) < DOUBLE_TIE_MARGIN)
+        return append_printf(buf, "%f", value);
+
+    millionths = integral;
+    if (fraction > 0.5)
+        millionths++;
+
+    r = append_uint(buf, millionths / 1000000, signbit(value));
+    SOL_INT_CHECK(r, < 0, r);
+
+    millionths %= 1000000;
+    tmp[0] = '.';
+    for (i = 6; i > 0; i--) {
+        tmp[i] = '0' + millionths % 10;
+        millionths /= 10;
+    }
+
+    return sol_buffer_append_slice(buf, SOL_STR_SLICE_STR(tmp, 7));
+}
+
+#undef DOUBLE_FAST_MAX
+#undef DOUBLE_TIE_MARGIN
+
+static void
+console_write(struct console_data *mdata)
+{
+    if (mdata->timer) {
+        sol_timeout_del(mdata->timer);
+        mdata->timer = NULL;
+    }
+
+    if (!mdata->buf.used)
+        return;
+
+    if (fwrite(mdata->buf.data, 1, mdata->buf.used, mdata->fp) != mdata->buf.used)
+        SOL_WRN("Could not write console output");
+    mdata->buf.used = 0;
+
+    if (mdata->flush)
+        fflush(mdata->fp);
+}
+
+static bool
+console_timeout(void *data)
 {
     struct console_data *mdata = data;
 
-    if (sol_flow_packet_get_type(packet) == SOL_FLOW_PACKET_TYPE_EMPTY) {
-        fprintf(mdata->fp, "%s(empty)%s\n",
-            mdata->prefix ? mdata->prefix : "",
-            mdata->suffix ? mdata->suffix : "");
-    } else if (sol_flow_packet_get_type(packet) == SOL_FLOW_PACKET_TYPE_BOOLEAN) {
+    mdata->timer = NULL;
+    console_write(mdata);
+    return false;
+}
+
+static int
+console_format(struct console_data *mdata, const struct sol_flow_packet *packet)
+{
+    const struct sol_flow_packet_type *type = sol_flow_packet_get_type(packet);
+    struct sol_buffer *buf = &mdata->buf;
+    int r;
+
+    if (type == SOL_FLOW_PACKET_TYPE_ERROR) {
+        int code;
+        const char *msg;
+
+        r = sol_flow_packet_get_error(packet, &code, &msg);
+        SOL_INT_CHECK(r, < 0, r);
+
+        /* suffix goes before the message for errors */
+        append_str(buf, mdata->prefix);
+        append_str(buf, "#");
+        append_hex02(buf, code);
+        append_str(buf, " (error)");
+        append_str(buf, mdata->suffix);
+        append_str(buf, " - ");
+        append_str(buf, msg);
+        return append_str(buf, "\n");
+    }
+
+    append_str(buf, mdata->prefix);
+
+    if (type == SOL_FLOW_PACKET_TYPE_EMPTY) {
+        append_str(buf, "(empty)");
+    } else if (type == SOL_FLOW_PACKET_TYPE_BOOLEAN) {
         bool value;
-        int r = sol_flow_packet_get_boolean(packet, &value);
+        r = sol_flow_packet_get_boolean(packet, &value);
         SOL_INT_CHECK(r, < 0, r);
-        fprintf(mdata->fp, "%s%s (boolean)%s\n",
-            mdata->prefix ? mdata->prefix : "",
-            value ? "true" : "false",
-            mdata->suffix ? mdata->suffix : "");
-    } else if (sol_flow_packet_get_type(packet) == SOL_FLOW_PACKET_TYPE_BYTE) {
+        append_str(buf, value ? "true (boolean)" : "false (boolean)");
+    } else if (type == SOL_FLOW_PACKET_TYPE_BYTE) {
         unsigned char value;
-        int r = sol_flow_packet_get_byte(packet, &value);
+        r = sol_flow_packet_get_byte(packet, &value);
         SOL_INT_CHECK(r, < 0, r);
-        fprintf(mdata->fp, "%s#%02x (byte)%s\n",
-            mdata->prefix ? mdata->prefix : "",
-            value,
-            mdata->suffix ? mdata->suffix : "");
-    } else if (sol_flow_packet_get_type(packet) == SOL_FLOW_PACKET_TYPE_IRANGE) {
+        append_str(buf, "#");
+        append_hex02(buf, value);
+        append_str(buf, " (byte)");
+    } else if (type == SOL_FLOW_PACKET_TYPE_IRANGE) {
         int32_t val;
-        int r = sol_flow_packet_get_irange_value(packet, &val);
+        r = sol_flow_packet_get_irange_value(packet, &val);
         SOL_INT_CHECK(r, < 0, r);
-        fprintf(mdata->fp, "%s%" PRId32 " (integer range)%s\n",
-            mdata->prefix ? mdata->prefix : "",
-            val,
-            mdata->suffix ? mdata->suffix : "");
-    } else if (sol_flow_packet_get_type(packet) == SOL_FLOW_PACKET_TYPE_DRANGE) {
+        append_int(buf, val);
+        append_str(buf, " (integer range)");
+    } else if (type == SOL_FLOW_PACKET_TYPE_DRANGE) {
         double val;
-        int r = sol_flow_packet_get_drange_value(packet, &val);
+        r = sol_flow_packet_get_drange_value(packet, &val);
         SOL_INT_CHECK(r, < 0, r);
-        fprintf(mdata->fp, "%s%f (float range)%s\n",
-            mdata->prefix ? mdata->prefix : "",
-            val,
-            mdata->suffix ? mdata->suffix : "");
-    } else if (sol_flow_packet_get_type(packet) == SOL_FLOW_PACKET_TYPE_RGB) {
+        append_double(buf, val);
+        append_str(buf, " (float range)");
+    } else if (type == SOL_FLOW_PACKET_TYPE_RGB) {
         uint32_t red, green, blue;
-        int r = sol_flow_packet_get_rgb_components(packet, &red, &green, &blue);
+        r = sol_flow_packet_get_rgb_components(packet, &red, &green, &blue);
         SOL_INT_CHECK(r, < 0, r);
-        fprintf(mdata->fp, "%s(%d, %d, %d) (rgb)%s\n",
-            mdata->prefix ? mdata->prefix : "",
-            red, green, blue,
-            mdata->suffix ? mdata->suffix : "");
-    } else if (sol_flow_packet_get_type(packet) == SOL_FLOW_PACKET_TYPE_DIRECTION_VECTOR) {
+        append_str(buf, "(");
+        append_int(buf, (int32_t)red);
+        append_str(buf, ", ");
+        append_int(buf, (int32_t)green);
+        append_str(buf, ", ");
+        append_int(buf, (int32_t)blue);
+        append_str(buf, ") (rgb)");
+    } else if (type == SOL_FLOW_PACKET_TYPE_DIRECTION_VECTOR) {
         double x, y, z;
-        int r = sol_flow_packet_get_direction_vector_components(packet, &x, &y, &z);
+        r = sol_flow_packet_get_direction_vector_components(packet, &x, &y, &z);
         SOL_INT_CHECK(r, < 0, r);
-        fprintf(mdata->fp, "%s(%lf, %lf, %lf) (direction-vector)%s\n",
-            mdata->prefix ? mdata->prefix : "",
-            x, y, z,
-            mdata->suffix ? mdata->suffix : "");
-    } else if (sol_flow_packet_get_type(packet) == SOL_FLOW_PACKET_TYPE_STRING) {
-        const char *val;
-
-        int r = sol_flow_packet_get_string(packet, &val);
+        append_str(buf, "(");
+        append_double(buf, x);
+        append_str(buf, ", ");
+        append_double(buf, y);
+        append_str(buf, ", ");
+        append_double(buf, z);
+        append_str(buf, ") (direction-vector)");
+    } else if (type == SOL_FLOW_PACKET_TYPE_STRING) {
+        struct sol_str_slice val;
+        r = sol_flow_packet_get_string_slice(packet, &val, NULL);
         SOL_INT_CHECK(r, < 0, r);
-        fprintf(mdata->fp, "%s%s (string)%s\n",
-            mdata->prefix ? mdata->prefix : "",
-            val,
-            mdata->suffix ? mdata->suffix : "");
-    } else if (sol_flow_packet_get_type(packet) == SOL_FLOW_PACKET_TYPE_BLOB) {
+        if (val.data)
+            sol_buffer_append_slice(buf, val);
+        else
+            append_str(buf, "(null)");
+        append_str(buf, " (string)");
+    } else if (type == SOL_FLOW_PACKET_TYPE_BLOB) {
         struct sol_blob *val;
-        const char *buf, *bufend;
+        const char *mem, *memend;
 
-        int r = sol_flow_packet_get_blob(packet, &val);
+        r = sol_flow_packet_get_blob(packet, &val);
         SOL_INT_CHECK(r, < 0, r);
-        fprintf(mdata->fp, "%stype=%p, parent=%p, size=%zd, refcnt=%hu, mem=%p {",
-            mdata->prefix ? mdata->prefix : "",
+        append_printf(buf, "type=%p, parent=%p, size=%zd, refcnt=%" PRIu32 ", mem=%p {",
             val->type, val->parent, val->size, val->refcnt, val->mem);
 
-        buf = val->mem;
-        bufend = buf + val->size;
-        for (; buf < bufend; buf++) {
-            if (isprint(*buf))
-                fprintf(mdata->fp, "%#x(%c)", *buf, *buf);
+        mem = val->mem;
+        memend = mem + val->size;
+        for (; mem < memend; mem++) {
+            if (isprint(*mem))
+                append_printf(buf, "%#x(%c)", *mem, *mem);
             else
-                fprintf(mdata->fp, "%#x", *buf);
-            if (buf + 1 < bufend)
-                fputs(", ", mdata->fp);
+                append_printf(buf, "%#x", *mem);
+            if (mem + 1 < memend)
+                append_str(buf, ", ");
         }
 
-        fprintf(mdata->fp, "} (blob)%s\n",
-            mdata->suffix ? mdata->suffix : "");
-    } else if (sol_flow_packet_get_type(packet) == SOL_FLOW_PACKET_TYPE_ERROR) {
-        int code;
-        const char *msg;
-        int r = sol_flow_packet_get_error(packet, &code, &msg);
-        SOL_INT_CHECK(r, < 0, r);
-        fprintf(mdata->fp, "%s#%02x (error)%s - %s\n",
-            mdata->prefix ? mdata->prefix : "",
-            code,
-            mdata->suffix ? mdata->suffix : "",
-            msg ? : "");
+        append_str(buf, "} (blob)");
     } else {
         SOL_WRN("Unsupported packet=%p type=%p (%s)",
-            packet, sol_flow_packet_get_type(packet), sol_flow_packet_get_type(packet)->name);
+            packet, type, type->name);
         return -EINVAL;
     }
 
-    if (mdata->flush)
-        fflush(mdata->fp);
+    append_str(buf, mdata->suffix);
+    return append_str(buf, "\n");
+}
+
+static int
+console_in_process(struct sol_flow_node *node, void *data, uint16_t port, uint16_t conn_id, const struct sol_flow_packet *packet)
+{
+    struct console_data *mdata = data;
+    size_t used = mdata->buf.used;
+    int r;
+
+    r = console_format(mdata, packet);
+    if (r < 0) {
+        /* drop whatever was formatted for this packet */
+        mdata->buf.used = used;
+        return r;
+    }
+
+    if (mdata->buf.used >= mdata->buffer_size)
+        console_write(mdata);
+    else if (mdata->flush_interval && !mdata->timer)
+        mdata->timer = sol_timeout_add(mdata->flush_interval, console_timeout, mdata);
 
     return 0;
 }
@@ -170,8 +363,22 @@ console_open(struct sol_flow_node *node, void *data, const struct sol_flow_node_
         mdata->prefix = opts->prefix ? strdup(opts->prefix) : NULL;
         mdata->suffix = opts->suffix ? strdup(opts->suffix) : NULL;
         mdata->flush = opts->flush;
+
+        if (opts->buffer_size.val < 0)
+            SOL_WRN("Option 'buffer_size' (%" PRId32 ") must be zero or "
+                "positive. Considering zero.", opts->buffer_size.val);
+        else
+            mdata->buffer_size = opts->buffer_size.val;
+
+        if (opts->flush_interval.val < 0)
+            SOL_WRN("Option 'flush_interval' (%" PRId32 ") must be zero or "
+                "positive. Considering zero.", opts->flush_interval.val);
+        else
+            mdata->flush_interval = opts->flush_interval.val;
     }
 
+    sol_buffer_init(&mdata->buf);
+
     if (!mdata->prefix) {
         char buf[512];
         int r;
@@ -191,6 +398,8 @@ console_close(struct sol_flow_node *node, void *data)
 {
     struct console_data *mdata = data;
 
+    console_write(mdata);
+    sol_buffer_fini(&mdata->buf);
     free(mdata->prefix);
     free(mdata->suffix);
 }
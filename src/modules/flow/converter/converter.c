@@ -1875,20 +1875,27 @@ static int
 string_to_blob_convert(struct sol_flow_node *node, void *data, uint16_t port, uint16_t conn_id, const struct sol_flow_packet *packet)
 {
     char *mem;
-    const char *str;
-    struct sol_blob *blob;
+    struct sol_str_slice str;
+    struct sol_blob *blob, *parent;
     int ret;
 
-    ret = sol_flow_packet_get_string(packet, &str);
+    ret = sol_flow_packet_get_string_slice(packet, &str, &parent);
     SOL_INT_CHECK(ret, < 0, -EINVAL);
+    SOL_NULL_CHECK(str.data, -EINVAL);
 
-    mem = strdup(str);
-    SOL_NULL_CHECK(mem, -ENOMEM);
-
-    blob = sol_blob_new(SOL_BLOB_TYPE_DEFAULT, NULL, mem, strlen(mem) + 1);
-    if (!blob) {
-        free(mem);
-        return -ENOMEM;
+    if (parent) {
+        /* string lives in a blob already, just point to it */
+        blob = sol_blob_new(SOL_BLOB_TYPE_NOFREE, parent, str.data, str.len + 1);
+        SOL_NULL_CHECK(blob, -ENOMEM);
+    } else {
+        mem = strndup(str.data, str.len);
+        SOL_NULL_CHECK(mem, -ENOMEM);
+
+        blob = sol_blob_new(SOL_BLOB_TYPE_DEFAULT, NULL, mem, str.len + 1);
+        if (!blob) {
+            free(mem);
+            return -ENOMEM;
+        }
     }
 
     ret = sol_flow_send_blob_packet(node,
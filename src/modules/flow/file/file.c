@@ -35,7 +35,11 @@
 #include <sys/types.h>
 #include <sys/stat.h>
 #include <fcntl.h>
+#include <pthread.h>
+#include <limits.h>
 #include <stdio.h>
+#include <sys/inotify.h>
+#include <sys/uio.h>
 
 #include "file-gen.h"
 
@@ -43,15 +47,15 @@
 #include "sol-flow-internal.h"
 #include "sol-worker-thread.h"
 #include "sol-util.h"
+#include "sol-vector.h"
 #include "sol-mainloop.h"
 
 /*
  * TODO:
  *
- * These types only handle a full file at once, there should be a
- * progressive version that loads chunks (blobs) and send them ASAP,
- * writing to disk as they arrive at input. In such cases there must
- * be a "reset" port so readers fseek() to start and writers truncate.
+ * file/writer only handles a full file at once, there should be a
+ * progressive version writing chunks to disk as they arrive at input,
+ * like file/chunk-reader reads them, with a "reset" port to truncate.
  */
 
 static void
@@ -193,6 +197,326 @@ file_reader_close(struct sol_flow_node *node, void *data)
     file_reader_unload(data);
 }
 
+struct file_chunk_reader_data {
+    struct sol_flow_node *node;
+    char *path;
+    struct sol_file_chunk_reader *reader;
+    struct sol_blob_pool *pool;
+    struct sol_idle *idler;
+    struct sol_fd *watch;
+    struct sol_fd *read_watch;
+    int watch_fd;
+    int chunk_size;
+    unsigned int demand;
+    bool lines;
+    bool follow;
+    bool on_demand;
+    bool at_eof;
+};
+
+static void
+file_chunk_reader_unload(struct file_chunk_reader_data *mdata)
+{
+    if (mdata->idler) {
+        sol_idle_del(mdata->idler);
+        mdata->idler = NULL;
+    }
+    if (mdata->watch) {
+        sol_fd_del(mdata->watch);
+        mdata->watch = NULL;
+    }
+    if (mdata->watch_fd >= 0) {
+        close(mdata->watch_fd);
+        mdata->watch_fd = -1;
+    }
+    if (mdata->read_watch) {
+        sol_fd_del(mdata->read_watch);
+        mdata->read_watch = NULL;
+    }
+    if (mdata->reader) {
+        sol_file_chunk_reader_close(mdata->reader);
+        mdata->reader = NULL;
+    }
+    mdata->demand = 0;
+    mdata->at_eof = false;
+}
+
+static int file_chunk_reader_schedule(struct file_chunk_reader_data *mdata);
+
+static bool
+file_chunk_reader_on_readable(void *data, int fd, unsigned int active_flags)
+{
+    struct file_chunk_reader_data *mdata = data;
+
+    mdata->read_watch = NULL;
+    file_chunk_reader_schedule(mdata);
+    return false;
+}
+
+/* Returns whether a chunk was sent. */
+static bool
+file_chunk_reader_send(struct file_chunk_reader_data *mdata)
+{
+    struct sol_str_slice chunk;
+    struct sol_blob *blob;
+    int r;
+
+    /* with follow, the last line may still be being written */
+    r = sol_file_chunk_reader_next(mdata->reader, !mdata->follow, &chunk);
+    if (r == -EAGAIN) {
+        /* a pipe or device with nothing to read yet */
+        if (!mdata->read_watch) {
+            mdata->read_watch = sol_fd_add(sol_file_chunk_reader_get_fd(mdata->reader),
+                SOL_FD_FLAGS_IN, file_chunk_reader_on_readable, mdata);
+            if (!mdata->read_watch)
+                sol_flow_send_error_packet(mdata->node, ENOMEM,
+                    "Could not watch \"%s\"", mdata->path);
+        }
+        return false;
+    }
+    if (r < 0) {
+        sol_flow_send_error_packet(mdata->node, -r,
+            "Could not read \"%s\": %s", mdata->path, sol_util_strerrora(-r));
+        return false;
+    }
+
+    if (!chunk.len) {
+        if (!mdata->at_eof) {
+            mdata->at_eof = true;
+            sol_flow_send_empty_packet(mdata->node,
+                SOL_FLOW_NODE_TYPE_FILE_CHUNK_READER__OUT__EOF);
+        }
+        return false;
+    }
+    mdata->at_eof = false;
+
+    /* Chunks are copied to blobs of a pool: mapped windows move on
+     * and the file may change, while blobs may be kept for long. */
+    blob = sol_blob_pool_get(mdata->pool);
+    SOL_NULL_CHECK(blob, false);
+    memcpy(blob->mem, chunk.data, chunk.len);
+    blob->size = chunk.len;
+
+    r = sol_flow_send_blob_packet(mdata->node,
+        SOL_FLOW_NODE_TYPE_FILE_CHUNK_READER__OUT__OUT, blob);
+    sol_blob_unref(blob);
+    SOL_INT_CHECK(r, < 0, false);
+
+    return true;
+}
+
+/* A chunk per main loop iteration, so packets are delivered as they
+ * are read instead of piling up. */
+static bool
+file_chunk_reader_on_idle(void *data)
+{
+    struct file_chunk_reader_data *mdata = data;
+
+    if (!file_chunk_reader_send(mdata)) {
+        mdata->idler = NULL;
+        return false;
+    }
+
+    if (mdata->on_demand && --mdata->demand == 0) {
+        mdata->idler = NULL;
+        return false;
+    }
+
+    return true;
+}
+
+static int
+file_chunk_reader_schedule(struct file_chunk_reader_data *mdata)
+{
+    if (!mdata->reader || mdata->idler)
+        return 0;
+    if (mdata->on_demand && !mdata->demand)
+        return 0;
+
+    mdata->idler = sol_idle_add(file_chunk_reader_on_idle, mdata);
+    SOL_NULL_CHECK(mdata->idler, -ENOMEM);
+    return 0;
+}
+
+static bool
+file_chunk_reader_on_watch(void *data, int fd, unsigned int active_flags)
+{
+    struct file_chunk_reader_data *mdata = data;
+    char buf[sizeof(struct inotify_event) + NAME_MAX + 1] __attribute__((aligned(__alignof__(struct inotify_event))));
+
+    while (read(fd, buf, sizeof(buf)) > 0)
+        ;
+
+    file_chunk_reader_schedule(mdata);
+    return true;
+}
+
+static int
+file_chunk_reader_watch(struct file_chunk_reader_data *mdata)
+{
+    int r;
+
+    mdata->watch_fd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+    if (mdata->watch_fd < 0)
+        return -errno;
+
+    if (inotify_add_watch(mdata->watch_fd, mdata->path, IN_MODIFY) < 0) {
+        r = -errno;
+        goto error;
+    }
+
+    mdata->watch = sol_fd_add(mdata->watch_fd, SOL_FD_FLAGS_IN,
+        file_chunk_reader_on_watch, mdata);
+    if (!mdata->watch) {
+        r = -ENOMEM;
+        goto error;
+    }
+
+    return 0;
+
+error:
+    close(mdata->watch_fd);
+    mdata->watch_fd = -1;
+    return r;
+}
+
+static int
+file_chunk_reader_load(struct file_chunk_reader_data *mdata)
+{
+    int r;
+
+    if (!mdata->path)
+        return 0;
+
+    mdata->reader = sol_file_chunk_reader_open(mdata->path,
+        mdata->chunk_size, mdata->lines ? '\n' : -1);
+    if (!mdata->reader) {
+        r = -errno;
+        sol_flow_send_error_packet(mdata->node, -r,
+            "Could not load \"%s\": %s", mdata->path, sol_util_strerrora(-r));
+        return r;
+    }
+
+    if (mdata->follow) {
+        r = file_chunk_reader_watch(mdata);
+        if (r < 0) {
+            sol_flow_send_error_packet(mdata->node, -r,
+                "Could not watch \"%s\": %s", mdata->path, sol_util_strerrora(-r));
+            file_chunk_reader_unload(mdata);
+            return r;
+        }
+    }
+
+    return file_chunk_reader_schedule(mdata);
+}
+
+static int
+file_chunk_reader_path_process(struct sol_flow_node *node, void *data, uint16_t port, uint16_t conn_id, const struct sol_flow_packet *packet)
+{
+    struct file_chunk_reader_data *mdata = data;
+    const char *path;
+    int r;
+
+    r = sol_flow_packet_get_string(packet, &path);
+    SOL_INT_CHECK(r, < 0, r);
+
+    if (path && mdata->path && streq(path, mdata->path))
+        return 0;
+
+    file_chunk_reader_unload(mdata);
+    free(mdata->path);
+
+    mdata->path = path ? strdup(path) : NULL;
+    return file_chunk_reader_load(mdata);
+}
+
+static int
+file_chunk_reader_next_process(struct sol_flow_node *node, void *data, uint16_t port, uint16_t conn_id, const struct sol_flow_packet *packet)
+{
+    struct file_chunk_reader_data *mdata = data;
+
+    if (!mdata->on_demand || !mdata->reader)
+        return 0;
+
+    if (mdata->demand < UINT_MAX)
+        mdata->demand++;
+    return file_chunk_reader_schedule(mdata);
+}
+
+static int
+file_chunk_reader_reset_process(struct sol_flow_node *node, void *data, uint16_t port, uint16_t conn_id, const struct sol_flow_packet *packet)
+{
+    struct file_chunk_reader_data *mdata = data;
+    int r;
+
+    if (!mdata->reader)
+        return 0;
+
+    r = sol_file_chunk_reader_rewind(mdata->reader);
+    SOL_INT_CHECK(r, < 0, r);
+
+    mdata->at_eof = false;
+    return file_chunk_reader_schedule(mdata);
+}
+
+static bool
+file_chunk_reader_open_delayed(void *data)
+{
+    struct file_chunk_reader_data *mdata = data;
+
+    mdata->idler = NULL;
+    file_chunk_reader_load(mdata);
+    return false;
+}
+
+static int
+file_chunk_reader_open(struct sol_flow_node *node, void *data, const struct sol_flow_node_options *options)
+{
+    const struct sol_flow_node_type_file_chunk_reader_options *opts = (const struct sol_flow_node_type_file_chunk_reader_options *)options;
+    struct file_chunk_reader_data *mdata = data;
+
+    mdata->node = node;
+    mdata->watch_fd = -1;
+
+    SOL_FLOW_NODE_OPTIONS_SUB_API_CHECK(options, SOL_FLOW_NODE_TYPE_FILE_CHUNK_READER_OPTIONS_API_VERSION, -EINVAL);
+
+    if (opts->chunk_size.val <= 0) {
+        SOL_WRN("Invalid chunk size %d", opts->chunk_size.val);
+        return -EINVAL;
+    }
+    mdata->chunk_size = opts->chunk_size.val;
+    mdata->lines = opts->lines;
+    mdata->follow = opts->follow;
+    mdata->on_demand = opts->on_demand;
+
+    mdata->pool = sol_blob_pool_new(mdata->chunk_size, 8);
+    SOL_NULL_CHECK(mdata->pool, -ENOMEM);
+
+    if (opts->path) {
+        mdata->path = strdup(opts->path);
+        SOL_NULL_CHECK_GOTO(mdata->path, error);
+    }
+
+    mdata->idler = sol_idle_add(file_chunk_reader_open_delayed, mdata);
+    SOL_NULL_CHECK_GOTO(mdata->idler, error);
+    return 0;
+
+error:
+    free(mdata->path);
+    sol_blob_pool_del(mdata->pool);
+    return -ENOMEM;
+}
+
+static void
+file_chunk_reader_close(struct sol_flow_node *node, void *data)
+{
+    struct file_chunk_reader_data *mdata = data;
+
+    file_chunk_reader_unload(mdata);
+    free(mdata->path);
+    sol_blob_pool_del(mdata->pool);
+}
+
 struct file_writer_data {
     struct sol_flow_node *node;
     char *path;
@@ -459,5 +783,523 @@ file_writer_close(struct sol_flow_node *node, void *data)
     free(mdata->path);
 }
 
+/*
+ * file/appender keeps a single worker thread per node for as long as
+ * packets keep coming. Blobs are queued in arrival order and the thread
+ * writes everything queued since its last pass with as few writev() as
+ * possible, rotating the file by size or age in between.
+ */
+#define FILE_APPENDER_IOV_MAX 64
+
+enum file_appender_sync {
+    FILE_APPENDER_SYNC_NONE,
+    FILE_APPENDER_SYNC_ROTATE,
+    FILE_APPENDER_SYNC_BATCH
+};
+
+struct file_appender_data {
+    struct sol_flow_node *node;
+    struct sol_worker_thread *worker;
+    pthread_mutex_t lock;
+    pthread_cond_t cond;
+    /* protected by lock: the main thread queues blobs and reads the
+     * counters, the worker takes the queue and updates them */
+    struct sol_ptr_vector queue;
+    size_t pending;
+    size_t written;
+    int error;
+    bool stop;
+    /* worker thread only */
+    struct timespec opened;
+    size_t file_size;
+    int fd;
+    /* set by the main thread while there's no worker, the worker only
+     * reads them */
+    char *path;
+    size_t rotate_size;
+    int rotate_interval;
+    int rotate_count;
+    int permissions;
+    enum file_appender_sync sync;
+    /* main thread only */
+    bool busy;
+};
+
+static int
+file_appender_open_file(struct file_appender_data *mdata)
+{
+    struct stat st;
+    int r;
+
+    mdata->fd = open(mdata->path, O_WRONLY | O_CLOEXEC | O_CREAT | O_APPEND,
+        mdata->permissions);
+    if (mdata->fd < 0)
+        return -errno;
+
+    if (fstat(mdata->fd, &st) < 0) {
+        r = -errno;
+        close(mdata->fd);
+        mdata->fd = -1;
+        return r;
+    }
+
+    mdata->file_size = st.st_size;
+    mdata->opened = sol_util_timespec_get_current();
+    SOL_DBG("open \"%s\" fd=%d, size=%zu", mdata->path, mdata->fd,
+        mdata->file_size);
+    return 0;
+}
+
+static int
+file_appender_close_file(struct file_appender_data *mdata)
+{
+    int r = 0;
+
+    if (mdata->fd < 0)
+        return 0;
+
+    if (mdata->sync != FILE_APPENDER_SYNC_NONE && fdatasync(mdata->fd) < 0)
+        r = -errno;
+    if (close(mdata->fd) < 0 && r == 0)
+        r = -errno;
+    mdata->fd = -1;
+    return r;
+}
+
+/* path.1 is the most recent rotated file, path.<rotate_count> the oldest. */
+static int
+file_appender_rotate(struct file_appender_data *mdata)
+{
+    char from[PATH_MAX], to[PATH_MAX];
+    int i, r;
+
+    r = file_appender_close_file(mdata);
+    if (r < 0)
+        return r;
+
+    for (i = mdata->rotate_count; i > 0; i--) {
+        if (i > 1)
+            r = snprintf(from, sizeof(from), "%s.%d", mdata->path, i - 1);
+        else
+            r = snprintf(from, sizeof(from), "%s", mdata->path);
+        if (r < 0 || r >= (int)sizeof(from))
+            return -ENAMETOOLONG;
+
+        r = snprintf(to, sizeof(to), "%s.%d", mdata->path, i);
+        if (r < 0 || r >= (int)sizeof(to))
+            return -ENAMETOOLONG;
+
+        if (rename(from, to) < 0 && errno != ENOENT)
+            return -errno;
+    }
+
+    SOL_DBG("rotated \"%s\"", mdata->path);
+    return file_appender_open_file(mdata);
+}
+
+static bool
+file_appender_needs_rotation(struct file_appender_data *mdata, size_t len)
+{
+    struct timespec now, deadline, interval;
+
+    if (mdata->file_size == 0)
+        return false;
+
+    if (mdata->rotate_size && mdata->file_size + len > mdata->rotate_size)
+        return true;
+
+    if (mdata->rotate_interval) {
+        interval = sol_util_timespec_from_msec(mdata->rotate_interval);
+        sol_util_timespec_sum(&mdata->opened, &interval, &deadline);
+        now = sol_util_timespec_get_current();
+        return sol_util_timespec_compare(&now, &deadline) >= 0;
+    }
+
+    return false;
+}
+
+static int
+file_appender_writev(struct file_appender_data *mdata, struct iovec *iov, int count, size_t *done)
+{
+    ssize_t w;
+
+    while (count > 0) {
+        w = writev(mdata->fd, iov, count);
+        if (w < 0) {
+            if (errno == EINTR)
+                continue;
+            return -errno;
+        }
+
+        mdata->file_size += w;
+        *done += w;
+
+        for (; count > 0 && (size_t)w >= iov->iov_len; iov++, count--)
+            w -= iov->iov_len;
+        if (count > 0) {
+            iov->iov_base = (uint8_t *)iov->iov_base + w;
+            iov->iov_len -= w;
+        }
+    }
+
+    return 0;
+}
+
+/*
+ * Blobs are never split across files: rotation happens before a blob
+ * that would not fit, so a blob larger than rotate_size gets a file of
+ * its own.
+ */
+static int
+file_appender_write_batch(struct file_appender_data *mdata, struct sol_ptr_vector *batch, size_t *done)
+{
+    struct iovec iov[FILE_APPENDER_IOV_MAX];
+    struct sol_blob *blob;
+    size_t len = 0;
+    uint16_t i;
+    int count = 0, r = 0;
+
+    SOL_PTR_VECTOR_FOREACH_IDX (batch, blob, i) {
+        if (count == FILE_APPENDER_IOV_MAX ||
+            (count > 0 && file_appender_needs_rotation(mdata, len + blob->size))) {
+            r = file_appender_writev(mdata, iov, count, done);
+            if (r < 0)
+                return r;
+            count = 0;
+            len = 0;
+        }
+
+        if (mdata->fd < 0) {
+            r = file_appender_open_file(mdata);
+            if (r < 0)
+                return r;
+        }
+
+        if (file_appender_needs_rotation(mdata, blob->size)) {
+            r = file_appender_rotate(mdata);
+            if (r < 0)
+                return r;
+        }
+
+        if (!blob->size)
+            continue;
+
+        iov[count].iov_base = blob->mem;
+        iov[count].iov_len = blob->size;
+        count++;
+        len += blob->size;
+    }
+
+    if (count > 0) {
+        r = file_appender_writev(mdata, iov, count, done);
+        if (r < 0)
+            return r;
+    }
+
+    if (mdata->sync == FILE_APPENDER_SYNC_BATCH && mdata->fd >= 0 &&
+        fdatasync(mdata->fd) < 0)
+        return -errno;
+
+    return 0;
+}
+
+static void
+file_appender_flush(struct file_appender_data *mdata, struct sol_ptr_vector *batch)
+{
+    struct sol_blob *blob;
+    size_t done = 0;
+    uint16_t i;
+    int r;
+
+    r = file_appender_write_batch(mdata, batch, &done);
+    if (r < 0) {
+        SOL_WRN("could not write to \"%s\": %s", mdata->path,
+            sol_util_strerrora(-r));
+        /* start over with a fresh descriptor on the next batch */
+        if (mdata->fd >= 0) {
+            close(mdata->fd);
+            mdata->fd = -1;
+        }
+    }
+
+    SOL_PTR_VECTOR_FOREACH_IDX (batch, blob, i)
+        sol_blob_unref(blob);
+
+    pthread_mutex_lock(&mdata->lock);
+    mdata->pending -= sol_ptr_vector_get_len(batch);
+    mdata->written += done;
+    if (r < 0)
+        mdata->error = -r;
+    pthread_mutex_unlock(&mdata->lock);
+
+    sol_ptr_vector_clear(batch);
+}
+
+static bool
+file_appender_worker_thread_iterate(void *data)
+{
+    struct file_appender_data *mdata = data;
+    struct sol_ptr_vector batch;
+
+    pthread_mutex_lock(&mdata->lock);
+    while (!sol_ptr_vector_get_len(&mdata->queue) && !mdata->stop)
+        pthread_cond_wait(&mdata->cond, &mdata->lock);
+    batch = mdata->queue;
+    sol_ptr_vector_init(&mdata->queue);
+    pthread_mutex_unlock(&mdata->lock);
+
+    if (!sol_ptr_vector_get_len(&batch))
+        return false;
+
+    file_appender_flush(mdata, &batch);
+
+    if (!sol_worker_thread_cancel_check(mdata->worker))
+        sol_worker_thread_feedback(mdata->worker);
+    return true;
+}
+
+static void
+file_appender_worker_thread_cancel(void *data)
+{
+    struct file_appender_data *mdata = data;
+
+    pthread_mutex_lock(&mdata->lock);
+    mdata->stop = true;
+    pthread_cond_broadcast(&mdata->cond);
+    pthread_mutex_unlock(&mdata->lock);
+}
+
+/* Whatever was queued before the cancel is still written out. */
+static void
+file_appender_worker_thread_cleanup(void *data)
+{
+    struct file_appender_data *mdata = data;
+    struct sol_ptr_vector batch;
+    int r;
+
+    pthread_mutex_lock(&mdata->lock);
+    batch = mdata->queue;
+    sol_ptr_vector_init(&mdata->queue);
+    pthread_mutex_unlock(&mdata->lock);
+
+    if (sol_ptr_vector_get_len(&batch))
+        file_appender_flush(mdata, &batch);
+
+    r = file_appender_close_file(mdata);
+    if (r < 0) {
+        SOL_WRN("could not close \"%s\": %s", mdata->path,
+            sol_util_strerrora(-r));
+        pthread_mutex_lock(&mdata->lock);
+        mdata->error = -r;
+        pthread_mutex_unlock(&mdata->lock);
+    }
+}
+
+static void
+file_appender_send(struct file_appender_data *mdata)
+{
+    struct sol_irange val = { 0, 0, INT32_MAX, 1 };
+    size_t pending, written;
+    int error;
+
+    pthread_mutex_lock(&mdata->lock);
+    pending = mdata->pending;
+    written = mdata->written;
+    error = mdata->error;
+    mdata->error = 0;
+    pthread_mutex_unlock(&mdata->lock);
+
+    if (error)
+        sol_flow_send_error_packet(mdata->node, error,
+            "could not write to \"%s\": %s", mdata->path,
+            sol_util_strerrora(error));
+
+    if (mdata->busy != (pending > 0)) {
+        mdata->busy = pending > 0;
+        sol_flow_send_boolean_packet(mdata->node,
+            SOL_FLOW_NODE_TYPE_FILE_APPENDER__OUT__BUSY, mdata->busy);
+    }
+
+    val.val = written > INT32_MAX ? INT32_MAX : (int32_t)written;
+    sol_flow_send_irange_packet(mdata->node,
+        SOL_FLOW_NODE_TYPE_FILE_APPENDER__OUT__DONE, &val);
+}
+
+static void
+file_appender_worker_thread_feedback(void *data)
+{
+    struct file_appender_data *mdata = data;
+
+    file_appender_send(mdata);
+}
+
+static void
+file_appender_worker_thread_finished(void *data)
+{
+    struct file_appender_data *mdata = data;
+
+    mdata->worker = NULL;
+}
+
+static void
+file_appender_unload(struct file_appender_data *mdata)
+{
+    if (!mdata->worker)
+        return;
+
+    sol_worker_thread_cancel(mdata->worker);
+    mdata->worker = NULL;
+    file_appender_send(mdata);
+}
+
+static int
+file_appender_load(struct file_appender_data *mdata)
+{
+    struct sol_worker_thread_spec spec = {
+        .api_version = SOL_WORKER_THREAD_SPEC_API_VERSION,
+        .iterate = file_appender_worker_thread_iterate,
+        .cleanup = file_appender_worker_thread_cleanup,
+        .cancel = file_appender_worker_thread_cancel,
+        .finished = file_appender_worker_thread_finished,
+        .feedback = file_appender_worker_thread_feedback,
+        .data = mdata
+    };
+
+    if (mdata->worker)
+        return 0;
+
+    mdata->stop = false;
+    mdata->worker = sol_worker_thread_new(&spec);
+    SOL_NULL_CHECK(mdata->worker, -errno);
+    return 0;
+}
+
+static int
+file_appender_path_process(struct sol_flow_node *node, void *data, uint16_t port, uint16_t conn_id, const struct sol_flow_packet *packet)
+{
+    struct file_appender_data *mdata = data;
+    const char *path;
+    int r;
+
+    r = sol_flow_packet_get_string(packet, &path);
+    SOL_INT_CHECK(r, < 0, r);
+
+    if (path && mdata->path && streq(path, mdata->path))
+        return 0;
+
+    /* the worker reads path, so drain it before switching files */
+    file_appender_unload(mdata);
+    free(mdata->path);
+
+    mdata->path = path ? strdup(path) : NULL;
+    if (path)
+        SOL_NULL_CHECK(mdata->path, -ENOMEM);
+    return 0;
+}
+
+static int
+file_appender_contents_process(struct sol_flow_node *node, void *data, uint16_t port, uint16_t conn_id, const struct sol_flow_packet *packet)
+{
+    struct file_appender_data *mdata = data;
+    struct sol_blob *blob;
+    bool notify = false;
+    int r;
+
+    r = sol_flow_packet_get_blob(packet, &blob);
+    SOL_INT_CHECK(r, < 0, r);
+
+    if (!mdata->path) {
+        SOL_WRN("no path to append to, dropping %zu bytes", blob->size);
+        return -EINVAL;
+    }
+
+    r = file_appender_load(mdata);
+    if (r < 0) {
+        sol_flow_send_error_packet(mdata->node, -r,
+            "could not start writer for \"%s\": %s", mdata->path,
+            sol_util_strerrora(-r));
+        return r;
+    }
+
+    blob = sol_blob_ref(blob);
+    SOL_NULL_CHECK(blob, -errno);
+
+    pthread_mutex_lock(&mdata->lock);
+    r = sol_ptr_vector_append(&mdata->queue, blob);
+    if (r == 0) {
+        notify = mdata->pending == 0;
+        mdata->pending++;
+        pthread_cond_signal(&mdata->cond);
+    }
+    pthread_mutex_unlock(&mdata->lock);
+
+    if (r < 0) {
+        sol_blob_unref(blob);
+        return r;
+    }
+
+    if (notify && !mdata->busy) {
+        mdata->busy = true;
+        sol_flow_send_boolean_packet(mdata->node,
+            SOL_FLOW_NODE_TYPE_FILE_APPENDER__OUT__BUSY, true);
+    }
+
+    return 0;
+}
+
+static int
+file_appender_open(struct sol_flow_node *node, void *data, const struct sol_flow_node_options *options)
+{
+    const struct sol_flow_node_type_file_appender_options *opts = (const struct sol_flow_node_type_file_appender_options *)options;
+    struct file_appender_data *mdata = data;
+
+    SOL_FLOW_NODE_OPTIONS_SUB_API_CHECK(options, SOL_FLOW_NODE_TYPE_FILE_APPENDER_OPTIONS_API_VERSION, -EINVAL);
+
+    if (!opts->fsync || streq(opts->fsync, "none"))
+        mdata->sync = FILE_APPENDER_SYNC_NONE;
+    else if (streq(opts->fsync, "rotate"))
+        mdata->sync = FILE_APPENDER_SYNC_ROTATE;
+    else if (streq(opts->fsync, "batch"))
+        mdata->sync = FILE_APPENDER_SYNC_BATCH;
+    else {
+        SOL_WRN("invalid fsync policy '%s', expected none, rotate or batch",
+            opts->fsync);
+        return -EINVAL;
+    }
+
+    SOL_INT_CHECK(opts->rotate_size.val, < 0, -EINVAL);
+    SOL_INT_CHECK(opts->rotate_interval.val, < 0, -EINVAL);
+
+    mdata->node = node;
+    mdata->fd = -1;
+    mdata->permissions = opts->permissions.val;
+    mdata->rotate_size = opts->rotate_size.val;
+    mdata->rotate_interval = opts->rotate_interval.val;
+    mdata->rotate_count = opts->rotate_count.val > 0 ? opts->rotate_count.val : 1;
+    sol_ptr_vector_init(&mdata->queue);
+
+    if (opts->path) {
+        mdata->path = strdup(opts->path);
+        SOL_NULL_CHECK(mdata->path, -ENOMEM);
+    }
+
+    pthread_mutex_init(&mdata->lock, NULL);
+    pthread_cond_init(&mdata->cond, NULL);
+    return 0;
+}
+
+static void
+file_appender_close(struct sol_flow_node *node, void *data)
+{
+    struct file_appender_data *mdata = data;
+
+    if (mdata->worker)
+        sol_worker_thread_cancel(mdata->worker);
+
+    pthread_cond_destroy(&mdata->cond);
+    pthread_mutex_destroy(&mdata->lock);
+    free(mdata->path);
+}
+
 
 #include "file-gen.c"
@@ -33,8 +33,10 @@
 #include "float-gen.h"
 #include "sol-flow-internal.h"
 #include "sol-mainloop.h"
+#include "sol-str-table.h"
 
 #include <sol-util.h>
+#include <sol-window-stats.h>
 #include <errno.h>
 #include <float.h>
 #include <math.h>
@@ -994,4 +996,261 @@ classify_process(struct sol_flow_node *node, void *data, uint16_t port, uint16_t
 
     return 0;
 }
+
+// =============================================================================
+// DRANGE BUFFER
+// =============================================================================
+
+struct drange_buffer_data {
+    struct sol_flow_node *node;
+    struct sol_timeout *timer;
+    struct sol_window_stats stats;
+    double (*normalize_cb)(const struct sol_window_stats *stats);
+    uint32_t timeout;
+    bool circular;
+};
+
+static double
+_normalize_mean(const struct sol_window_stats *stats)
+{
+    return sol_window_stats_mean(stats);
+}
+
+static double
+_normalize_median(const struct sol_window_stats *stats)
+{
+    return sol_window_stats_median(stats);
+}
+
+static const struct sol_str_table_ptr buffer_table[] = {
+    SOL_STR_TABLE_PTR_ITEM("mean", _normalize_mean),
+    SOL_STR_TABLE_PTR_ITEM("median", _normalize_median),
+    SOL_STR_TABLE_PTR_ITEM("variance", sol_window_stats_variance),
+    SOL_STR_TABLE_PTR_ITEM("stddev", sol_window_stats_stddev),
+    SOL_STR_TABLE_PTR_ITEM("min", sol_window_stats_min),
+    SOL_STR_TABLE_PTR_ITEM("max", sol_window_stats_max),
+    { }
+};
+
+static int
+drange_buffer_do(struct drange_buffer_data *mdata)
+{
+    if (!sol_window_stats_count(&mdata->stats))
+        return 0;
+
+    return sol_flow_send_drange_value_packet(mdata->node,
+        SOL_FLOW_NODE_TYPE_FLOAT_BUFFER__OUT__OUT,
+        mdata->normalize_cb(&mdata->stats));
+}
+
+static bool
+drange_buffer_timeout_cb(void *data)
+{
+    struct drange_buffer_data *mdata = data;
+
+    drange_buffer_do(mdata);
+    sol_window_stats_reset(&mdata->stats);
+    return true;
+}
+
+static void
+drange_buffer_restart(struct drange_buffer_data *mdata)
+{
+    sol_window_stats_reset(&mdata->stats);
+
+    if (mdata->timer)
+        sol_timeout_del(mdata->timer);
+    mdata->timer = NULL;
+    if (mdata->timeout)
+        mdata->timer = sol_timeout_add(mdata->timeout, drange_buffer_timeout_cb, mdata);
+}
+
+static int
+drange_buffer_reset(struct sol_flow_node *node, void *data, uint16_t port, uint16_t conn_id,
+    const struct sol_flow_packet *packet)
+{
+    drange_buffer_restart(data);
+    return 0;
+}
+
+static int
+drange_buffer_timeout(struct sol_flow_node *node, void *data, uint16_t port, uint16_t conn_id,
+    const struct sol_flow_packet *packet)
+{
+    struct drange_buffer_data *mdata = data;
+    int32_t timeout;
+    int r;
+
+    r = sol_flow_packet_get_irange_value(packet, &timeout);
+    SOL_INT_CHECK(r, < 0, r);
+
+    if (timeout < 0) {
+        SOL_WRN("Invalid 'timeout' value: '%" PRId32 "'. Skipping it.", timeout);
+        return -EINVAL;
+    }
+
+    mdata->timeout = timeout;
+
+    if (mdata->timer)
+        sol_timeout_del(mdata->timer);
+    mdata->timer = NULL;
+    if (mdata->timeout)
+        mdata->timer = sol_timeout_add(mdata->timeout, drange_buffer_timeout_cb, mdata);
+
+    return 0;
+}
+
+static int
+drange_buffer_process(struct sol_flow_node *node, void *data, uint16_t port, uint16_t conn_id,
+    const struct sol_flow_packet *packet)
+{
+    struct drange_buffer_data *mdata = data;
+    double value;
+    int r;
+
+    r = sol_flow_packet_get_drange_value(packet, &value);
+    SOL_INT_CHECK(r, < 0, r);
+
+    sol_window_stats_add(&mdata->stats, value);
+
+    if (mdata->circular)
+        return drange_buffer_do(mdata);
+
+    if (sol_window_stats_is_full(&mdata->stats)) {
+        r = drange_buffer_do(mdata);
+        drange_buffer_restart(mdata);
+    }
+
+    return r;
+}
+
+static int
+drange_buffer_open(struct sol_flow_node *node, void *data, const struct sol_flow_node_options *options)
+{
+    struct drange_buffer_data *mdata = data;
+    const struct sol_flow_node_type_float_buffer_options *opts =
+        (const struct sol_flow_node_type_float_buffer_options *)options;
+    int r;
+
+    SOL_FLOW_NODE_OPTIONS_SUB_API_CHECK(options,
+        SOL_FLOW_NODE_TYPE_FLOAT_BUFFER_OPTIONS_API_VERSION, -EINVAL);
+
+    SOL_INT_CHECK(opts->timeout.val, < 0, -EINVAL);
+    SOL_INT_CHECK(opts->samples.val, <= 0, -EINVAL);
+
+    mdata->node = node;
+    mdata->timeout = opts->timeout.val;
+    mdata->circular = opts->circular;
+    mdata->normalize_cb = sol_str_table_ptr_lookup_fallback
+            (buffer_table, sol_str_slice_from_str(opts->operation), _normalize_mean);
+
+    r = sol_window_stats_init(&mdata->stats, opts->samples.val, 0);
+    SOL_INT_CHECK(r, < 0, r);
+
+    if (mdata->timeout > 0)
+        mdata->timer = sol_timeout_add(mdata->timeout, drange_buffer_timeout_cb, mdata);
+
+    return 0;
+}
+
+static void
+drange_buffer_close(struct sol_flow_node *node, void *data)
+{
+    struct drange_buffer_data *mdata = data;
+
+    if (mdata->timer)
+        sol_timeout_del(mdata->timer);
+
+    sol_window_stats_fini(&mdata->stats);
+}
+
+// =============================================================================
+// DRANGE STATS
+// =============================================================================
+
+struct drange_stats_data {
+    struct sol_window_stats stats;
+    double percentile;
+};
+
+static int
+drange_stats_open(struct sol_flow_node *node, void *data, const struct sol_flow_node_options *options)
+{
+    struct drange_stats_data *mdata = data;
+    const struct sol_flow_node_type_float_stats_options *opts =
+        (const struct sol_flow_node_type_float_stats_options *)options;
+
+    SOL_FLOW_NODE_OPTIONS_SUB_API_CHECK(options,
+        SOL_FLOW_NODE_TYPE_FLOAT_STATS_OPTIONS_API_VERSION, -EINVAL);
+
+    SOL_INT_CHECK(opts->samples.val, <= 0, -EINVAL);
+    if (opts->percentile.val < 0 || opts->percentile.val > 100) {
+        SOL_WRN("Invalid 'percentile' value: '%g'. It must be between 0 and 100.",
+            opts->percentile.val);
+        return -EINVAL;
+    }
+    if (opts->ewma_alpha.val <= 0 || opts->ewma_alpha.val > 1) {
+        SOL_WRN("Invalid 'ewma_alpha' value: '%g'. It must be in the (0, 1] interval.",
+            opts->ewma_alpha.val);
+        return -EINVAL;
+    }
+
+    mdata->percentile = opts->percentile.val;
+
+    return sol_window_stats_init(&mdata->stats, opts->samples.val,
+        opts->ewma_alpha.val);
+}
+
+static void
+drange_stats_close(struct sol_flow_node *node, void *data)
+{
+    struct drange_stats_data *mdata = data;
+
+    sol_window_stats_fini(&mdata->stats);
+}
+
+static int
+drange_stats_reset(struct sol_flow_node *node, void *data, uint16_t port, uint16_t conn_id,
+    const struct sol_flow_packet *packet)
+{
+    struct drange_stats_data *mdata = data;
+
+    sol_window_stats_reset(&mdata->stats);
+    return 0;
+}
+
+static int
+drange_stats_process(struct sol_flow_node *node, void *data, uint16_t port, uint16_t conn_id,
+    const struct sol_flow_packet *packet)
+{
+    struct drange_stats_data *mdata = data;
+    const struct sol_window_stats *stats = &mdata->stats;
+    double value;
+    int r;
+
+    r = sol_flow_packet_get_drange_value(packet, &value);
+    SOL_INT_CHECK(r, < 0, r);
+
+    sol_window_stats_add(&mdata->stats, value);
+
+    sol_flow_send_drange_value_packet(node,
+        SOL_FLOW_NODE_TYPE_FLOAT_STATS__OUT__MEAN, sol_window_stats_mean(stats));
+    sol_flow_send_drange_value_packet(node,
+        SOL_FLOW_NODE_TYPE_FLOAT_STATS__OUT__VARIANCE, sol_window_stats_variance(stats));
+    sol_flow_send_drange_value_packet(node,
+        SOL_FLOW_NODE_TYPE_FLOAT_STATS__OUT__STDDEV, sol_window_stats_stddev(stats));
+    sol_flow_send_drange_value_packet(node,
+        SOL_FLOW_NODE_TYPE_FLOAT_STATS__OUT__MIN, sol_window_stats_min(stats));
+    sol_flow_send_drange_value_packet(node,
+        SOL_FLOW_NODE_TYPE_FLOAT_STATS__OUT__MAX, sol_window_stats_max(stats));
+    sol_flow_send_drange_value_packet(node,
+        SOL_FLOW_NODE_TYPE_FLOAT_STATS__OUT__MEDIAN, sol_window_stats_median(stats));
+    sol_flow_send_drange_value_packet(node,
+        SOL_FLOW_NODE_TYPE_FLOAT_STATS__OUT__PERCENTILE,
+        sol_window_stats_percentile(stats, mdata->percentile));
+
+    return sol_flow_send_drange_value_packet(node,
+        SOL_FLOW_NODE_TYPE_FLOAT_STATS__OUT__EWMA, sol_window_stats_ewma(stats));
+}
+
 #include "float-gen.c"
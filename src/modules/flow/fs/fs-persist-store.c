@@ -0,0 +1,858 @@
+/*
+ * This file is part of the Soletta Project
+ *
+ * Copyright (C) 2015 Intel Corporation. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above copyright
+ *     notice, this list of conditions and the following disclaimer in
+ *     the documentation and/or other materials provided with the
+ *     distribution.
+ *   * Neither the name of Intel Corporation nor the names of its
+ *     contributors may be used to endorse or promote products derived
+ *     from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ * OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <errno.h>
+#include <fcntl.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <sys/types.h>
+#include <unistd.h>
+
+#include "sol-buffer.h"
+#include "sol-flow.h"
+#include "sol-log.h"
+#include "sol-mainloop.h"
+#include "sol-util.h"
+#include "sol-vector.h"
+
+#include "fs-persist-store.h"
+
+#define LOG_MAGIC "SOLPST1\n"
+#define LOG_MAGIC_LEN (sizeof(LOG_MAGIC) - 1)
+
+/* Logs smaller than this are not compacted. */
+#define LOG_COMPACT_MIN (16 * 1024)
+
+/* Failed writes are retried after this, doubled on each failure. */
+#define FLUSH_RETRY_MIN_MS 100
+#define FLUSH_RETRY_MAX_MS (60 * 1000)
+
+/* Followed by the key and the value. */
+struct log_record {
+    uint32_t crc;
+    uint32_t len;
+    uint16_t key_len;
+    uint16_t reserved;
+};
+
+struct fs_persist_store {
+    char *path;
+    struct sol_ptr_vector values;
+    struct sol_timeout *timer;
+    struct timespec deadline;
+    size_t log_size; /* valid bytes in the log */
+    size_t live_size; /* bytes of the last record of each key */
+    unsigned int refcnt;
+    unsigned int retry_ms; /* since the last write failed, 0 if it didn't */
+    int fd; /* the log, -1 for single value files */
+};
+
+struct fs_persist_value {
+    struct fs_persist_store *store;
+    char *key; /* NULL for single value files */
+    void *mem;
+    size_t len;
+    size_t record_size; /* of its last record in the log */
+    struct timespec first_change;
+    struct timespec last_change;
+    unsigned int flush_interval;
+    unsigned int max_staleness;
+    unsigned int refcnt;
+    bool dirty;
+};
+
+static struct sol_ptr_vector stores = SOL_PTR_VECTOR_INIT;
+static bool shutdown_hooked;
+
+static uint32_t
+crc32_update(uint32_t crc, const void *mem, size_t len)
+{
+    const uint8_t *p = mem;
+    int i;
+
+    crc = ~crc;
+    while (len--) {
+        crc ^= *p++;
+        for (i = 0; i < 8; i++)
+            crc = (crc >> 1) ^ (0xedb88320 & -(crc & 1));
+    }
+    return ~crc;
+}
+
+static uint32_t
+record_crc(const struct log_record *rec, const char *key, const void *mem)
+{
+    uint32_t crc;
+
+    crc = crc32_update(0, &rec->len,
+        sizeof(*rec) - offsetof(struct log_record, len));
+    crc = crc32_update(crc, key, rec->key_len);
+    return crc32_update(crc, mem, rec->len);
+}
+
+static size_t
+record_size(const struct fs_persist_value *value)
+{
+    return sizeof(struct log_record) + strlen(value->key) + value->len;
+}
+
+static int
+record_append(struct sol_buffer *buf, const struct fs_persist_value *value)
+{
+    struct log_record rec = {
+        .len = value->len,
+        .key_len = strlen(value->key),
+    };
+    int r;
+
+    rec.crc = record_crc(&rec, value->key, value->mem);
+
+    r = sol_buffer_append_slice(buf,
+        SOL_STR_SLICE_STR((const char *)&rec, sizeof(rec)));
+    if (r == 0)
+        r = sol_buffer_append_slice(buf,
+            SOL_STR_SLICE_STR(value->key, rec.key_len));
+    if (r == 0 && value->len)
+        r = sol_buffer_append_slice(buf,
+            SOL_STR_SLICE_STR(value->mem, value->len));
+    return r;
+}
+
+static int
+read_file(int fd, char **data, size_t *size)
+{
+    struct stat st;
+    size_t done = 0;
+    ssize_t r;
+    char *buf;
+
+    if (fstat(fd, &st) < 0)
+        return -errno;
+
+    buf = malloc(st.st_size + 1);
+    if (!buf)
+        return -ENOMEM;
+
+    while (done < (size_t)st.st_size) {
+        r = pread(fd, buf + done, st.st_size - done, done);
+        if (r < 0 && errno == EINTR)
+            continue;
+        if (r < 0) {
+            r = -errno;
+            free(buf);
+            return r;
+        }
+        if (r == 0)
+            break;
+        done += r;
+    }
+
+    *data = buf;
+    *size = done;
+    return 0;
+}
+
+static int
+write_all(int fd, const void *mem, size_t len, off_t off)
+{
+    const char *p = mem;
+    ssize_t r;
+
+    while (len) {
+        r = pwrite(fd, p, len, off);
+        if (r < 0 && errno == EINTR)
+            continue;
+        if (r < 0)
+            return -errno;
+        p += r;
+        off += r;
+        len -= r;
+    }
+
+    return 0;
+}
+
+static int
+sync_dir(const char *path)
+{
+    const char *slash = strrchr(path, '/');
+    char *dir;
+    int fd, r = 0;
+
+    if (!slash)
+        dir = strdup(".");
+    else if (slash == path)
+        dir = strdup("/");
+    else
+        dir = strndup(path, slash - path);
+    if (!dir)
+        return -ENOMEM;
+
+    fd = open(dir, O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+    free(dir);
+    if (fd < 0)
+        return -errno;
+
+    if (fsync(fd) < 0)
+        r = -errno;
+    close(fd);
+    return r;
+}
+
+/* A synced temporary file is renamed over path, so path has either
+ * the old or the new content, even after a power loss. */
+static int
+replace_file(const char *path, const void *mem, size_t len, int *keep_fd)
+{
+    struct stat st;
+    char *tmp_path;
+    int fd, r;
+
+    if (asprintf(&tmp_path, "%s.XXXXXX", path) < 0)
+        return -ENOMEM;
+
+    fd = mkostemp(tmp_path, O_CLOEXEC);
+    if (fd < 0) {
+        r = -errno;
+        free(tmp_path);
+        return r;
+    }
+
+    /* keep the mode of the file being replaced */
+    if (fchmod(fd, stat(path, &st) == 0 ? st.st_mode & 07777 : 0644) < 0)
+        r = -errno;
+    else
+        r = write_all(fd, mem, len, 0);
+    if (r == 0 && fdatasync(fd) < 0)
+        r = -errno;
+    if (r == 0 && rename(tmp_path, path) < 0)
+        r = -errno;
+
+    if (r < 0) {
+        unlink(tmp_path);
+        close(fd);
+    } else {
+        r = sync_dir(path);
+        if (keep_fd)
+            *keep_fd = fd;
+        else
+            close(fd);
+    }
+
+    free(tmp_path);
+    return r;
+}
+
+static int
+value_set_mem(struct fs_persist_value *value, const void *mem, size_t len)
+{
+    void *tmp = NULL;
+
+    if (len) {
+        tmp = sol_util_memdup(mem, len);
+        if (!tmp)
+            return -ENOMEM;
+    }
+
+    free(value->mem);
+    value->mem = tmp;
+    value->len = len;
+    return 0;
+}
+
+static struct fs_persist_value *
+value_find(const struct fs_persist_store *store, const char *key, size_t key_len)
+{
+    struct fs_persist_value *value;
+    uint16_t i;
+
+    SOL_PTR_VECTOR_FOREACH_IDX (&store->values, value, i) {
+        if (!key || (strlen(value->key) == key_len &&
+            memcmp(value->key, key, key_len) == 0))
+            return value;
+    }
+
+    return NULL;
+}
+
+static struct fs_persist_value *
+value_add(struct fs_persist_store *store, const char *key, size_t key_len)
+{
+    struct fs_persist_value *value;
+
+    value = calloc(1, sizeof(*value));
+    SOL_NULL_CHECK(value, NULL);
+
+    if (key) {
+        value->key = strndup(key, key_len);
+        SOL_NULL_CHECK_GOTO(value->key, error);
+    }
+
+    if (sol_ptr_vector_append(&store->values, value) < 0)
+        goto error;
+
+    value->store = store;
+    return value;
+
+error:
+    free(value->key);
+    free(value);
+    return NULL;
+}
+
+static int
+store_load_file(struct fs_persist_store *store)
+{
+    struct fs_persist_value *value;
+    size_t size;
+    char *data;
+    int fd, r;
+
+    value = value_add(store, NULL, 0);
+    SOL_NULL_CHECK(value, -ENOMEM);
+
+    fd = open(store->path, O_RDONLY | O_CLOEXEC);
+    if (fd < 0)
+        return errno == ENOENT ? 0 : -errno;
+
+    r = read_file(fd, &data, &size);
+    close(fd);
+    if (r < 0)
+        return r;
+
+    value->mem = data;
+    value->len = size;
+    return 0;
+}
+
+static int
+store_load_record(struct fs_persist_store *store, const struct log_record *rec, const char *key)
+{
+    struct fs_persist_value *value;
+    int r;
+
+    value = value_find(store, key, rec->key_len);
+    if (!value) {
+        value = value_add(store, key, rec->key_len);
+        SOL_NULL_CHECK(value, -ENOMEM);
+    }
+
+    r = value_set_mem(value, key + rec->key_len, rec->len);
+    if (r < 0)
+        return r;
+
+    store->live_size -= value->record_size;
+    value->record_size = record_size(value);
+    store->live_size += value->record_size;
+    return 0;
+}
+
+static int
+store_load_log(struct fs_persist_store *store)
+{
+    struct log_record rec;
+    size_t size, off, left;
+    char *data;
+    int r;
+
+    store->fd = open(store->path, O_RDWR | O_CREAT | O_CLOEXEC, 0644);
+    if (store->fd < 0)
+        return -errno;
+
+    r = read_file(store->fd, &data, &size);
+    if (r < 0)
+        return r;
+
+    /* a new log, the magic is written with the first records */
+    if (!size)
+        goto end;
+
+    if (size < LOG_MAGIC_LEN || memcmp(data, LOG_MAGIC, LOG_MAGIC_LEN)) {
+        SOL_WRN("'%s' is not a store of persisted values", store->path);
+        r = -EINVAL;
+        goto end;
+    }
+
+    for (off = LOG_MAGIC_LEN; size - off >= sizeof(rec);
+        off += sizeof(rec) + rec.key_len + rec.len) {
+        memcpy(&rec, data + off, sizeof(rec));
+        left = size - off - sizeof(rec);
+        if (rec.key_len > left || rec.len > left - rec.key_len)
+            break;
+        if (rec.crc != record_crc(&rec, data + off + sizeof(rec),
+            data + off + sizeof(rec) + rec.key_len))
+            break;
+
+        r = store_load_record(store, &rec, data + off + sizeof(rec));
+        if (r < 0)
+            goto end;
+    }
+
+    if (off < size) {
+        SOL_WRN("Dropping %zu bytes of a torn record at the end of '%s'",
+            size - off, store->path);
+        if (ftruncate(store->fd, off) < 0) {
+            r = -errno;
+            goto end;
+        }
+    }
+    store->log_size = off;
+
+end:
+    free(data);
+    return r;
+}
+
+static int
+store_compact(struct fs_persist_store *store)
+{
+    struct fs_persist_value *value;
+    struct sol_buffer buf;
+    uint16_t i;
+    int fd, r;
+
+    sol_buffer_init(&buf);
+    r = sol_buffer_append_slice(&buf, sol_str_slice_from_str(LOG_MAGIC));
+    SOL_PTR_VECTOR_FOREACH_IDX (&store->values, value, i) {
+        if (r < 0)
+            break;
+        if (value->dirty || value->record_size)
+            r = record_append(&buf, value);
+    }
+
+    if (r == 0)
+        r = replace_file(store->path, buf.data, buf.used, &fd);
+    if (r == 0) {
+        close(store->fd);
+        store->fd = fd;
+        store->log_size = buf.used;
+    }
+
+    sol_buffer_fini(&buf);
+    return r;
+}
+
+static int
+store_append(struct fs_persist_store *store)
+{
+    struct fs_persist_value *value;
+    struct sol_buffer buf;
+    uint16_t i;
+    int r = 0;
+
+    sol_buffer_init(&buf);
+    if (!store->log_size)
+        r = sol_buffer_append_slice(&buf, sol_str_slice_from_str(LOG_MAGIC));
+    SOL_PTR_VECTOR_FOREACH_IDX (&store->values, value, i) {
+        if (r < 0)
+            break;
+        if (value->dirty)
+            r = record_append(&buf, value);
+    }
+
+    /* Written past the valid records, a torn write is dropped when
+     * loaded and overwritten by the next one. */
+    if (r == 0)
+        r = write_all(store->fd, buf.data, buf.used, store->log_size);
+    if (r == 0 && fdatasync(store->fd) < 0)
+        r = -errno;
+    if (r == 0)
+        store->log_size += buf.used;
+
+    sol_buffer_fini(&buf);
+    return r;
+}
+
+static int
+store_flush(struct fs_persist_store *store)
+{
+    struct fs_persist_value *value;
+    size_t live_size = store->live_size, append_size = 0;
+    uint16_t i;
+    int r;
+
+    if (store->timer) {
+        sol_timeout_del(store->timer);
+        store->timer = NULL;
+    }
+
+    if (store->fd < 0) {
+        value = sol_ptr_vector_get(&store->values, 0);
+        if (!value->dirty)
+            return 0;
+        r = replace_file(store->path, value->mem, value->len, NULL);
+        if (r == 0)
+            value->dirty = false;
+        goto end;
+    }
+
+    SOL_PTR_VECTOR_FOREACH_IDX (&store->values, value, i) {
+        if (!value->dirty)
+            continue;
+        append_size += record_size(value);
+        live_size += record_size(value) - value->record_size;
+    }
+    if (!append_size)
+        return 0;
+
+    /* rewrite the log instead if it would be mostly stale records */
+    if (store->log_size + append_size > LOG_COMPACT_MIN &&
+        store->log_size + append_size > 2 * (LOG_MAGIC_LEN + live_size))
+        r = store_compact(store);
+    else
+        r = store_append(store);
+    if (r < 0)
+        goto end;
+
+    SOL_PTR_VECTOR_FOREACH_IDX (&store->values, value, i) {
+        if (!value->dirty)
+            continue;
+        value->record_size = record_size(value);
+        value->dirty = false;
+    }
+    store->live_size = live_size;
+
+end:
+    if (r < 0)
+        SOL_WRN("Could not write '%s': %s", store->path, sol_util_strerrora(-r));
+    else
+        store->retry_ms = 0;
+    return r;
+}
+
+/* The deadline of the first value to write, false if there's none. */
+static bool
+store_get_deadline(const struct fs_persist_store *store, struct timespec *deadline)
+{
+    struct fs_persist_value *value;
+    struct timespec d, s, t;
+    bool found = false;
+    uint16_t i;
+
+    SOL_PTR_VECTOR_FOREACH_IDX (&store->values, value, i) {
+        if (!value->dirty)
+            continue;
+
+        t = sol_util_timespec_from_msec(value->flush_interval);
+        sol_util_timespec_sum(&value->last_change, &t, &d);
+        t = sol_util_timespec_from_msec(value->max_staleness);
+        sol_util_timespec_sum(&value->first_change, &t, &s);
+        if (sol_util_timespec_compare(&s, &d) < 0)
+            d = s;
+
+        if (!found || sol_util_timespec_compare(&d, deadline) < 0)
+            *deadline = d;
+        found = true;
+    }
+
+    return found;
+}
+
+static bool store_on_timeout(void *data);
+
+static void
+store_schedule(struct fs_persist_store *store)
+{
+    struct timespec deadline, now, diff;
+    int ms = 0;
+
+    if (!store_get_deadline(store, &deadline))
+        return;
+
+    /* after a failed write, changes wait for its retry */
+    if (store->timer && store->retry_ms)
+        return;
+
+    /* the deadline is checked again when the timer expires, so it's
+     * only moved if it must expire earlier */
+    if (store->timer) {
+        if (sol_util_timespec_compare(&deadline, &store->deadline) >= 0)
+            return;
+        sol_timeout_del(store->timer);
+    }
+
+    now = sol_util_timespec_get_current();
+    if (sol_util_timespec_compare(&deadline, &now) > 0) {
+        sol_util_timespec_sub(&deadline, &now, &diff);
+        ms = sol_util_msec_from_timespec(&diff) + 1;
+    }
+
+    store->deadline = deadline;
+    store->timer = sol_timeout_add(ms, store_on_timeout, store);
+    if (!store->timer) {
+        SOL_WRN("Could not schedule writing '%s', writing it now", store->path);
+        store_flush(store);
+    }
+}
+
+/* Values that failed to be written are kept changed and written
+ * again later, backing off while the failures go on. */
+static void
+store_retry(struct fs_persist_store *store)
+{
+    if (!store->retry_ms)
+        store->retry_ms = FLUSH_RETRY_MIN_MS;
+    else if (store->retry_ms < FLUSH_RETRY_MAX_MS / 2)
+        store->retry_ms *= 2;
+    else
+        store->retry_ms = FLUSH_RETRY_MAX_MS;
+
+    store->timer = sol_timeout_add(store->retry_ms, store_on_timeout, store);
+    if (!store->timer)
+        SOL_WRN("Could not schedule writing '%s' again", store->path);
+}
+
+/* All changed values are written together, when the first is due. */
+static bool
+store_on_timeout(void *data)
+{
+    struct fs_persist_store *store = data;
+    struct timespec deadline, now;
+
+    store->timer = NULL;
+    if (!store_get_deadline(store, &deadline))
+        return false;
+
+    now = sol_util_timespec_get_current();
+    if (sol_util_timespec_compare(&deadline, &now) > 0)
+        store_schedule(store);
+    else if (store_flush(store) < 0)
+        store_retry(store);
+    return false;
+}
+
+/* Nodes are often never deleted, values still unwritten are written
+ * when the application exits. */
+static void
+stores_on_shutdown(void *data)
+{
+    struct fs_persist_store *store;
+    uint16_t i;
+
+    shutdown_hooked = false;
+    /* failures are not retried, the main loop is going away */
+    SOL_PTR_VECTOR_FOREACH_IDX (&stores, store, i)
+        store_flush(store);
+}
+
+static void
+store_free(struct fs_persist_store *store)
+{
+    struct fs_persist_value *value;
+    uint16_t i;
+
+    SOL_PTR_VECTOR_FOREACH_IDX (&store->values, value, i) {
+        free(value->key);
+        free(value->mem);
+        free(value);
+    }
+    sol_ptr_vector_clear(&store->values);
+
+    if (store->timer)
+        sol_timeout_del(store->timer);
+    if (store->fd >= 0)
+        close(store->fd);
+    free(store->path);
+    free(store);
+}
+
+static struct fs_persist_store *
+store_new(const char *path, bool log)
+{
+    struct fs_persist_store *store;
+    int r;
+
+    store = calloc(1, sizeof(*store));
+    SOL_NULL_CHECK(store, NULL);
+
+    store->fd = -1;
+    sol_ptr_vector_init(&store->values);
+    store->path = strdup(path);
+    if (!store->path) {
+        r = -ENOMEM;
+        goto error;
+    }
+
+    r = log ? store_load_log(store) : store_load_file(store);
+    if (r < 0) {
+        SOL_WRN("Could not load '%s': %s", path, sol_util_strerrora(-r));
+        goto error;
+    }
+
+    if (!shutdown_hooked) {
+        r = sol_flow_add_shutdown_callback(stores_on_shutdown, NULL);
+        if (r < 0)
+            goto error;
+        shutdown_hooked = true;
+    }
+
+    r = sol_ptr_vector_append(&stores, store);
+    if (r < 0)
+        goto error;
+
+    return store;
+
+error:
+    store_free(store);
+    errno = -r;
+    return NULL;
+}
+
+static void
+store_del(struct fs_persist_store *store)
+{
+    struct fs_persist_store *itr;
+    uint16_t i;
+
+    store_flush(store);
+
+    SOL_PTR_VECTOR_FOREACH_REVERSE_IDX (&stores, itr, i) {
+        if (itr == store) {
+            sol_ptr_vector_del(&stores, i);
+            break;
+        }
+    }
+    if (!sol_ptr_vector_get_len(&stores)) {
+        sol_ptr_vector_clear(&stores);
+        if (shutdown_hooked) {
+            sol_flow_del_shutdown_callback(stores_on_shutdown, NULL);
+            shutdown_hooked = false;
+        }
+    }
+
+    store_free(store);
+}
+
+static struct fs_persist_store *
+store_find(const char *path)
+{
+    struct fs_persist_store *store;
+    uint16_t i;
+
+    SOL_PTR_VECTOR_FOREACH_IDX (&stores, store, i) {
+        if (streq(store->path, path))
+            return store;
+    }
+
+    return NULL;
+}
+
+struct fs_persist_value *
+fs_persist_value_new(const char *path, const char *key, unsigned int flush_interval, unsigned int max_staleness)
+{
+    struct fs_persist_store *store;
+    struct fs_persist_value *value;
+    size_t key_len = key ? strlen(key) : 0;
+
+    if (!path || (key && (!key_len || key_len > UINT16_MAX))) {
+        errno = EINVAL;
+        return NULL;
+    }
+
+    store = store_find(path);
+    if (!store) {
+        store = store_new(path, !!key);
+        if (!store)
+            return NULL;
+    } else if ((store->fd >= 0) != !!key) {
+        SOL_WRN("'%s' can't be both a store and a single value file", path);
+        errno = EINVAL;
+        return NULL;
+    }
+
+    value = value_find(store, key, key_len);
+    if (!value) {
+        value = value_add(store, key, key_len);
+        if (!value) {
+            if (!store->refcnt)
+                store_del(store);
+            errno = ENOMEM;
+            return NULL;
+        }
+    }
+
+    /* shared values are written as often as their most demanding user wants */
+    if (!value->refcnt || flush_interval < value->flush_interval)
+        value->flush_interval = flush_interval;
+    if (!value->refcnt || max_staleness < value->max_staleness)
+        value->max_staleness = max_staleness;
+
+    value->refcnt++;
+    store->refcnt++;
+    return value;
+}
+
+void
+fs_persist_value_del(struct fs_persist_value *value)
+{
+    struct fs_persist_store *store = value->store;
+
+    value->refcnt--;
+    if (--store->refcnt == 0)
+        store_del(store);
+}
+
+struct sol_str_slice
+fs_persist_value_get(const struct fs_persist_value *value)
+{
+    return SOL_STR_SLICE_STR(value->mem, value->len);
+}
+
+int
+fs_persist_value_set(struct fs_persist_value *value, const void *mem, size_t len)
+{
+    struct timespec now;
+    int r;
+
+    if (len > UINT32_MAX)
+        return -EFBIG;
+
+    if (len == value->len && (!len || memcmp(mem, value->mem, len) == 0))
+        return 0;
+
+    r = value_set_mem(value, mem, len);
+    if (r < 0)
+        return r;
+
+    now = sol_util_timespec_get_current();
+    if (!value->dirty)
+        value->first_change = now;
+    value->last_change = now;
+    value->dirty = true;
+
+    store_schedule(value->store);
+    return 0;
+}
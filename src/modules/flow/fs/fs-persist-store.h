@@ -0,0 +1,61 @@
+/*
+ * This file is part of the Soletta Project
+ *
+ * Copyright (C) 2015 Intel Corporation. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above copyright
+ *     notice, this list of conditions and the following disclaimer in
+ *     the documentation and/or other materials provided with the
+ *     distribution.
+ *   * Neither the name of Intel Corporation nor the names of its
+ *     contributors may be used to endorse or promote products derived
+ *     from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ * OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#pragma once
+
+#include <stdbool.h>
+#include <stddef.h>
+
+#include "sol-str-slice.h"
+
+/*
+ * Values of the fs/persist-* nodes are kept in memory and written
+ * behind: flush_interval ms after their last change, but at most
+ * max_staleness ms after their first unwritten one, when the last
+ * user of their file is gone and on sol_shutdown(). Values changed
+ * together are written together.
+ *
+ * Without a key, the value is the whole content of the file, that is
+ * replaced by renaming a synced temporary file over it. With a key,
+ * the file is a store shared by many values: an append-only log of
+ * checksummed records, where the last record of a key wins and a torn
+ * record at the end is dropped. The log is compacted the same way the
+ * single value files are replaced, once it's mostly stale records.
+ */
+struct fs_persist_value;
+
+struct fs_persist_value *fs_persist_value_new(const char *path, const char *key, unsigned int flush_interval, unsigned int max_staleness);
+void fs_persist_value_del(struct fs_persist_value *value);
+
+/* The data is empty if nothing was stored yet. */
+struct sol_str_slice fs_persist_value_get(const struct fs_persist_value *value);
+int fs_persist_value_set(struct fs_persist_value *value, const void *mem, size_t len);
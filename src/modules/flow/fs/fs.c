@@ -41,12 +41,13 @@
 #include <string.h>
 
 #include "fs-gen.h"
+#include "fs-persist-store.h"
 
 #include "sol-flow.h"
 #include "sol-util.h"
 
 struct fs_persist_data {
-    FILE *file;
+    struct fs_persist_value *value;
     void *value_ptr;
     struct sol_flow_packet *(*packet_new_fn)(const struct fs_persist_data *data);
     int (*packet_data_get_fn)(const struct sol_flow_packet *packet, void *value_ptr);
@@ -58,40 +59,47 @@ struct fs_persist_data {
 static int
 fs_persist_open(struct sol_flow_node *node,
     void *data,
-    const char *path)
+    const char *path,
+    const char *store,
+    int32_t flush_interval,
+    int32_t max_staleness)
 {
     struct fs_persist_data *mdata = data;
-    struct stat st;
-    int r;
+    struct sol_str_slice value;
+
+    SOL_NULL_CHECK(path, -EINVAL);
+    if (flush_interval < 0 || max_staleness < 0) {
+        SOL_WRN("Invalid flush interval (%d) or maximum staleness (%d)",
+            flush_interval, max_staleness);
+        return -EINVAL;
+    }
 
-    mdata->file = fopen(path, "re+");
-    if (!mdata->file) {
-        SOL_WRN("Failed to open file %s", path);
+    /* with a store, the path is the key of the value in it */
+    mdata->value = fs_persist_value_new(store ? store : path,
+        store ? path : NULL, flush_interval, max_staleness);
+    if (!mdata->value) {
+        SOL_WRN("Failed to open file %s", store ? store : path);
         return -errno;
     }
 
-    r = fstat(fileno(mdata->file), &st);
-    SOL_INT_CHECK(r, < 0, r);
+    value = fs_persist_value_get(mdata->value);
 
     /* a zero packet_data_size means dynamic size content */
     if (mdata->packet_data_size) {
         /* by returning early, mdata->last_set continues as false */
-        if ((size_t)st.st_size < mdata->packet_data_size)
+        if (value.len < mdata->packet_data_size)
             return 0;
 
-        r = fread(mdata->value_ptr, mdata->packet_data_size, 1, mdata->file);
-        SOL_INT_CHECK(r, < 0, r);
+        memcpy(mdata->value_ptr, value.data, mdata->packet_data_size);
     } else {
         /* by returning early, mdata->last_set continues as false */
-        if (!st.st_size)
+        if (!value.len)
             return 0;
-        mdata->value_ptr = calloc(1, st.st_size + 1);
-        SOL_NULL_CHECK(mdata->value_ptr, -ENOMEM);
-        do {
-            r = fread(mdata->value_ptr, 256, 1, mdata->file);
-        } while (r > 0);
-        SOL_INT_CHECK(r, < 0, r);
-        ((char *)mdata->value_ptr)[st.st_size] = '\0';
+        mdata->value_ptr = strndup(value.data, value.len);
+        if (!mdata->value_ptr) {
+            fs_persist_value_del(mdata->value);
+            return -ENOMEM;
+        }
     }
 
     mdata->last_set = true;
@@ -104,7 +112,7 @@ fs_persist_close(struct sol_flow_node *node, void *data)
 {
     struct fs_persist_data *mdata = data;
 
-    fclose(mdata->file);
+    fs_persist_value_del(mdata->value);
     if (!mdata->packet_data_size)
         free(mdata->value_ptr);
 }
@@ -129,19 +137,15 @@ fs_persist_process(struct sol_flow_node *node,
     }
     SOL_INT_CHECK(r, < 0, r);
 
-    r = fseek(mdata->file, SEEK_SET, 0);
-    SOL_INT_CHECK(r, < 0, r);
-
+    /* written behind, see fs-persist-store.h */
     if (mdata->packet_data_size) {
-        r = fwrite(value, mdata->packet_data_size, 1, mdata->file);
+        r = fs_persist_value_set(mdata->value, value, mdata->packet_data_size);
     } else {
         size = strlen(value_ptr) + 1;
-        r = fwrite(value_ptr, size, 1, mdata->file);
+        r = fs_persist_value_set(mdata->value, value_ptr, size);
     }
     SOL_INT_CHECK(r, < 0, r);
 
-    fflush(mdata->file);
-
     if (mdata->packet_data_size) {
         memcpy(mdata->value_ptr, value, mdata->packet_data_size);
     } else {
@@ -208,7 +212,8 @@ fs_persist_boolean_open(struct sol_flow_node *node,
     mdata->base.packet_data_get_fn = fs_persist_boolean_packet_data_get;
     mdata->base.packet_send_fn = fs_persist_boolean_packet_send;
 
-    return fs_persist_open(node, data, opts->path);
+    return fs_persist_open(node, data, opts->path, opts->store,
+        opts->flush_interval.val, opts->max_staleness.val);
 }
 
 struct fs_persist_byte_data {
@@ -260,7 +265,8 @@ fs_persist_byte_open(struct sol_flow_node *node,
     mdata->base.packet_data_get_fn = fs_persist_byte_packet_data_get;
     mdata->base.packet_send_fn = fs_persist_byte_packet_send;
 
-    return fs_persist_open(node, data, opts->path);
+    return fs_persist_open(node, data, opts->path, opts->store,
+        opts->flush_interval.val, opts->max_staleness.val);
 }
 
 struct fs_persist_irange_data {
@@ -313,7 +319,8 @@ fs_persist_irange_open(struct sol_flow_node *node,
     mdata->base.packet_data_get_fn = fs_persist_irange_packet_data_get;
     mdata->base.packet_send_fn = fs_persist_irange_packet_send;
 
-    return fs_persist_open(node, data, opts->path);
+    return fs_persist_open(node, data, opts->path, opts->store,
+        opts->flush_interval.val, opts->max_staleness.val);
 }
 
 struct fs_persist_drange_data {
@@ -357,8 +364,8 @@ fs_persist_drange_open(struct sol_flow_node *node,
     const struct sol_flow_node_options *options)
 {
     struct fs_persist_drange_data *mdata = data;
-    const struct sol_flow_node_type_fs_persist_int_options *opts =
-        (const struct sol_flow_node_type_fs_persist_int_options *)options;
+    const struct sol_flow_node_type_fs_persist_float_options *opts =
+        (const struct sol_flow_node_type_fs_persist_float_options *)options;
 
     mdata->base.packet_data_size = sizeof(struct sol_drange);
     mdata->base.value_ptr = &mdata->last_value;
@@ -366,7 +373,8 @@ fs_persist_drange_open(struct sol_flow_node *node,
     mdata->base.packet_data_get_fn = fs_persist_drange_packet_data_get;
     mdata->base.packet_send_fn = fs_persist_drange_packet_send;
 
-    return fs_persist_open(node, data, opts->path);
+    return fs_persist_open(node, data, opts->path, opts->store,
+        opts->flush_interval.val, opts->max_staleness.val);
 }
 
 struct fs_persist_string_data {
@@ -407,14 +415,15 @@ fs_persist_string_open(struct sol_flow_node *node,
     const struct sol_flow_node_options *options)
 {
     struct fs_persist_string_data *mdata = data;
-    const struct sol_flow_node_type_fs_persist_int_options *opts =
-        (const struct sol_flow_node_type_fs_persist_int_options *)options;
+    const struct sol_flow_node_type_fs_persist_string_options *opts =
+        (const struct sol_flow_node_type_fs_persist_string_options *)options;
 
     mdata->base.packet_new_fn = fs_persist_string_packet_new;
     mdata->base.packet_data_get_fn = fs_persist_string_packet_data_get;
     mdata->base.packet_send_fn = fs_persist_string_packet_send;
 
-    return fs_persist_open(node, data, opts->path);
+    return fs_persist_open(node, data, opts->path, opts->store,
+        opts->flush_interval.val, opts->max_staleness.val);
 }
 
 
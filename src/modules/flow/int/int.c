@@ -38,7 +38,9 @@
 #include "sol-mainloop.h"
 
 #include <sol-util.h>
+#include <sol-window-stats.h>
 #include <limits.h>
+#include <math.h>
 #include <errno.h>
 
 // =============================================================================
@@ -491,11 +493,10 @@ irange_constrain_process(struct sol_flow_node *node, void *data, uint16_t port,
 struct irange_buffer_data {
     struct sol_flow_node *node;
     struct sol_timeout *timer;
-    int32_t *input_queue;
-    int32_t (*normalize_cb)(const int32_t *const values, size_t len);
-    size_t cur_len;
-    size_t n_samples;
+    struct sol_window_stats stats;
+    int32_t (*normalize_cb)(const struct sol_window_stats *stats);
     uint32_t timeout;
+    bool circular;
 };
 
 // =============================================================================
@@ -503,51 +504,68 @@ struct irange_buffer_data {
 // =============================================================================
 
 static int32_t
-_normalize_mean(const int32_t *const values, const size_t len)
+_double_to_int32(double value)
 {
-    int64_t sum = 0;
-
-    for (size_t i = 0; i < len; i++)
-        sum += values[i];
-
-    return sum / len;
+    if (isnan(value))
+        return 0;
+    if (value >= INT32_MAX)
+        return INT32_MAX;
+    if (value <= INT32_MIN)
+        return INT32_MIN;
+    return lround(value);
 }
 
-static int
-int_cmp(const void *data1, const void *data2)
+static int32_t
+_normalize_mean(const struct sol_window_stats *stats)
 {
-    const int32_t *i1 = data1;
-    const int32_t *i2 = data2;
-
-    return (*i1 > *i2) - (*i1 < *i2);
+    /* int32 sums are exact as doubles, keep integer division semantics */
+    return (int64_t)sol_window_stats_sum(stats) /
+           (int64_t)sol_window_stats_count(stats);
 }
 
 static int32_t
-_normalize_median(const int32_t *const values, const size_t len)
+_normalize_median(const struct sol_window_stats *stats)
 {
-    int32_t *copy_queue;
-    int32_t ret;
+    uint32_t len = sol_window_stats_count(stats);
 
-    copy_queue = calloc(len, sizeof(*copy_queue));
-    SOL_NULL_CHECK(copy_queue, 0);
+    if (len % 2)
+        return sol_window_stats_nth(stats, len / 2);
 
-    memcpy(copy_queue, values, len * sizeof(*copy_queue));
+    return ((int64_t)sol_window_stats_nth(stats, len / 2 - 1) +
+           (int64_t)sol_window_stats_nth(stats, len / 2)) / 2;
+}
 
-    qsort(copy_queue, len, sizeof(*copy_queue), int_cmp);
+static int32_t
+_normalize_variance(const struct sol_window_stats *stats)
+{
+    return _double_to_int32(sol_window_stats_variance(stats));
+}
 
-    if (len % 2)
-        ret = copy_queue[len / 2];
-    else
-        ret = _normalize_mean(&copy_queue[len / 2 - 1], 2);
+static int32_t
+_normalize_stddev(const struct sol_window_stats *stats)
+{
+    return _double_to_int32(sol_window_stats_stddev(stats));
+}
 
-    free(copy_queue);
+static int32_t
+_normalize_min(const struct sol_window_stats *stats)
+{
+    return sol_window_stats_min(stats);
+}
 
-    return ret;
+static int32_t
+_normalize_max(const struct sol_window_stats *stats)
+{
+    return sol_window_stats_max(stats);
 }
 
 static const struct sol_str_table_ptr table[] = {
     SOL_STR_TABLE_PTR_ITEM("mean", _normalize_mean),
     SOL_STR_TABLE_PTR_ITEM("median", _normalize_median),
+    SOL_STR_TABLE_PTR_ITEM("variance", _normalize_variance),
+    SOL_STR_TABLE_PTR_ITEM("stddev", _normalize_stddev),
+    SOL_STR_TABLE_PTR_ITEM("min", _normalize_min),
+    SOL_STR_TABLE_PTR_ITEM("max", _normalize_max),
     { }
 };
 
@@ -558,10 +576,10 @@ _irange_buffer_do(struct irange_buffer_data *mdata)
 {
     int32_t result;
 
-    if (!mdata->cur_len)
+    if (!sol_window_stats_count(&mdata->stats))
         return 0;
 
-    result = mdata->normalize_cb(mdata->input_queue, mdata->cur_len);
+    result = mdata->normalize_cb(&mdata->stats);
 
     return sol_flow_send_irange_value_packet(mdata->node,
         SOL_FLOW_NODE_TYPE_INT_BUFFER__OUT__OUT, result);
@@ -573,7 +591,7 @@ _timeout(void *data)
     struct irange_buffer_data *mdata = data;
 
     _irange_buffer_do(mdata);
-    mdata->cur_len = 0;
+    sol_window_stats_reset(&mdata->stats);
     return true;
 }
 
@@ -582,7 +600,7 @@ _reset(void *data)
 {
     struct irange_buffer_data *mdata = data;
 
-    mdata->cur_len = 0;
+    sol_window_stats_reset(&mdata->stats);
 
     if (mdata->timer)
         sol_timeout_del(mdata->timer);
@@ -627,12 +645,18 @@ irange_buffer_process(struct sol_flow_node *node, void *data, uint16_t port, uin
     const struct sol_flow_packet *packet)
 {
     int r;
+    int32_t value;
     struct irange_buffer_data *mdata = data;
 
-    r = sol_flow_packet_get_irange_value(packet, &mdata->input_queue[mdata->cur_len]);
+    r = sol_flow_packet_get_irange_value(packet, &value);
     SOL_INT_CHECK(r, < 0, r);
 
-    if (mdata->n_samples <= ++mdata->cur_len) {
+    sol_window_stats_add(&mdata->stats, value);
+
+    if (mdata->circular)
+        return _irange_buffer_do(mdata);
+
+    if (sol_window_stats_is_full(&mdata->stats)) {
         r = _irange_buffer_do(mdata);
         _reset(data);
     }
@@ -644,26 +668,26 @@ static int
 irange_buffer_open(struct sol_flow_node *node, void *data,
     const struct sol_flow_node_options *options)
 {
+    int r;
     struct irange_buffer_data *mdata = data;
     const struct sol_flow_node_type_int_buffer_options *opts =
         (const struct sol_flow_node_type_int_buffer_options *)options;
 
     mdata->node = node;
-    mdata->cur_len = 0;
 
     SOL_FLOW_NODE_OPTIONS_SUB_API_CHECK
         (options, SOL_FLOW_NODE_TYPE_INT_BUFFER_OPTIONS_API_VERSION, -EINVAL);
 
     SOL_INT_CHECK(opts->timeout.val, < 0, -EINVAL);
-    SOL_INT_CHECK(opts->samples.val, == 0, -EINVAL);
+    SOL_INT_CHECK(opts->samples.val, <= 0, -EINVAL);
 
-    mdata->n_samples = opts->samples.val;
     mdata->timeout = opts->timeout.val;
+    mdata->circular = opts->circular;
     mdata->normalize_cb = sol_str_table_ptr_lookup_fallback
             (table, sol_str_slice_from_str(opts->operation), _normalize_mean);
 
-    mdata->input_queue = calloc(mdata->n_samples, sizeof(*mdata->input_queue));
-    SOL_NULL_CHECK(mdata->input_queue, -ENOMEM);
+    r = sol_window_stats_init(&mdata->stats, opts->samples.val, 0);
+    SOL_INT_CHECK(r, < 0, r);
 
     if (mdata->timeout > 0)
         mdata->timer = sol_timeout_add(mdata->timeout, _timeout, mdata);
@@ -681,7 +705,7 @@ irange_buffer_close(struct sol_flow_node *node, void *data)
         mdata->timer = NULL;
     }
 
-    free(mdata->input_queue);
+    sol_window_stats_fini(&mdata->stats);
 }
 
 // =============================================================================
@@ -56,6 +56,7 @@ struct subprocess_data {
     struct sol_flow_node *node;
     struct sol_platform_linux_fork_run *fork_run;
     char *command;
+    char **argv;
 };
 
 void process_log_init(void);
@@ -35,6 +35,7 @@
 #include "sol-platform-linux.h"
 #include "sol-util.h"
 
+#include <ctype.h>
 #include <fcntl.h>
 #include <signal.h>
 #include <stdio.h>
@@ -146,38 +147,6 @@ process_subprocess_in_process(struct sol_flow_node *node, void *data, uint16_t p
     return 0;
 }
 
-static void
-on_fork(void *data)
-{
-    struct subprocess_data *mdata = data;
-
-    close(mdata->pipes.out[1]);
-    close(mdata->pipes.err[0]);
-    close(mdata->pipes.in[0]);
-    close(STDOUT_FILENO);
-    close(STDIN_FILENO);
-    close(STDERR_FILENO);
-
-    if (dup2(mdata->pipes.out[0], STDIN_FILENO) < 0)
-        goto err;
-    if (dup2(mdata->pipes.in[1], STDOUT_FILENO) < 0)
-        goto err;
-    if (dup2(mdata->pipes.err[1], STDERR_FILENO) < 0)
-        goto err;
-
-    execl("/bin/sh", "sh", "-c", mdata->command, (char *)0);
-
-/*
- * An error happened, just exiting with the error to be catch by the parent
- */
-err:
-    SOL_WRN("Failed in setup the files descriptors");
-    close(mdata->pipes.out[1]);
-    close(mdata->pipes.err[0]);
-    close(mdata->pipes.in[0]);
-    exit(-errno);
-}
-
 static int
 child_read(struct sol_blob **p_blob, bool *eof, int fd)
 {
@@ -323,6 +292,58 @@ on_fork_exit(void *data, uint64_t pid, int status)
     sol_flow_send_irange_value_packet(mdata->node, SOL_FLOW_NODE_TYPE_PROCESS_SUBPROCESS__OUT__STATUS, status);
 }
 
+static int
+spawn(struct subprocess_data *mdata)
+{
+    const int fds[3] = { mdata->pipes.out[0], mdata->pipes.in[1], mdata->pipes.err[1] };
+
+    mdata->fork_run = sol_platform_linux_spawn((const char *const *)mdata->argv,
+        fds, on_fork_exit, mdata);
+    SOL_NULL_CHECK(mdata->fork_run, -errno);
+
+    return 0;
+}
+
+/* Without the shell, the command is split at blanks into the program
+ * and its arguments, with no quoting or expansion. */
+static int
+setup_argv(struct subprocess_data *mdata, bool shell)
+{
+    char *p;
+    size_t n = 0, words = 0;
+
+    if (shell) {
+        mdata->argv = calloc(4, sizeof(char *));
+        SOL_NULL_CHECK(mdata->argv, -ENOMEM);
+        mdata->argv[0] = (char *)"/bin/sh";
+        mdata->argv[1] = (char *)"-c";
+        mdata->argv[2] = mdata->command;
+        return 0;
+    }
+
+    for (p = mdata->command; *p; p++) {
+        if (!isblank((unsigned char)*p) && (p == mdata->command || isblank((unsigned char)p[-1])))
+            words++;
+    }
+    if (!words) {
+        SOL_WRN("Empty command");
+        errno = EINVAL;
+        return -EINVAL;
+    }
+
+    mdata->argv = calloc(words + 1, sizeof(char *));
+    SOL_NULL_CHECK(mdata->argv, -ENOMEM);
+
+    for (p = mdata->command; *p; p++) {
+        if (isblank((unsigned char)*p))
+            *p = '\0';
+        else if (p == mdata->command || !p[-1])
+            mdata->argv[n++] = p;
+    }
+
+    return 0;
+}
+
 static int
 setup_watches(struct subprocess_data *mdata)
 {
@@ -350,8 +371,8 @@ process_subprocess_start_process(struct sol_flow_node *node, void *data, uint16_
     if (setup_watches(mdata) < 0)
         return -1;
 
-    mdata->fork_run = sol_platform_linux_fork_run(on_fork, on_fork_exit, mdata);
-    SOL_NULL_CHECK_GOTO(mdata->fork_run, fork_err);
+    if (spawn(mdata) < 0)
+        goto fork_err;
 
     return 0;
 
@@ -403,17 +424,17 @@ process_subprocess_open(struct sol_flow_node *node, void *data, const struct sol
     mdata->node = node;
     sol_vector_init(&mdata->write_data, sizeof(struct write_data));
 
-    if (pipe(mdata->pipes.out) < 0) {
+    if (pipe2(mdata->pipes.out, O_CLOEXEC) < 0) {
         SOL_WRN("Failed to create out pipe");
         return -errno;
     }
 
-    if (pipe(mdata->pipes.in) < 0) {
+    if (pipe2(mdata->pipes.in, O_CLOEXEC) < 0) {
         SOL_WRN("Failed to create in pipe");
         goto in_err;
     }
 
-    if (pipe(mdata->pipes.err) < 0) {
+    if (pipe2(mdata->pipes.err, O_CLOEXEC) < 0) {
         SOL_WRN("Failed to create err pipe");
         goto err_err;
     }
@@ -428,11 +449,14 @@ process_subprocess_open(struct sol_flow_node *node, void *data, const struct sol
     mdata->command = strdup(opts->command);
     SOL_NULL_CHECK_GOTO(mdata->command, flags_err);
 
+    if (setup_argv(mdata, opts->shell) < 0)
+        goto argv_err;
+
     if (opts->start) {
         if (setup_watches(mdata) < 0)
             goto watch_err;
-        mdata->fork_run = sol_platform_linux_fork_run(on_fork, on_fork_exit, mdata);
-        SOL_NULL_CHECK_GOTO(mdata->fork_run, err);
+        if (spawn(mdata) < 0)
+            goto err;
     }
 
     return 0;
@@ -441,6 +465,8 @@ err:
     sol_fd_del(mdata->watches.in);
     sol_fd_del(mdata->watches.err);
 watch_err:
+    free(mdata->argv);
+argv_err:
     free(mdata->command);
 flags_err:
     close(mdata->pipes.err[0]);
@@ -483,5 +509,6 @@ process_subprocess_close(struct sol_flow_node *node, void *data)
     close(mdata->pipes.out[0]);
     close(mdata->pipes.out[1]);
 
+    free(mdata->argv);
     free(mdata->command);
 }
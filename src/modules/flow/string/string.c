@@ -34,12 +34,14 @@
 
 #include "sol-flow-internal.h"
 
+#include "sol-buffer.h"
+
 #include <sol-util.h>
 #include <errno.h>
 
 struct string_data {
     int n;
-    char *string[2];
+    struct sol_buffer string[2];
 };
 
 struct string_concatenate_data {
@@ -57,8 +59,8 @@ string_close(struct sol_flow_node *node, void *data)
 {
     struct string_data *mdata = data;
 
-    free(mdata->string[0]);
-    free(mdata->string[1]);
+    sol_buffer_fini(&mdata->string[0]);
+    sol_buffer_fini(&mdata->string[1]);
 }
 
 static void
@@ -73,19 +75,23 @@ string_concatenate_close(struct sol_flow_node *node, void *data)
 static bool
 get_string(const struct sol_flow_packet *packet, uint16_t port, struct string_data *mdata)
 {
-    const char *in_value;
+    struct sol_buffer *buf = &mdata->string[port];
+    struct sol_str_slice in_value;
     int r;
 
-    r = sol_flow_packet_get_string(packet, &in_value);
-    SOL_INT_CHECK(r, < 0, r);
+    r = sol_flow_packet_get_string_slice(packet, &in_value, NULL);
+    SOL_INT_CHECK(r, < 0, false);
+    SOL_NULL_CHECK(in_value.data, false);
 
-    if (mdata->string[port] && !strcmp(mdata->string[port], in_value))
+    if (buf->data && buf->used == in_value.len &&
+        !memcmp(buf->data, in_value.data, in_value.len))
         return false;
 
-    free(mdata->string[port]);
-    mdata->string[port] = strdup(in_value);
+    /* the buffer keeps its memory, so no allocation in the common case */
+    r = sol_buffer_set_slice(buf, in_value);
+    SOL_INT_CHECK(r, < 0, false);
 
-    if (!mdata->string[0] || !mdata->string[1])
+    if (!mdata->string[0].data || !mdata->string[1].data)
         return false;
 
     return true;
@@ -126,28 +132,31 @@ static int
 string_concat(struct sol_flow_node *node, void *data, uint16_t port, uint16_t conn_id, const struct sol_flow_packet *packet)
 {
     struct string_concatenate_data *mdata = data;
+    const struct sol_buffer *str0 = &mdata->base.string[0];
+    const struct sol_buffer *str1 = &mdata->base.string[1];
+    size_t sep_len = 0, str1_len, len;
     char *dest;
-    int err, len;
+    int err;
 
     if (!get_string(packet, port, &mdata->base))
         return 0;
 
-    len = strlen(mdata->base.string[0]) + strlen(mdata->base.string[1]) + 1;
     if (mdata->separator)
-        len += strlen(mdata->separator);
+        sep_len = strlen(mdata->separator);
 
-    dest = malloc(len);
-    SOL_NULL_CHECK(dest, -ENOMEM);
+    str1_len = str1->used;
+    if (mdata->base.n && (size_t)mdata->base.n < str1_len)
+        str1_len = mdata->base.n;
 
-    dest = strcpy(dest, mdata->base.string[0]);
+    len = str0->used + sep_len + str1_len;
+    dest = malloc(len + 1);
+    SOL_NULL_CHECK(dest, -ENOMEM);
 
-    if (mdata->separator)
-        dest = strcat(dest, mdata->separator);
-
-    if (!mdata->base.n)
-        dest = strcat(dest, mdata->base.string[1]);
-    else
-        dest = strncat(dest, mdata->base.string[1], mdata->base.n);
+    memcpy(dest, str0->data, str0->used);
+    if (sep_len)
+        memcpy(dest + str0->used, mdata->separator, sep_len);
+    memcpy(dest + str0->used + sep_len, str1->data, str1_len);
+    dest[len] = '\0';
 
     err = sol_flow_send_string_take_packet(node,
         SOL_FLOW_NODE_TYPE_STRING_CONCATENATE__OUT__OUT,
@@ -185,24 +194,26 @@ static int
 string_compare(struct sol_flow_node *node, void *data, uint16_t port, uint16_t conn_id, const struct sol_flow_packet *packet)
 {
     struct string_compare_data *mdata = data;
+    const char *str0, *str1;
     uint32_t result;
     int err;
 
     if (!get_string(packet, port, &mdata->base))
         return 0;
 
+    str0 = mdata->base.string[0].data;
+    str1 = mdata->base.string[1].data;
+
     if (mdata->base.n) {
         if (mdata->ignore_case)
-            result = strncasecmp(mdata->base.string[0], mdata->base.string[1],
-                mdata->base.n);
+            result = strncasecmp(str0, str1, mdata->base.n);
         else
-            result = strncmp(mdata->base.string[0], mdata->base.string[1],
-                mdata->base.n);
+            result = strncmp(str0, str1, mdata->base.n);
     } else {
         if (mdata->ignore_case)
-            result = strcasecmp(mdata->base.string[0], mdata->base.string[1]);
+            result = strcasecmp(str0, str1);
         else
-            result = strcmp(mdata->base.string[0], mdata->base.string[1]);
+            result = strcmp(str0, str1);
     }
 
     err = sol_flow_send_boolean_packet(node,
@@ -263,11 +274,13 @@ string_length_process(struct sol_flow_node *node, void *data, uint16_t port, uin
 
 
 struct string_split_data {
-    struct sol_ptr_vector substrings;
-    char *string;
+    struct sol_buffer string;
+    /* copy of 'string' with separators replaced by NUL bytes, shared
+     * by the substring packets */
+    struct sol_blob *tokens;
     char *separator;
-    char *dupstring;
     int index;
+    int len;
 };
 
 static int
@@ -291,7 +304,7 @@ string_split_open(struct sol_flow_node *node, void *data, const struct sol_flow_
         SOL_NULL_CHECK(mdata->separator, -ENOMEM);
     }
 
-    sol_ptr_vector_init(&mdata->substrings);
+    sol_buffer_init(&mdata->string);
 
     return 0;
 }
@@ -299,8 +312,11 @@ string_split_open(struct sol_flow_node *node, void *data, const struct sol_flow_
 static void
 clear_substrings(struct string_split_data *mdata)
 {
-    free(mdata->dupstring);
-    sol_ptr_vector_clear(&mdata->substrings);
+    if (mdata->tokens) {
+        sol_blob_unref(mdata->tokens);
+        mdata->tokens = NULL;
+    }
+    mdata->len = 0;
 }
 
 static void
@@ -309,53 +325,77 @@ string_split_close(struct sol_flow_node *node, void *data)
     struct string_split_data *mdata = data;
 
     clear_substrings(mdata);
-    free(mdata->string);
+    sol_buffer_fini(&mdata->string);
     free(mdata->separator);
 }
 
 static int
 calculate_substrings(struct string_split_data *mdata, struct sol_flow_node *node)
 {
-    char *saveptr, *token;
+    char *saveptr, *token, *tokens;
 
-    if (!(mdata->string && mdata->separator))
+    if (!(mdata->string.data && mdata->separator))
         return 0;
 
-    mdata->dupstring = strdup(mdata->string);
-    SOL_NULL_CHECK(mdata->dupstring, -ENOMEM);
+    clear_substrings(mdata);
+
+    /* Previous substrings may still be referenced by packets, so
+     * a new copy is needed, but a single one for all substrings,
+     * allocated together with its blob. */
+    mdata->tokens = malloc(sizeof(struct sol_blob) + mdata->string.used + 1);
+    SOL_NULL_CHECK(mdata->tokens, -ENOMEM);
+
+    tokens = (char *)(mdata->tokens + 1);
+    memcpy(tokens, mdata->string.data, mdata->string.used + 1);
+    sol_blob_setup(mdata->tokens, SOL_BLOB_TYPE_NOFREE, tokens,
+        mdata->string.used + 1);
+    mdata->tokens->parent = NULL;
 
-    token = strtok_r(mdata->string, mdata->separator, &saveptr);
+    token = strtok_r(tokens, mdata->separator, &saveptr);
     while (token) {
-        sol_ptr_vector_append(&mdata->substrings, token);
+        mdata->len++;
         token = strtok_r(NULL, mdata->separator, &saveptr);
     }
 
     return sol_flow_send_irange_value_packet(node,
-        SOL_FLOW_NODE_TYPE_STRING_SPLIT__OUT__LENGTH,
-        sol_ptr_vector_get_len(&mdata->substrings));
+        SOL_FLOW_NODE_TYPE_STRING_SPLIT__OUT__LENGTH, mdata->len);
+}
+
+static struct sol_str_slice
+get_substring(const struct sol_blob *tokens, int index)
+{
+    const char *p = tokens->mem;
+    const char *end = p + tokens->size - 1;
+    size_t len;
+
+    while (true) {
+        while (p < end && *p == '\0')
+            p++;
+        len = strlen(p);
+        if (!index--)
+            return SOL_STR_SLICE_STR(p, len);
+        p += len;
+    }
 }
 
 static int
 send_substring(struct string_split_data *mdata, struct sol_flow_node *node)
 {
-    int len;
-
-    if (!(mdata->string && mdata->separator))
+    if (!(mdata->string.data && mdata->separator))
         return 0;
 
-    len = sol_ptr_vector_get_len(&mdata->substrings);
-    if (!len)
+    if (!mdata->len)
         return 0;
 
-    if (mdata->index >= len) {
+    if (mdata->index >= mdata->len) {
         SOL_WRN("Index (%" PRId32 ") greater than substrings "
-            "length (%" PRId32 ").", mdata->index, len);
+            "length (%" PRId32 ").", mdata->index, mdata->len);
         return -EINVAL;
     }
 
-    return sol_flow_send_string_packet(node,
-        SOL_FLOW_NODE_TYPE_STRING_SPLIT__OUT__OUT,
-        sol_ptr_vector_get(&mdata->substrings, mdata->index));
+    return sol_flow_send_string_slice_packet(node,
+        SOL_FLOW_NODE_TYPE_STRING_SPLIT__OUT__OUT, mdata->tokens,
+        get_substring(mdata->tokens, mdata->index));
 }
 
 static int
@@ -378,34 +418,23 @@ set_string_index(struct sol_flow_node *node, void *data, uint16_t port, uint16_t
 }
 
 static int
-split_get_string(const struct sol_flow_packet *packet, char **string)
+set_string_separator(struct sol_flow_node *node, void *data, uint16_t port, uint16_t conn_id, const struct sol_flow_packet *packet)
 {
+    struct string_split_data *mdata = data;
     const char *in_value;
     int r;
 
     r = sol_flow_packet_get_string(packet, &in_value);
     SOL_INT_CHECK(r, < 0, r);
 
-    free(*string);
+    free(mdata->separator);
     if (!in_value)
-        *string = NULL;
+        mdata->separator = NULL;
     else {
-        *string = strdup(in_value);
-        SOL_NULL_CHECK(*string, -ENOMEM);
+        mdata->separator = strdup(in_value);
+        SOL_NULL_CHECK(mdata->separator, -ENOMEM);
     }
 
-    return 0;
-}
-
-static int
-set_string_separator(struct sol_flow_node *node, void *data, uint16_t port, uint16_t conn_id, const struct sol_flow_packet *packet)
-{
-    struct string_split_data *mdata = data;
-    int r;
-
-    r = split_get_string(packet, &mdata->separator);
-    SOL_INT_CHECK(r, < 0, r);
-
     r = calculate_substrings(mdata, node);
     SOL_INT_CHECK(r, < 0, r);
 
@@ -416,9 +445,19 @@ static int
 string_split(struct sol_flow_node *node, void *data, uint16_t port, uint16_t conn_id, const struct sol_flow_packet *packet)
 {
     struct string_split_data *mdata = data;
+    struct sol_str_slice in_value;
     int r;
 
-    r = split_get_string(packet, &mdata->string);
+    r = sol_flow_packet_get_string_slice(packet, &in_value, NULL);
+    SOL_INT_CHECK(r, < 0, r);
+
+    if (!in_value.data) {
+        clear_substrings(mdata);
+        sol_buffer_fini(&mdata->string);
+        return 0;
+    }
+
+    r = sol_buffer_set_slice(&mdata->string, in_value);
     SOL_INT_CHECK(r, < 0, r);
 
     r = calculate_substrings(mdata, node);
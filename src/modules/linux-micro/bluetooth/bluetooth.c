@@ -180,12 +180,15 @@ bluetooth_start(const struct sol_platform_linux_micro_module *mod,
 
     name = service;
 
-    if (fork_run)
+    if (fork_run) {
+        sol_platform_linux_micro_inform_service_state
+            (service, SOL_PLATFORM_SERVICE_STATE_ACTIVE);
         return 0;
+    }
 
     ret = sol_platform_add_service_monitor
             (on_dbus_service_state_changed, DBUS, mod);
-    if (ret >= 0)
+    if (ret < 0)
         goto err;
 
     ret = sol_platform_start_service(DBUS);
@@ -225,8 +228,12 @@ bluetooth_init(const struct sol_platform_linux_micro_module *module,
     return 0;
 }
 
+/* bluetoothd talks to the system bus */
+static const char *const bluetooth_requires[] = { "dbus", NULL };
+
 SOL_PLATFORM_LINUX_MICRO_MODULE(BLUETOOTH,
     .name = "bluetooth",
+    .requires = bluetooth_requires,
     .init = bluetooth_init,
     .start = bluetooth_start,
     .stop = bluetooth_stop,
@@ -504,8 +504,12 @@ console_init(const struct sol_platform_linux_micro_module *module, const char *s
  *
  */
 
+/* the login prompt shows the host name */
+static const char *const console_after[] = { "hostname", "locale", NULL };
+
 SOL_PLATFORM_LINUX_MICRO_MODULE(CONSOLE,
     .name = "console",
+    .after = console_after,
     .init = console_init,
     .start = console_start,
     .restart = console_restart,
@@ -136,8 +136,12 @@ on_timeout(void *data)
 static int
 dbus_start(const struct sol_platform_linux_micro_module *mod, const char *service)
 {
-    if (fork_run)
+    if (fork_run) {
+        /* still starting, on_timeout() informs it */
+        if (!check_timeout)
+            sol_platform_linux_micro_inform_service_state(service, SOL_PLATFORM_SERVICE_STATE_ACTIVE);
         return 0;
+    }
 
     name = service;
     fork_run = sol_platform_linux_fork_run(on_fork, on_fork_exit, NULL);
@@ -151,6 +155,10 @@ dbus_start(const struct sol_platform_linux_micro_module *mod, const char *servic
 
     /* TODO: change to use inotify */
     check_timeout = sol_timeout_add(200, on_timeout, NULL);
+    if (!check_timeout) {
+        SOL_WRN("could not watch dbus-daemon socket, assuming it's ready");
+        sol_platform_linux_micro_inform_service_state(service, SOL_PLATFORM_SERVICE_STATE_ACTIVE);
+    }
 
     return 0;
 }
@@ -206,8 +214,11 @@ dbus_init(const struct sol_platform_linux_micro_module *module, const char *serv
     return 0;
 }
 
+static const char *const dbus_after[] = { "fstab", NULL };
+
 SOL_PLATFORM_LINUX_MICRO_MODULE(DBUS,
     .name = "dbus",
+    .after = dbus_after,
     .init = dbus_init,
     .start = dbus_start,
     .stop = dbus_stop,
@@ -151,10 +151,13 @@ fstab_start(const struct sol_platform_linux_micro_module *mod, const char *servi
     if (!fstab) {
         if (errno == ENOENT) {
             SOL_INF("No /etc/fstab");
+            sol_platform_linux_micro_inform_service_state(service, SOL_PLATFORM_SERVICE_STATE_ACTIVE);
             return 0;
         } else {
-            SOL_WRN("Unable to open /etc/fstab file: %s", sol_util_strerrora(-errno));
-            return -errno;
+            err = -errno;
+            SOL_WRN("Unable to open /etc/fstab file: %s", sol_util_strerrora(-err));
+            sol_platform_linux_micro_inform_service_state(service, SOL_PLATFORM_SERVICE_STATE_FAILED);
+            return err;
         }
     }
 
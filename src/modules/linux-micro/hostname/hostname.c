@@ -52,8 +52,10 @@ hostname_start(const struct sol_platform_linux_micro_module *mod, const char *se
 
     reader = sol_file_reader_open("/etc/hostname");
     if (!reader) {
+        err = -errno;
         SOL_WRN("could not read /etc/hostname");
-        return -errno;
+        sol_platform_linux_micro_inform_service_state(service, SOL_PLATFORM_SERVICE_STATE_FAILED);
+        return err;
     }
 
     str = sol_file_reader_get_all(reader);
@@ -95,8 +97,11 @@ hostname_init(const struct sol_platform_linux_micro_module *module, const char *
     return 0;
 }
 
+static const char *const hostname_after[] = { "fstab", NULL };
+
 SOL_PLATFORM_LINUX_MICRO_MODULE(HOSTNAME,
     .name = "hostname",
+    .after = hostname_after,
     .init = hostname_init,
     .start = hostname_start,
     );
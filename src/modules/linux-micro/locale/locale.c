@@ -220,8 +220,11 @@ locale_init(const struct sol_platform_linux_micro_module *module, const char *se
     return 0;
 }
 
+static const char *const locale_after[] = { "fstab", NULL };
+
 SOL_PLATFORM_LINUX_MICRO_MODULE(LOCALE,
     .name = "locale",
+    .after = locale_after,
     .init = locale_init,
     .start = locale_start,
     );
@@ -68,6 +68,7 @@ network_up_start(const struct sol_platform_linux_micro_module *mod, const char *
         sol_network_link_up(itr->index);
     }
 
+    sol_platform_linux_micro_inform_service_state(service, SOL_PLATFORM_SERVICE_STATE_ACTIVE);
     return 0;
 }
 
@@ -92,8 +93,12 @@ network_up_shutdown(const struct sol_platform_linux_micro_module *module, const
     sol_network_shutdown();
 }
 
+/* interfaces may be tuned by sysctl settings */
+static const char *const network_up_after[] = { "sysctl", NULL };
+
 SOL_PLATFORM_LINUX_MICRO_MODULE(NETWORK_UP,
     .name = "network-up",
+    .after = network_up_after,
     .init = network_up_init,
     .shutdown = network_up_shutdown,
     .start = network_up_start,
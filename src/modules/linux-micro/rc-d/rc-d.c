@@ -34,6 +34,7 @@
 #include <inttypes.h>
 #include <limits.h>
 #include <signal.h>
+#include <spawn.h>
 #include <stdio.h>
 #include <sys/wait.h>
 #include <unistd.h>
@@ -62,8 +63,8 @@ static struct sol_ptr_vector monitors = SOL_PTR_VECTOR_INIT;
 static struct sol_timeout *monitor_timer;
 static struct sol_vector pendings = SOL_VECTOR_INIT(struct pending);
 
-static void
-find_exec(const char *service, const char *arg)
+static int
+find_exec(const char *service, char path[PATH_MAX])
 {
     const char **itr, *dirs[] = {
         "/etc/init.d",
@@ -71,26 +72,15 @@ find_exec(const char *service, const char *arg)
     };
 
     for (itr = dirs; itr < dirs + ARRAY_SIZE(dirs); itr++) {
-        char path[PATH_MAX];
         int r;
 
-        r = snprintf(path, sizeof(path), "%s/%s", *itr, service);
-        if (r > 0 && r < (int)sizeof(path) && access(path, R_OK | X_OK) == 0) {
-            SOL_DBG("exec %s %s", path, arg);
-            execl(path, path, path, arg, NULL);
-        }
+        r = snprintf(path, PATH_MAX, "%s/%s", *itr, service);
+        if (r > 0 && r < PATH_MAX && access(path, R_OK | X_OK) == 0)
+            return 0;
     }
 
     SOL_WRN("service not found: %s", service);
-    exit(EXIT_FAILURE);
-}
-
-static void
-on_fork_run(void *data)
-{
-    struct pending *p = data;
-
-    find_exec(p->service, p->arg);
+    return -ENOENT;
 }
 
 static void
@@ -116,16 +106,22 @@ on_fork_run_exit(void *data, uint64_t pid, int status)
 static int
 rc_d_run(const char *service, const char *arg, void (*cb)(void *data, const char *service, const char *arg, int status), const void *data)
 {
+    char path[PATH_MAX];
+    const char *argv[] = { path, arg, NULL };
     struct pending *p;
     int err;
 
+    err = find_exec(service, path);
+    SOL_INT_CHECK(err, < 0, err);
+    SOL_DBG("exec %s %s", path, arg);
+
     p = sol_vector_append(&pendings);
     SOL_NULL_CHECK(p, -errno);
     p->service = service;
     p->arg = arg;
     p->cb = cb;
     p->data = data;
-    p->fork_run = sol_platform_linux_fork_run(on_fork_run, on_fork_run_exit, p);
+    p->fork_run = sol_platform_linux_spawn(argv, NULL, on_fork_run_exit, p);
     SOL_NULL_CHECK_GOTO(p->fork_run, error_fork_run);
     SOL_DBG("run '%s %s' as pid=%" PRIu64,
         service, arg,
@@ -152,7 +148,13 @@ on_start(void *data, const char *service, const char *arg, int status)
 static int
 rc_d_start(const struct sol_platform_linux_micro_module *mod, const char *service)
 {
-    return rc_d_run(service, "start", on_start, NULL);
+    int err;
+
+    /* on_start() informs the state once the script exits */
+    err = rc_d_run(service, "start", on_start, NULL);
+    if (err < 0)
+        sol_platform_linux_micro_inform_service_state(service, SOL_PLATFORM_SERVICE_STATE_FAILED);
+    return err;
 }
 
 static void
@@ -171,22 +173,29 @@ rc_d_stop(const struct sol_platform_linux_micro_module *mod, const char *service
     if (!force_immediate)
         return rc_d_run(service, "stop", on_stop, NULL);
     else {
-        pid_t pid = fork();
-        if (pid == 0) {
-            sigset_t emptyset;
-            sigemptyset(&emptyset);
-            sigprocmask(SIG_SETMASK, &emptyset, NULL);
-            find_exec(service, "stop");
-            return -errno;
-        } else if (pid < 0)
+        char path[PATH_MAX];
+        char *const argv[] = { path, (char *)"stop", NULL };
+        posix_spawnattr_t attr;
+        sigset_t emptyset;
+        int r, status = 0;
+        pid_t pid;
+
+        r = find_exec(service, path);
+        SOL_INT_CHECK(r, < 0, r);
+
+        r = posix_spawnattr_init(&attr);
+        SOL_INT_CHECK(r, != 0, -r);
+        sigemptyset(&emptyset);
+        posix_spawnattr_setsigmask(&attr, &emptyset);
+        posix_spawnattr_setflags(&attr, POSIX_SPAWN_SETSIGMASK);
+        r = posix_spawn(&pid, path, NULL, &attr, argv, environ);
+        posix_spawnattr_destroy(&attr);
+        SOL_INT_CHECK(r, != 0, -r);
+
+        if (waitpid(pid, &status, 0) < 0)
             return -errno;
-        else {
-            int status = 0;
-            if (waitpid(pid, &status, 0) < 0)
-                return -errno;
-            on_stop(NULL, service, "stop", status);
-            return 0;
-        }
+        on_stop(NULL, service, "stop", status);
+        return 0;
     }
 }
 
@@ -300,8 +309,12 @@ rc_d_shutdown(const struct sol_platform_linux_micro_module *module, const char *
     rc_d_stop_monitor(module, service);
 }
 
+/* init scripts expect the basic system to be set up */
+static const char *const rc_d_after[] = { "fstab", "sysctl", "hostname", "network-up", NULL };
+
 SOL_PLATFORM_LINUX_MICRO_MODULE(RC_D,
     .name = "rc-d",
+    .after = rc_d_after,
     .init = rc_d_init,
     .shutdown = rc_d_shutdown,
     .start = rc_d_start,
@@ -215,8 +215,10 @@ sysctl_start(const struct sol_platform_linux_micro_module *mod, const char *serv
 
     psfd = open("/proc/sys/", O_RDONLY | O_CLOEXEC | O_DIRECTORY);
     if (psfd < 0) {
+        err = -errno;
         SOL_WRN("/proc/sys not mounted or not a directory");
-        return -errno;
+        sol_platform_linux_micro_inform_service_state(service, SOL_PLATFORM_SERVICE_STATE_FAILED);
+        return err;
     }
 
     ret = sysctl_apply_filename(psfd, -1, "/etc/sysctl.conf");
@@ -255,6 +257,9 @@ next_dir:
     }
 
     close(psfd);
+
+    sol_platform_linux_micro_inform_service_state(service,
+        err < 0 ? SOL_PLATFORM_SERVICE_STATE_FAILED : SOL_PLATFORM_SERVICE_STATE_ACTIVE);
     return err;
 }
 
@@ -265,8 +270,11 @@ sysctl_init(const struct sol_platform_linux_micro_module *module, const char *se
     return 0;
 }
 
+static const char *const sysctl_after[] = { "fstab", NULL };
+
 SOL_PLATFORM_LINUX_MICRO_MODULE(SYSCTL,
     .name = "sysctl",
+    .after = sysctl_after,
     .init = sysctl_init,
     .start = sysctl_start,
     );
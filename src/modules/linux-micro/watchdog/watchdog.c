@@ -142,8 +142,10 @@ watchdog_start(const struct sol_platform_linux_micro_module *mod, const char *se
     int timeout = 60;
     unsigned int timeout_ms;
 
-    if (watchdog_fd >= 0)
+    if (watchdog_fd >= 0) {
+        sol_platform_linux_micro_inform_service_state(service, SOL_PLATFORM_SERVICE_STATE_ACTIVE);
         return 0;
+    }
 
     service_name = service;
 
@@ -86,7 +86,9 @@ found_resource(struct sol_oic_client *cli, struct sol_oic_resource *res, void *d
 int
 main(int argc, char *argv[])
 {
-    struct sol_oic_client client;
+    struct sol_oic_client client = {
+        .api_version = SOL_OIC_CLIENT_API_VERSION
+    };
     struct sol_network_link_addr cliaddr = { .family = AF_INET, .port = 5683 };
     const char *resource_type;
 
@@ -111,5 +113,7 @@ main(int argc, char *argv[])
 
     sol_run();
 
+    sol_coap_server_unref(client.server);
+
     return 0;
 }
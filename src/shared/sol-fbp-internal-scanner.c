@@ -32,6 +32,9 @@
 
 #include <assert.h>
 #include <ctype.h>
+#include <errno.h>
+#include <stdlib.h>
+#include <string.h>
 
 #include "sol-fbp-internal-log.h"
 #include "sol-fbp-internal-scanner.h"
@@ -56,6 +59,82 @@ sol_fbp_scanner_init(struct sol_fbp_scanner *s, struct sol_str_slice input)
 
     s->cur.line = s->cur.col = 1;
     s->start = s->cur;
+
+    s->read = NULL;
+    s->read_data = NULL;
+    s->buf = NULL;
+    s->buf_size = 0;
+    s->read_error = 0;
+}
+
+#define STREAM_WINDOW_SIZE 4096
+
+void
+sol_fbp_scanner_init_stream(struct sol_fbp_scanner *s,
+    ssize_t (*read)(void *data, char *buf, size_t len), void *data)
+{
+    sol_fbp_scanner_init(s, (struct sol_str_slice)SOL_STR_SLICE_EMPTY);
+    s->read = read;
+    s->read_data = data;
+}
+
+void
+sol_fbp_scanner_fini(struct sol_fbp_scanner *s)
+{
+    free(s->buf);
+    s->buf = NULL;
+    s->buf_size = 0;
+    s->read = NULL;
+}
+
+/* Called when the scanner reached the end of the window. Moves the
+ * token being scanned to the beginning of the window, growing it
+ * only when that token alone fills it, and reads more input after
+ * it. Returns false at the end of the input. */
+static bool
+refill(struct sol_fbp_scanner *s)
+{
+    size_t keep;
+    ssize_t r;
+
+    if (!s->read)
+        return false;
+
+    keep = s->input_end - s->token.start;
+    if (keep == s->buf_size) {
+        size_t size = s->buf_size ? s->buf_size * 2 : STREAM_WINDOW_SIZE;
+        char *buf = malloc(size);
+
+        if (!buf) {
+            s->read_error = -ENOMEM;
+            s->read = NULL;
+            return false;
+        }
+        if (keep)
+            memcpy(buf, s->token.start, keep);
+        free(s->buf);
+        s->buf = buf;
+        s->buf_size = size;
+    } else if (keep && s->token.start != s->buf) {
+        memmove(s->buf, s->token.start, keep);
+    }
+
+    do {
+        r = s->read(s->read_data, s->buf + keep, s->buf_size - keep);
+    } while (r == -EINTR);
+
+    s->token.start = s->buf;
+    s->token.end = s->input_end = s->buf + keep;
+
+    if (r <= 0) {
+        if (r < 0)
+            s->read_error = r;
+        s->read = NULL;
+        return false;
+    }
+
+    s->input_end += r;
+    return true;
 }
 
 static inline char
@@ -63,7 +142,7 @@ next(struct sol_fbp_scanner *s)
 {
     char c;
 
-    if (s->token.end == s->input_end)
+    if (s->token.end == s->input_end && !refill(s))
         return 0;
     c = *s->token.end;
     s->token.end++;
@@ -87,7 +166,7 @@ set_token(struct sol_fbp_scanner *s, enum sol_fbp_token_type type)
 static inline char
 peek(struct sol_fbp_scanner *s)
 {
-    if (s->token.end == s->input_end)
+    if (s->token.end == s->input_end && !refill(s))
         return 0;
     return *s->token.end;
 }
@@ -126,8 +205,11 @@ comment_state(struct sol_fbp_scanner *s)
 {
     char c;
 
-    for (c = peek(s); c != '\n' && c != 0; c = peek(s))
+    /* Comments are not part of any token, don't keep them around. */
+    for (c = peek(s); c != '\n' && c != 0; c = peek(s)) {
         next(s);
+        ignore(s);
+    }
     return default_state;
 }
 
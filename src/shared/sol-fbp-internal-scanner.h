@@ -32,6 +32,8 @@
 
 #pragma once
 
+#include <sys/types.h>
+
 #include "sol-str-slice.h"
 
 /* Given an input string written using the "FBP file format" described
@@ -85,7 +87,25 @@ struct sol_fbp_scanner {
         unsigned int line;
         unsigned int col;
     } start, cur;
+
+    /* Only used when scanning a stream: the window holds the token
+     * being scanned plus whatever was read after it, previous input
+     * is dropped on refill. */
+    ssize_t (*read)(void *data, char *buf, size_t len);
+    void *read_data;
+    char *buf;
+    size_t buf_size;
+    int read_error;
 };
 
 void sol_fbp_scanner_init(struct sol_fbp_scanner *s, struct sol_str_slice input);
+
+/* Scan input as it is returned by read(), that works like read(2)
+ * returning the number of bytes copied, 0 at the end of the input or
+ * a negative errno. Tokens are only valid until the next call to
+ * sol_fbp_scan_token(). If reading fails the scanner stops as if
+ * the input ended and read_error is set. */
+void sol_fbp_scanner_init_stream(struct sol_fbp_scanner *s,
+    ssize_t (*read)(void *data, char *buf, size_t len), void *data);
+void sol_fbp_scanner_fini(struct sol_fbp_scanner *s);
 void sol_fbp_scan_token(struct sol_fbp_scanner *s);
@@ -51,6 +51,10 @@ struct sol_fbp_parser {
     struct sol_fbp_position error_pos;
 
     struct sol_fbp_graph *graph;
+
+    /* Streamed input doesn't outlive the token, so the contents of
+     * the tokens the graph may reference are copied to its arena. */
+    bool stream;
 };
 
 static struct sol_fbp_position
@@ -62,6 +66,34 @@ get_token_position(struct sol_fbp_token *t)
     };
 }
 
+static void
+keep_token(struct sol_fbp_parser *p, struct sol_fbp_token *t)
+{
+    struct sol_str_slice slice;
+
+    if (t->type != SOL_FBP_TOKEN_IDENTIFIER
+        && t->type != SOL_FBP_TOKEN_INTEGER
+        && t->type != SOL_FBP_TOKEN_STRING)
+        return;
+
+    slice.data = t->start;
+    slice.len = t->end - t->start;
+    if (slice.len == 0) {
+        t->start = t->end = "";
+        return;
+    }
+
+    if (sol_arena_slice_dup(p->graph->arena, &slice, slice) < 0) {
+        /* Reported as a read error when the parse ends. */
+        p->scanner.read_error = -ENOMEM;
+        t->type = SOL_FBP_TOKEN_ERROR;
+        return;
+    }
+
+    t->start = slice.data;
+    t->end = slice.data + slice.len;
+}
+
 static enum sol_fbp_token_type
 next_token(struct sol_fbp_parser *p)
 {
@@ -76,6 +108,9 @@ next_token(struct sol_fbp_parser *p)
     sol_fbp_scan_token(&p->scanner);
     p->current_token = p->scanner.token;
 
+    if (p->stream)
+        keep_token(p, &p->current_token);
+
     return p->current_token.type;
 }
 
@@ -712,33 +747,70 @@ sol_fbp_error_free(struct sol_fbp_error *e)
     free(e);
 }
 
+static struct sol_fbp_error *
+parse(struct sol_fbp_parser *p)
+{
+    struct sol_fbp_error *e;
+
+    p->current_token.type = SOL_FBP_TOKEN_NONE;
+    p->pending_token = p->current_token;
+    p->error_msg = NULL;
+
+    parse_stmt_list(p);
+
+    if (p->scanner.read_error < 0) {
+        /* Whatever the parser said about the truncated input is
+         * misleading, report the actual failure. */
+        free(p->error_msg);
+        p->error_msg = NULL;
+        p->error_pos.line = p->scanner.cur.line;
+        p->error_pos.column = p->scanner.cur.col;
+        set_parse_error(p, "Couldn't read input: %s",
+            sol_util_strerrora(-p->scanner.read_error));
+    } else if (!p->error_msg && verify_graph(p)) {
+        return NULL;
+    }
+
+    e = calloc(1, sizeof(struct sol_fbp_error));
+    if (!e) {
+        free(p->error_msg);
+        return NULL;
+    }
+
+    e->msg = p->error_msg;
+    e->position = p->error_pos;
+
+    return e;
+}
+
 struct sol_fbp_error *
 sol_fbp_parse(struct sol_str_slice input, struct sol_fbp_graph *g)
 {
     struct sol_fbp_parser p = { };
-    struct sol_fbp_error *e;
 
     sol_fbp_init_log_domain();
 
     sol_fbp_scanner_init(&p.scanner, input);
-    p.current_token.type = SOL_FBP_TOKEN_NONE;
-    p.pending_token = p.current_token;
-    p.error_msg = NULL;
     p.graph = g;
 
-    parse_stmt_list(&p);
+    return parse(&p);
+}
 
-    if (!p.error_msg && verify_graph(&p))
-        return NULL;
+struct sol_fbp_error *
+sol_fbp_parse_stream(ssize_t (*read)(void *data, char *buf, size_t len),
+    void *data, struct sol_fbp_graph *g)
+{
+    struct sol_fbp_parser p = { };
+    struct sol_fbp_error *e;
 
-    e = calloc(1, sizeof(struct sol_fbp_error));
-    if (!e) {
-        free(p.error_msg);
-        return NULL;
-    }
+    sol_fbp_init_log_domain();
+
+    sol_fbp_scanner_init_stream(&p.scanner, read, data);
+    p.graph = g;
+    p.stream = true;
 
-    e->msg = p.error_msg;
-    e->position = p.error_pos;
+    e = parse(&p);
+    sol_fbp_scanner_fini(&p.scanner);
 
     return e;
 }
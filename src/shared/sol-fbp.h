@@ -32,6 +32,8 @@
 
 #pragma once
 
+#include <sys/types.h>
+
 #include "sol-arena.h"
 #include "sol-str-slice.h"
 #include "sol-vector.h"
@@ -162,6 +164,14 @@ int sol_fbp_graph_option(struct sol_fbp_graph *g,
  * graph of it. See also README.fbp. */
 struct sol_fbp_error *sol_fbp_parse(struct sol_str_slice input, struct sol_fbp_graph *g);
 
+/* Like sol_fbp_parse(), but the input is pulled with read(), that
+ * works like read(2) returning a negative errno on failure. Only the
+ * token being scanned is buffered; the strings referenced by the
+ * graph are copied to its arena, so the input doesn't need to be
+ * kept around. */
+struct sol_fbp_error *sol_fbp_parse_stream(ssize_t (*read)(void *data, char *buf, size_t len),
+    void *data, struct sol_fbp_graph *g);
+
 /* Print out a message of a given FBP file. */
 void sol_fbp_log_print(const char *file, unsigned int line, unsigned int column, const char *format, ...);
 void sol_fbp_error_free(struct sol_fbp_error *e);
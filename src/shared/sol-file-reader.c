@@ -33,6 +33,7 @@
 #include <errno.h>
 #include <fcntl.h>
 #include <stdlib.h>
+#include <string.h>
 #include <sys/mman.h>
 #include <sys/stat.h>
 #include <sys/types.h>
@@ -116,3 +117,278 @@ sol_file_reader_get_stat(const struct sol_file_reader *fr)
 {
     return &fr->st;
 }
+
+/* Windows are at least this big, so small chunks don't mean a
+ * mapping or a read() per chunk. */
+#define CHUNK_READER_WINDOW_MIN (1024 * 1024)
+
+struct sol_file_chunk_reader {
+    char *window; /* mapping or read buffer */
+    size_t win_size; /* maximum window length */
+    size_t win_len; /* file bytes in the window */
+    off_t win_off; /* file offset of the window */
+    off_t pos; /* file offset of the next chunk */
+    size_t chunk_size;
+    int fd;
+    int delim;
+    bool mmapped;
+};
+
+struct sol_file_chunk_reader *
+sol_file_chunk_reader_open(const char *filename, size_t chunk_size, int delim)
+{
+    struct sol_file_chunk_reader *cr;
+    size_t page = sysconf(_SC_PAGESIZE);
+    struct stat st;
+    int saved_errno;
+
+    if (!chunk_size) {
+        errno = EINVAL;
+        return NULL;
+    }
+
+    cr = calloc(1, sizeof(*cr));
+    if (!cr)
+        return NULL;
+
+    cr->chunk_size = chunk_size;
+    cr->delim = delim;
+
+    /* a chunk must fit after the page aligned start of a mapping */
+    cr->win_size = ((chunk_size + page - 1) / page + 1) * page;
+    if (cr->win_size < CHUNK_READER_WINDOW_MIN)
+        cr->win_size = CHUNK_READER_WINDOW_MIN;
+
+    /* opening a FIFO doesn't wait for a writer, and reading it
+     * doesn't wait for data */
+    cr->fd = open(filename, O_RDONLY | O_CLOEXEC | O_NONBLOCK);
+    if (cr->fd < 0)
+        goto err;
+
+    if (fstat(cr->fd, &st) < 0)
+        goto err;
+
+    /* Files in /proc and /sys report a zero size and must be read,
+     * as well as pipes and devices. */
+    cr->mmapped = S_ISREG(st.st_mode) && st.st_size > 0;
+    if (!cr->mmapped) {
+        cr->window = malloc(cr->win_size);
+        if (!cr->window)
+            goto err;
+    }
+
+    posix_fadvise(cr->fd, 0, 0, POSIX_FADV_SEQUENTIAL);
+    return cr;
+
+err:
+    saved_errno = errno;
+    if (cr->fd >= 0)
+        close(cr->fd);
+    free(cr);
+    errno = saved_errno;
+    return NULL;
+}
+
+void
+sol_file_chunk_reader_close(struct sol_file_chunk_reader *cr)
+{
+    if (!cr->mmapped)
+        free(cr->window);
+    else if (cr->window)
+        munmap(cr->window, cr->win_len);
+    close(cr->fd);
+    free(cr);
+}
+
+static void
+chunk_reader_reset(struct sol_file_chunk_reader *cr)
+{
+    if (cr->mmapped && cr->window) {
+        munmap(cr->window, cr->win_len);
+        cr->window = NULL;
+    }
+    cr->win_off = 0;
+    cr->win_len = 0;
+    cr->pos = 0;
+}
+
+/* A single read(), pipes and devices may have nothing more yet:
+ * -EAGAIN then. */
+static int
+chunk_reader_read(struct sol_file_chunk_reader *cr)
+{
+    size_t used = cr->pos - cr->win_off;
+    struct stat st;
+    ssize_t r = 0;
+
+    /* keep what wasn't returned yet at the start of the buffer */
+    memmove(cr->window, cr->window + used, cr->win_len - used);
+    cr->win_len -= used;
+    cr->win_off = cr->pos;
+
+    if (cr->win_len < cr->win_size) {
+        do {
+            r = read(cr->fd, cr->window + cr->win_len, cr->win_size - cr->win_len);
+        } while (r < 0 && errno == EINTR);
+        if (r < 0)
+            return -errno;
+        cr->win_len += r;
+    }
+
+    /* truncated file, start over */
+    if (cr->win_len == 0 && fstat(cr->fd, &st) == 0 && S_ISREG(st.st_mode)
+        && st.st_size > 0 && st.st_size < cr->pos) {
+        if (lseek(cr->fd, 0, SEEK_SET) < 0)
+            return -errno;
+        chunk_reader_reset(cr);
+        return chunk_reader_read(cr);
+    }
+
+    return 0;
+}
+
+static int
+chunk_reader_map(struct sol_file_chunk_reader *cr)
+{
+    size_t page = sysconf(_SC_PAGESIZE);
+    struct stat st;
+    size_t len;
+    off_t off;
+    void *p;
+
+    if (fstat(cr->fd, &st) < 0)
+        return -errno;
+
+    /* truncated file, start over */
+    if (st.st_size < cr->pos)
+        chunk_reader_reset(cr);
+
+    off = cr->pos - cr->pos % page;
+    len = st.st_size - off;
+    if (len > cr->win_size)
+        len = cr->win_size;
+    if (cr->window && off == cr->win_off && len == cr->win_len)
+        return 0;
+
+    if (cr->window) {
+        munmap(cr->window, cr->win_len);
+        cr->window = NULL;
+    }
+    cr->win_off = off;
+    cr->win_len = 0;
+    if (!len)
+        return 0;
+
+    p = mmap(NULL, len, PROT_READ, MAP_PRIVATE, cr->fd, off);
+    if (p == MAP_FAILED) {
+        if (errno == ENOMEM)
+            return -errno;
+
+        /* not mappable after all, read it from here on */
+        cr->window = malloc(cr->win_size);
+        if (!cr->window)
+            return -errno;
+        cr->mmapped = false;
+        cr->win_off = cr->pos;
+        if (lseek(cr->fd, cr->pos, SEEK_SET) < 0)
+            return -errno;
+        return chunk_reader_read(cr);
+    }
+
+    madvise(p, len, MADV_SEQUENTIAL);
+    /* have the next window read while this one is used */
+    if (off + (off_t)len < st.st_size)
+        posix_fadvise(cr->fd, off + len, cr->win_size, POSIX_FADV_WILLNEED);
+
+    cr->window = p;
+    cr->win_len = len;
+    return 0;
+}
+
+/* Mapped pages past the end of a file that shrank since they were
+ * mapped raise SIGBUS when touched: shrink the mapping along. */
+static int
+chunk_reader_check_map(struct sol_file_chunk_reader *cr)
+{
+    struct stat st;
+
+    if (!cr->window)
+        return 0;
+    if (fstat(cr->fd, &st) < 0)
+        return -errno;
+    if (st.st_size >= cr->win_off + (off_t)cr->win_len)
+        return 0;
+    return chunk_reader_map(cr);
+}
+
+static size_t
+chunk_reader_find(const struct sol_file_chunk_reader *cr, bool *complete)
+{
+    size_t avail = cr->win_off + cr->win_len - cr->pos;
+    size_t len = avail < cr->chunk_size ? avail : cr->chunk_size;
+    const char *p, *end;
+
+    *complete = len == cr->chunk_size;
+    if (!len || cr->delim < 0)
+        return len;
+
+    p = cr->window + (cr->pos - cr->win_off);
+    end = memchr(p, cr->delim, len);
+    if (!end)
+        return len;
+
+    *complete = true;
+    return end - p + 1;
+}
+
+int
+sol_file_chunk_reader_next(struct sol_file_chunk_reader *cr, bool partial, struct sol_str_slice *chunk)
+{
+    bool complete;
+    size_t len;
+    int r;
+
+    if (cr->mmapped) {
+        r = chunk_reader_check_map(cr);
+        if (r < 0)
+            return r;
+    }
+
+    len = chunk_reader_find(cr, &complete);
+    if (!complete) {
+        if (cr->mmapped)
+            r = chunk_reader_map(cr);
+        else
+            r = chunk_reader_read(cr);
+        if (r < 0 && r != -EAGAIN)
+            return r;
+
+        len = chunk_reader_find(cr, &complete);
+        if (!complete && !partial)
+            len = 0;
+        /* not the end, there's just nothing to return yet */
+        if (!len && r == -EAGAIN)
+            return r;
+    }
+
+    chunk->data = len ? cr->window + (cr->pos - cr->win_off) : "";
+    chunk->len = len;
+    cr->pos += len;
+    return 0;
+}
+
+int
+sol_file_chunk_reader_get_fd(const struct sol_file_chunk_reader *cr)
+{
+    return cr->fd;
+}
+
+int
+sol_file_chunk_reader_rewind(struct sol_file_chunk_reader *cr)
+{
+    if (!cr->mmapped && lseek(cr->fd, 0, SEEK_SET) < 0)
+        return -errno;
+
+    chunk_reader_reset(cr);
+    return 0;
+}
@@ -40,3 +40,29 @@ struct sol_file_reader *sol_file_reader_open(const char *filename);
 void sol_file_reader_close(struct sol_file_reader *fr);
 struct sol_str_slice sol_file_reader_get_all(const struct sol_file_reader *fr);
 const struct stat *sol_file_reader_get_stat(const struct sol_file_reader *fr);
+
+/*
+ * Reads a file in chunks of at most chunk_size bytes through a
+ * sliding mmap window, or a read buffer for files that can't be
+ * mapped, so the memory used doesn't depend on the file size. If
+ * delim is not negative, chunks end right after a delimiter (e.g.
+ * '\n' for lines), unless there's none in chunk_size bytes.
+ */
+struct sol_file_chunk_reader;
+
+struct sol_file_chunk_reader *sol_file_chunk_reader_open(const char *filename, size_t chunk_size, int delim);
+void sol_file_chunk_reader_close(struct sol_file_chunk_reader *cr);
+
+/*
+ * Gets the next chunk, valid until the next call. An empty chunk
+ * means the end of the file was reached, more data is returned if the
+ * file grows later. If partial is false, a last chunk that is neither
+ * full nor delimited is kept until the file grows.
+ *
+ * Pipes, FIFOs and devices are read without blocking: -EAGAIN is
+ * returned when they have nothing to read yet, try again once the
+ * reader's fd is readable.
+ */
+int sol_file_chunk_reader_next(struct sol_file_chunk_reader *cr, bool partial, struct sol_str_slice *chunk);
+int sol_file_chunk_reader_get_fd(const struct sol_file_chunk_reader *cr);
+int sol_file_chunk_reader_rewind(struct sol_file_chunk_reader *cr);
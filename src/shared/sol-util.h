@@ -157,6 +157,24 @@ align_power2(unsigned int u)
  */
 struct sol_vector sol_util_str_split(const struct sol_str_slice slice, const char *delim, size_t maxsplit);
 
+/* FNV-1a over a memory area, chained through 'hash' so several areas
+ * can be folded together. Start with SOL_UTIL_HASH_INIT. Meant for
+ * cache keys, not for anything adversarial. */
+#define SOL_UTIL_HASH_INIT (14695981039346656037ULL)
+
+static inline uint64_t
+sol_util_hash_mem(uint64_t hash, const void *mem, size_t len)
+{
+    const uint8_t *p = mem;
+
+    for (; len > 0; len--, p++) {
+        hash ^= *p;
+        hash *= 1099511628211ULL;
+    }
+
+    return hash;
+}
+
 static inline int
 sol_util_size_mul(size_t elem_size, size_t num_elems, size_t *out)
 {
@@ -0,0 +1,421 @@
+/*
+ * This file is part of the Soletta Project
+ *
+ * Copyright (C) 2015 Intel Corporation. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above copyright
+ *     notice, this list of conditions and the following disclaimer in
+ *     the documentation and/or other materials provided with the
+ *     distribution.
+ *   * Neither the name of Intel Corporation nor the names of its
+ *     contributors may be used to endorse or promote products derived
+ *     from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ * OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+#include <errno.h>
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "sol-log.h"
+#include "sol-util.h"
+#include "sol-window-stats.h"
+
+/* Order statistics treap. Nodes are addressed by index, 0 being the
+ * empty tree, and the node of the sample stored at ring slot 'i' is
+ * nodes[i + 1], so no allocation happens when samples come and go. */
+struct sol_window_stats_node {
+    double value;
+    uint64_t seq;
+    uint32_t child[2];
+    uint32_t size;
+    uint32_t prio;
+};
+
+static inline uint32_t
+slot_of(const struct sol_window_stats *ws, uint64_t seq)
+{
+    return seq % ws->capacity;
+}
+
+static inline double
+value_of(const struct sol_window_stats *ws, uint64_t seq)
+{
+    return ws->values[slot_of(ws, seq)];
+}
+
+static uint32_t
+next_prio(struct sol_window_stats *ws)
+{
+    uint32_t x = ws->prio_state;
+
+    /* xorshift32 */
+    x ^= x << 13;
+    x ^= x >> 17;
+    x ^= x << 5;
+    ws->prio_state = x;
+
+    return x;
+}
+
+/* Total order, NaNs sorting last and equal values by arrival. */
+static bool
+node_less(const struct sol_window_stats_node *a, const struct sol_window_stats_node *b)
+{
+    bool a_nan = isnan(a->value), b_nan = isnan(b->value);
+
+    if (a_nan != b_nan)
+        return b_nan;
+    if (a->value < b->value)
+        return true;
+    if (a->value > b->value)
+        return false;
+    return a->seq < b->seq;
+}
+
+static inline void
+node_update(struct sol_window_stats_node *nodes, uint32_t i)
+{
+    nodes[i].size = 1 + nodes[nodes[i].child[0]].size + nodes[nodes[i].child[1]].size;
+}
+
+static uint32_t
+treap_rotate(struct sol_window_stats_node *nodes, uint32_t root, unsigned int dir)
+{
+    uint32_t c = nodes[root].child[dir];
+
+    nodes[root].child[dir] = nodes[c].child[!dir];
+    nodes[c].child[!dir] = root;
+    node_update(nodes, root);
+    node_update(nodes, c);
+
+    return c;
+}
+
+static uint32_t
+treap_insert(struct sol_window_stats_node *nodes, uint32_t root, uint32_t n)
+{
+    unsigned int dir;
+
+    if (!root)
+        return n;
+
+    dir = !node_less(&nodes[n], &nodes[root]);
+    nodes[root].child[dir] = treap_insert(nodes, nodes[root].child[dir], n);
+    if (nodes[nodes[root].child[dir]].prio > nodes[root].prio)
+        return treap_rotate(nodes, root, dir);
+
+    node_update(nodes, root);
+    return root;
+}
+
+/* Joins two treaps, every node of 'a' being less than those of 'b'. */
+static uint32_t
+treap_merge(struct sol_window_stats_node *nodes, uint32_t a, uint32_t b)
+{
+    if (!a)
+        return b;
+    if (!b)
+        return a;
+
+    if (nodes[a].prio > nodes[b].prio) {
+        nodes[a].child[1] = treap_merge(nodes, nodes[a].child[1], b);
+        node_update(nodes, a);
+        return a;
+    }
+
+    nodes[b].child[0] = treap_merge(nodes, a, nodes[b].child[0]);
+    node_update(nodes, b);
+    return b;
+}
+
+static uint32_t
+treap_remove(struct sol_window_stats_node *nodes, uint32_t root, uint32_t n)
+{
+    unsigned int dir;
+
+    if (!root)
+        return 0;
+    if (root == n)
+        return treap_merge(nodes, nodes[n].child[0], nodes[n].child[1]);
+
+    dir = !node_less(&nodes[n], &nodes[root]);
+    nodes[root].child[dir] = treap_remove(nodes, nodes[root].child[dir], n);
+    node_update(nodes, root);
+
+    return root;
+}
+
+/* Monotonic deques of sequence numbers, stored in rings with room for
+ * a whole window. Front holds the current minimum (or maximum). */
+static inline void
+deque_push_back(struct sol_window_stats *ws, uint64_t *deque, uint32_t head, uint32_t *len,
+    uint64_t seq)
+{
+    deque[(head + *len) % ws->capacity] = seq;
+    (*len)++;
+}
+
+static inline uint64_t
+deque_back(const struct sol_window_stats *ws, const uint64_t *deque, uint32_t head, uint32_t len)
+{
+    return deque[(head + len - 1) % ws->capacity];
+}
+
+static inline void
+deque_pop_front(struct sol_window_stats *ws, uint32_t *head, uint32_t *len)
+{
+    *head = (*head + 1) % ws->capacity;
+    (*len)--;
+}
+
+int
+sol_window_stats_init(struct sol_window_stats *ws, uint32_t capacity, double ewma_alpha)
+{
+    size_t size;
+    int r;
+
+    SOL_NULL_CHECK(ws, -EINVAL);
+    SOL_INT_CHECK(capacity, == 0, -EINVAL);
+
+    /* so the error path only frees what was allocated here */
+    memset(ws, 0, sizeof(*ws));
+    ws->capacity = capacity;
+    ws->ewma_alpha = ewma_alpha;
+    ws->prio_state = 0x9e3779b9;
+
+    r = sol_util_size_mul(capacity, sizeof(*ws->values), &size);
+    SOL_INT_CHECK(r, < 0, r);
+    ws->values = malloc(size);
+    SOL_NULL_CHECK(ws->values, -ENOMEM);
+
+    r = sol_util_size_mul(capacity, sizeof(*ws->min_deque), &size);
+    SOL_INT_CHECK_GOTO(r, < 0, err_deques);
+    ws->min_deque = malloc(size);
+    ws->max_deque = malloc(size);
+    if (!ws->min_deque || !ws->max_deque) {
+        r = -ENOMEM;
+        goto err_deques;
+    }
+
+    r = sol_util_size_mul((size_t)capacity + 1, sizeof(*ws->nodes), &size);
+    SOL_INT_CHECK_GOTO(r, < 0, err_deques);
+    ws->nodes = malloc(size);
+    if (!ws->nodes) {
+        r = -ENOMEM;
+        goto err_deques;
+    }
+
+    /* empty tree sentinel */
+    ws->nodes[0].size = 0;
+
+    sol_window_stats_reset(ws);
+    return 0;
+
+err_deques:
+    free(ws->min_deque);
+    free(ws->max_deque);
+    free(ws->values);
+    memset(ws, 0, sizeof(*ws));
+    return r;
+}
+
+void
+sol_window_stats_fini(struct sol_window_stats *ws)
+{
+    if (!ws)
+        return;
+
+    free(ws->values);
+    free(ws->nodes);
+    free(ws->min_deque);
+    free(ws->max_deque);
+    ws->values = NULL;
+    ws->nodes = NULL;
+    ws->min_deque = NULL;
+    ws->max_deque = NULL;
+}
+
+void
+sol_window_stats_reset(struct sol_window_stats *ws)
+{
+    ws->first_seq = ws->next_seq = 0;
+    ws->root = 0;
+    ws->sum = ws->mean = ws->m2 = 0;
+    ws->ewma = 0;
+    ws->min_head = ws->min_len = 0;
+    ws->max_head = ws->max_len = 0;
+}
+
+static void
+evict_oldest(struct sol_window_stats *ws)
+{
+    uint64_t seq = ws->first_seq++;
+    uint32_t slot = slot_of(ws, seq);
+    double value = ws->values[slot];
+    uint32_t n = sol_window_stats_count(ws);
+    double delta;
+
+    ws->root = treap_remove(ws->nodes, ws->root, slot + 1);
+
+    if (!n) {
+        ws->sum = ws->mean = ws->m2 = 0;
+    } else {
+        ws->sum -= value;
+        delta = value - ws->mean;
+        ws->mean -= delta / n;
+        ws->m2 -= delta * (value - ws->mean);
+        /* rounding errors must not make it negative */
+        if (ws->m2 < 0)
+            ws->m2 = 0;
+    }
+
+    if (ws->min_len && ws->min_deque[ws->min_head] == seq)
+        deque_pop_front(ws, &ws->min_head, &ws->min_len);
+    if (ws->max_len && ws->max_deque[ws->max_head] == seq)
+        deque_pop_front(ws, &ws->max_head, &ws->max_len);
+}
+
+void
+sol_window_stats_add(struct sol_window_stats *ws, double value)
+{
+    struct sol_window_stats_node *node;
+    uint64_t seq;
+    uint32_t slot, n;
+    double delta;
+
+    if (sol_window_stats_is_full(ws))
+        evict_oldest(ws);
+
+    if (ws->next_seq == 0)
+        ws->ewma = value;
+    else
+        ws->ewma += ws->ewma_alpha * (value - ws->ewma);
+
+    seq = ws->next_seq++;
+    slot = slot_of(ws, seq);
+    ws->values[slot] = value;
+
+    node = &ws->nodes[slot + 1];
+    node->value = value;
+    node->seq = seq;
+    node->child[0] = node->child[1] = 0;
+    node->size = 1;
+    node->prio = next_prio(ws);
+    ws->root = treap_insert(ws->nodes, ws->root, slot + 1);
+
+    n = sol_window_stats_count(ws);
+    ws->sum += value;
+    delta = value - ws->mean;
+    ws->mean += delta / n;
+    ws->m2 += delta * (value - ws->mean);
+
+    while (ws->min_len &&
+        value_of(ws, deque_back(ws, ws->min_deque, ws->min_head, ws->min_len)) >= value)
+        ws->min_len--;
+    deque_push_back(ws, ws->min_deque, ws->min_head, &ws->min_len, seq);
+
+    while (ws->max_len &&
+        value_of(ws, deque_back(ws, ws->max_deque, ws->max_head, ws->max_len)) <= value)
+        ws->max_len--;
+    deque_push_back(ws, ws->max_deque, ws->max_head, &ws->max_len, seq);
+}
+
+double
+sol_window_stats_variance(const struct sol_window_stats *ws)
+{
+    uint32_t n = sol_window_stats_count(ws);
+
+    if (!n)
+        return 0;
+    return ws->m2 / n;
+}
+
+double
+sol_window_stats_stddev(const struct sol_window_stats *ws)
+{
+    return sqrt(sol_window_stats_variance(ws));
+}
+
+double
+sol_window_stats_min(const struct sol_window_stats *ws)
+{
+    if (!ws->min_len)
+        return 0;
+    return value_of(ws, ws->min_deque[ws->min_head]);
+}
+
+double
+sol_window_stats_max(const struct sol_window_stats *ws)
+{
+    if (!ws->max_len)
+        return 0;
+    return value_of(ws, ws->max_deque[ws->max_head]);
+}
+
+double
+sol_window_stats_nth(const struct sol_window_stats *ws, uint32_t rank)
+{
+    const struct sol_window_stats_node *nodes = ws->nodes;
+    uint32_t i = ws->root;
+
+    while (i) {
+        uint32_t left_size = nodes[nodes[i].child[0]].size;
+
+        if (rank < left_size) {
+            i = nodes[i].child[0];
+        } else if (rank == left_size) {
+            return nodes[i].value;
+        } else {
+            rank -= left_size + 1;
+            i = nodes[i].child[1];
+        }
+    }
+
+    return 0;
+}
+
+double
+sol_window_stats_percentile(const struct sol_window_stats *ws, double p)
+{
+    uint32_t n = sol_window_stats_count(ws);
+    uint32_t rank;
+    double pos, frac, low, high;
+
+    if (!n)
+        return 0;
+
+    if (p <= 0)
+        p = 0;
+    else if (p >= 100)
+        p = 100;
+
+    pos = p / 100 * (n - 1);
+    rank = pos;
+    frac = pos - rank;
+    low = sol_window_stats_nth(ws, rank);
+    if (frac <= 0 || rank + 1 >= n)
+        return low;
+
+    high = sol_window_stats_nth(ws, rank + 1);
+    return low + (high - low) * frac;
+}
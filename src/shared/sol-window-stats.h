@@ -0,0 +1,131 @@
+/*
+ * This file is part of the Soletta Project
+ *
+ * Copyright (C) 2015 Intel Corporation. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above copyright
+ *     notice, this list of conditions and the following disclaimer in
+ *     the documentation and/or other materials provided with the
+ *     distribution.
+ *   * Neither the name of Intel Corporation nor the names of its
+ *     contributors may be used to endorse or promote products derived
+ *     from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ * OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+#pragma once
+
+#include <stdbool.h>
+#include <stdint.h>
+
+/*
+ * Incremental statistics over a window of the last 'capacity' samples.
+ *
+ * Adding a sample to a full window evicts the oldest one, so it can
+ * be used directly as a sliding window, or as a tumbling one by
+ * calling sol_window_stats_reset() whenever the window is consumed.
+ *
+ * Sum, mean, variance and standard deviation are kept up to date in
+ * O(1) per sample, minimum and maximum with monotonic deques (O(1)
+ * amortized) and order statistics (median, percentiles) with a treap
+ * indexed by rank (O(log n)). No memory is allocated after
+ * sol_window_stats_init().
+ *
+ * An exponentially weighted moving average of all samples added
+ * since the last reset, regardless of the window, is also kept.
+ */
+
+struct sol_window_stats_node;
+
+struct sol_window_stats {
+    double *values;
+    struct sol_window_stats_node *nodes;
+    uint64_t *min_deque;
+    uint64_t *max_deque;
+    uint64_t first_seq;
+    uint64_t next_seq;
+    double sum;
+    double mean;
+    double m2;
+    double ewma;
+    double ewma_alpha;
+    uint32_t capacity;
+    uint32_t root;
+    uint32_t min_head, min_len;
+    uint32_t max_head, max_len;
+    uint32_t prio_state;
+};
+
+int sol_window_stats_init(struct sol_window_stats *ws, uint32_t capacity, double ewma_alpha);
+void sol_window_stats_fini(struct sol_window_stats *ws);
+
+void sol_window_stats_reset(struct sol_window_stats *ws);
+void sol_window_stats_add(struct sol_window_stats *ws, double value);
+
+static inline uint32_t
+sol_window_stats_count(const struct sol_window_stats *ws)
+{
+    return ws->next_seq - ws->first_seq;
+}
+
+static inline bool
+sol_window_stats_is_full(const struct sol_window_stats *ws)
+{
+    return sol_window_stats_count(ws) == ws->capacity;
+}
+
+static inline double
+sol_window_stats_sum(const struct sol_window_stats *ws)
+{
+    return ws->sum;
+}
+
+static inline double
+sol_window_stats_mean(const struct sol_window_stats *ws)
+{
+    return ws->mean;
+}
+
+static inline double
+sol_window_stats_ewma(const struct sol_window_stats *ws)
+{
+    return ws->ewma;
+}
+
+/* Population variance of the samples in the window. */
+double sol_window_stats_variance(const struct sol_window_stats *ws);
+double sol_window_stats_stddev(const struct sol_window_stats *ws);
+
+double sol_window_stats_min(const struct sol_window_stats *ws);
+double sol_window_stats_max(const struct sol_window_stats *ws);
+
+/* Returns the sample with the given rank, 0 being the smallest one. */
+double sol_window_stats_nth(const struct sol_window_stats *ws, uint32_t rank);
+
+/* Percentile 'p' (from 0 to 100) of the samples in the window,
+ * linearly interpolated between the closest ranks. */
+double sol_window_stats_percentile(const struct sol_window_stats *ws, double p);
+
+static inline double
+sol_window_stats_median(const struct sol_window_stats *ws)
+{
+    return sol_window_stats_percentile(ws, 50);
+}
@@ -0,0 +1,215 @@
+/*
+ * This file is part of the Soletta Project
+ *
+ * Copyright (C) 2015 Intel Corporation. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above copyright
+ *     notice, this list of conditions and the following disclaimer in
+ *     the documentation and/or other materials provided with the
+ *     distribution.
+ *   * Neither the name of Intel Corporation nor the names of its
+ *     contributors may be used to endorse or promote products derived
+ *     from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ * OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <errno.h>
+#include <pthread.h>
+
+#include "sol-types.h"
+#include "sol-util.h"
+
+#include "test.h"
+
+#define THREADS 4
+#define ITERATIONS 100000
+
+static unsigned int freed;
+
+static void
+count_free(struct sol_blob *blob)
+{
+    __atomic_add_fetch(&freed, 1, __ATOMIC_RELAXED);
+}
+
+static const struct sol_blob_type counting_type = {
+    .api_version = SOL_BLOB_TYPE_API_VERSION,
+    .free = count_free,
+};
+
+static void *
+ref_unref_thread(void *data)
+{
+    struct sol_blob *blob = data;
+    int i;
+
+    for (i = 0; i < ITERATIONS; i++) {
+        if (!sol_blob_ref(blob))
+            return NULL;
+        sol_blob_unref(blob);
+    }
+
+    sol_blob_unref(blob);
+    return blob;
+}
+
+DEFINE_TEST(ref_unref_from_threads);
+
+static void
+ref_unref_from_threads(void)
+{
+    static char mem[16];
+    struct sol_blob blob;
+    pthread_t threads[THREADS];
+    void *ret;
+    int i;
+
+    freed = 0;
+    ASSERT_INT_EQ(sol_blob_setup(&blob, &counting_type, mem, sizeof(mem)), 0);
+
+    /* each thread owns one reference */
+    for (i = 0; i < THREADS - 1; i++)
+        ASSERT(sol_blob_ref(&blob));
+
+    for (i = 0; i < THREADS; i++)
+        ASSERT_INT_EQ(pthread_create(&threads[i], NULL, ref_unref_thread, &blob), 0);
+
+    for (i = 0; i < THREADS; i++) {
+        ASSERT_INT_EQ(pthread_join(threads[i], &ret), 0);
+        ASSERT(ret == &blob);
+    }
+
+    ASSERT_INT_EQ(freed, 1);
+}
+
+DEFINE_TEST(refcount_saturates_at_16_bits);
+
+static void
+refcount_saturates_at_16_bits(void)
+{
+    static char mem[16];
+    struct sol_blob blob;
+    unsigned int i, count = UINT16_MAX - 1;
+
+    freed = 0;
+    ASSERT_INT_EQ(sol_blob_setup(&blob, &counting_type, mem, sizeof(mem)), 0);
+
+    for (i = 0; i < count; i++)
+        ASSERT(sol_blob_ref(&blob));
+
+    /* The count is kept at 16 bits for ABI compatibility. */
+    ASSERT(!sol_blob_ref(&blob));
+    ASSERT_INT_EQ(errno, ENOMEM);
+
+    for (i = 0; i < count; i++)
+        sol_blob_unref(&blob);
+    ASSERT_INT_EQ(freed, 0);
+
+    sol_blob_unref(&blob);
+    ASSERT_INT_EQ(freed, 1);
+}
+
+DEFINE_TEST(pool_reuses_blobs);
+
+static void
+pool_reuses_blobs(void)
+{
+    struct sol_blob_pool *pool;
+    struct sol_blob *a, *b, *c;
+
+    pool = sol_blob_pool_new(64, 1);
+    ASSERT(pool);
+
+    a = sol_blob_pool_get(pool);
+    ASSERT(a);
+    ASSERT_INT_EQ(a->size, 64);
+    memset(a->mem, 0xaa, a->size);
+
+    b = sol_blob_pool_get(pool);
+    ASSERT(b);
+    ASSERT(a != b);
+
+    sol_blob_unref(a);
+    /* only one free blob is kept */
+    sol_blob_unref(b);
+
+    c = sol_blob_pool_get(pool);
+    ASSERT(c == a);
+    ASSERT(!c->parent);
+    ASSERT_INT_EQ(c->refcnt, 1);
+
+    sol_blob_unref(c);
+    sol_blob_pool_del(pool);
+}
+
+static void *
+pool_thread(void *data)
+{
+    struct sol_blob_pool *pool = data;
+    struct sol_blob *blobs[8];
+    int i, j;
+
+    for (i = 0; i < ITERATIONS / 100; i++) {
+        for (j = 0; j < (int)ARRAY_SIZE(blobs); j++) {
+            blobs[j] = sol_blob_pool_get(pool);
+            if (!blobs[j])
+                return NULL;
+            memset(blobs[j]->mem, j, blobs[j]->size);
+        }
+        for (j = 0; j < (int)ARRAY_SIZE(blobs); j++)
+            sol_blob_unref(blobs[j]);
+    }
+
+    /* keep one, released after the pool is deleted */
+    return sol_blob_pool_get(pool);
+}
+
+DEFINE_TEST(pool_from_threads);
+
+static void
+pool_from_threads(void)
+{
+    struct sol_blob_pool *pool;
+    struct sol_blob *kept[THREADS];
+    pthread_t threads[THREADS];
+    void *ret;
+    int i;
+
+    pool = sol_blob_pool_new(128, 8);
+    ASSERT(pool);
+
+    for (i = 0; i < THREADS; i++)
+        ASSERT_INT_EQ(pthread_create(&threads[i], NULL, pool_thread, pool), 0);
+
+    for (i = 0; i < THREADS; i++) {
+        ASSERT_INT_EQ(pthread_join(threads[i], &ret), 0);
+        ASSERT(ret);
+        kept[i] = ret;
+    }
+
+    sol_blob_pool_del(pool);
+
+    for (i = 0; i < THREADS; i++) {
+        ASSERT_INT_EQ(kept[i]->size, 128);
+        sol_blob_unref(kept[i]);
+    }
+}
+
+TEST_MAIN();
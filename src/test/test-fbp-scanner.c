@@ -31,6 +31,7 @@
  */
 
 #include <stdbool.h>
+#include <string.h>
 
 #include "sol-log.h"
 #include "sol-mainloop.h"
@@ -503,6 +504,55 @@ run_table_tests(void)
 }
 
 
+static ssize_t
+read_one_byte(void *data, char *buf, size_t len)
+{
+    const char **input = data;
+
+    if (!**input)
+        return 0;
+
+    *buf = **input;
+    (*input)++;
+    return 1;
+}
+
+DEFINE_TEST(scan_stream);
+
+static void
+scan_stream(void)
+{
+    unsigned int i;
+
+    /* Feeding one byte at a time every token crosses a refill, the
+     * results must match scanning the whole input. */
+    for (i = 0; i < ARRAY_SIZE(scan_tests); i++) {
+        struct sol_fbp_scanner whole, stream;
+        const char *input = scan_tests[i].input;
+
+        sol_fbp_scanner_init(&whole, sol_str_slice_from_str(input));
+        sol_fbp_scanner_init_stream(&stream, read_one_byte, &input);
+
+        do {
+            sol_fbp_scan_token(&whole);
+            sol_fbp_scan_token(&stream);
+
+            ASSERT_INT_EQ(stream.token.type, whole.token.type);
+            ASSERT_INT_EQ(stream.token.line, whole.token.line);
+            ASSERT_INT_EQ(stream.token.column, whole.token.column);
+            ASSERT_INT_EQ(stream.token.end - stream.token.start,
+                whole.token.end - whole.token.start);
+            ASSERT(memcmp(stream.token.start, whole.token.start,
+                whole.token.end - whole.token.start) == 0);
+        } while (whole.token.type != SOL_FBP_TOKEN_EOF
+            && whole.token.type != SOL_FBP_TOKEN_ERROR);
+
+        ASSERT_INT_EQ(stream.read_error, 0);
+        sol_fbp_scanner_fini(&stream);
+    }
+}
+
+
 DEFINE_TEST(scan_errors);
 
 static void
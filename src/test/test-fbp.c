@@ -30,6 +30,8 @@
  * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
  */
 
+#include <errno.h>
+
 #include "sol-fbp.h"
 #include "sol-log.h"
 #include "sol-mainloop.h"
@@ -756,4 +758,119 @@ run_parse_tests(void)
 }
 
 
+struct chunked_input {
+    struct sol_str_slice input;
+    size_t pos;
+    size_t chunk;
+    int fail_at;
+};
+
+static ssize_t
+read_chunk(void *data, char *buf, size_t len)
+{
+    struct chunked_input *in = data;
+
+    if (in->fail_at >= 0 && in->pos >= (size_t)in->fail_at)
+        return -EIO;
+
+    if (len > in->chunk)
+        len = in->chunk;
+    if (len > in->input.len - in->pos)
+        len = in->input.len - in->pos;
+    memcpy(buf, in->input.data + in->pos, len);
+    in->pos += len;
+
+    return len;
+}
+
+DEFINE_TEST(run_parse_stream_tests);
+
+static void
+run_parse_stream_tests(void)
+{
+    static const size_t chunks[] = { 1, 3, 4096 };
+    struct sol_fbp_error *fbp_error;
+    unsigned int i, j;
+
+    for (i = 0; i < ARRAY_SIZE(parse_tests); i++) {
+        for (j = 0; j < ARRAY_SIZE(chunks); j++) {
+            struct chunked_input in = {
+                .input = *parse_tests[i].input,
+                .chunk = chunks[j],
+                .fail_at = -1,
+            };
+            struct sol_fbp_graph g;
+            int r;
+
+            r = sol_fbp_graph_init(&g);
+            ASSERT_INT_EQ(r, 0);
+
+            fbp_error = sol_fbp_parse_stream(read_chunk, &in, &g);
+            if (fbp_error) {
+                sol_fbp_log_print(NULL, fbp_error->position.line, fbp_error->position.column, fbp_error->msg);
+                sol_fbp_error_free(fbp_error);
+                SOL_ERR("Failed to parse string '%.*s' in chunks of %zu.",
+                    SOL_STR_SLICE_PRINT(*parse_tests[i].input), chunks[j]);
+                ASSERT(false);
+            }
+
+            parse_tests[i].func(&g);
+
+            r = sol_fbp_graph_fini(&g);
+            ASSERT_INT_EQ(r, 0);
+        }
+    }
+}
+
+DEFINE_TEST(parse_stream_errors);
+
+static void
+parse_stream_errors(void)
+{
+    static const struct sol_str_slice input = SOL_STR_SLICE_LITERAL(
+        "a(console) OUT -> IN b(console)\n"
+        "# a comment\n"
+        "c(console) OUT -> -> IN d(console)\n");
+    struct sol_fbp_error *expected, *e;
+    struct sol_fbp_graph g;
+    struct chunked_input in = {
+        .input = input,
+        .chunk = 1,
+        .fail_at = -1,
+    };
+    int r;
+
+    /* Syntax errors are reported at the same position. */
+    r = sol_fbp_graph_init(&g);
+    ASSERT_INT_EQ(r, 0);
+    expected = sol_fbp_parse(input, &g);
+    ASSERT(expected);
+    sol_fbp_graph_fini(&g);
+
+    r = sol_fbp_graph_init(&g);
+    ASSERT_INT_EQ(r, 0);
+    e = sol_fbp_parse_stream(read_chunk, &in, &g);
+    ASSERT(e);
+    ASSERT_INT_EQ(e->position.line, expected->position.line);
+    ASSERT_INT_EQ(e->position.column, expected->position.column);
+    ASSERT(streq(e->msg, expected->msg));
+    sol_fbp_error_free(e);
+    sol_fbp_error_free(expected);
+    sol_fbp_graph_fini(&g);
+
+    /* Read failures are reported where the input stopped. */
+    in.pos = 0;
+    in.fail_at = 35;
+    r = sol_fbp_graph_init(&g);
+    ASSERT_INT_EQ(r, 0);
+    e = sol_fbp_parse_stream(read_chunk, &in, &g);
+    ASSERT(e);
+    ASSERT_INT_EQ(e->position.line, 2);
+    ASSERT_INT_EQ(e->position.column, 4);
+    ASSERT(strstr(e->msg, "Couldn't read input"));
+    sol_fbp_error_free(e);
+    sol_fbp_graph_fini(&g);
+}
+
+
 TEST_MAIN();
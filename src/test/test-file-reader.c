@@ -0,0 +1,334 @@
+/*
+ * This file is part of the Soletta Project
+ *
+ * Copyright (C) 2015 Intel Corporation. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above copyright
+ *     notice, this list of conditions and the following disclaimer in
+ *     the documentation and/or other materials provided with the
+ *     distribution.
+ *   * Neither the name of Intel Corporation nor the names of its
+ *     contributors may be used to endorse or promote products derived
+ *     from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ * OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+#include <errno.h>
+#include <fcntl.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/stat.h>
+
+#include "sol-file-reader.h"
+#include "sol-util.h"
+
+#include "test.h"
+
+/* bigger than a window, so chunks cross windows */
+#define CONTENT_SIZE (3 * 1024 * 1024 + 123)
+
+static char filename[] = "/tmp/test-file-reader-XXXXXX";
+
+static int
+create_file(const char *content, size_t len)
+{
+    int fd;
+
+    strcpy(filename + strlen(filename) - 6, "XXXXXX");
+    fd = mkstemp(filename);
+    ASSERT(fd >= 0);
+    ASSERT(write(fd, content, len) == (ssize_t)len);
+    return fd;
+}
+
+static char *
+create_content(bool lines)
+{
+    char *content = malloc(CONTENT_SIZE);
+    size_t i, line_len = 0;
+
+    ASSERT(content);
+    for (i = 0; i < CONTENT_SIZE; i++) {
+        /* lines of growing length, some longer than a chunk */
+        if (lines && line_len == (i / 997) % 150) {
+            content[i] = '\n';
+            line_len = 0;
+        } else {
+            content[i] = 'a' + i % 26;
+            line_len++;
+        }
+    }
+    return content;
+}
+
+DEFINE_TEST(test_chunks);
+
+static void
+test_chunks(void)
+{
+    char *content = create_content(false);
+    struct sol_file_chunk_reader *cr;
+    struct sol_str_slice chunk;
+    size_t tail = CONTENT_SIZE % 4000;
+    size_t done = 0;
+    int fd;
+
+    fd = create_file(content, CONTENT_SIZE);
+    cr = sol_file_chunk_reader_open(filename, 4000, -1);
+    ASSERT(cr);
+
+    while (1) {
+        ASSERT_INT_EQ(sol_file_chunk_reader_next(cr, false, &chunk), 0);
+        if (!chunk.len)
+            break;
+        ASSERT_INT_EQ(chunk.len, 4000);
+        ASSERT(memcmp(chunk.data, content + done, chunk.len) == 0);
+        done += chunk.len;
+    }
+    ASSERT_INT_EQ(done, CONTENT_SIZE - tail);
+
+    /* the incomplete last chunk */
+    ASSERT_INT_EQ(sol_file_chunk_reader_next(cr, true, &chunk), 0);
+    ASSERT_INT_EQ(chunk.len, tail);
+    ASSERT(memcmp(chunk.data, content + done, chunk.len) == 0);
+    ASSERT_INT_EQ(sol_file_chunk_reader_next(cr, true, &chunk), 0);
+    ASSERT_INT_EQ(chunk.len, 0);
+
+    ASSERT_INT_EQ(sol_file_chunk_reader_rewind(cr), 0);
+    ASSERT_INT_EQ(sol_file_chunk_reader_next(cr, true, &chunk), 0);
+    ASSERT_INT_EQ(chunk.len, 4000);
+    ASSERT(memcmp(chunk.data, content, chunk.len) == 0);
+
+    sol_file_chunk_reader_close(cr);
+    close(fd);
+    unlink(filename);
+    free(content);
+}
+
+DEFINE_TEST(test_lines);
+
+static void
+test_lines(void)
+{
+    char *content = create_content(true);
+    struct sol_file_chunk_reader *cr;
+    struct sol_str_slice chunk;
+    size_t done = 0;
+    int fd;
+
+    fd = create_file(content, CONTENT_SIZE);
+    cr = sol_file_chunk_reader_open(filename, 100, '\n');
+    ASSERT(cr);
+
+    while (1) {
+        ASSERT_INT_EQ(sol_file_chunk_reader_next(cr, true, &chunk), 0);
+        if (!chunk.len)
+            break;
+        ASSERT(chunk.len <= 100);
+        ASSERT(memcmp(chunk.data, content + done, chunk.len) == 0);
+        done += chunk.len;
+        /* lines are split only if too long */
+        ASSERT(chunk.data[chunk.len - 1] == '\n' || chunk.len == 100 ||
+            done == CONTENT_SIZE);
+        ASSERT(chunk.len == 100 || !memchr(chunk.data, '\n', chunk.len - 1));
+    }
+    ASSERT_INT_EQ(done, CONTENT_SIZE);
+
+    sol_file_chunk_reader_close(cr);
+    close(fd);
+    unlink(filename);
+    free(content);
+}
+
+static void
+check_growth(int fd, struct sol_file_chunk_reader *cr)
+{
+    struct sol_str_slice chunk;
+
+    ASSERT(write(fd, "first\nsec", 9) == 9);
+    ASSERT_INT_EQ(sol_file_chunk_reader_next(cr, false, &chunk), 0);
+    ASSERT(sol_str_slice_str_eq(chunk, "first\n"));
+
+    /* the incomplete line is kept until completed */
+    ASSERT_INT_EQ(sol_file_chunk_reader_next(cr, false, &chunk), 0);
+    ASSERT_INT_EQ(chunk.len, 0);
+    ASSERT(write(fd, "ond\n", 4) == 4);
+    ASSERT_INT_EQ(sol_file_chunk_reader_next(cr, false, &chunk), 0);
+    ASSERT(sol_str_slice_str_eq(chunk, "second\n"));
+    ASSERT_INT_EQ(sol_file_chunk_reader_next(cr, false, &chunk), 0);
+    ASSERT_INT_EQ(chunk.len, 0);
+
+    /* truncated, read from the start */
+    ASSERT_INT_EQ(ftruncate(fd, 0), 0);
+    ASSERT(pwrite(fd, "new\n", 4, 0) == 4);
+    ASSERT_INT_EQ(sol_file_chunk_reader_next(cr, false, &chunk), 0);
+    ASSERT(sol_str_slice_str_eq(chunk, "new\n"));
+}
+
+DEFINE_TEST(test_growing_file);
+
+static void
+test_growing_file(void)
+{
+    struct sol_file_chunk_reader *cr;
+    struct sol_str_slice chunk;
+    int fd;
+
+    /* empty files are read instead of mapped */
+    fd = create_file("", 0);
+    cr = sol_file_chunk_reader_open(filename, 100, '\n');
+    ASSERT(cr);
+    ASSERT_INT_EQ(sol_file_chunk_reader_next(cr, false, &chunk), 0);
+    ASSERT_INT_EQ(chunk.len, 0);
+    check_growth(fd, cr);
+    sol_file_chunk_reader_close(cr);
+    close(fd);
+    unlink(filename);
+
+    fd = create_file("0\n", 2);
+    cr = sol_file_chunk_reader_open(filename, 100, '\n');
+    ASSERT(cr);
+    ASSERT_INT_EQ(sol_file_chunk_reader_next(cr, false, &chunk), 0);
+    ASSERT(sol_str_slice_str_eq(chunk, "0\n"));
+    check_growth(fd, cr);
+    sol_file_chunk_reader_close(cr);
+    close(fd);
+    unlink(filename);
+}
+
+DEFINE_TEST(test_truncated_window);
+
+static void
+test_truncated_window(void)
+{
+    char *content = create_content(false);
+    struct sol_file_chunk_reader *cr;
+    struct sol_str_slice chunk;
+    size_t size = 512 * 1024;
+    size_t done = 0;
+    int fd;
+
+    fd = create_file(content, CONTENT_SIZE);
+    cr = sol_file_chunk_reader_open(filename, 4096, -1);
+    ASSERT(cr);
+    ASSERT_INT_EQ(sol_file_chunk_reader_next(cr, false, &chunk), 0);
+    ASSERT_INT_EQ(chunk.len, 4096);
+    done += chunk.len;
+
+    /* the window mapped past the new end still has unread data */
+    ASSERT_INT_EQ(ftruncate(fd, size), 0);
+    while (1) {
+        ASSERT_INT_EQ(sol_file_chunk_reader_next(cr, false, &chunk), 0);
+        if (!chunk.len)
+            break;
+        ASSERT(memcmp(chunk.data, content + done, chunk.len) == 0);
+        done += chunk.len;
+    }
+    ASSERT_INT_EQ(done, size);
+
+    /* truncated before the position, read from the start */
+    ASSERT_INT_EQ(ftruncate(fd, 8192), 0);
+    ASSERT_INT_EQ(sol_file_chunk_reader_next(cr, false, &chunk), 0);
+    ASSERT_INT_EQ(chunk.len, 4096);
+    ASSERT(memcmp(chunk.data, content, chunk.len) == 0);
+
+    /* and again while that window isn't consumed */
+    ASSERT_INT_EQ(ftruncate(fd, 6000), 0);
+    ASSERT_INT_EQ(sol_file_chunk_reader_next(cr, true, &chunk), 0);
+    ASSERT_INT_EQ(chunk.len, 6000 - 4096);
+    ASSERT(memcmp(chunk.data, content + 4096, chunk.len) == 0);
+
+    sol_file_chunk_reader_close(cr);
+    close(fd);
+    unlink(filename);
+    free(content);
+}
+
+DEFINE_TEST(test_fifo);
+
+static void
+test_fifo(void)
+{
+    struct sol_file_chunk_reader *cr;
+    struct sol_str_slice chunk;
+    char *dir, *path;
+    char tmpl[] = "/tmp/test-file-reader-XXXXXX";
+    int fd, r;
+
+    dir = mkdtemp(tmpl);
+    ASSERT(dir);
+    r = asprintf(&path, "%s/fifo", dir);
+    ASSERT(r > 0);
+    ASSERT_INT_EQ(mkfifo(path, 0600), 0);
+
+    /* neither opening nor reading wait for a writer */
+    cr = sol_file_chunk_reader_open(path, 100, '\n');
+    ASSERT(cr);
+    ASSERT(sol_file_chunk_reader_get_fd(cr) >= 0);
+    ASSERT_INT_EQ(sol_file_chunk_reader_next(cr, false, &chunk), 0);
+    ASSERT_INT_EQ(chunk.len, 0);
+
+    fd = open(path, O_WRONLY | O_NONBLOCK | O_CLOEXEC);
+    ASSERT(fd >= 0);
+
+    /* a writer without data yet */
+    ASSERT_INT_EQ(sol_file_chunk_reader_next(cr, false, &chunk), -EAGAIN);
+
+    ASSERT(write(fd, "first\nsec", 9) == 9);
+    ASSERT_INT_EQ(sol_file_chunk_reader_next(cr, false, &chunk), 0);
+    ASSERT(sol_str_slice_str_eq(chunk, "first\n"));
+
+    /* the incomplete line waits for more */
+    ASSERT_INT_EQ(sol_file_chunk_reader_next(cr, false, &chunk), -EAGAIN);
+    ASSERT(write(fd, "ond\nthi", 7) == 7);
+    ASSERT_INT_EQ(sol_file_chunk_reader_next(cr, false, &chunk), 0);
+    ASSERT(sol_str_slice_str_eq(chunk, "second\n"));
+
+    /* partial chunks are returned as they are */
+    ASSERT_INT_EQ(sol_file_chunk_reader_next(cr, true, &chunk), 0);
+    ASSERT(sol_str_slice_str_eq(chunk, "thi"));
+    ASSERT_INT_EQ(sol_file_chunk_reader_next(cr, true, &chunk), -EAGAIN);
+
+    /* the writer is gone, that's the end */
+    close(fd);
+    ASSERT_INT_EQ(sol_file_chunk_reader_next(cr, true, &chunk), 0);
+    ASSERT_INT_EQ(chunk.len, 0);
+
+    sol_file_chunk_reader_close(cr);
+    unlink(path);
+    rmdir(dir);
+    free(path);
+}
+
+DEFINE_TEST(test_invalid);
+
+static void
+test_invalid(void)
+{
+    ASSERT(!sol_file_chunk_reader_open("/dev/null", 0, -1));
+    ASSERT_INT_EQ(errno, EINVAL);
+    ASSERT(!sol_file_chunk_reader_open("/nonexistent/file", 10, -1));
+    ASSERT_INT_EQ(errno, ENOENT);
+}
+
+
+TEST_MAIN();
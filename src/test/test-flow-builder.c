@@ -31,6 +31,7 @@
  */
 
 #include <errno.h>
+#include <stddef.h>
 
 #include "sol-flow.h"
 #include "sol-flow-builder.h"
@@ -383,6 +384,60 @@ nodes_must_have_unique_names(void)
     sol_flow_builder_del(builder);
 }
 
+DEFINE_TEST(many_nodes_are_found_by_name);
+
+static void
+many_nodes_are_found_by_name(void)
+{
+    struct sol_flow_node *flow, *first, *middle, *last;
+    struct sol_flow_node_type *node_type;
+    struct sol_flow_builder *builder;
+    char name[32];
+    int i, ret;
+
+    builder = sol_flow_builder_new();
+
+    for (i = 0; i < 1000; i++) {
+        snprintf(name, sizeof(name), "node%d", i);
+        ret = sol_flow_builder_add_node(builder, name, &test_node_type, NULL);
+        ASSERT_INT_EQ(ret, 0);
+    }
+
+    /* names added before the lookup table grew are still unique */
+    ret = sol_flow_builder_add_node(builder, "node0", &test_node_type, NULL);
+    ASSERT_INT_EQ(ret, -ENOTUNIQ);
+    ret = sol_flow_builder_add_node(builder, "node999", &test_node_type, NULL);
+    ASSERT_INT_EQ(ret, -ENOTUNIQ);
+
+    ret = sol_flow_builder_connect(builder, "node0", "OUT1", -1, "node999", "IN1", -1);
+    ASSERT_INT_EQ(ret, 0);
+    ret = sol_flow_builder_connect(builder, "node999", "OUT1", -1, "node500", "IN1", -1);
+    ASSERT_INT_EQ(ret, 0);
+    ret = sol_flow_builder_connect(builder, "node500", "OUT2", -1, "node0", "IN2", -1);
+    ASSERT_INT_EQ(ret, 0);
+    ret = sol_flow_builder_connect(builder, "node1000", "OUT1", -1, "node0", "IN1", -1);
+    ASSERT(ret < 0);
+
+    node_type = sol_flow_builder_get_node_type(builder);
+    sol_flow_builder_del(builder);
+    ASSERT(node_type);
+
+    flow = sol_flow_node_new(NULL, "many", node_type, NULL);
+    ASSERT(flow);
+
+    first = sol_flow_static_get_node(flow, 0);
+    middle = sol_flow_static_get_node(flow, 500);
+    last = sol_flow_static_get_node(flow, 999);
+
+    ASSERT_EVENT_COUNT(first, EVENT_PORT_CONNECT, 2);
+    ASSERT_EVENT_COUNT(middle, EVENT_PORT_CONNECT, 2);
+    ASSERT_EVENT_COUNT(last, EVENT_PORT_CONNECT, 2);
+    ASSERT_EVENT_COUNT(NULL, EVENT_PORT_CONNECT, 6);
+
+    sol_flow_node_del(flow);
+    sol_flow_node_type_del(node_type);
+}
+
 DEFINE_TEST(node_ports_must_have_unique_names);
 
 static void
@@ -454,6 +509,90 @@ ports_can_be_exported(void)
 }
 
 
+#define TEST_OPTS_SUB_API 0x7e57
+
+struct test_opts_options {
+    struct sol_flow_node_options base;
+    struct sol_irange value;
+};
+
+static unsigned int test_opts_allocated;
+
+static struct {
+    const struct sol_flow_node_options *opts;
+    int32_t value;
+} test_opts_opened[8];
+static unsigned int test_opts_opened_count;
+
+static struct sol_flow_node_options *
+test_opts_new_options(const struct sol_flow_node_type *type, const struct sol_flow_node_options *copy_from)
+{
+    struct test_opts_options *opts;
+
+    opts = calloc(1, sizeof(*opts));
+    ASSERT(opts);
+    test_opts_allocated++;
+
+    if (copy_from) {
+        memcpy(opts, copy_from, sizeof(*opts));
+    } else {
+        opts->base.api_version = SOL_FLOW_NODE_OPTIONS_API_VERSION;
+        opts->base.sub_api = TEST_OPTS_SUB_API;
+        opts->value.val = 1;
+    }
+
+    return &opts->base;
+}
+
+static void
+test_opts_free_options(const struct sol_flow_node_type *type, struct sol_flow_node_options *options)
+{
+    free(options);
+}
+
+static int
+test_opts_open(struct sol_flow_node *node, void *data, const struct sol_flow_node_options *options)
+{
+    const struct test_opts_options *opts = (const struct test_opts_options *)options;
+
+    ASSERT(test_opts_opened_count < ARRAY_SIZE(test_opts_opened));
+    test_opts_opened[test_opts_opened_count].opts = options;
+    test_opts_opened[test_opts_opened_count].value = opts->value.val;
+    test_opts_opened_count++;
+    return 0;
+}
+
+static const struct sol_flow_node_type_description test_opts_node_description = {
+    .options = &((const struct sol_flow_node_options_description){
+        .members = (const struct sol_flow_node_options_member_description[]){
+            {
+                .name = "value",
+                .data_type = "int",
+                .offset = offsetof(struct test_opts_options, value),
+                .size = sizeof(struct sol_irange),
+            },
+            {}
+        },
+        .data_size = sizeof(struct test_opts_options),
+        .sub_api = TEST_OPTS_SUB_API,
+    }),
+};
+
+static const struct sol_flow_node_type test_opts_node_type = {
+    .api_version = SOL_FLOW_NODE_TYPE_API_VERSION,
+
+    .get_ports_counts = test_node_get_ports_counts,
+    .get_port_in = test_node_get_port_in,
+    .get_port_out = test_node_get_port_out,
+
+    .open = test_opts_open,
+    .new_options = test_opts_new_options,
+    .free_options = test_opts_free_options,
+
+    .description = &test_opts_node_description,
+};
+
+
 static int
 custom_resolve(void *data, const char *id, struct sol_flow_node_type const **type,
     const char ***opts_strv)
@@ -462,6 +601,10 @@ custom_resolve(void *data, const char *id, struct sol_flow_node_type const **typ
         *type = &test_node_type;
         return 0;
     }
+    if (streq(id, "custom_opts_type")) {
+        *type = &test_opts_node_type;
+        return 0;
+    }
     return -ENOENT;
 }
 
@@ -532,6 +675,157 @@ add_node_by_type(void)
     sol_flow_builder_del(builder);
 }
 
+DEFINE_TEST(nodes_share_parsed_options);
+
+static void
+nodes_share_parsed_options(void)
+{
+    static const char *const five[] = { "value=5", NULL };
+    static const char *const seven[] = { "value=7", NULL };
+    const struct sol_flow_node_options_member_description *member;
+    struct sol_flow_node_options *flow_opts;
+    struct sol_flow_builder *builder;
+    struct sol_flow_node_type *type;
+    struct sol_flow_node *flow;
+    struct sol_irange *exported;
+
+    test_opts_allocated = 0;
+    test_opts_opened_count = 0;
+
+    builder = sol_flow_builder_new();
+    sol_flow_builder_set_resolver(builder, &custom_resolver);
+
+    ASSERT(sol_flow_builder_add_node_by_type(builder, "a", "custom_opts_type", five) == 0);
+    ASSERT(sol_flow_builder_add_node_by_type(builder, "b", "custom_opts_type", five) == 0);
+    ASSERT(sol_flow_builder_add_node_by_type(builder, "c", "custom_opts_type", seven) == 0);
+
+    /* Same type and options are parsed once. */
+    ASSERT_INT_EQ(test_opts_allocated, 2);
+
+    type = sol_flow_builder_get_node_type(builder);
+    ASSERT(type);
+
+    /* Nothing overrides the children options, so opening doesn't
+     * copy them. */
+    flow = sol_flow_node_new(NULL, "flow", type, NULL);
+    ASSERT(flow);
+    ASSERT_INT_EQ(test_opts_allocated, 2);
+    ASSERT_INT_EQ(test_opts_opened_count, 3);
+    ASSERT(test_opts_opened[0].opts == test_opts_opened[1].opts);
+    ASSERT(test_opts_opened[0].opts != test_opts_opened[2].opts);
+    ASSERT_INT_EQ(test_opts_opened[0].value, 5);
+    ASSERT_INT_EQ(test_opts_opened[2].value, 7);
+    sol_flow_node_del(flow);
+
+    sol_flow_builder_del(builder);
+    sol_flow_node_type_del(type);
+
+    /* Overriding a member through an exported option gives that
+     * child a copy, the shared options stay untouched. */
+    test_opts_opened_count = 0;
+    builder = sol_flow_builder_new();
+    sol_flow_builder_set_resolver(builder, &custom_resolver);
+
+    ASSERT(sol_flow_builder_add_node_by_type(builder, "a", "custom_opts_type", five) == 0);
+    ASSERT(sol_flow_builder_add_node_by_type(builder, "b", "custom_opts_type", five) == 0);
+    ASSERT(sol_flow_builder_export_option(builder, "b", "value", "BValue") == 0);
+
+    type = sol_flow_builder_get_node_type(builder);
+    ASSERT(type);
+
+    flow_opts = sol_flow_node_options_new_from_strv(type, NULL);
+    ASSERT(flow_opts);
+    member = type->description->options->members;
+    exported = (struct sol_irange *)((char *)flow_opts + member->offset);
+    ASSERT_INT_EQ(exported->val, 5);
+    exported->val = 42;
+
+    flow = sol_flow_node_new(NULL, "flow", type, flow_opts);
+    ASSERT(flow);
+    sol_flow_node_del(flow);
+    sol_flow_node_options_del(type, flow_opts);
+
+    flow = sol_flow_node_new(NULL, "flow", type, NULL);
+    ASSERT(flow);
+    sol_flow_node_del(flow);
+
+    ASSERT_INT_EQ(test_opts_opened_count, 4);
+    ASSERT_INT_EQ(test_opts_opened[0].value, 5);
+    ASSERT_INT_EQ(test_opts_opened[1].value, 42);
+    ASSERT_INT_EQ(test_opts_opened[2].value, 5);
+    ASSERT_INT_EQ(test_opts_opened[3].value, 5);
+
+    sol_flow_builder_del(builder);
+    sol_flow_node_type_del(type);
+}
+
+static struct sol_flow_node_type *
+build_exported_option_type(const char *const *children, const char *exported_child, const char *exported_name)
+{
+    static const char *const five[] = { "value=5", NULL };
+    struct sol_flow_builder *builder;
+    struct sol_flow_node_type *type;
+
+    builder = sol_flow_builder_new();
+    sol_flow_builder_set_resolver(builder, &custom_resolver);
+
+    for (; *children; children++)
+        ASSERT(sol_flow_builder_add_node_by_type(builder, *children, "custom_opts_type", five) == 0);
+    ASSERT(sol_flow_builder_export_option(builder, exported_child, "value", exported_name) == 0);
+
+    type = sol_flow_builder_get_node_type(builder);
+    ASSERT(type);
+    sol_flow_builder_del(builder);
+
+    return type;
+}
+
+DEFINE_TEST(update_keeps_exported_options);
+
+static void
+update_keeps_exported_options(void)
+{
+    static const char *const ab[] = { "a", "b", NULL };
+    static const char *const abc[] = { "a", "b", "c", NULL };
+    static const char *const a[] = { "a", NULL };
+    static const char *const bvalue_42[] = { "BValue=42", NULL };
+    struct sol_flow_node_type *type, *moved_type, *other_type;
+    struct sol_flow_node_options *flow_opts;
+    struct sol_flow_node *flow;
+
+    type = build_exported_option_type(ab, "b", "BValue");
+    moved_type = build_exported_option_type(abc, "c", "BValue");
+    other_type = build_exported_option_type(a, "a", "Other");
+
+    flow_opts = sol_flow_node_options_new_from_strv(type, bvalue_42);
+    ASSERT(flow_opts);
+
+    test_opts_opened_count = 0;
+    flow = sol_flow_node_new(NULL, "flow", type, flow_opts);
+    ASSERT(flow);
+    sol_flow_node_options_del(type, flow_opts);
+    ASSERT_INT_EQ(test_opts_opened_count, 2);
+    ASSERT_INT_EQ(test_opts_opened[1].value, 42);
+
+    /* a and b are kept, c is opened with the options the flow was
+     * opened with, even after the caller freed them. */
+    test_opts_opened_count = 0;
+    ASSERT_INT_EQ(sol_flow_static_update(flow, moved_type), 0);
+    ASSERT_INT_EQ(test_opts_opened_count, 1);
+    ASSERT_INT_EQ(test_opts_opened[0].value, 42);
+
+    /* A type exporting other options can't read them. */
+    test_opts_opened_count = 0;
+    ASSERT_INT_EQ(sol_flow_static_update(flow, other_type), -ENOTSUP);
+    ASSERT_INT_EQ(test_opts_opened_count, 0);
+    ASSERT(sol_flow_node_get_type(flow) == moved_type);
+
+    sol_flow_node_del(flow);
+    sol_flow_node_type_del(other_type);
+    sol_flow_node_type_del(moved_type);
+    sol_flow_node_type_del(type);
+}
+
 DEFINE_TEST(add_type_descriptions);
 
 static void
@@ -566,4 +860,50 @@ add_type_descriptions(void)
     sol_flow_node_type_del(type);
 }
 
+struct resolve_builtin_ctx {
+    unsigned int count;
+    bool failed;
+};
+
+static bool
+resolve_builtin_cb(void *data, const struct sol_flow_node_type *type)
+{
+    struct resolve_builtin_ctx *ctx = data;
+    const struct sol_flow_node_type *resolved = NULL;
+    const char **opts_strv = NULL;
+    int err;
+
+    if (!type->description || !type->description->name)
+        return true;
+
+    err = sol_flow_resolve(sol_flow_get_builtins_resolver(),
+        type->description->name, &resolved, &opts_strv);
+    if (err < 0 || resolved != type || opts_strv) {
+        SOL_ERR("Couldn't resolve builtin type '%s' back to itself", type->description->name);
+        ctx->failed = true;
+    }
+
+    ctx->count++;
+    return true;
+}
+
+DEFINE_TEST(builtins_resolver_finds_every_builtin_type);
+
+static void
+builtins_resolver_finds_every_builtin_type(void)
+{
+    struct resolve_builtin_ctx ctx = { };
+    const struct sol_flow_node_type *type = NULL;
+    const char **opts_strv = NULL;
+
+    sol_flow_foreach_builtin_node_type(resolve_builtin_cb, &ctx);
+    ASSERT(!ctx.failed);
+    ASSERT(ctx.count > 0);
+
+    ASSERT(sol_flow_resolve(sol_flow_get_builtins_resolver(),
+        "type_that_doesnt_exist", &type, &opts_strv) == -ENOENT);
+    ASSERT(sol_flow_resolve(sol_flow_get_builtins_resolver(),
+        "boolean/and_that_doesnt_exist", &type, &opts_strv) == -ENOENT);
+}
+
 TEST_MAIN_WITH_RESET_FUNC(clear_events);
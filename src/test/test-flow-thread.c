@@ -0,0 +1,607 @@
+/*
+ * This file is part of the Soletta Project
+ *
+ * Copyright (C) 2015 Intel Corporation. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above copyright
+ *     notice, this list of conditions and the following disclaimer in
+ *     the documentation and/or other materials provided with the
+ *     distribution.
+ *   * Neither the name of Intel Corporation nor the names of its
+ *     contributors may be used to endorse or promote products derived
+ *     from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ * OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <errno.h>
+#include <pthread.h>
+
+#include "sol-flow.h"
+#include "sol-flow-static.h"
+#include "sol-flow-thread.h"
+#include "sol-mainloop.h"
+#include "sol-util.h"
+#include "sol-vector.h"
+
+#include "test.h"
+
+static pthread_t main_thread;
+static bool processed_in_main_thread;
+static struct sol_vector received = SOL_VECTOR_INIT(int32_t);
+static uint16_t expected_count;
+
+static bool
+quit_loop(void *data)
+{
+    sol_quit();
+    return false;
+}
+
+/* Runs the main loop until the sink got expected_count packets, or
+ * gives up after a while. */
+static void
+wait_packets(uint16_t count)
+{
+    struct sol_timeout *timeout;
+
+    expected_count = count;
+    if (received.len < expected_count) {
+        timeout = sol_timeout_add(5000, quit_loop, NULL);
+        sol_run();
+        sol_timeout_del(timeout);
+    }
+}
+
+static int
+double_process(struct sol_flow_node *node, void *data, uint16_t port, uint16_t conn_id, const struct sol_flow_packet *packet)
+{
+    int32_t value;
+    int r;
+
+    if (pthread_equal(pthread_self(), main_thread))
+        processed_in_main_thread = true;
+
+    r = sol_flow_packet_get_irange_value(packet, &value);
+    if (r < 0)
+        return r;
+
+    return sol_flow_send_irange_value_packet(node, 0, value * 2);
+}
+
+static int
+sink_process(struct sol_flow_node *node, void *data, uint16_t port, uint16_t conn_id, const struct sol_flow_packet *packet)
+{
+    int32_t *value;
+    int r;
+
+    value = sol_vector_append(&received);
+    if (!value)
+        return -ENOMEM;
+
+    r = sol_flow_packet_get_irange_value(packet, value);
+    if (r < 0)
+        return r;
+
+    if (received.len == expected_count)
+        sol_quit();
+
+    return 0;
+}
+
+static struct sol_flow_port_type_in double_port_in = {
+    .api_version = SOL_FLOW_PORT_TYPE_IN_API_VERSION,
+    .packet_type = NULL, /* placeholder for SOL_FLOW_PACKET_TYPE_IRANGE */
+    .process = double_process,
+};
+
+static struct sol_flow_port_type_in sink_port_in = {
+    .api_version = SOL_FLOW_PORT_TYPE_IN_API_VERSION,
+    .packet_type = NULL, /* placeholder for SOL_FLOW_PACKET_TYPE_IRANGE */
+    .process = sink_process,
+};
+
+static struct sol_flow_port_type_out int_port_out = {
+    .api_version = SOL_FLOW_PORT_TYPE_OUT_API_VERSION,
+    .packet_type = NULL, /* placeholder for SOL_FLOW_PACKET_TYPE_IRANGE */
+};
+
+static void
+init_port_types(void)
+{
+    double_port_in.packet_type = SOL_FLOW_PACKET_TYPE_IRANGE;
+    sink_port_in.packet_type = SOL_FLOW_PACKET_TYPE_IRANGE;
+    int_port_out.packet_type = SOL_FLOW_PACKET_TYPE_IRANGE;
+}
+
+static void
+one_in_one_out_get_ports_counts(const struct sol_flow_node_type *type, uint16_t *ports_in_count, uint16_t *ports_out_count)
+{
+    if (ports_in_count)
+        *ports_in_count = 1;
+    if (ports_out_count)
+        *ports_out_count = 1;
+}
+
+static void
+sink_get_ports_counts(const struct sol_flow_node_type *type, uint16_t *ports_in_count, uint16_t *ports_out_count)
+{
+    if (ports_in_count)
+        *ports_in_count = 1;
+    if (ports_out_count)
+        *ports_out_count = 0;
+}
+
+static void
+source_get_ports_counts(const struct sol_flow_node_type *type, uint16_t *ports_in_count, uint16_t *ports_out_count)
+{
+    if (ports_in_count)
+        *ports_in_count = 0;
+    if (ports_out_count)
+        *ports_out_count = 1;
+}
+
+static const struct sol_flow_port_type_in *
+double_get_port_in(const struct sol_flow_node_type *type, uint16_t port)
+{
+    return &double_port_in;
+}
+
+static const struct sol_flow_port_type_in *
+sink_get_port_in(const struct sol_flow_node_type *type, uint16_t port)
+{
+    return &sink_port_in;
+}
+
+static const struct sol_flow_port_type_out *
+int_get_port_out(const struct sol_flow_node_type *type, uint16_t port)
+{
+    return &int_port_out;
+}
+
+static const struct sol_flow_node_type double_type = {
+    .api_version = SOL_FLOW_NODE_TYPE_API_VERSION,
+    .init_type = init_port_types,
+    .get_ports_counts = one_in_one_out_get_ports_counts,
+    .get_port_in = double_get_port_in,
+    .get_port_out = int_get_port_out,
+};
+
+static const struct sol_flow_node_type sink_type = {
+    .api_version = SOL_FLOW_NODE_TYPE_API_VERSION,
+    .init_type = init_port_types,
+    .get_ports_counts = sink_get_ports_counts,
+    .get_port_in = sink_get_port_in,
+};
+
+static const struct sol_flow_node_type source_type = {
+    .api_version = SOL_FLOW_NODE_TYPE_API_VERSION,
+    .init_type = init_port_types,
+    .get_ports_counts = source_get_ports_counts,
+    .get_port_out = int_get_port_out,
+};
+
+/* source -> thread(child_type) -> sink */
+static void
+send_through_thread(const struct sol_flow_node_type *child_type, int32_t factor)
+{
+    struct sol_flow_node_type *thread_type;
+    struct sol_flow_node *flow, *source;
+    struct sol_flow_static_node_spec nodes[] = {
+        { .type = &source_type, .name = "source" },
+        { .type = NULL, .name = "thread" },
+        { .type = &sink_type, .name = "sink" },
+        SOL_FLOW_STATIC_NODE_SPEC_GUARD
+    };
+    static const struct sol_flow_static_conn_spec conns[] = {
+        { .src = 0, .src_port = 0, .dst = 1, .dst_port = 0 },
+        { .src = 1, .src_port = 0, .dst = 2, .dst_port = 0 },
+        SOL_FLOW_STATIC_CONN_SPEC_GUARD
+    };
+    int32_t *value;
+    uint16_t i;
+
+    main_thread = pthread_self();
+    processed_in_main_thread = false;
+
+    thread_type = sol_flow_thread_new_type(child_type);
+    ASSERT(thread_type);
+    nodes[1].type = thread_type;
+
+    flow = sol_flow_static_new(NULL, nodes, conns);
+    ASSERT(flow);
+    source = sol_flow_static_get_node(flow, 0);
+
+    for (i = 0; i < 100; i++)
+        sol_flow_send_irange_value_packet(source, 0, i);
+
+    wait_packets(100);
+
+    ASSERT_INT_EQ(received.len, 100);
+    SOL_VECTOR_FOREACH_IDX (&received, value, i)
+        ASSERT_INT_EQ(*value, i * factor);
+    ASSERT(!processed_in_main_thread);
+
+    sol_flow_node_del(flow);
+    sol_flow_node_type_del(thread_type);
+    sol_vector_clear(&received);
+}
+
+DEFINE_TEST(packets_are_processed_in_thread_and_keep_order);
+
+static void
+packets_are_processed_in_thread_and_keep_order(void)
+{
+    send_through_thread(&double_type, 2);
+}
+
+DEFINE_TEST(subflow_sends_are_delivered_in_thread);
+
+static void
+subflow_sends_are_delivered_in_thread(void)
+{
+    struct sol_flow_node_type *subflow_type;
+    static const struct sol_flow_static_node_spec nodes[] = {
+        { .type = &double_type, .name = "first" },
+        { .type = &double_type, .name = "second" },
+        SOL_FLOW_STATIC_NODE_SPEC_GUARD
+    };
+    static const struct sol_flow_static_conn_spec conns[] = {
+        { .src = 0, .src_port = 0, .dst = 1, .dst_port = 0 },
+        SOL_FLOW_STATIC_CONN_SPEC_GUARD
+    };
+    static const struct sol_flow_static_port_spec exported_in[] = {
+        { 0, 0 },
+        SOL_FLOW_STATIC_PORT_SPEC_GUARD
+    };
+    static const struct sol_flow_static_port_spec exported_out[] = {
+        { 1, 0 },
+        SOL_FLOW_STATIC_PORT_SPEC_GUARD
+    };
+    static const struct sol_flow_static_spec spec = {
+        .api_version = SOL_FLOW_STATIC_API_VERSION,
+        .nodes = nodes,
+        .conns = conns,
+        .exported_in = exported_in,
+        .exported_out = exported_out,
+    };
+
+    subflow_type = sol_flow_static_new_type(&spec);
+    ASSERT(subflow_type);
+
+    send_through_thread(subflow_type, 4);
+
+    sol_flow_node_type_del(subflow_type);
+}
+
+DEFINE_TEST(nested_threads_deliver_packets);
+
+static void
+nested_threads_deliver_packets(void)
+{
+    struct sol_flow_node_type *inner_type, *subflow_type;
+    struct sol_flow_static_node_spec nodes[] = {
+        { .type = NULL, .name = "inner" },
+        { .type = &double_type, .name = "second" },
+        SOL_FLOW_STATIC_NODE_SPEC_GUARD
+    };
+    static const struct sol_flow_static_conn_spec conns[] = {
+        { .src = 0, .src_port = 0, .dst = 1, .dst_port = 0 },
+        SOL_FLOW_STATIC_CONN_SPEC_GUARD
+    };
+    static const struct sol_flow_static_port_spec exported_in[] = {
+        { 0, 0 },
+        SOL_FLOW_STATIC_PORT_SPEC_GUARD
+    };
+    static const struct sol_flow_static_port_spec exported_out[] = {
+        { 1, 0 },
+        SOL_FLOW_STATIC_PORT_SPEC_GUARD
+    };
+    struct sol_flow_static_spec spec = {
+        .api_version = SOL_FLOW_STATIC_API_VERSION,
+        .nodes = nodes,
+        .conns = conns,
+        .exported_in = exported_in,
+        .exported_out = exported_out,
+    };
+
+    inner_type = sol_flow_thread_new_type(&double_type);
+    ASSERT(inner_type);
+    nodes[0].type = inner_type;
+
+    subflow_type = sol_flow_static_new_type(&spec);
+    ASSERT(subflow_type);
+
+    send_through_thread(subflow_type, 4);
+
+    sol_flow_node_type_del(subflow_type);
+    sol_flow_node_type_del(inner_type);
+}
+
+#define TICKS 50
+#define BURSTS 50
+#define BURST_LEN 20
+
+struct ticker_data {
+    struct sol_timeout *timer;
+    struct sol_timeout *unused_timer;
+    int32_t ticks;
+};
+
+static struct sol_vector ticks = SOL_VECTOR_INIT(int32_t);
+static bool ticked_in_main_thread;
+
+static bool
+ticker_tick(void *data)
+{
+    struct sol_flow_node *node = data;
+    struct ticker_data *tdata = sol_flow_node_get_private_data(node);
+
+    if (pthread_equal(pthread_self(), main_thread))
+        ticked_in_main_thread = true;
+
+    tdata->ticks++;
+    sol_flow_send_irange_value_packet(node, 1, tdata->ticks);
+    if (tdata->ticks < TICKS)
+        return true;
+
+    tdata->timer = NULL;
+    return false;
+}
+
+static bool
+ticker_unused_tick(void *data)
+{
+    ticked_in_main_thread = true;
+    return false;
+}
+
+static int
+ticker_open(struct sol_flow_node *node, void *data, const struct sol_flow_node_options *options)
+{
+    struct ticker_data *tdata = data;
+
+    tdata->ticks = 0;
+    tdata->timer = sol_timeout_add(1, ticker_tick, node);
+    if (!tdata->timer)
+        return -ENOMEM;
+
+    /* Never fires, it's deleted on close. */
+    tdata->unused_timer = sol_timeout_add(60000, ticker_unused_tick, node);
+    if (!tdata->unused_timer) {
+        sol_timeout_del(tdata->timer);
+        return -ENOMEM;
+    }
+
+    return 0;
+}
+
+static void
+ticker_close(struct sol_flow_node *node, void *data)
+{
+    struct ticker_data *tdata = data;
+
+    if (tdata->timer)
+        sol_timeout_del(tdata->timer);
+    sol_timeout_del(tdata->unused_timer);
+}
+
+static int
+ticker_process(struct sol_flow_node *node, void *data, uint16_t port, uint16_t conn_id, const struct sol_flow_packet *packet)
+{
+    int32_t value;
+    int r;
+
+    if (pthread_equal(pthread_self(), main_thread))
+        processed_in_main_thread = true;
+
+    r = sol_flow_packet_get_irange_value(packet, &value);
+    if (r < 0)
+        return r;
+
+    return sol_flow_send_irange_value_packet(node, 0, value);
+}
+
+static int
+ticks_sink_process(struct sol_flow_node *node, void *data, uint16_t port, uint16_t conn_id, const struct sol_flow_packet *packet)
+{
+    int32_t *value;
+
+    value = sol_vector_append(&ticks);
+    if (!value)
+        return -ENOMEM;
+
+    return sol_flow_packet_get_irange_value(packet, value);
+}
+
+static struct sol_flow_port_type_in ticker_port_in = {
+    .api_version = SOL_FLOW_PORT_TYPE_IN_API_VERSION,
+    .packet_type = NULL, /* placeholder for SOL_FLOW_PACKET_TYPE_IRANGE */
+    .process = ticker_process,
+};
+
+static struct sol_flow_port_type_in ticks_sink_port_in = {
+    .api_version = SOL_FLOW_PORT_TYPE_IN_API_VERSION,
+    .packet_type = NULL, /* placeholder for SOL_FLOW_PACKET_TYPE_IRANGE */
+    .process = ticks_sink_process,
+};
+
+static void
+ticker_init_port_types(void)
+{
+    init_port_types();
+    ticker_port_in.packet_type = SOL_FLOW_PACKET_TYPE_IRANGE;
+    ticks_sink_port_in.packet_type = SOL_FLOW_PACKET_TYPE_IRANGE;
+}
+
+static void
+ticker_get_ports_counts(const struct sol_flow_node_type *type, uint16_t *ports_in_count, uint16_t *ports_out_count)
+{
+    if (ports_in_count)
+        *ports_in_count = 1;
+    if (ports_out_count)
+        *ports_out_count = 2;
+}
+
+static const struct sol_flow_port_type_in *
+ticker_get_port_in(const struct sol_flow_node_type *type, uint16_t port)
+{
+    return &ticker_port_in;
+}
+
+static const struct sol_flow_port_type_in *
+ticks_sink_get_port_in(const struct sol_flow_node_type *type, uint16_t port)
+{
+    return &ticks_sink_port_in;
+}
+
+static const struct sol_flow_node_type ticker_type = {
+    .api_version = SOL_FLOW_NODE_TYPE_API_VERSION,
+    .data_size = sizeof(struct ticker_data),
+    .init_type = ticker_init_port_types,
+    .get_ports_counts = ticker_get_ports_counts,
+    .get_port_in = ticker_get_port_in,
+    .get_port_out = int_get_port_out,
+    .open = ticker_open,
+    .close = ticker_close,
+};
+
+static const struct sol_flow_node_type ticks_sink_type = {
+    .api_version = SOL_FLOW_NODE_TYPE_API_VERSION,
+    .init_type = ticker_init_port_types,
+    .get_ports_counts = sink_get_ports_counts,
+    .get_port_in = ticks_sink_get_port_in,
+};
+
+struct feeder {
+    struct sol_flow_node *source;
+    int32_t sent;
+};
+
+/* Sends a burst of packets per main loop iteration, while the timer
+ * of the wrapped node fires in the thread. */
+static bool
+feed(void *data)
+{
+    struct feeder *feeder = data;
+    int i;
+
+    for (i = 0; i < BURST_LEN && feeder->sent < BURSTS * BURST_LEN; i++)
+        sol_flow_send_irange_value_packet(feeder->source, 0, feeder->sent++);
+
+    if (received.len == BURSTS * BURST_LEN && ticks.len == TICKS) {
+        sol_quit();
+        return false;
+    }
+
+    return true;
+}
+
+DEFINE_TEST(wrapped_timeouts_are_dispatched_in_thread);
+
+static void
+wrapped_timeouts_are_dispatched_in_thread(void)
+{
+    struct sol_flow_node_type *subflow_type, *thread_type;
+    static const struct sol_flow_static_node_spec subflow_nodes[] = {
+        { .type = &ticker_type, .name = "ticker" },
+        { .type = &double_type, .name = "double" },
+        SOL_FLOW_STATIC_NODE_SPEC_GUARD
+    };
+    static const struct sol_flow_static_conn_spec subflow_conns[] = {
+        { .src = 0, .src_port = 0, .dst = 1, .dst_port = 0 },
+        SOL_FLOW_STATIC_CONN_SPEC_GUARD
+    };
+    static const struct sol_flow_static_port_spec exported_in[] = {
+        { 0, 0 },
+        SOL_FLOW_STATIC_PORT_SPEC_GUARD
+    };
+    static const struct sol_flow_static_port_spec exported_out[] = {
+        { 0, 1 },
+        { 1, 0 },
+        SOL_FLOW_STATIC_PORT_SPEC_GUARD
+    };
+    static const struct sol_flow_static_spec subflow_spec = {
+        .api_version = SOL_FLOW_STATIC_API_VERSION,
+        .nodes = subflow_nodes,
+        .conns = subflow_conns,
+        .exported_in = exported_in,
+        .exported_out = exported_out,
+    };
+    struct sol_flow_static_node_spec nodes[] = {
+        { .type = &source_type, .name = "source" },
+        { .type = NULL, .name = "thread" },
+        { .type = &sink_type, .name = "sink" },
+        { .type = &ticks_sink_type, .name = "ticks" },
+        SOL_FLOW_STATIC_NODE_SPEC_GUARD
+    };
+    static const struct sol_flow_static_conn_spec conns[] = {
+        { .src = 0, .src_port = 0, .dst = 1, .dst_port = 0 },
+        { .src = 1, .src_port = 0, .dst = 3, .dst_port = 0 },
+        { .src = 1, .src_port = 1, .dst = 2, .dst_port = 0 },
+        SOL_FLOW_STATIC_CONN_SPEC_GUARD
+    };
+    struct feeder feeder = { 0 };
+    struct sol_timeout *feed_timeout, *timeout;
+    struct sol_flow_node *flow;
+    int32_t *value;
+    uint16_t i;
+
+    main_thread = pthread_self();
+    processed_in_main_thread = false;
+    ticked_in_main_thread = false;
+    expected_count = UINT16_MAX;
+
+    /* The flow thread type copies the ports of the subflow, which
+     * doesn't initialize its children types. */
+    ticker_init_port_types();
+
+    subflow_type = sol_flow_static_new_type(&subflow_spec);
+    ASSERT(subflow_type);
+    thread_type = sol_flow_thread_new_type(subflow_type);
+    ASSERT(thread_type);
+    nodes[1].type = thread_type;
+
+    flow = sol_flow_static_new(NULL, nodes, conns);
+    ASSERT(flow);
+    feeder.source = sol_flow_static_get_node(flow, 0);
+
+    feed_timeout = sol_timeout_add(1, feed, &feeder);
+    ASSERT(feed_timeout);
+    timeout = sol_timeout_add(5000, quit_loop, NULL);
+    sol_run();
+    sol_timeout_del(timeout);
+
+    ASSERT_INT_EQ(received.len, BURSTS * BURST_LEN);
+    SOL_VECTOR_FOREACH_IDX (&received, value, i)
+        ASSERT_INT_EQ(*value, i * 2);
+    ASSERT_INT_EQ(ticks.len, TICKS);
+    SOL_VECTOR_FOREACH_IDX (&ticks, value, i)
+        ASSERT_INT_EQ(*value, i + 1);
+    ASSERT(!processed_in_main_thread);
+    ASSERT(!ticked_in_main_thread);
+
+    sol_flow_node_del(flow);
+    sol_flow_node_type_del(thread_type);
+    sol_flow_node_type_del(subflow_type);
+    sol_vector_clear(&received);
+    sol_vector_clear(&ticks);
+}
+
+TEST_MAIN();
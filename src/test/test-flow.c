@@ -30,6 +30,8 @@
  * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
  */
 
+#include <errno.h>
+
 #include "sol-flow.h"
 #include "sol-flow-static.h"
 #include "sol-mainloop.h"
@@ -613,6 +615,146 @@ multiple_conns_to_the_same_in_port_have_different_conn_ids(void)
 }
 
 
+DEFINE_TEST(precomputed_type_has_same_conn_ids);
+
+static void
+precomputed_type_has_same_conn_ids(void)
+{
+    struct sol_flow_node *flow, *first_out, *second_out, *node_in;
+    struct sol_flow_node_type *type;
+    static const struct sol_flow_static_node_spec nodes[] = {
+        [0] = { .type = &test_node_type, .name = "first node out" },
+        [1] = { .type = &test_node_type, .name = "second node out" },
+        [2] = { .type = &test_node_type, .name = "node in" },
+        SOL_FLOW_STATIC_NODE_SPEC_GUARD
+    };
+    static const struct sol_flow_static_conn_spec conns[] = {
+        { 0, 0, 2, 0 },
+        { 0, 1, 2, 0 },
+        { 1, 0, 2, 0 },
+        SOL_FLOW_STATIC_CONN_SPEC_GUARD
+    };
+    static const struct sol_flow_static_port_spec exported_in[] = {
+        { 2, 0 },
+        SOL_FLOW_STATIC_PORT_SPEC_GUARD
+    };
+    static const struct sol_flow_static_spec spec = {
+        .api_version = SOL_FLOW_STATIC_API_VERSION,
+        .nodes = nodes,
+        .conns = conns,
+        .exported_in = exported_in,
+    };
+    static const struct sol_flow_static_node_info node_infos[] = {
+        { 0, 4, 4 },
+        { 2, 4, 4 },
+        { 0, 4, 4 },
+    };
+    static const struct sol_flow_static_conn_info conn_infos[] = {
+        { 0, 0 },
+        { 0, 1 },
+        { 0, 2 },
+    };
+    static const uint16_t exported_in_base_conn_ids[] = { 3 };
+    static const struct sol_flow_static_precomputed precomputed = {
+        .api_version = SOL_FLOW_STATIC_PRECOMPUTED_API_VERSION,
+        .node_count = 3,
+        .conn_count = 3,
+        .node_infos = node_infos,
+        .conn_infos = conn_infos,
+        .exported_in_base_conn_ids = exported_in_base_conn_ids,
+    };
+
+    type = sol_flow_static_new_type_precomputed(&spec, &precomputed);
+    ASSERT(type);
+
+    flow = sol_flow_node_new(NULL, NULL, type, NULL);
+    ASSERT(flow);
+    first_out = sol_flow_static_get_node(flow, 0);
+    second_out = sol_flow_static_get_node(flow, 1);
+    node_in = sol_flow_static_get_node(flow, 2);
+
+    ASSERT_EVENT_WITH_ID_COUNT(node_in, EVENT_PORT_IN_CONNECT, 0, 1);
+    ASSERT_EVENT_WITH_ID_COUNT(node_in, EVENT_PORT_IN_CONNECT, 1, 1);
+    ASSERT_EVENT_WITH_ID_COUNT(node_in, EVENT_PORT_IN_CONNECT, 2, 1);
+    ASSERT_EVENT_WITH_ID_COUNT(first_out, EVENT_PORT_OUT_CONNECT, 0, 2);
+    ASSERT_EVENT_WITH_ID_COUNT(second_out, EVENT_PORT_OUT_CONNECT, 0, 1);
+
+    sol_flow_send_empty_packet(first_out, 1);
+    ASSERT_EVENT_WITH_ID_COUNT(node_in, EVENT_PORT_PROCESS, 0, 0);
+    ASSERT_EVENT_WITH_ID_COUNT(node_in, EVENT_PORT_PROCESS, 1, 1);
+
+    sol_flow_send_empty_packet(second_out, 0);
+    ASSERT_EVENT_WITH_ID_COUNT(node_in, EVENT_PORT_PROCESS, 2, 1);
+
+    sol_flow_node_del(flow);
+    sol_flow_node_type_del(type);
+}
+
+
+DEFINE_TEST(precomputed_type_must_match_spec);
+
+static void
+precomputed_type_must_match_spec(void)
+{
+    struct sol_flow_node_type *type;
+    static const struct sol_flow_static_node_spec nodes[] = {
+        [0] = { .type = &test_node_type },
+        [1] = { .type = &test_node_type },
+        SOL_FLOW_STATIC_NODE_SPEC_GUARD
+    };
+    static const struct sol_flow_static_conn_spec conns[] = {
+        { 0, 0, 1, 0 },
+        SOL_FLOW_STATIC_CONN_SPEC_GUARD
+    };
+    static const struct sol_flow_static_spec spec = {
+        .api_version = SOL_FLOW_STATIC_API_VERSION,
+        .nodes = nodes,
+        .conns = conns,
+    };
+    static const struct sol_flow_static_node_info node_infos[] = {
+        { 0, 4, 4 },
+        { 0, 4, 4 },
+    };
+    static const struct sol_flow_static_node_info wrong_ports_node_infos[] = {
+        { 0, 4, 4 },
+        { 0, 1, 1 },
+    };
+    static const struct sol_flow_static_conn_info conn_infos[] = {
+        { 0, 0 },
+    };
+    struct sol_flow_static_precomputed precomputed = {
+        .api_version = SOL_FLOW_STATIC_PRECOMPUTED_API_VERSION,
+        .node_count = 2,
+        .conn_count = 1,
+        .node_infos = node_infos,
+        .conn_infos = conn_infos,
+    };
+
+    type = sol_flow_static_new_type_precomputed(&spec, &precomputed);
+    ASSERT(type);
+    sol_flow_node_type_del(type);
+
+    precomputed.node_count = 1;
+    type = sol_flow_static_new_type_precomputed(&spec, &precomputed);
+    ASSERT(!type);
+    precomputed.node_count = 2;
+
+    precomputed.conn_count = 0;
+    type = sol_flow_static_new_type_precomputed(&spec, &precomputed);
+    ASSERT(!type);
+    precomputed.conn_count = 1;
+
+    precomputed.node_infos = wrong_ports_node_infos;
+    type = sol_flow_static_new_type_precomputed(&spec, &precomputed);
+    ASSERT(!type);
+    precomputed.node_infos = node_infos;
+
+    precomputed.api_version = SOL_FLOW_STATIC_PRECOMPUTED_API_VERSION + 1;
+    type = sol_flow_static_new_type_precomputed(&spec, &precomputed);
+    ASSERT(!type);
+}
+
+
 DEFINE_TEST(create_multiple_nodes_from_same_flow);
 
 static void
@@ -1146,6 +1288,150 @@ send_packets_match_packet_types(void)
 }
 
 
+DEFINE_TEST(update_keeps_unchanged_nodes);
+
+static void
+update_keeps_unchanged_nodes(void)
+{
+    struct sol_flow_node *flow, *a, *b, *c, *d;
+    struct sol_flow_node_type *new_type;
+    static const struct sol_flow_static_node_spec nodes[] = {
+        [0] = { .type = &test_node_type, .name = "a" },
+        [1] = { .type = &test_node_type, .name = "b" },
+        [2] = { .type = &test_node_type, .name = "c" },
+        SOL_FLOW_STATIC_NODE_SPEC_GUARD
+    };
+    static const struct sol_flow_static_conn_spec conns[] = {
+        { .src = 0, .src_port = 0, .dst = 1, .dst_port = 0 },
+        { .src = 1, .src_port = 0, .dst = 2, .dst_port = 0 },
+        SOL_FLOW_STATIC_CONN_SPEC_GUARD
+    };
+    static const struct sol_flow_static_node_spec new_nodes[] = {
+        [0] = { .type = &test_node_type, .name = "d" },
+        [1] = { .type = &test_node_type, .name = "a" },
+        [2] = { .type = &test_node_type, .name = "b" },
+        SOL_FLOW_STATIC_NODE_SPEC_GUARD
+    };
+    static const struct sol_flow_static_conn_spec new_conns[] = {
+        { .src = 0, .src_port = 0, .dst = 1, .dst_port = 1 },
+        { .src = 1, .src_port = 0, .dst = 2, .dst_port = 0 },
+        { .src = 2, .src_port = 0, .dst = 0, .dst_port = 0 },
+        SOL_FLOW_STATIC_CONN_SPEC_GUARD
+    };
+    static const struct sol_flow_static_spec new_spec = {
+        .api_version = SOL_FLOW_STATIC_API_VERSION,
+        .nodes = new_nodes,
+        .conns = new_conns,
+    };
+
+    new_type = sol_flow_static_new_type(&new_spec);
+    ASSERT(new_type);
+
+    /* The type is owned by the flow, the update deletes it. */
+    flow = sol_flow_static_new(NULL, nodes, conns);
+    ASSERT(flow);
+    a = sol_flow_static_get_node(flow, 0);
+    b = sol_flow_static_get_node(flow, 1);
+    c = sol_flow_static_get_node(flow, 2);
+
+    /* Still queued when updating, delivered through the new connection. */
+    ASSERT_INT_EQ(sol_flow_send_empty_packet(b, 0), 0);
+
+    ASSERT_INT_EQ(sol_flow_static_update(flow, new_type), 0);
+    ASSERT(sol_flow_node_get_type(flow) == new_type);
+
+    ASSERT(sol_flow_static_get_node(flow, 1) == a);
+    ASSERT(sol_flow_static_get_node(flow, 2) == b);
+    d = sol_flow_static_get_node(flow, 0);
+    ASSERT(d && d != c);
+
+    ASSERT_EVENT_COUNT(a, EVENT_NODE_OPEN, 1);
+    ASSERT_EVENT_COUNT(a, EVENT_NODE_CLOSE, 0);
+    ASSERT_EVENT_COUNT(a, EVENT_PORT_OUT_CONNECT, 1);
+    ASSERT_EVENT_COUNT(a, EVENT_PORT_OUT_DISCONNECT, 0);
+    ASSERT_EVENT_WITH_ID_COUNT(a, EVENT_PORT_IN_CONNECT, 0, 1);
+
+    ASSERT_EVENT_COUNT(b, EVENT_NODE_CLOSE, 0);
+    ASSERT_EVENT_COUNT(b, EVENT_PORT_IN_CONNECT, 1);
+    ASSERT_EVENT_COUNT(b, EVENT_PORT_IN_DISCONNECT, 0);
+    ASSERT_EVENT_COUNT(b, EVENT_PORT_OUT_CONNECT, 2);
+    ASSERT_EVENT_COUNT(b, EVENT_PORT_OUT_DISCONNECT, 1);
+
+    ASSERT_EVENT_COUNT(c, EVENT_PORT_IN_DISCONNECT, 1);
+    ASSERT_EVENT_COUNT(c, EVENT_NODE_CLOSE, 1);
+    ASSERT_EVENT_COUNT(c, EVENT_PORT_PROCESS, 0);
+
+    ASSERT_EVENT_COUNT(d, EVENT_NODE_OPEN, 1);
+    ASSERT_EVENT_COUNT(d, EVENT_PORT_IN_CONNECT, 1);
+    ASSERT_EVENT_COUNT(d, EVENT_PORT_OUT_CONNECT, 1);
+    ASSERT_EVENT_COUNT(d, EVENT_PORT_PROCESS, 1);
+
+    sol_flow_send_empty_packet(a, 0);
+    ASSERT_EVENT_COUNT(b, EVENT_PORT_PROCESS, 1);
+    sol_flow_send_empty_packet(d, 0);
+    ASSERT_EVENT_COUNT(a, EVENT_PORT_PROCESS, 1);
+
+    sol_flow_node_del(flow);
+    ASSERT_EVENT_COUNT(a, EVENT_NODE_CLOSE, 1);
+    ASSERT_EVENT_COUNT(b, EVENT_NODE_CLOSE, 1);
+    ASSERT_EVENT_COUNT(d, EVENT_NODE_CLOSE, 1);
+
+    sol_flow_node_type_del(new_type);
+}
+
+DEFINE_TEST(update_needs_same_exported_ports_with_parent);
+
+static void
+update_needs_same_exported_ports_with_parent(void)
+{
+    struct sol_flow_node *flow, *child;
+    struct sol_flow_node_type *type, *new_type;
+    static const struct sol_flow_static_node_spec new_nodes[] = {
+        [0] = { .type = &test_node_type },
+        [1] = { .type = &test_node_type },
+        SOL_FLOW_STATIC_NODE_SPEC_GUARD
+    };
+    static const struct sol_flow_static_conn_spec new_conns[] = {
+        SOL_FLOW_STATIC_CONN_SPEC_GUARD
+    };
+    static const struct sol_flow_static_spec new_spec = {
+        .api_version = SOL_FLOW_STATIC_API_VERSION,
+        .nodes = new_nodes,
+        .conns = new_conns,
+    };
+    struct sol_flow_static_node_spec nodes[] = {
+        [0] = { .type = NULL, .name = "child" },
+        SOL_FLOW_STATIC_NODE_SPEC_GUARD
+    };
+    static const struct sol_flow_static_conn_spec conns[] = {
+        SOL_FLOW_STATIC_CONN_SPEC_GUARD
+    };
+
+    type = test_flow_new_type();
+    new_type = sol_flow_static_new_type(&new_spec);
+    ASSERT(type && new_type);
+
+    nodes[0].type = type;
+    flow = sol_flow_static_new(NULL, nodes, conns);
+    ASSERT(flow);
+    child = sol_flow_static_get_node(flow, 0);
+
+    ASSERT_INT_EQ(sol_flow_static_update(child, new_type), -ENOTSUP);
+    ASSERT(sol_flow_node_get_type(child) == type);
+
+    sol_flow_node_del(flow);
+
+    /* Without a parent, nobody is connected to the exported ports. */
+    flow = sol_flow_node_new(NULL, NULL, type, NULL);
+    ASSERT(flow);
+    ASSERT_INT_EQ(sol_flow_static_update(flow, new_type), 0);
+    sol_flow_node_del(flow);
+
+    test_flow_del_type(new_type);
+    test_flow_del_type(type);
+}
+
+
 DEFINE_TEST(node_options_from_strv);
 
 static void
@@ -1320,5 +1606,60 @@ need_a_valid_type_to_create_packets(void)
     ASSERT(!packet_invalid_type);
 }
 
+DEFINE_TEST(string_slice_packets);
+
+static void
+string_slice_packets(void)
+{
+    static const char text[] = "first\0second,third";
+    struct sol_flow_packet *packet;
+    struct sol_str_slice slice;
+    struct sol_blob *blob, *parent;
+    const char *str;
+
+    blob = sol_blob_new(SOL_BLOB_TYPE_NOFREE, NULL, text, sizeof(text));
+    ASSERT(blob);
+
+    /* NUL terminated inside the blob: shares its memory */
+    packet = sol_flow_packet_new_string_slice(blob, SOL_STR_SLICE_STR(text, 5));
+    ASSERT(packet);
+    ASSERT_INT_EQ(blob->refcnt, 2);
+    ASSERT_INT_EQ(sol_flow_packet_get_string(packet, &str), 0);
+    ASSERT(str == text);
+    ASSERT_INT_EQ(sol_flow_packet_get_string_slice(packet, &slice, &parent), 0);
+    ASSERT(parent == blob);
+    ASSERT_INT_EQ(slice.len, 5);
+    sol_flow_packet_del(packet);
+    ASSERT_INT_EQ(blob->refcnt, 1);
+
+    /* not terminated: copied */
+    packet = sol_flow_packet_new_string_slice(blob, SOL_STR_SLICE_STR(text + 6, 6));
+    ASSERT(packet);
+    ASSERT_INT_EQ(blob->refcnt, 1);
+    ASSERT_INT_EQ(sol_flow_packet_get_string_slice(packet, &slice, &parent), 0);
+    ASSERT(!parent);
+    ASSERT(slice.data != text + 6);
+    ASSERT(sol_str_slice_str_eq(slice, "second"));
+    ASSERT_INT_EQ(sol_flow_packet_get_string(packet, &str), 0);
+    ASSERT(streq(str, "second"));
+    sol_flow_packet_del(packet);
+
+    /* last string, terminated by the blob's last byte */
+    packet = sol_flow_packet_new_string_slice(blob, SOL_STR_SLICE_STR(text + 6, 12));
+    ASSERT(packet);
+    ASSERT_INT_EQ(blob->refcnt, 2);
+    sol_flow_packet_del(packet);
+
+    sol_blob_unref(blob);
+
+    /* regular strings carry their length too */
+    packet = sol_flow_packet_new_string("regular");
+    ASSERT(packet);
+    ASSERT_INT_EQ(sol_flow_packet_get_string_slice(packet, &slice, &parent), 0);
+    ASSERT(!parent);
+    ASSERT(sol_str_slice_str_eq(slice, "regular"));
+    sol_flow_packet_del(packet);
+}
+
 
 TEST_MAIN_WITH_RESET_FUNC(clear_events);
@@ -0,0 +1,390 @@
+/*
+ * This file is part of the Soletta Project
+ *
+ * Copyright (C) 2015 Intel Corporation. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above copyright
+ *     notice, this list of conditions and the following disclaimer in
+ *     the documentation and/or other materials provided with the
+ *     distribution.
+ *   * Neither the name of Intel Corporation nor the names of its
+ *     contributors may be used to endorse or promote products derived
+ *     from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ * OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+#include <dirent.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include "sol-mainloop.h"
+#include "sol-util.h"
+
+#include "fs-persist-store.h"
+
+#include "test.h"
+
+/* magic, record header and key */
+#define LOG_HEADER_SIZE 8
+#define RECORD_SIZE(key, len) (12 + strlen(key) + (len))
+
+static char dir[] = "/tmp/test-fs-persist-store-XXXXXX";
+static char path[sizeof(dir) + 16];
+
+static void
+setup(const char *name)
+{
+    ASSERT(mkdtemp(dir));
+    snprintf(path, sizeof(path), "%s/%s", dir, name);
+}
+
+/* Also checks no temporary file was left behind. */
+static void
+teardown(void)
+{
+    struct dirent *de;
+    DIR *d;
+
+    d = opendir(dir);
+    ASSERT(d);
+    while ((de = readdir(d))) {
+        if (de->d_name[0] == '.')
+            continue;
+        ASSERT(streq(de->d_name, strrchr(path, '/') + 1));
+    }
+    closedir(d);
+
+    unlink(path);
+    ASSERT_INT_EQ(rmdir(dir), 0);
+    strcpy(dir + strlen(dir) - 6, "XXXXXX");
+}
+
+static off_t
+file_size(void)
+{
+    struct stat st;
+
+    if (stat(path, &st) < 0)
+        return -1;
+    return st.st_size;
+}
+
+static bool
+on_timeout_quit(void *data)
+{
+    sol_quit();
+    return false;
+}
+
+static void
+run_loop(unsigned int ms)
+{
+    ASSERT(sol_timeout_add(ms, on_timeout_quit, NULL));
+    sol_run();
+}
+
+static void
+check_value(struct fs_persist_value *value, const char *expected)
+{
+    struct sol_str_slice slice = fs_persist_value_get(value);
+
+    ASSERT(sol_str_slice_str_eq(slice, expected));
+}
+
+DEFINE_TEST(test_single_value_file);
+
+static void
+test_single_value_file(void)
+{
+    struct fs_persist_value *value, *other;
+
+    setup("value");
+
+    value = fs_persist_value_new(path, NULL, 0, 0);
+    ASSERT(value);
+    ASSERT_INT_EQ(fs_persist_value_get(value).len, 0);
+
+    /* changes in the same main loop iteration are written once */
+    ASSERT_INT_EQ(fs_persist_value_set(value, "first", 5), 0);
+    ASSERT_INT_EQ(fs_persist_value_set(value, "second", 6), 0);
+    ASSERT_INT_EQ(file_size(), -1);
+    run_loop(10);
+    ASSERT_INT_EQ(file_size(), 6);
+
+    /* users of the same file share the value */
+    other = fs_persist_value_new(path, NULL, 0, 0);
+    ASSERT(other == value);
+    fs_persist_value_del(other);
+    fs_persist_value_del(value);
+
+    /* written when its last user is gone */
+    value = fs_persist_value_new(path, NULL, 100000, 100000);
+    ASSERT(value);
+    check_value(value, "second");
+    ASSERT_INT_EQ(fs_persist_value_set(value, "third", 5), 0);
+    run_loop(10);
+    ASSERT_INT_EQ(file_size(), 6);
+    fs_persist_value_del(value);
+    ASSERT_INT_EQ(file_size(), 5);
+
+    value = fs_persist_value_new(path, NULL, 0, 0);
+    ASSERT(value);
+    check_value(value, "third");
+
+    /* a file can't be a store too */
+    ASSERT(!fs_persist_value_new(path, "key", 0, 0));
+
+    fs_persist_value_del(value);
+    teardown();
+}
+
+DEFINE_TEST(test_failed_write);
+
+static void
+test_failed_write(void)
+{
+    struct fs_persist_value *value;
+
+    setup("value");
+
+    value = fs_persist_value_new(path, NULL, 0, 0);
+    ASSERT(value);
+
+    /* the file can't be replaced while it's a directory */
+    ASSERT_INT_EQ(mkdir(path, 0755), 0);
+    ASSERT_INT_EQ(fs_persist_value_set(value, "kept", 4), 0);
+    run_loop(10);
+    check_value(value, "kept");
+
+    /* changes meanwhile wait for the retry */
+    ASSERT_INT_EQ(fs_persist_value_set(value, "newer", 5), 0);
+    run_loop(10);
+
+    /* written again, without a new change */
+    ASSERT_INT_EQ(rmdir(path), 0);
+    run_loop(500);
+    ASSERT_INT_EQ(file_size(), 5);
+
+    fs_persist_value_del(value);
+    value = fs_persist_value_new(path, NULL, 0, 0);
+    ASSERT(value);
+    check_value(value, "newer");
+
+    fs_persist_value_del(value);
+    teardown();
+}
+
+DEFINE_TEST(test_flush_interval);
+
+static void
+test_flush_interval(void)
+{
+    struct fs_persist_value *value;
+    int i, r;
+
+    setup("value");
+
+    /* keeps changing, written when it gets too stale */
+    value = fs_persist_value_new(path, NULL, 50, 200);
+    ASSERT(value);
+    for (i = 0; i < 10; i++) {
+        r = fs_persist_value_set(value, "ab", (i & 1) + 1);
+        ASSERT_INT_EQ(r, 0);
+        run_loop(30);
+        if (i < 5)
+            ASSERT_INT_EQ(file_size(), -1);
+    }
+    ASSERT(file_size() > 0);
+
+    /* written flush_interval after the last change */
+    ASSERT_INT_EQ(fs_persist_value_set(value, "abc", 3), 0);
+    run_loop(20);
+    ASSERT(file_size() != 3);
+    run_loop(60);
+    ASSERT_INT_EQ(file_size(), 3);
+
+    fs_persist_value_del(value);
+    teardown();
+}
+
+DEFINE_TEST(test_shutdown);
+
+static void
+test_shutdown(void)
+{
+    struct fs_persist_value *value;
+    int status;
+    pid_t pid;
+
+    setup("value");
+
+    /* written by sol_shutdown(), even if its user is still there; a
+     * child shuts down so this process keeps running */
+    value = fs_persist_value_new(path, NULL, 100000, 100000);
+    ASSERT(value);
+    ASSERT_INT_EQ(fs_persist_value_set(value, "last", 4), 0);
+    ASSERT_INT_EQ(file_size(), -1);
+    pid = fork();
+    ASSERT(pid >= 0);
+    if (pid == 0) {
+        sol_shutdown();
+        _exit(0);
+    }
+    ASSERT(waitpid(pid, &status, 0) == pid);
+    ASSERT(WIFEXITED(status) && WEXITSTATUS(status) == 0);
+    ASSERT_INT_EQ(file_size(), 4);
+
+    fs_persist_value_del(value);
+    value = fs_persist_value_new(path, NULL, 0, 0);
+    ASSERT(value);
+    check_value(value, "last");
+
+    fs_persist_value_del(value);
+    teardown();
+}
+
+DEFINE_TEST(test_store);
+
+static void
+test_store(void)
+{
+    struct fs_persist_value *a, *b;
+    char buf[64];
+    int i, fd;
+
+    setup("store");
+
+    a = fs_persist_value_new(path, "a", 0, 0);
+    b = fs_persist_value_new(path, "b", 0, 0);
+    ASSERT(a && b);
+
+    /* values changed together are written together */
+    for (i = 0; i < 100; i++) {
+        snprintf(buf, sizeof(buf), "%d", i);
+        ASSERT_INT_EQ(fs_persist_value_set(a, buf, strlen(buf)), 0);
+        ASSERT_INT_EQ(fs_persist_value_set(b, buf, strlen(buf)), 0);
+    }
+    run_loop(10);
+    ASSERT_INT_EQ(file_size(), LOG_HEADER_SIZE + 2 * RECORD_SIZE("a", 2));
+
+    /* an unchanged value isn't written again */
+    ASSERT_INT_EQ(fs_persist_value_set(a, "99", 2), 0);
+    ASSERT_INT_EQ(fs_persist_value_set(b, "last", 4), 0);
+    run_loop(10);
+    ASSERT_INT_EQ(file_size(),
+        LOG_HEADER_SIZE + 2 * RECORD_SIZE("a", 2) + RECORD_SIZE("b", 4));
+
+    fs_persist_value_del(a);
+    fs_persist_value_del(b);
+
+    /* a torn record at the end is dropped */
+    fd = open(path, O_WRONLY | O_APPEND);
+    ASSERT(fd >= 0);
+    ASSERT(write(fd, "\1\2\3\4\5\6\7\10\11\12\13\14\15", 13) == 13);
+    close(fd);
+
+    b = fs_persist_value_new(path, "b", 0, 0);
+    a = fs_persist_value_new(path, "a", 0, 0);
+    ASSERT(a && b);
+    check_value(a, "99");
+    check_value(b, "last");
+    ASSERT_INT_EQ(file_size(),
+        LOG_HEADER_SIZE + 2 * RECORD_SIZE("a", 2) + RECORD_SIZE("b", 4));
+
+    /* values whose users are gone are kept */
+    fs_persist_value_del(b);
+    ASSERT_INT_EQ(fs_persist_value_set(a, "new", 3), 0);
+    fs_persist_value_del(a);
+    b = fs_persist_value_new(path, "b", 0, 0);
+    a = fs_persist_value_new(path, "a", 0, 0);
+    check_value(a, "new");
+    check_value(b, "last");
+    fs_persist_value_del(a);
+    fs_persist_value_del(b);
+
+    teardown();
+}
+
+DEFINE_TEST(test_store_compaction);
+
+static void
+test_store_compaction(void)
+{
+    struct fs_persist_value *a, *b;
+    char buf[200];
+    int i;
+
+    setup("store");
+
+    a = fs_persist_value_new(path, "a", 0, 0);
+    b = fs_persist_value_new(path, "b", 0, 0);
+    ASSERT(a && b);
+    ASSERT_INT_EQ(fs_persist_value_set(b, "kept", 4), 0);
+
+    for (i = 0; i < 300; i++) {
+        memset(buf, 'a' + i % 26, sizeof(buf));
+        ASSERT_INT_EQ(fs_persist_value_set(a, buf, sizeof(buf)), 0);
+        run_loop(1);
+        /* without compaction it would be 300 records */
+        ASSERT(file_size() <= 2 * 16 * 1024);
+    }
+    fs_persist_value_del(a);
+    fs_persist_value_del(b);
+
+    a = fs_persist_value_new(path, "a", 0, 0);
+    b = fs_persist_value_new(path, "b", 0, 0);
+    ASSERT(a && b);
+    ASSERT(memcmp(fs_persist_value_get(a).data, buf, sizeof(buf)) == 0);
+    check_value(b, "kept");
+    fs_persist_value_del(a);
+    fs_persist_value_del(b);
+
+    teardown();
+}
+
+DEFINE_TEST(test_not_a_store);
+
+static void
+test_not_a_store(void)
+{
+    int fd;
+
+    setup("store");
+
+    fd = open(path, O_WRONLY | O_CREAT, 0644);
+    ASSERT(fd >= 0);
+    ASSERT(write(fd, "something else", 14) == 14);
+    close(fd);
+
+    ASSERT(!fs_persist_value_new(path, "a", 0, 0));
+    ASSERT_INT_EQ(file_size(), 14);
+    ASSERT(!fs_persist_value_new(path, "", 0, 0));
+
+    teardown();
+}
+
+
+TEST_MAIN();
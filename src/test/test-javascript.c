@@ -34,8 +34,11 @@
 
 #include "sol-flow.h"
 #include "sol-flow-js.h"
+#include "sol-flow-static.h"
 #include "sol-log.h"
+#include "sol-mainloop.h"
 #include "sol-util.h"
+#include "sol-vector.h"
 
 #include "test.h"
 
@@ -79,9 +82,285 @@ test_js(void)
     JS_ASSERT_TRUE("var node = { in: [{ name: 'IN', type: 'rgb', process: function() { print('process'); }} ]};");
     JS_ASSERT_TRUE("var node = { out: [{ name: 'OUT', type: 'string', connect: function() { print('connect'); }} ]};");
 
+    /* value only ports */
+    JS_ASSERT_TRUE("var node = { in: [{ name: 'IN', type: 'int', valueOnly: true, process: function(v) { print(v); }} ]};");
+    JS_ASSERT_TRUE("var node = { in: [{ name: 'IN', type: 'string', valueOnly: true }]};");
+
     /* properties on node variable */
     JS_ASSERT_TRUE("var node = { in: [{ name: 'IN', type: 'rgb', process: function() { print('process'); }} ], property_1:123 };");
 }
 
+/* Javascript nodes are tested inside a static flow, fed by a source
+ * node with an int and a float output ports, with their packets
+ * collected by a sink node with two int input ports. */
+struct received_packet {
+    uint16_t port;
+    int32_t value;
+};
+
+static struct sol_flow_node *test_source;
+static struct sol_vector test_received = SOL_VECTOR_INIT(struct received_packet);
+
+static int
+source_open(struct sol_flow_node *node, void *data, const struct sol_flow_node_options *options)
+{
+    test_source = node;
+    return 0;
+}
+
+static int
+sink_process(struct sol_flow_node *node, void *data, uint16_t port, uint16_t conn_id, const struct sol_flow_packet *packet)
+{
+    struct received_packet *p;
+
+    p = sol_vector_append(&test_received);
+    ASSERT(p);
+    p->port = port;
+    ASSERT_INT_EQ(sol_flow_packet_get_irange_value(packet, &p->value), 0);
+    return 0;
+}
+
+static struct sol_flow_port_type_out source_int_port = {
+    .api_version = SOL_FLOW_PORT_TYPE_OUT_API_VERSION,
+    .packet_type = NULL, /* placeholder for SOL_FLOW_PACKET_TYPE_IRANGE */
+};
+
+static struct sol_flow_port_type_out source_float_port = {
+    .api_version = SOL_FLOW_PORT_TYPE_OUT_API_VERSION,
+    .packet_type = NULL, /* placeholder for SOL_FLOW_PACKET_TYPE_DRANGE */
+};
+
+static struct sol_flow_port_type_in sink_port = {
+    .api_version = SOL_FLOW_PORT_TYPE_IN_API_VERSION,
+    .packet_type = NULL, /* placeholder for SOL_FLOW_PACKET_TYPE_IRANGE */
+    .process = sink_process,
+};
+
+static void
+init_port_packet_types(void)
+{
+    if (source_int_port.packet_type)
+        return;
+
+    source_int_port.packet_type = SOL_FLOW_PACKET_TYPE_IRANGE;
+    source_float_port.packet_type = SOL_FLOW_PACKET_TYPE_DRANGE;
+    sink_port.packet_type = SOL_FLOW_PACKET_TYPE_IRANGE;
+}
+
+static void
+source_get_ports_counts(const struct sol_flow_node_type *type, uint16_t *ports_in_count, uint16_t *ports_out_count)
+{
+    init_port_packet_types();
+    if (ports_in_count)
+        *ports_in_count = 0;
+    if (ports_out_count)
+        *ports_out_count = 2;
+}
+
+static const struct sol_flow_port_type_out *
+source_get_port_out(const struct sol_flow_node_type *type, uint16_t port)
+{
+    return port == 0 ? &source_int_port : &source_float_port;
+}
+
+static void
+sink_get_ports_counts(const struct sol_flow_node_type *type, uint16_t *ports_in_count, uint16_t *ports_out_count)
+{
+    init_port_packet_types();
+    if (ports_in_count)
+        *ports_in_count = 2;
+    if (ports_out_count)
+        *ports_out_count = 0;
+}
+
+static const struct sol_flow_port_type_in *
+sink_get_port_in(const struct sol_flow_node_type *type, uint16_t port)
+{
+    return &sink_port;
+}
+
+static const struct sol_flow_node_type source_node_type = {
+    .api_version = SOL_FLOW_NODE_TYPE_API_VERSION,
+    .open = source_open,
+    .get_ports_counts = source_get_ports_counts,
+    .get_port_out = source_get_port_out,
+};
+
+static const struct sol_flow_node_type sink_node_type = {
+    .api_version = SOL_FLOW_NODE_TYPE_API_VERSION,
+    .get_ports_counts = sink_get_ports_counts,
+    .get_port_in = sink_get_port_in,
+};
+
+static bool
+quit_loop(void *data)
+{
+    sol_quit();
+    return false;
+}
+
+static void
+wait_received(uint16_t count)
+{
+    unsigned int i;
+
+    /* Static flows deliver packets from the main loop. */
+    for (i = 0; i < 100 && test_received.len < count; i++) {
+        sol_timeout_add(1, quit_loop, NULL);
+        sol_run();
+    }
+    ASSERT_INT_EQ(test_received.len, count);
+}
+
+static void
+clear_received(void)
+{
+    sol_vector_clear(&test_received);
+    test_source = NULL;
+}
+
+DEFINE_TEST(nodes_of_a_type_have_own_globals);
+
+static void
+nodes_of_a_type_have_own_globals(void)
+{
+    static const char script[] =
+        "var count = 0;"
+        "var node = {"
+        "    in: [{ name: 'IN', type: 'int', process: function(v) { count += v.val; sendPacket('OUT', count); } }],"
+        "    out: [{ name: 'OUT', type: 'int' }]"
+        "};";
+    static struct sol_flow_static_node_spec nodes[] = {
+        { .type = &source_node_type, .name = "source" },
+        { .name = "a" },
+        { .name = "b" },
+        { .type = &sink_node_type, .name = "sink" },
+        SOL_FLOW_STATIC_NODE_SPEC_GUARD
+    };
+    static const struct sol_flow_static_conn_spec conns[] = {
+        { .src = 0, .src_port = 0, .dst = 1, .dst_port = 0 },
+        { .src = 0, .src_port = 0, .dst = 2, .dst_port = 0 },
+        { .src = 1, .src_port = 0, .dst = 3, .dst_port = 0 },
+        { .src = 2, .src_port = 0, .dst = 3, .dst_port = 1 },
+        SOL_FLOW_STATIC_CONN_SPEC_GUARD
+    };
+    static const struct sol_flow_static_spec spec = {
+        .api_version = SOL_FLOW_STATIC_API_VERSION,
+        .nodes = nodes,
+        .conns = conns,
+    };
+    struct sol_flow_node_type *js_type, *flow_type;
+    struct sol_flow_node *flow;
+    struct received_packet *p;
+    int32_t a_sum = 0, b_sum = 0;
+    uint16_t i;
+
+    js_type = sol_flow_js_new_type(script, strlen(script));
+    ASSERT(js_type);
+    nodes[1].type = js_type;
+    nodes[2].type = js_type;
+    flow_type = sol_flow_static_new_type(&spec);
+    ASSERT(flow_type);
+
+    flow = sol_flow_node_new(NULL, "flow", flow_type, NULL);
+    ASSERT(flow);
+    ASSERT(test_source);
+
+    /* Both nodes get every packet, each one adds them to its own
+     * 'count', even if the type shares a heap between them. */
+    ASSERT_INT_EQ(sol_flow_send_irange_value_packet(test_source, 0, 1), 0);
+    ASSERT_INT_EQ(sol_flow_send_irange_value_packet(test_source, 0, 10), 0);
+    wait_received(4);
+
+    SOL_VECTOR_FOREACH_IDX (&test_received, p, i) {
+        if (p->port == 0)
+            a_sum = p->value;
+        else
+            b_sum = p->value;
+    }
+    ASSERT_INT_EQ(a_sum, 11);
+    ASSERT_INT_EQ(b_sum, 11);
+
+    sol_flow_node_del(flow);
+    sol_flow_node_type_del(flow_type);
+    sol_flow_node_type_del(js_type);
+}
+
+DEFINE_TEST(value_only_ports_get_numbers);
+
+static void
+value_only_ports_get_numbers(void)
+{
+    /* 'INT' and 'FLOAT' get plain numbers, 'RANGE' gets the whole
+     * range object. Anything else is reported as -1. */
+    static const char script[] =
+        "var node = {"
+        "    in: [{ name: 'INT', type: 'int', valueOnly: true,"
+        "           process: function(v) { sendPacket('OUT', typeof v === 'number' ? v : -1); } },"
+        "         { name: 'FLOAT', type: 'float', valueOnly: true,"
+        "           process: function(v) { sendPacket('OUT', typeof v === 'number' ? Math.round(v * 10) : -1); } },"
+        "         { name: 'RANGE', type: 'int',"
+        "           process: function(v) { sendPacket('OUT', typeof v === 'object' ? v.val + v.max : -1); } }],"
+        "    out: [{ name: 'OUT', type: 'int' }]"
+        "};";
+    static struct sol_flow_static_node_spec nodes[] = {
+        { .type = &source_node_type, .name = "source" },
+        { .name = "js" },
+        { .type = &sink_node_type, .name = "sink" },
+        SOL_FLOW_STATIC_NODE_SPEC_GUARD
+    };
+    static const struct sol_flow_static_conn_spec conns[] = {
+        { .src = 0, .src_port = 0, .dst = 1, .dst_port = 0 },
+        { .src = 0, .src_port = 0, .dst = 1, .dst_port = 2 },
+        { .src = 0, .src_port = 1, .dst = 1, .dst_port = 1 },
+        { .src = 1, .src_port = 0, .dst = 2, .dst_port = 0 },
+        SOL_FLOW_STATIC_CONN_SPEC_GUARD
+    };
+    static const struct sol_flow_static_spec spec = {
+        .api_version = SOL_FLOW_STATIC_API_VERSION,
+        .nodes = nodes,
+        .conns = conns,
+    };
+    struct sol_flow_node_type *js_type, *flow_type;
+    struct sol_flow_node *flow;
+    struct sol_irange range = { .val = 7, .min = 0, .max = 100, .step = 1 };
+    struct received_packet *p;
+    bool got_int = false, got_float = false, got_range = false;
+    uint16_t i;
+
+    js_type = sol_flow_js_new_type(script, strlen(script));
+    ASSERT(js_type);
+    nodes[1].type = js_type;
+    flow_type = sol_flow_static_new_type(&spec);
+    ASSERT(flow_type);
+
+    flow = sol_flow_node_new(NULL, "flow", flow_type, NULL);
+    ASSERT(flow);
+    ASSERT(test_source);
+
+    ASSERT_INT_EQ(sol_flow_send_irange_packet(test_source, 0, &range), 0);
+    ASSERT_INT_EQ(sol_flow_send_drange_value_packet(test_source, 1, 2.5), 0);
+    wait_received(3);
+
+    SOL_VECTOR_FOREACH_IDX (&test_received, p, i) {
+        if (p->value == 7)
+            got_int = true;
+        else if (p->value == 25)
+            got_float = true;
+        else if (p->value == 107)
+            got_range = true;
+        else {
+            SOL_ERR("Unexpected value %d on the sink", p->value);
+            FAIL();
+        }
+    }
+    ASSERT(got_int);
+    ASSERT(got_float);
+    ASSERT(got_range);
+
+    sol_flow_node_del(flow);
+    sol_flow_node_type_del(flow_type);
+    sol_flow_node_type_del(js_type);
+}
 
-TEST_MAIN();
+TEST_MAIN_WITH_RESET_FUNC(clear_received);
@@ -0,0 +1,315 @@
+/*
+ * This file is part of the Soletta Project
+ *
+ * Copyright (C) 2015 Intel Corporation. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above copyright
+ *     notice, this list of conditions and the following disclaimer in
+ *     the documentation and/or other materials provided with the
+ *     distribution.
+ *   * Neither the name of Intel Corporation nor the names of its
+ *     contributors may be used to endorse or promote products derived
+ *     from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ * OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <errno.h>
+#include <stdlib.h>
+
+#include "sol-mainloop.h"
+#include "sol-platform-linux-micro-boot.h"
+#include "sol-util.h"
+
+#include "test.h"
+
+/* Stub services: SYNC ones are done as soon as they start, ASYNC ones
+ * after their delay, FAIL ones fail to start and SILENT ones never
+ * inform their state. */
+enum stub_kind {
+    SYNC,
+    ASYNC,
+    FAIL,
+    SILENT
+};
+
+struct stub {
+    struct sol_platform_linux_micro_module module;
+    enum stub_kind kind;
+    unsigned int delay;
+};
+
+static const char *const b_after[] = { "a", NULL };
+static const char *const c_requires[] = { "d", NULL };
+static const char *const e_after[] = { "b", "c", NULL };
+static const char *const f_requires[] = { "missing", NULL };
+static const char *const h_requires[] = { "g", NULL };
+static const char *const x_after[] = { "y", NULL };
+static const char *const y_after[] = { "x", NULL };
+static const char *const o_requires[] = { "n", NULL };
+
+#define STUB_MODULE .api_version = SOL_PLATFORM_LINUX_MICRO_MODULE_API_VERSION
+
+static const struct stub stubs[] = {
+    { { STUB_MODULE, .name = "a" }, SYNC, 0 },
+    { { STUB_MODULE, .name = "b", .after = b_after }, ASYNC, 20 },
+    { { STUB_MODULE, .name = "c", .requires = c_requires }, SYNC, 0 },
+    { { STUB_MODULE, .name = "d" }, ASYNC, 50 },
+    { { STUB_MODULE, .name = "e", .after = e_after }, SYNC, 0 },
+    { { STUB_MODULE, .name = "f", .requires = f_requires }, SYNC, 0 },
+    { { STUB_MODULE, .name = "g" }, FAIL, 0 },
+    { { STUB_MODULE, .name = "h", .requires = h_requires }, SYNC, 0 },
+    { { STUB_MODULE, .name = "x", .after = x_after }, SYNC, 0 },
+    { { STUB_MODULE, .name = "y", .after = y_after }, SYNC, 0 },
+    { { STUB_MODULE, .name = "n" }, SILENT, 0 },
+    { { STUB_MODULE, .name = "o", .requires = o_requires }, SYNC, 0 },
+    /* version 1 modules have no dependencies, the lists are ignored */
+    { { .api_version = 1, .name = "v", .requires = f_requires }, SYNC, 0 },
+};
+
+static struct sol_platform_linux_micro_boot *boot;
+static char started[64];
+static unsigned int starting, max_starting;
+
+static const struct stub *
+find_stub(const char *service)
+{
+    unsigned int i;
+
+    for (i = 0; i < ARRAY_SIZE(stubs); i++) {
+        if (streq(stubs[i].module.name, service))
+            return stubs + i;
+    }
+
+    return NULL;
+}
+
+static const struct sol_platform_linux_micro_module *
+stub_find_module(void *data, const char *service)
+{
+    const struct stub *stub = find_stub(service);
+
+    return stub ? &stub->module : NULL;
+}
+
+static bool
+on_stub_ready(void *data)
+{
+    const struct stub *stub = data;
+
+    starting--;
+    sol_platform_linux_micro_boot_inform(boot, stub->module.name,
+        SOL_PLATFORM_SERVICE_STATE_ACTIVE);
+    if (sol_platform_linux_micro_boot_is_finished(boot))
+        sol_quit();
+    return false;
+}
+
+static int
+stub_start(void *data, const char *service)
+{
+    const struct stub *stub = find_stub(service);
+
+    strcat(started, service);
+
+    switch (stub->kind) {
+    case SYNC:
+        sol_platform_linux_micro_boot_inform(boot, service,
+            SOL_PLATFORM_SERVICE_STATE_ACTIVE);
+        return 0;
+    case ASYNC:
+        starting++;
+        if (starting > max_starting)
+            max_starting = starting;
+        sol_timeout_add(stub->delay, on_stub_ready, stub);
+        return 0;
+    case SILENT:
+        return 0;
+    default:
+        return -EIO;
+    }
+}
+
+static const struct sol_platform_linux_micro_boot_ops stub_ops = {
+    .find_module = stub_find_module,
+    .start = stub_start,
+};
+
+static bool
+watchdog(void *data)
+{
+    sol_quit();
+    return false;
+}
+
+static bool
+quit_when_finished(void *data)
+{
+    if (!sol_platform_linux_micro_boot_is_finished(boot))
+        return true;
+
+    sol_quit();
+    return false;
+}
+
+static void
+boot_setup(void)
+{
+    started[0] = '\0';
+    starting = max_starting = 0;
+    boot = sol_platform_linux_micro_boot_new(&stub_ops, NULL);
+    ASSERT(boot);
+}
+
+DEFINE_TEST(dependency_order);
+
+static void
+dependency_order(void)
+{
+    struct sol_timeout *timeout;
+    char *path;
+
+    boot_setup();
+    ASSERT_INT_EQ(sol_platform_linux_micro_boot_add(boot, "e", true), 0);
+    ASSERT_INT_EQ(sol_platform_linux_micro_boot_add(boot, "c", true), 0);
+    ASSERT_INT_EQ(sol_platform_linux_micro_boot_add(boot, "b", true), 0);
+    ASSERT_INT_EQ(sol_platform_linux_micro_boot_add(boot, "a", true), 0);
+
+    /* a is done right away, b and the pulled in d run together */
+    ASSERT_INT_EQ(sol_platform_linux_micro_boot_run(boot), 0);
+    ASSERT_STR_EQ(started, "adb");
+    ASSERT(!sol_platform_linux_micro_boot_is_finished(boot));
+
+    timeout = sol_timeout_add(5000, watchdog, NULL);
+    sol_run();
+    sol_timeout_del(timeout);
+
+    ASSERT(sol_platform_linux_micro_boot_is_finished(boot));
+    ASSERT_STR_EQ(started, "adbce");
+    ASSERT_INT_EQ(max_starting, 2);
+
+    /* d took the longest, c and e waited for it */
+    path = sol_platform_linux_micro_boot_get_critical_path(boot);
+    ASSERT(path);
+    ASSERT_STR_EQ(path, "d > c > e");
+    free(path);
+
+    sol_platform_linux_micro_boot_del(boot);
+}
+
+DEFINE_TEST(failures);
+
+static void
+failures(void)
+{
+    /* g fails to start, h requires it so it's not even started */
+    boot_setup();
+    ASSERT_INT_EQ(sol_platform_linux_micro_boot_add(boot, "h", false), 0);
+    ASSERT_INT_EQ(sol_platform_linux_micro_boot_run(boot), 0);
+    ASSERT_STR_EQ(started, "g");
+    ASSERT(sol_platform_linux_micro_boot_is_finished(boot));
+    sol_platform_linux_micro_boot_del(boot);
+
+    /* unknown required dependency */
+    boot_setup();
+    ASSERT_INT_EQ(sol_platform_linux_micro_boot_add(boot, "a", true), 0);
+    ASSERT_INT_EQ(sol_platform_linux_micro_boot_add(boot, "f", true), 0);
+    ASSERT_INT_EQ(sol_platform_linux_micro_boot_run(boot), -ENOENT);
+    ASSERT_STR_EQ(started, "a");
+    sol_platform_linux_micro_boot_del(boot);
+
+    /* required service failing to start */
+    boot_setup();
+    ASSERT_INT_EQ(sol_platform_linux_micro_boot_add(boot, "g", true), 0);
+    ASSERT_INT_EQ(sol_platform_linux_micro_boot_run(boot), -EIO);
+    sol_platform_linux_micro_boot_del(boot);
+}
+
+DEFINE_TEST(circular_dependencies);
+
+static void
+circular_dependencies(void)
+{
+    boot_setup();
+    ASSERT_INT_EQ(sol_platform_linux_micro_boot_add(boot, "x", true), 0);
+    ASSERT_INT_EQ(sol_platform_linux_micro_boot_add(boot, "y", true), 0);
+    ASSERT_INT_EQ(sol_platform_linux_micro_boot_add(boot, "a", true), 0);
+
+    ASSERT_INT_EQ(sol_platform_linux_micro_boot_run(boot), -ELOOP);
+    ASSERT_STR_EQ(started, "a");
+    ASSERT(sol_platform_linux_micro_boot_is_finished(boot));
+    sol_platform_linux_micro_boot_del(boot);
+}
+
+DEFINE_TEST(version_1_module);
+
+static void
+version_1_module(void)
+{
+    boot_setup();
+    ASSERT_INT_EQ(sol_platform_linux_micro_boot_add(boot, "v", true), 0);
+    ASSERT_INT_EQ(sol_platform_linux_micro_boot_run(boot), 0);
+    ASSERT(sol_platform_linux_micro_boot_is_finished(boot));
+    ASSERT_STR_EQ(started, "v");
+    sol_platform_linux_micro_boot_del(boot);
+}
+
+DEFINE_TEST(service_not_informing_its_state);
+
+static void
+service_not_informing_its_state(void)
+{
+    struct sol_timeout *timeout;
+    struct timespec begin, end, elapsed;
+    char *path;
+
+    /* n never informs, o waits for it until it's assumed done */
+    boot_setup();
+    sol_platform_linux_micro_boot_set_inform_timeout(boot, 50);
+    ASSERT_INT_EQ(sol_platform_linux_micro_boot_add(boot, "o", true), 0);
+
+    begin = sol_util_timespec_get_current();
+    ASSERT_INT_EQ(sol_platform_linux_micro_boot_run(boot), 0);
+    ASSERT_STR_EQ(started, "n");
+    ASSERT(!sol_platform_linux_micro_boot_is_finished(boot));
+
+    ASSERT(sol_timeout_add(10, quit_when_finished, NULL));
+    timeout = sol_timeout_add(5000, watchdog, NULL);
+    sol_run();
+    sol_timeout_del(timeout);
+    end = sol_util_timespec_get_current();
+
+    ASSERT(sol_platform_linux_micro_boot_is_finished(boot));
+    ASSERT_STR_EQ(started, "no");
+    sol_util_timespec_sub(&end, &begin, &elapsed);
+    ASSERT(sol_util_msec_from_timespec(&elapsed) >= 50);
+
+    path = sol_platform_linux_micro_boot_get_critical_path(boot);
+    ASSERT(path);
+    ASSERT_STR_EQ(path, "n > o");
+    free(path);
+
+    /* informing afterwards changes nothing */
+    sol_platform_linux_micro_boot_inform(boot, "n", SOL_PLATFORM_SERVICE_STATE_FAILED);
+    ASSERT(sol_platform_linux_micro_boot_is_finished(boot));
+
+    sol_platform_linux_micro_boot_del(boot);
+}
+
+TEST_MAIN();
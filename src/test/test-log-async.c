@@ -0,0 +1,145 @@
+/*
+ * This file is part of the Soletta Project
+ *
+ * Copyright (C) 2015 Intel Corporation. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above copyright
+ *     notice, this list of conditions and the following disclaimer in
+ *     the documentation and/or other materials provided with the
+ *     distribution.
+ *   * Neither the name of Intel Corporation nor the names of its
+ *     contributors may be used to endorse or promote products derived
+ *     from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ * OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+#include <pthread.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "sol-log.h"
+#include "sol-mainloop.h"
+#include "sol-util.h"
+
+#include "test.h"
+
+/* Threads may run one after the other and reuse the same ring while
+ * the writer is starved, so all messages together must fit in a ring
+ * (~90 bytes each) or the overflow path drops some. */
+#define THREADS 4
+#define MESSAGES 120
+
+static void *
+thr_run(void *data)
+{
+    int id = (intptr_t)data;
+    int i;
+
+    for (i = 0; i < MESSAGES; i++)
+        SOL_WRN("async thread=%d msg=%d", id, i);
+
+    return NULL;
+}
+
+static void
+check_threads(FILE *fp)
+{
+    int next[THREADS] = { 0 };
+    char line[4096];
+    int i;
+
+    rewind(fp);
+    while (fgets(line, sizeof(line), fp)) {
+        const char *p = strstr(line, "async thread=");
+        int id, msg, r;
+
+        if (!p)
+            continue;
+        r = sscanf(p, "async thread=%d msg=%d", &id, &msg);
+        ASSERT_INT_EQ(r, 2);
+        ASSERT(id >= 0 && id < THREADS);
+        /* messages from a single thread keep their order */
+        ASSERT_INT_EQ(msg, next[id]);
+        next[id]++;
+    }
+
+    for (i = 0; i < THREADS; i++)
+        ASSERT_INT_EQ(next[i], MESSAGES);
+}
+
+static void
+check_sync_order(FILE *fp)
+{
+    const char *expected[] = { "order=first", "order=long", "order=last" };
+    char line[8192];
+    unsigned int n = 0;
+
+    rewind(fp);
+    while (fgets(line, sizeof(line), fp)) {
+        if (!strstr(line, "order="))
+            continue;
+        ASSERT(n < ARRAY_SIZE(expected));
+        ASSERT(strstr(line, expected[n]));
+        n++;
+    }
+    ASSERT_INT_EQ(n, ARRAY_SIZE(expected));
+}
+
+int
+main(int argc, char *argv[])
+{
+    pthread_t thr[THREADS];
+    char long_msg[4096];
+    FILE *fp;
+    int i;
+
+    setenv("SOL_LOG_ASYNC", "1", 1);
+    ASSERT(sol_init() == 0);
+
+    fp = tmpfile();
+    ASSERT(fp);
+    sol_log_set_print_function(sol_log_print_function_file, fp);
+
+    for (i = 0; i < THREADS; i++)
+        ASSERT_INT_EQ(pthread_create(&thr[i], NULL, thr_run,
+            (void *)(intptr_t)i), 0);
+    for (i = 0; i < THREADS; i++)
+        pthread_join(thr[i], NULL);
+
+    /* longer than the per-thread line buffer: goes synchronous after
+     * flushing what was queued before it */
+    memset(long_msg, 'x', sizeof(long_msg) - 1);
+    long_msg[sizeof(long_msg) - 1] = '\0';
+    SOL_WRN("order=first");
+    SOL_WRN("order=long %s", long_msg);
+    SOL_WRN("order=last");
+
+    sol_shutdown();
+
+    check_threads(fp);
+    check_sync_order(fp);
+    fclose(fp);
+
+    return 0;
+}
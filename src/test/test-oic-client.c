@@ -0,0 +1,310 @@
+/*
+ * This file is part of the Soletta Project
+ *
+ * Copyright (C) 2015 Intel Corporation. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above copyright
+ *     notice, this list of conditions and the following disclaimer in
+ *     the documentation and/or other materials provided with the
+ *     distribution.
+ *   * Neither the name of Intel Corporation nor the names of its
+ *     contributors may be used to endorse or promote products derived
+ *     from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ * OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <arpa/inet.h>
+#include <netinet/in.h>
+
+#include "sol-coap.h"
+#include "sol-mainloop.h"
+#include "sol-oic-client.h"
+#include "sol-oic-server.h"
+#include "sol-util.h"
+
+#include "test.h"
+
+#define TEST_PORT 56833
+/* A bit longer than the request cache TTL in sol-oic-client.c */
+#define REQUEST_EXPIRED_MS 1100
+
+static struct sol_oic_client client = {
+    .api_version = SOL_OIC_CLIENT_API_VERSION
+};
+static struct sol_network_link_addr server_addr = {
+    .family = AF_INET,
+    .port = TEST_PORT
+};
+static struct sol_oic_resource *resource;
+static struct sol_timeout *tick_timeout;
+static struct timespec step_start;
+static unsigned int step, found, responses, put_replies, server_gets;
+static bool done;
+
+static sol_coap_responsecode_t
+handle_get(const struct sol_network_link_addr *cliaddr, const void *data,
+    uint8_t *payload, uint16_t *payload_len)
+{
+    static const char response[] = "{\"state\":true}";
+
+    server_gets++;
+
+    if (sizeof(response) - 1 > *payload_len)
+        return SOL_COAP_RSPCODE_INTERNAL_ERROR;
+
+    memcpy(payload, response, sizeof(response) - 1);
+    *payload_len = sizeof(response) - 1;
+    return SOL_COAP_RSPCODE_CONTENT;
+}
+
+/* Echoes the new state back, so the client knows when it's done */
+static sol_coap_responsecode_t
+handle_put(const struct sol_network_link_addr *cliaddr, const void *data,
+    uint8_t *payload, uint16_t *payload_len)
+{
+    return SOL_COAP_RSPCODE_CONTENT;
+}
+
+static void
+setup_server(void)
+{
+    static const struct sol_oic_resource_type resource_type = {
+        .api_version = SOL_OIC_RESOURCE_TYPE_API_VERSION,
+        .endpoint = SOL_STR_SLICE_LITERAL("/a/test"),
+        .resource_type = SOL_STR_SLICE_LITERAL("core.test"),
+        .iface = SOL_STR_SLICE_LITERAL("oc.mi.def"),
+        .get = { .handle = handle_get },
+        .put = { .handle = handle_put }
+    };
+    struct sol_oic_device_definition *def;
+
+    ASSERT(sol_oic_server_init(TEST_PORT));
+
+    def = sol_oic_server_register_definition(
+        (struct sol_str_slice)SOL_STR_SLICE_LITERAL("/t"),
+        (struct sol_str_slice)SOL_STR_SLICE_LITERAL("oic.test"),
+        SOL_COAP_FLAGS_OC_CORE | SOL_COAP_FLAGS_WELL_KNOWN);
+    ASSERT(def);
+    ASSERT(sol_oic_device_definition_register_resource_type(def,
+        &resource_type, NULL, SOL_COAP_FLAGS_OC_CORE));
+}
+
+static void
+found_resource(struct sol_oic_client *cli, struct sol_oic_resource *res, void *data)
+{
+    ASSERT(cli == &client);
+
+    found++;
+    if (!resource)
+        resource = sol_oic_resource_ref(res);
+}
+
+static void
+got_response(struct sol_oic_client *cli, const struct sol_network_link_addr *addr,
+    const struct sol_str_slice *href, const struct sol_str_slice *payload, void *data)
+{
+    ASSERT(cli == &client);
+    ASSERT(sol_str_slice_str_eq(*href, "/a/test"));
+    ASSERT(sol_str_slice_str_eq(*payload, "{\"state\":true}"));
+
+    responses++;
+}
+
+static void
+put_done(struct sol_oic_client *cli, const struct sol_network_link_addr *addr,
+    const struct sol_str_slice *href, const struct sol_str_slice *payload, void *data)
+{
+    ASSERT(cli == &client);
+    ASSERT(sol_str_slice_str_eq(*payload, "{\"state\":false}"));
+
+    put_replies++;
+}
+
+static bool
+find(void)
+{
+    return sol_oic_client_find_resource(&client, &server_addr, "core.test",
+        found_resource, NULL);
+}
+
+static bool
+get(void)
+{
+    return sol_oic_client_resource_request(&client, resource,
+        SOL_COAP_METHOD_GET, NULL, 0, got_response, NULL);
+}
+
+static bool
+elapsed(int msec)
+{
+    struct timespec now = sol_util_timespec_get_current();
+    struct timespec diff;
+
+    sol_util_timespec_sub(&now, &step_start, &diff);
+    return sol_util_msec_from_timespec(&diff) >= msec;
+}
+
+static void
+next_step(void)
+{
+    step++;
+    step_start = sol_util_timespec_get_current();
+}
+
+/* Each step waits for the replies of the previous one, then checks
+ * how many of the requests actually reached the server. */
+static bool
+on_tick(void *data)
+{
+    static uint8_t put_payload[] = "{\"state\":false}";
+
+    switch (step) {
+    case 0:
+        /* identical discoveries share a single request */
+        ASSERT(find());
+        ASSERT(find());
+        next_step();
+        break;
+    case 1:
+        if (found < 2)
+            break;
+        ASSERT_INT_EQ(found, 2);
+        ASSERT(resource);
+
+        /* cache hit, still delivered after the call returns */
+        ASSERT(find());
+        ASSERT_INT_EQ(found, 2);
+        next_step();
+        break;
+    case 2:
+        if (found < 3)
+            break;
+        ASSERT(get());
+        ASSERT(get());
+        next_step();
+        break;
+    case 3:
+        if (responses < 2)
+            break;
+        ASSERT_INT_EQ(server_gets, 1);
+
+        ASSERT(get());
+        ASSERT_INT_EQ(responses, 2);
+        next_step();
+        break;
+    case 4:
+        if (responses < 3)
+            break;
+        ASSERT_INT_EQ(server_gets, 1);
+
+        /* anything but a GET invalidates the cached reply */
+        ASSERT(sol_oic_client_resource_request(&client, resource,
+            SOL_COAP_METHOD_PUT, put_payload, sizeof(put_payload) - 1,
+            put_done, NULL));
+        next_step();
+        break;
+    case 5:
+        if (put_replies < 1)
+            break;
+        ASSERT(get());
+        next_step();
+        break;
+    case 6:
+        if (responses < 4)
+            break;
+        ASSERT_INT_EQ(server_gets, 2);
+        next_step();
+        break;
+    case 7:
+        if (!elapsed(REQUEST_EXPIRED_MS))
+            break;
+        /* the cached reply expired */
+        ASSERT(get());
+        next_step();
+        break;
+    case 8:
+        if (responses < 5)
+            break;
+        ASSERT_INT_EQ(server_gets, 3);
+
+        /* releasing the client's server drops its cached deliveries
+         * and its requests in flight */
+        ASSERT(find());
+        ASSERT(sol_oic_client_resource_request(&client, resource,
+            SOL_COAP_METHOD_PUT, put_payload, sizeof(put_payload) - 1,
+            NULL, NULL));
+        ASSERT(get());
+        sol_coap_server_unref(client.server);
+        client.server = sol_coap_server_new(0);
+        ASSERT(client.server);
+        next_step();
+        break;
+    case 9:
+        if (!elapsed(100))
+            break;
+        ASSERT_INT_EQ(found, 3);
+        ASSERT_INT_EQ(responses, 5);
+
+        /* the request that went away doesn't hold back new ones */
+        ASSERT(get());
+        next_step();
+        break;
+    case 10:
+        if (responses < 6)
+            break;
+        done = true;
+        sol_quit();
+        tick_timeout = NULL;
+        return false;
+    }
+
+    if (elapsed(5000)) {
+        fprintf(stderr, "Timed out at step %u\n", step);
+        FAIL();
+    }
+
+    return true;
+}
+
+DEFINE_TEST(test_oic_client_cache);
+
+static void
+test_oic_client_cache(void)
+{
+    ASSERT_INT_EQ(inet_pton(AF_INET, "127.0.0.1", &server_addr.addr), 1);
+
+    setup_server();
+    client.server = sol_coap_server_new(0);
+    ASSERT(client.server);
+
+    step_start = sol_util_timespec_get_current();
+    tick_timeout = sol_timeout_add(10, on_tick, NULL);
+    ASSERT(tick_timeout);
+
+    sol_run();
+    ASSERT(done);
+
+    sol_oic_resource_unref(resource);
+    sol_coap_server_unref(client.server);
+    sol_oic_server_release();
+}
+
+
+TEST_MAIN();
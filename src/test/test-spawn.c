@@ -0,0 +1,178 @@
+/*
+ * This file is part of the Soletta Project
+ *
+ * Copyright (C) 2015 Intel Corporation. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above copyright
+ *     notice, this list of conditions and the following disclaimer in
+ *     the documentation and/or other materials provided with the
+ *     distribution.
+ *   * Neither the name of Intel Corporation nor the names of its
+ *     contributors may be used to endorse or promote products derived
+ *     from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ * OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <errno.h>
+#include <fcntl.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <unistd.h>
+
+#include "sol-mainloop.h"
+#include "sol-platform-linux.h"
+
+#include "test.h"
+
+#define SPAWN_COUNT 200
+#define SPAWN_TOGETHER_COUNT 20
+
+static int exited;
+static int last_status;
+
+static bool
+watchdog(void *data)
+{
+    sol_quit();
+    return false;
+}
+
+static void
+on_exit_quit(void *data, uint64_t pid, int status)
+{
+    exited++;
+    last_status = status;
+    sol_quit();
+}
+
+static void
+run_loop(void)
+{
+    struct sol_timeout *timeout = sol_timeout_add(10000, watchdog, NULL);
+
+    sol_run();
+    sol_timeout_del(timeout);
+}
+
+DEFINE_TEST(spawn_status);
+
+static void
+spawn_status(void)
+{
+    const char *argv[] = { "sh", "-c", "exit 3", NULL };
+
+    exited = 0;
+    ASSERT(sol_platform_linux_spawn(argv, NULL, on_exit_quit, NULL));
+    run_loop();
+
+    ASSERT_INT_EQ(exited, 1);
+    ASSERT_INT_EQ(last_status, 3);
+}
+
+DEFINE_TEST(spawn_stdout);
+
+static void
+spawn_stdout(void)
+{
+    const char *argv[] = { "echo", "hello", NULL };
+    int pfds[2], fds[3] = { -1, -1, -1 };
+    char buf[16] = { };
+
+    ASSERT_INT_EQ(pipe2(pfds, O_CLOEXEC), 0);
+    fds[1] = pfds[1];
+
+    exited = 0;
+    ASSERT(sol_platform_linux_spawn(argv, fds, on_exit_quit, NULL));
+    close(pfds[1]);
+    run_loop();
+
+    ASSERT_INT_EQ(exited, 1);
+    ASSERT_INT_EQ(last_status, 0);
+    ASSERT_INT_EQ(read(pfds[0], buf, sizeof(buf) - 1), 6);
+    ASSERT_STR_EQ(buf, "hello\n");
+    close(pfds[0]);
+}
+
+DEFINE_TEST(spawn_not_found);
+
+static void
+spawn_not_found(void)
+{
+    const char *argv[] = { "/nonexistent/program", NULL };
+
+    ASSERT(!sol_platform_linux_spawn(argv, NULL, on_exit_quit, NULL));
+    ASSERT_INT_EQ(errno, ENOENT);
+}
+
+static void
+on_exit_respawn(void *data, uint64_t pid, int status)
+{
+    static const char *argv[] = { "true", NULL };
+
+    if (++exited == SPAWN_COUNT) {
+        sol_quit();
+        return;
+    }
+
+    if (!sol_platform_linux_spawn(argv, NULL, on_exit_respawn, NULL))
+        sol_quit();
+}
+
+DEFINE_TEST(spawn_many);
+
+static void
+spawn_many(void)
+{
+    const char *argv[] = { "true", NULL };
+
+    /* children exiting right away must not be missed by the main
+     * loop, or it would sleep until the watchdog */
+    exited = 0;
+    ASSERT(sol_platform_linux_spawn(argv, NULL, on_exit_respawn, NULL));
+    run_loop();
+
+    ASSERT_INT_EQ(exited, SPAWN_COUNT);
+}
+
+static void
+on_exit_count(void *data, uint64_t pid, int status)
+{
+    if (++exited == SPAWN_TOGETHER_COUNT)
+        sol_quit();
+}
+
+DEFINE_TEST(spawn_together);
+
+static void
+spawn_together(void)
+{
+    const char *argv[] = { "true", NULL };
+    int i;
+
+    /* their SIGCHLD may be coalesced, all exits must be reported */
+    exited = 0;
+    for (i = 0; i < SPAWN_TOGETHER_COUNT; i++)
+        ASSERT(sol_platform_linux_spawn(argv, NULL, on_exit_count, NULL));
+    run_loop();
+
+    ASSERT_INT_EQ(exited, SPAWN_TOGETHER_COUNT);
+}
+
+TEST_MAIN();
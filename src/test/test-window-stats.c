@@ -0,0 +1,229 @@
+/*
+ * This file is part of the Soletta Project
+ *
+ * Copyright (C) 2015 Intel Corporation. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above copyright
+ *     notice, this list of conditions and the following disclaimer in
+ *     the documentation and/or other materials provided with the
+ *     distribution.
+ *   * Neither the name of Intel Corporation nor the names of its
+ *     contributors may be used to endorse or promote products derived
+ *     from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ * OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <errno.h>
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "sol-util.h"
+#include "sol-window-stats.h"
+
+#include "test.h"
+
+static bool
+double_eq(double a, double b)
+{
+    return fabs(a - b) <= 1e-6 * (1 + fabs(b));
+}
+
+#define ASSERT_DOUBLE_EQ(a, b) ASSERT(double_eq(a, b))
+
+static int
+double_cmp(const void *data1, const void *data2)
+{
+    const double *d1 = data1;
+    const double *d2 = data2;
+
+    return (*d1 > *d2) - (*d1 < *d2);
+}
+
+/* Checks the engine against a plain recomputation of the window */
+static void
+check_window(const struct sol_window_stats *ws, const double *window, uint32_t len)
+{
+    double sorted[64];
+    double sum = 0, mean, variance = 0;
+    uint32_t i;
+
+    ASSERT_INT_EQ(sol_window_stats_count(ws), len);
+
+    for (i = 0; i < len; i++)
+        sum += window[i];
+    mean = sum / len;
+    for (i = 0; i < len; i++)
+        variance += (window[i] - mean) * (window[i] - mean);
+    variance /= len;
+
+    memcpy(sorted, window, len * sizeof(*sorted));
+    qsort(sorted, len, sizeof(*sorted), double_cmp);
+
+    ASSERT_DOUBLE_EQ(sol_window_stats_sum(ws), sum);
+    ASSERT_DOUBLE_EQ(sol_window_stats_mean(ws), mean);
+    ASSERT_DOUBLE_EQ(sol_window_stats_variance(ws), variance);
+    ASSERT_DOUBLE_EQ(sol_window_stats_stddev(ws), sqrt(variance));
+    ASSERT_DOUBLE_EQ(sol_window_stats_min(ws), sorted[0]);
+    ASSERT_DOUBLE_EQ(sol_window_stats_max(ws), sorted[len - 1]);
+
+    for (i = 0; i < len; i++)
+        ASSERT_DOUBLE_EQ(sol_window_stats_nth(ws, i), sorted[i]);
+
+    if (len % 2)
+        ASSERT_DOUBLE_EQ(sol_window_stats_median(ws), sorted[len / 2]);
+    else
+        ASSERT_DOUBLE_EQ(sol_window_stats_median(ws),
+            (sorted[len / 2 - 1] + sorted[len / 2]) / 2);
+
+    ASSERT_DOUBLE_EQ(sol_window_stats_percentile(ws, 0), sorted[0]);
+    ASSERT_DOUBLE_EQ(sol_window_stats_percentile(ws, 100), sorted[len - 1]);
+}
+
+DEFINE_TEST(test_sliding_window);
+
+static void
+test_sliding_window(void)
+{
+    static const uint32_t capacities[] = { 1, 2, 3, 7, 16, 64 };
+    double window[64];
+    unsigned int c, i;
+
+    srand(42);
+
+    for (c = 0; c < ARRAY_SIZE(capacities); c++) {
+        struct sol_window_stats ws;
+        uint32_t cap = capacities[c];
+        uint32_t len = 0;
+
+        ASSERT_INT_EQ(sol_window_stats_init(&ws, cap, 0.5), 0);
+
+        for (i = 0; i < 500; i++) {
+            /* small range, so there are plenty of repeated values */
+            double value = (rand() % 21) - 10;
+
+            sol_window_stats_add(&ws, value);
+            if (len == cap) {
+                memmove(window, window + 1, (len - 1) * sizeof(*window));
+                len--;
+            }
+            window[len++] = value;
+
+            ASSERT_INT_EQ(sol_window_stats_is_full(&ws), len == cap);
+            check_window(&ws, window, len);
+        }
+
+        sol_window_stats_fini(&ws);
+    }
+}
+
+DEFINE_TEST(test_tumbling_window);
+
+static void
+test_tumbling_window(void)
+{
+    struct sol_window_stats ws;
+    static const double samples[] = { 3.5, -1, 8, 8, 0.25 };
+    double window[ARRAY_SIZE(samples)];
+    unsigned int round, i;
+
+    ASSERT_INT_EQ(sol_window_stats_init(&ws, ARRAY_SIZE(samples), 0.5), 0);
+
+    for (round = 0; round < 3; round++) {
+        for (i = 0; i < ARRAY_SIZE(samples); i++) {
+            window[i] = samples[i] * (round + 1);
+            sol_window_stats_add(&ws, window[i]);
+            check_window(&ws, window, i + 1);
+        }
+        sol_window_stats_reset(&ws);
+        ASSERT_INT_EQ(sol_window_stats_count(&ws), 0);
+    }
+
+    sol_window_stats_fini(&ws);
+}
+
+DEFINE_TEST(test_percentile);
+
+static void
+test_percentile(void)
+{
+    struct sol_window_stats ws;
+    unsigned int i;
+
+    ASSERT_INT_EQ(sol_window_stats_init(&ws, 5, 0.5), 0);
+
+    /* 10 20 30 40 50 in shuffled order */
+    sol_window_stats_add(&ws, 40);
+    sol_window_stats_add(&ws, 10);
+    sol_window_stats_add(&ws, 50);
+    sol_window_stats_add(&ws, 30);
+    sol_window_stats_add(&ws, 20);
+
+    ASSERT_DOUBLE_EQ(sol_window_stats_percentile(&ws, 25), 20);
+    ASSERT_DOUBLE_EQ(sol_window_stats_percentile(&ws, 50), 30);
+    ASSERT_DOUBLE_EQ(sol_window_stats_percentile(&ws, 90), 46);
+    ASSERT_DOUBLE_EQ(sol_window_stats_percentile(&ws, -10), 10);
+    ASSERT_DOUBLE_EQ(sol_window_stats_percentile(&ws, 200), 50);
+
+    /* a window full of the same value */
+    for (i = 0; i < 5; i++)
+        sol_window_stats_add(&ws, 7);
+    ASSERT_DOUBLE_EQ(sol_window_stats_percentile(&ws, 33), 7);
+    ASSERT_DOUBLE_EQ(sol_window_stats_variance(&ws), 0);
+
+    sol_window_stats_fini(&ws);
+}
+
+DEFINE_TEST(test_ewma);
+
+static void
+test_ewma(void)
+{
+    struct sol_window_stats ws;
+
+    ASSERT_INT_EQ(sol_window_stats_init(&ws, 2, 0.25), 0);
+
+    sol_window_stats_add(&ws, 8);
+    ASSERT_DOUBLE_EQ(sol_window_stats_ewma(&ws), 8);
+    sol_window_stats_add(&ws, 0);
+    ASSERT_DOUBLE_EQ(sol_window_stats_ewma(&ws), 6);
+    /* evicting samples from the window does not affect it */
+    sol_window_stats_add(&ws, 2);
+    ASSERT_DOUBLE_EQ(sol_window_stats_ewma(&ws), 5);
+
+    sol_window_stats_reset(&ws);
+    sol_window_stats_add(&ws, 1);
+    ASSERT_DOUBLE_EQ(sol_window_stats_ewma(&ws), 1);
+
+    sol_window_stats_fini(&ws);
+}
+
+DEFINE_TEST(test_invalid_capacity);
+
+static void
+test_invalid_capacity(void)
+{
+    struct sol_window_stats ws;
+
+    ASSERT_INT_EQ(sol_window_stats_init(&ws, 0, 0.5), -EINVAL);
+}
+
+
+TEST_MAIN();